@@ -18,6 +18,8 @@ sereExpr : boolExpr                                 # sereBoolExpr
                   ',' err=sereExpr ')'              # sereAbort
           | PERMUTE '(' (elements += sereExpr)
                     (',' elements += sereExpr)* ')' # serePermute
+          | WITHIN '(' arg=sereExpr
+                   ',' limit=NUM ')'                # sereWithin
           | COMPLEMENT arg=sereExpr                 # sereComplement
           | arg=sereExpr KLEENESTAR                 # sereKleeneStar
           | arg=sereExpr KLEENEPLUS                 # sereKleenePlus
@@ -45,6 +47,7 @@ COMPLEMENT : '~' ;
 ABORT : 'ABORT' ;
 PARTIAL : 'PARTIAL' ;
 PERMUTE : 'PERMUTE' ;
+WITHIN : 'WITHIN' ;
 INTERSECTION : '&' ;
 UNION : '|' ;
 FUSION : ':' ;
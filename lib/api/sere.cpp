@@ -6,14 +6,30 @@
 #include "nfasl/BisimNfasl.hpp"
 #include "nfasl/Dfasl.hpp"
 #include "nfasl/Dot.hpp"
+#include "rt/RtClock.hpp"
 #include "rt/RtDfasl.hpp"
+#include "rt/RtDfaslTable.hpp"
+#include "rt/RtImage.hpp"
+#include "rt/RtKeyed.hpp"
+#include "rt/RtLazyDfasl.hpp"
+#include "rt/RtMatcher.hpp"
 #include "rt/RtNfasl.hpp"
+#include "rt/RtNfaslBits.hpp"
+#include "rt/RtRetention.hpp"
+#include "rt/RtReverse.hpp"
+#include "rt/RtScheduler.hpp"
+#include "rt/RtSet.hpp"
+#include "rt/Snapshot.hpp"
 #include "boolean/Expr.hpp"
 #include "Match.hpp"
 
 #include <nlohmann/json.hpp>
 
 #include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
 #include <vector>
 
 using json = nlohmann::json;
@@ -34,19 +50,74 @@ struct sere_context {
   std::shared_ptr<sere_object> object;
   rt::ExecutorPtr context;
   rt::Names vars;
+  std::vector<uint8_t> snapshot;
 };
 
 struct sere_context_extended {
   std::shared_ptr<sere_object> object;
   rt::ExtendedExecutorPtr context;
   rt::Names vars;
+  std::vector<uint8_t> snapshot;
+  rt::SnapshotKind kind = rt::Snapshot_ExtendedExecutor; /** executors differ in state */
+  rt::EventRetention retention;
+  bool retain = false;
+  uint64_t offset = 0;   /** offset of the next event in the stream */
+  uint64_t payload = 0;  /** payload of the next event, see `hasPayload` */
+  bool hasPayload = false;
+  std::vector<uint64_t> offsets; /** payloads of a batch without payloads */
+
+  void clearRetention() {
+    retention.clear();
+    hasPayload = false;
+  }
+
+  void retainNext() {
+    if (retain) {
+      retention.append(hasPayload ? payload : offset, context->getResult());
+    }
+    hasPayload = false;
+    ++offset;
+  }
+};
+
+struct sere_keyed {
+  std::shared_ptr<sere_object> object;
+  rt::KeyedExecutorPtr context;
+  rt::Names vars;
+  std::vector<uint8_t> snapshot;
+};
+
+struct sere_scheduler {
+  std::shared_ptr<sere_object> object;
+  std::unique_ptr<rt::StreamScheduler> context;
+};
+
+struct sere_set {
+  std::vector<std::shared_ptr<sere_object>> objects;
+  std::map<std::string, size_t> atomicIds;
+  std::vector<std::string> atomics;
+  rt::SereSet context;
+  rt::Names vars;
+};
+
+struct sere_matcher {
+  std::vector<std::shared_ptr<sere_object>> objects;
+  std::map<std::string, size_t> atomicIds;
+  std::vector<std::string> atomics;
+  std::unique_ptr<rt::Matcher> context;
+  rt::Names vars;
 };
 
 class sere_object {
 public:
-  static std::shared_ptr<sere_object> load(const char* data);
+  static std::shared_ptr<sere_object> load(const char* data, size_t size);
+  /** Image kept by the caller, see `sere_context_load_image` */
+  static std::shared_ptr<sere_object> load(rt::Image::Storage image, size_t size);
+  /** Object of a checked image, see `ImageCache` */
+  static std::shared_ptr<sere_object> load(std::shared_ptr<const rt::Image> image);
 
   const std::vector<std::string>& getAtomics() const { return atomics; }
+  uint64_t getFingerprint() const { return fingerprint; }
   void setAtomics(const std::map<std::string, size_t>& vars) {
     atomics.resize(vars.size());
     for (auto v : vars) {
@@ -54,26 +125,71 @@ public:
     }
   }
 
-  virtual rt::ExecutorPtr createExecutor() const = 0;
+  /** Time window of a match, zero if none (see `rt::RtClock`) */
+  rt::Timestamp getWindow() const { return window; }
+  void setWindow(rt::Timestamp window_) { window = window_; }
+
+  /** Anchored executor, it fails once the time window is over */
+  rt::ExecutorPtr createExecutor() const {
+    rt::ExecutorPtr executor = createUntimedExecutor();
+    if (executor && window != 0) {
+      return std::make_shared<rt::TimedContext>(executor, window);
+    }
+    return executor;
+  }
+  virtual rt::ExecutorPtr createUntimedExecutor() const = 0;
   virtual rt::ExtendedExecutorPtr createExtendedExecutor() const = 0;
+  /** Extended executor with a reverse pass, see `rt::NfaslReverseContext` */
+  virtual rt::ExtendedExecutorPtr createReverseExecutor() const {
+    return createExtendedExecutor();
+  }
+  virtual rt::KeyedExecutorPtr createKeyedExecutor() const = 0;
+  virtual rt::SereSet::RuleId addTo(rt::SereSet& set,
+                                    const rt::SereSet::AtomicMap& atomics) const = 0;
+  /** NFASL has counting states, it can not be added to a set (see `rt::Counter`) */
+  virtual bool counting() const { return false; }
   virtual int toDot(const std::string& file) const = 0;
   virtual void load(const json& j) = 0;
   virtual void save(json& j) const = 0;
+  virtual void save(std::vector<uint8_t>& image) const = 0;
   virtual ~sere_object() {}
 protected:
   std::vector<std::string>& getAtomicsRef() { return atomics; }
 private:
   std::vector<std::string> atomics;
+  uint64_t fingerprint = 0; /** identifies the image, see `rt::SnapshotHeader` */
+  rt::Timestamp window = 0;
 };
 
 class sere_nfasl : public sere_object {
 public:
-  rt::ExecutorPtr createExecutor() const override {
+  rt::ExecutorPtr createUntimedExecutor() const override {
+    // small automata are evaluated by bit-parallel executor
+    rt::ExecutorPtr executor = rt::createNfaslBitsContext(*rt);
+    if (executor) {
+      return executor;
+    }
     return std::make_shared<rt::NfaslContext>(rt);
   }
   rt::ExtendedExecutorPtr createExtendedExecutor() const override {
     return std::make_shared<rt::NfaslExtendedContext>(rt);
   }
+  rt::ExtendedExecutorPtr createReverseExecutor() const override {
+    rt::ExtendedExecutorPtr executor = rt::createNfaslReverseContext(rt, getReversed());
+    if (executor) {
+      return executor;
+    }
+    return createExtendedExecutor();
+  }
+  rt::KeyedExecutorPtr createKeyedExecutor() const override {
+    // only small automata, state is kept inline
+    return rt::createKeyedExecutor(*rt);
+  }
+  rt::SereSet::RuleId addTo(rt::SereSet& set,
+                            const rt::SereSet::AtomicMap& atomics) const override {
+    return set.add(*rt, atomics);
+  }
+  bool counting() const override { return !nfa.counters.empty(); }
   int toDot(const std::string& file) const override {
     nfasl::toDot(nfa, file);
     return 0;
@@ -82,30 +198,102 @@ public:
     from_json(j, nfa);
     rt = std::make_shared<rt::Nfasl>();
     nfasl::toRt(nfa, *rt);
+    rt->window = getWindow();
   }
   void save(json& j) const override {
     j = json {
               { "kind", "nfasl" },
               { "atomics", getAtomics() },
               { "fasl", nfa } };
+    if (getWindow() != 0) {
+      j["within"] = getWindow();
+    }
+  }
+  void save(std::vector<uint8_t>& image) const override {
+    rt::Nfasl u;
+    nfasl::toRt(nfa, u);
+    u.window = getWindow();
+    rt::writeImage(u, getAtomics(), image);
   }
   void setNfasl(const nfasl::Nfasl& nfa_) { nfa = nfa_; }
   const nfasl::Nfasl& getNfasl() const { return nfa; }
 
-private:
+protected:
   std::shared_ptr<rt::Nfasl> rt;
   nfasl::Nfasl nfa;
+
+private:
+  /** Reverse automaton, built on first use and shared by executors */
+  std::shared_ptr<rt::Nfasl> getReversed() const {
+    std::call_once(reversedBuilt, [this]() {
+      if (rt->counters.empty()) {
+        reversed = rt::reverse(*rt);
+      }
+    });
+    return reversed;
+  }
+
+  mutable std::once_flag reversedBuilt;
+  mutable std::shared_ptr<rt::Nfasl> reversed;
+};
+
+class sere_lazy : public sere_nfasl {
+public:
+  sere_lazy(size_t cacheSize_) : cacheSize(cacheSize_) {}
+
+  rt::ExecutorPtr createUntimedExecutor() const override {
+    rt::ExecutorPtr executor = rt::createLazyDfaslContext(rt, cacheSize);
+    if (executor) {
+      return executor;
+    }
+    return sere_nfasl::createUntimedExecutor();
+  }
+  void save(json& j) const override {
+    j = json {
+              { "kind", "lazy" },
+              { "atomics", getAtomics() },
+              { "cacheSize", cacheSize },
+              { "fasl", nfa } };
+    if (getWindow() != 0) {
+      j["within"] = getWindow();
+    }
+  }
+  void save(std::vector<uint8_t>& image) const override {
+    rt::Nfasl u;
+    nfasl::toRt(nfa, u);
+    u.window = getWindow();
+    rt::writeImage(u, getAtomics(), image, rt::Image_LazyDfasl, cacheSize);
+  }
+
+private:
+  size_t cacheSize;
 };
 
 class sere_dfasl : public sere_object {
 public:
-  rt::ExecutorPtr createExecutor() const override {
+  rt::ExecutorPtr createUntimedExecutor() const override {
+    if (auto table = getTable()) {
+      return std::make_shared<rt::DfaslTableContext>(table);
+    }
     return std::make_shared<rt::DfaslContext>(rt);
   }
   rt::ExtendedExecutorPtr createExtendedExecutor() const override {
-    // not implemented
+    if (auto table = getTable()) {
+      return std::make_shared<rt::DfaslTableExtendedContext>(table);
+    }
+    return std::make_shared<rt::DfaslExtendedContext>(rt);
+  }
+  rt::KeyedExecutorPtr createKeyedExecutor() const override {
+    // only table form, state is a single id
+    if (auto table = getTable()) {
+      return rt::createKeyedExecutor(table);
+    }
     return nullptr;
   }
+  rt::SereSet::RuleId addTo(rt::SereSet& set,
+                            const rt::SereSet::AtomicMap& atomics) const override {
+    return set.add(*rt, atomics);
+  }
   int toDot(const std::string& file) const override {
     // not implemented
     assert(false);
@@ -115,24 +303,288 @@ public:
     from_json(j, dfa);
     rt = std::make_shared<rt::Dfasl>();
     dfasl::toRt(dfa, *rt);
+    rt->window = getWindow();
   }
   void save(json& j) const override {
     j = json {
               { "kind", "dfasl" },
               { "atomics", getAtomics() },
               { "fasl", dfa } };
+    if (getWindow() != 0) {
+      j["within"] = getWindow();
+    }
+  }
+  void save(std::vector<uint8_t>& image) const override {
+    rt::Dfasl u;
+    dfasl::toRt(dfa, u);
+    u.window = getWindow();
+    rt::DfaslTable t;
+    bool dense = rt::toTable(u, t);
+    rt::writeImage(u, dense ? &t : nullptr, getAtomics(), image);
   }
   void setDfasl(const dfasl::Dfasl& dfa_) { dfa = dfa_; }
   const dfasl::Dfasl& getDfasl() const { return dfa; }
 private:
+  /** Table form, built on first use: objects only added to sets do not need it */
+  std::shared_ptr<rt::DfaslTable> getTable() const {
+    std::call_once(tableBuilt, [this]() {
+      // fall back to rule interpretation if the table is too large
+      auto t = std::make_shared<rt::DfaslTable>();
+      if (rt::toTable(*rt, *t)) {
+        table = t;
+      }
+    });
+    return table;
+  }
+
   std::shared_ptr<rt::Dfasl> rt;
+  mutable std::once_flag tableBuilt;
+  mutable std::shared_ptr<rt::DfaslTable> table;
   dfasl::Dfasl dfa;
 };
 
-std::shared_ptr<sere_object> sere_object::load(const char* data) {
+/**
+ * Binary image (`SERE_FORMAT_RT`)
+ *
+ * Plain executors run on the image itself, other executors
+ * need runtime structures, which are built on first use.
+ * They refer to predicate code and the transition table
+ * of the image, so only rules are copied.
+ */
+class sere_image : public sere_object {
+public:
+  sere_image(std::shared_ptr<const rt::Image> image_) : image(image_) {}
+
+  rt::ExecutorPtr createUntimedExecutor() const override {
+    switch (image->kind()) {
+    case rt::Image_Dfasl:
+      return std::make_shared<rt::ImageDfaslContext>(image);
+    case rt::Image_LazyDfasl: {
+      rt::ExecutorPtr executor = rt::createLazyDfaslContext(getNfasl(), image->cacheSize());
+      if (executor) {
+        return executor;
+      }
+      break;
+    }
+    case rt::Image_Nfasl:
+      break;
+    }
+    // counters are run only by rule interpretation
+    if (image->counting()) {
+      return std::make_shared<rt::NfaslContext>(getNfasl());
+    }
+    // small automata are evaluated by bit-parallel executor
+    if (image->stateCount() <= rt::maxNfaslBitsStates) {
+      rt::ExecutorPtr executor = rt::createNfaslBitsContext(*getNfasl());
+      if (executor) {
+        return executor;
+      }
+    }
+    return std::make_shared<rt::ImageNfaslContext>(image);
+  }
+  rt::ExtendedExecutorPtr createExtendedExecutor() const override {
+    if (image->kind() != rt::Image_Dfasl) {
+      return std::make_shared<rt::NfaslExtendedContext>(getNfasl());
+    }
+    if (image->hasTable()) {
+      return std::make_shared<rt::DfaslTableExtendedContext>(getTable());
+    }
+    return std::make_shared<rt::DfaslExtendedContext>(getDfasl());
+  }
+  rt::ExtendedExecutorPtr createReverseExecutor() const override {
+    if (image->kind() != rt::Image_Dfasl) {
+      rt::ExtendedExecutorPtr executor = rt::createNfaslReverseContext(getNfasl(), getReversed());
+      if (executor) {
+        return executor;
+      }
+    }
+    return createExtendedExecutor();
+  }
+  rt::KeyedExecutorPtr createKeyedExecutor() const override {
+    if (image->kind() != rt::Image_Dfasl) {
+      return rt::createKeyedExecutor(*getNfasl());
+    }
+    if (image->hasTable()) {
+      return rt::createKeyedExecutor(getTable());
+    }
+    return nullptr;
+  }
+  rt::SereSet::RuleId addTo(rt::SereSet& set,
+                            const rt::SereSet::AtomicMap& atomics) const override {
+    if (image->kind() != rt::Image_Dfasl) {
+      return set.add(*getNfasl(), atomics);
+    }
+    return set.add(*getDfasl(), atomics);
+  }
+  bool counting() const override { return image->counting(); }
+  int toDot(const std::string& /*file*/) const override {
+    // not available, an image has no source automaton
+    return -1;
+  }
+  void load(const json& /*j*/) override {
+    // images are not JSON
+    assert(false);
+  }
+  void save(json& /*j*/) const override {
+    // images are not JSON
+    assert(false);
+  }
+  void save(std::vector<uint8_t>& /*data*/) const override {
+    // not used, images are only loaded
+    assert(false);
+  }
+
+private:
+  std::shared_ptr<rt::Nfasl> getNfasl() const {
+    std::call_once(built, [this]() { build(); });
+    return nfasl;
+  }
+  std::shared_ptr<rt::Dfasl> getDfasl() const {
+    std::call_once(built, [this]() { build(); });
+    return dfasl;
+  }
+  std::shared_ptr<rt::DfaslTable> getTable() const {
+    std::call_once(built, [this]() { build(); });
+    return table;
+  }
+  std::shared_ptr<rt::Nfasl> getReversed() const {
+    std::call_once(reversedBuilt, [this]() {
+      if (!image->counting()) {
+        reversed = rt::reverse(*getNfasl());
+      }
+    });
+    return reversed;
+  }
+  void build() const {
+    if (image->kind() == rt::Image_Dfasl) {
+      dfasl = rt::toDfasl(image);
+      table = rt::toDfaslTable(image);
+    } else {
+      nfasl = rt::toNfasl(image);
+    }
+  }
+
+  std::shared_ptr<const rt::Image> image;
+  mutable std::once_flag built;
+  mutable std::shared_ptr<rt::Nfasl> nfasl;
+  mutable std::shared_ptr<rt::Dfasl> dfasl;
+  mutable std::shared_ptr<rt::DfaslTable> table;
+  mutable std::once_flag reversedBuilt;
+  mutable std::shared_ptr<rt::Nfasl> reversed;
+};
+
+/**
+ * Images in use
+ *
+ * Contexts loaded from the same image share its `sere_object`,
+ * so the image is checked and its runtime automata are built once.
+ * Objects are kept while they are in use only.
+ *
+ * An object of an image loaded in place refers to memory of the caller,
+ * which is valid only while contexts of that load are alive. So it is
+ * shared only by loads of the same address, while a copied image may
+ * be shared by any load.
+ */
+class ImageCache {
+public:
+  /**
+   * @param[in] data image (possibly unaligned)
+   * @param[in] size image size
+   * @param[in] storage makes storage of the image, if it is not loaded
+   * @param[in] inPlace `storage` is `data` of the caller, not a copy
+   */
+  template <typename Storage>
+  std::shared_ptr<sere_object> get(const void* data, size_t size, Storage storage, bool inPlace) {
+    Key copied{ 0, size, nullptr };
+    if (size >= sizeof(rt::ImageHeader)) {
+      rt::ImageHeader header;
+      memcpy(&header, data, sizeof(header));
+      std::get<0>(copied) = header.checksum;
+    }
+    Key key = copied;
+    if (inPlace) {
+      std::get<2>(key) = data;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::shared_ptr<sere_object> obj = find(copied, data);
+      if (!obj && inPlace) {
+        obj = find(key, data);
+      }
+      if (obj) {
+        return obj;
+      }
+    }
+    // checked out of the lock, a concurrent load of the same image is dropped
+    auto image = std::make_shared<const rt::Image>(storage(), size);
+    std::shared_ptr<sere_object> obj = sere_object::load(image);
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<sere_object> loaded = find(key, data);
+    if (loaded) {
+      return loaded;
+    }
+    for (auto it = images.begin(); it != images.end(); ) {
+      it = it->second.object.expired() ? images.erase(it) : std::next(it);
+    }
+    images[key] = { obj, image };
+    return obj;
+  }
+
+private:
+  /** checksum, size and address of an image loaded in place (nullptr if copied) */
+  typedef std::tuple<uint64_t, size_t, const void*> Key;
+
+  struct Entry {
+    std::weak_ptr<sere_object> object;
+    std::weak_ptr<const rt::Image> image;
+  };
+
+  std::shared_ptr<sere_object> find(const Key& key, const void* data) {
+    auto it = images.find(key);
+    if (it == images.end()) {
+      return nullptr;
+    }
+    std::shared_ptr<sere_object> obj = it->second.object.lock();
+    std::shared_ptr<const rt::Image> image = it->second.image.lock();
+    if (!obj || !image) {
+      return nullptr;
+    }
+    // equal checksums are not enough, the image could be corrupted
+    if (image->data() != data && memcmp(image->data(), data, std::get<1>(key)) != 0) {
+      return nullptr;
+    }
+    return obj;
+  }
+
+  std::mutex mutex;
+  std::map<Key, Entry> images;
+};
+
+static ImageCache imageCache;
+
+std::shared_ptr<sere_object> sere_object::load(std::shared_ptr<const rt::Image> image) {
+  std::shared_ptr<sere_object> obj = std::make_shared<sere_image>(image);
+  for (size_t ix = 0; ix < image->atomicCount(); ++ix) {
+    obj->atomics.push_back(image->atomicName(ix));
+  }
+  obj->fingerprint = image->checksum();
+  obj->window = image->window();
+  return obj;
+}
+
+std::shared_ptr<sere_object> sere_object::load(rt::Image::Storage data, size_t size) {
+  return imageCache.get(data.get(), size, [data]() { return data; }, true);
+}
+
+std::shared_ptr<sere_object> sere_object::load(const char* data, size_t size) {
   std::string kind;
   std::shared_ptr<sere_object> obj;
 
+  if (rt::Image::probe(data, size)) {
+    return imageCache.get(data, size, [data, size]() { return rt::Image::copy(data, size); },
+                          false);
+  }
+
   json j = json::parse(data);
 
   j.at("kind").get_to(kind);
@@ -141,10 +593,15 @@ std::shared_ptr<sere_object> sere_object::load(const char* data) {
     obj = std::make_shared<sere_nfasl>();
   } else if (kind == "dfasl") {
     obj = std::make_shared<sere_dfasl>();
+  } else if (kind == "lazy") {
+    obj = std::make_shared<sere_lazy>(j.value("cacheSize", rt::defaultLazyCacheSize));
   } else {
     assert(false); // TODO: report an error
   }
   j.at("atomics").get_to(obj->getAtomicsRef());
+  obj->fingerprint = rt::fingerprint(reinterpret_cast<const uint8_t*>(data), strlen(data));
+  // runtime automata are built with the window
+  obj->window = j.value("within", rt::Timestamp(0));
   obj->load(j.at("fasl"));
 
   return obj;
@@ -179,29 +636,57 @@ int sere_compile(const char* expr,
     Ptr<SereExpr> expr = r.expr;
     const std::map<std::string, size_t>& vars = r.vars;
 
-    nfasl::Nfasl nfa = sereToNfasl(*expr);
+    // only NFASL is run with counters, other targets are determinized
+    nfasl::Nfasl nfa = sereToNfasl(*expr, opts->target == SERE_TARGET_NFASL);
     nfasl::Nfasl min;
     nfasl::minimize(nfa, min);
+    if (opts->unanchored && r.within) {
+      // the window bounds a match, not the stream before it
+      throw std::invalid_argument("WITHIN of unanchored SERE");
+    }
 
     result->compiled = 1;
 
-    if (opts->target == SERE_TARGET_DFASL) {
+    dfasl::Dfasl dfa;
+    bool determinized = false;
+    if (opts->target == SERE_TARGET_DFASL && opts->unanchored) {
+      determinized = dfasl::toSearchDfasl(min, dfa, opts->maxDfaslStates);
+    } else if (opts->target == SERE_TARGET_DFASL) {
+      dfasl::toDfasl(min, dfa);
+      determinized = true;
+    }
+    if (opts->unanchored && !determinized) {
+      min = nfasl::search(min);
+    }
+
+    if (determinized) {
       auto ptr = std::make_shared<sere_dfasl>();
       result->ref->object = ptr;
-      dfasl::Dfasl dfa;
-      dfasl::toDfasl(min, dfa);
       ptr->setDfasl(dfa);
     } else if (opts->target == SERE_TARGET_NFASL) {
       auto ptr = std::make_shared<sere_nfasl>();
       result->ref->object = ptr;
       ptr->setNfasl(min);
+    } else if (opts->target == SERE_TARGET_LAZY_DFASL || opts->target == SERE_TARGET_DFASL) {
+      // DFASL of unanchored SERE is too large, it is built as it runs
+      size_t cacheSize = opts->maxCacheSize ? opts->maxCacheSize : rt::defaultLazyCacheSize;
+      auto ptr = std::make_shared<sere_lazy>(cacheSize);
+      result->ref->object = ptr;
+      ptr->setNfasl(min);
     } else {
       assert(false); // TODO: error reporting
     }
     result->ref->object->setAtomics(vars);
-    json j;
-    result->ref->object->save(j);
-    result->ref->content = j.dump(4);
+    result->ref->object->setWindow(r.within);
+    if (opts->format == SERE_FORMAT_RT) {
+      std::vector<uint8_t> image;
+      result->ref->object->save(image);
+      result->ref->content.assign(image.begin(), image.end());
+    } else {
+      json j;
+      result->ref->object->save(j);
+      result->ref->content = j.dump(4);
+    }
     result->content = result->ref->content.c_str();
     result->content_size = result->ref->content.size();
     return 0;
@@ -214,28 +699,43 @@ int sere_compile(const char* expr,
   }
 }
 
-template <typename Ctx, typename Factory>
-int temp_context_load(Factory factory,
-                      const char* rt, /** serialized *FASL */
-                      size_t, /** serialized *FASL size */
-                      void** sere /** loaded SERE */
-                      ) {
+template <typename Ctx, typename Factory, typename Load>
+int temp_context_create(Factory factory,
+                        Load load, /** loads SERE object */
+                        void** sere /** loaded SERE */
+                        ) {
   Ctx* ctx = nullptr;
   try {
     ctx = new Ctx;
-    ctx->object = sere_object::load(rt);
+    ctx->object = load();
     ctx->context = factory(ctx->object);
+    if (!ctx->context) {
+      delete ctx;
+      return -1;
+    }
     ctx->vars.resize(ctx->object->getAtomics().size());
     *sere = reinterpret_cast<void*>(ctx);
     return 0;
-  } catch(rt::LoadingFailed& ex) {
-    throw;
+  } catch(rt::LoadingFailed&) {
+    // corrupted image
+    delete ctx;
+    return -1;
   } catch(std::exception&) {
     delete ctx;
     return -1;
   }
 }
 
+template <typename Ctx, typename Factory>
+int temp_context_load(Factory factory,
+                      const char* rt, /** serialized *FASL */
+                      size_t sz, /** serialized *FASL size */
+                      void** sere /** loaded SERE */
+                      ) {
+  return temp_context_create<Ctx>
+    (factory, [rt, sz]() { return sere_object::load(rt, sz); }, sere);
+}
+
 int sere_context_load(const char* rt, /** serialized *FASL */
                       size_t sz, /** serialized *FASL size */
                       void** sere /** loaded SERE */
@@ -245,6 +745,15 @@ int sere_context_load(const char* rt, /** serialized *FASL */
      rt, sz, sere);
 }
 
+int sere_context_load_image(const void* image, size_t image_size, void** sere) {
+  // the image is owned by the caller
+  rt::Image::Storage storage(reinterpret_cast<const uint8_t*>(image), [](const uint8_t*) {});
+  return temp_context_create<sere_context>
+    ([](auto obj) { return obj->createExecutor(); },
+     [storage, image_size]() { return sere_object::load(storage, image_size); },
+     sere);
+}
+
 int sere_context_extended_load(const char* rt, /** serialized *FASL */
                                size_t sz, /** serialized *FASL size */
                                void** sere /** loaded SERE */
@@ -254,7 +763,38 @@ int sere_context_extended_load(const char* rt, /** serialized *FASL */
      rt, sz, sere);
 }
 
+int sere_context_extended_load_reverse(const char* rt, /** serialized *FASL */
+                                       size_t sz, /** serialized *FASL size */
+                                       void** sere /** loaded SERE */
+                                       ) {
+  int r = temp_context_load<sere_context_extended>
+    ([](auto obj) { return obj->createReverseExecutor(); },
+     rt, sz, sere);
+  if (r == 0) {
+    auto ctx = reinterpret_cast<sere_context_extended*>(*sere);
+    // DFASL and counting NFASL fall back to the plain extended executor
+    if (dynamic_cast<rt::NfaslReverseContext*>(ctx->context.get())) {
+      ctx->kind = rt::Snapshot_ReverseExecutor;
+    }
+  }
+  return r;
+}
+
 
+int sere_keyed_load(const char* rt, /** serialized *FASL */
+                    size_t sz, /** serialized *FASL size */
+                    void** sere /** loaded keyed SERE */
+                    ) {
+  return temp_context_load<sere_keyed>
+    ([](auto obj) -> rt::KeyedExecutorPtr {
+      // events have no time
+      if (obj->getWindow() != 0) {
+        return nullptr;
+      }
+      return obj->createKeyedExecutor();
+    },
+     rt, sz, sere);
+}
 
 template <typename Ctx>
 int temp_context_to_dot(void* ctx, const char* file) {
@@ -282,6 +822,10 @@ void sere_context_extended_atomic_count(void* ctx, size_t* count) {
   temp_context_atomic_count<sere_context_extended>(ctx, count);
 }
 
+void sere_keyed_atomic_count(void* ctx, size_t* count) {
+  temp_context_atomic_count<sere_keyed>(ctx, count);
+}
+
 template <typename Ctx>
 int temp_context_atomic_name(void* ctx, size_t id, const char** name) {
   auto ref = reinterpret_cast<Ctx*>(ctx);
@@ -300,6 +844,10 @@ int sere_context_extended_atomic_name(void* ctx, size_t id, const char** name) {
   return temp_context_atomic_name<sere_context_extended>(ctx, id, name);
 }
 
+int sere_keyed_atomic_name(void* ctx, size_t id, const char** name) {
+  return temp_context_atomic_name<sere_keyed>(ctx, id, name);
+}
+
 template <typename Ctx>
 void temp_context_release(void* ctx) {
   delete reinterpret_cast<Ctx*>(ctx);
@@ -313,6 +861,10 @@ void sere_context_extended_release(void* ctx) {
   temp_context_release<sere_context_extended>(ctx);
 }
 
+void sere_keyed_release(void* ctx) {
+  temp_context_release<sere_keyed>(ctx);
+}
+
 template <typename Ctx>
 void temp_context_reset(void* ctx) {
   auto ref = reinterpret_cast<Ctx*>(ctx);
@@ -326,6 +878,9 @@ void sere_context_reset(void* ctx) {
 
 void sere_context_extended_reset(void* ctx) {
   temp_context_reset<sere_context_extended>(ctx);
+  auto ref = reinterpret_cast<sere_context_extended*>(ctx);
+  ref->clearRetention();
+  ref->offset = 0;
 }
 
 template <typename Ctx>
@@ -346,6 +901,10 @@ int sere_context_extended_set_atomic(void* ctx, size_t atomic) {
   return temp_context_set_atomic<sere_context_extended>(ctx, atomic);
 }
 
+int sere_keyed_set_atomic(void* ctx, size_t atomic) {
+  return temp_context_set_atomic<sere_keyed>(ctx, atomic);
+}
+
 template <typename Ctx>
 void temp_context_advance(void* ctx) {
   auto ref = reinterpret_cast<Ctx*>(ctx);
@@ -359,6 +918,87 @@ void sere_context_advance(void* ctx) {
 
 void sere_context_extended_advance(void* ctx) {
   temp_context_advance<sere_context_extended>(ctx);
+  reinterpret_cast<sere_context_extended*>(ctx)->retainNext();
+}
+
+template <typename Ctx>
+void temp_context_advance_at(void* ctx, uint64_t time) {
+  auto ref = reinterpret_cast<Ctx*>(ctx);
+  ref->context->advanceAt(ref->vars, time);
+  ref->vars.reset();
+}
+
+void sere_context_advance_at(void* ctx, uint64_t time) {
+  temp_context_advance_at<sere_context>(ctx, time);
+}
+
+void sere_context_extended_advance_at(void* ctx, uint64_t time) {
+  temp_context_advance_at<sere_context_extended>(ctx, time);
+  reinterpret_cast<sere_context_extended*>(ctx)->retainNext();
+}
+
+template <typename Ctx, typename Result>
+int temp_context_advance_batch(void* ctx,
+                               const uint8_t* events,
+                               size_t stride,
+                               size_t count,
+                               Result* results) {
+  auto ref = reinterpret_cast<Ctx*>(ctx);
+  if (stride * 8 < ref->vars.size()) {
+    return -1;
+  }
+  ref->vars.reset();
+  ref->context->advanceBatch({ events, stride, count, ref->vars.size() }, results);
+  return 0;
+}
+
+int sere_context_advance_batch(void* ctx,
+                               const uint8_t* events,
+                               size_t stride,
+                               size_t count,
+                               Match* results) {
+  return temp_context_advance_batch<sere_context>
+    (ctx, events, stride, count, results);
+}
+
+int sere_context_extended_advance_batch(void* ctx,
+                                        const uint8_t* events,
+                                        size_t stride,
+                                        size_t count,
+                                        ExtendedMatch* results) {
+  return sere_context_extended_advance_batch_payloads
+    (ctx, events, stride, count, nullptr, results);
+}
+
+int sere_context_extended_advance_batch_payloads(void* ctx,
+                                                 const uint8_t* events,
+                                                 size_t stride,
+                                                 size_t count,
+                                                 const uint64_t* payloads,
+                                                 ExtendedMatch* results) {
+  int r = temp_context_advance_batch<sere_context_extended>
+    (ctx, events, stride, count, results);
+  if (r != 0) {
+    return r;
+  }
+  auto ref = reinterpret_cast<sere_context_extended*>(ctx);
+  if (ref->retain) {
+    // only the events within the horizon are retained
+    const ExtendedMatch& last = ref->context->getResult();
+    size_t fresh = std::min(count, rt::EventRetention::retained(last));
+    if (payloads) {
+      ref->retention.append(payloads + count - fresh, fresh, last);
+    } else {
+      ref->offsets.resize(fresh);
+      for (size_t ix = 0; ix < fresh; ++ix) {
+        ref->offsets[ix] = ref->offset + count - fresh + ix;
+      }
+      ref->retention.append(ref->offsets.data(), fresh, last);
+    }
+  }
+  ref->hasPayload = false;
+  ref->offset += count;
+  return 0;
 }
 
 void sere_context_get_result(void* ctx, int* result) {
@@ -368,3 +1008,427 @@ void sere_context_get_result(void* ctx, int* result) {
 void sere_context_extended_get_result(void* ctx, ExtendedMatch* result) {
   *result = reinterpret_cast<sere_context_extended*>(ctx)->context->getResult();
 }
+
+void sere_context_extended_retain(void* ctx, int enable) {
+  auto ref = reinterpret_cast<sere_context_extended*>(ctx);
+  ref->retain = enable != 0;
+  ref->clearRetention();
+}
+
+void sere_context_extended_set_payload(void* ctx, uint64_t payload) {
+  auto ref = reinterpret_cast<sere_context_extended*>(ctx);
+  ref->payload = payload;
+  ref->hasPayload = true;
+}
+
+void sere_context_extended_retained(void* ctx, const uint64_t** payloads, size_t* count) {
+  auto ref = reinterpret_cast<sere_context_extended*>(ctx);
+  *payloads = ref->retention.data();
+  *count = ref->retention.size();
+}
+
+int sere_context_extended_match_payloads(void* ctx,
+                                         int longest,
+                                         const uint64_t** payloads,
+                                         size_t* count) {
+  auto ref = reinterpret_cast<sere_context_extended*>(ctx);
+  return ref->retention.match(ref->context->getResult(), longest != 0, *payloads, *count) ? 0 : -1;
+}
+
+void sere_keyed_advance(void* ctx, uint64_t key, int* result) {
+  auto ref = reinterpret_cast<sere_keyed*>(ctx);
+  *result = ref->context->advance(key, ref->vars);
+  ref->vars.reset();
+}
+
+void sere_keyed_get_result(void* ctx, uint64_t key, int* result) {
+  *result = reinterpret_cast<sere_keyed*>(ctx)->context->getResult(key);
+}
+
+int sere_keyed_erase(void* ctx, uint64_t key) {
+  return reinterpret_cast<sere_keyed*>(ctx)->context->erase(key) ? 0 : -1;
+}
+
+void sere_keyed_clear(void* ctx) {
+  reinterpret_cast<sere_keyed*>(ctx)->context->clear();
+}
+
+void sere_keyed_reserve(void* ctx, size_t count) {
+  reinterpret_cast<sere_keyed*>(ctx)->context->reserve(count);
+}
+
+void sere_keyed_count(void* ctx, size_t* count) {
+  *count = reinterpret_cast<sere_keyed*>(ctx)->context->size();
+}
+
+void sere_keyed_for_each(void* ctx,
+                         void (*visitor)(void* arg, uint64_t key, int result),
+                         void* arg) {
+  reinterpret_cast<sere_keyed*>(ctx)->context->forEach
+    ([visitor, arg](rt::MonitorKey key, Match result) {
+      visitor(arg, key, result);
+    });
+}
+
+void sere_keyed_set_expiry(void* ctx, uint64_t timeout, int drop_initial) {
+  reinterpret_cast<sere_keyed*>(ctx)->context->setExpiry(timeout, drop_initial != 0);
+}
+
+size_t sere_keyed_tick(void* ctx,
+                       uint64_t now,
+                       void (*visitor)(void* arg, uint64_t key, int result),
+                       void* arg) {
+  rt::KeyedExecutor::Visitor expired;
+  if (visitor) {
+    expired = [visitor, arg](rt::MonitorKey key, Match result) {
+      visitor(arg, key, result);
+    };
+  }
+  return reinterpret_cast<sere_keyed*>(ctx)->context->tick(now, expired);
+}
+
+template <typename Ctx>
+void temp_context_snapshot(void* ctx,
+                           rt::SnapshotKind kind,
+                           const char** data,
+                           size_t* size) {
+  auto ref = reinterpret_cast<Ctx*>(ctx);
+  ref->snapshot.clear();
+  rt::SnapshotWriter writer(ref->snapshot);
+  writer.writeValue(rt::SnapshotHeader{ rt::snapshotMagic,
+                                        rt::snapshotVersion,
+                                        kind,
+                                        ref->object->getFingerprint() });
+  ref->context->save(writer);
+  *data = reinterpret_cast<const char*>(ref->snapshot.data());
+  *size = ref->snapshot.size();
+}
+
+template <typename Ctx>
+int temp_context_restore(void* ctx,
+                         rt::SnapshotKind kind,
+                         const char* data,
+                         size_t size) {
+  auto ref = reinterpret_cast<Ctx*>(ctx);
+  try {
+    rt::SnapshotReader reader(reinterpret_cast<const uint8_t*>(data), size);
+    rt::SnapshotHeader hdr;
+    reader.readValue(hdr);
+    if (hdr.magic != rt::snapshotMagic ||
+        hdr.version != rt::snapshotVersion ||
+        hdr.kind != kind ||
+        hdr.fingerprint != ref->object->getFingerprint()) {
+      return -1;
+    }
+    ref->context->restore(reader);
+    ref->vars.reset();
+    return 0;
+  } catch(rt::RestoreFailed&) {
+    return -1;
+  }
+}
+
+void sere_context_snapshot(void* ctx, const char** data, size_t* size) {
+  temp_context_snapshot<sere_context>(ctx, rt::Snapshot_Executor, data, size);
+}
+
+int sere_context_restore(void* ctx, const char* data, size_t size) {
+  return temp_context_restore<sere_context>(ctx, rt::Snapshot_Executor, data, size);
+}
+
+void sere_context_extended_snapshot(void* ctx, const char** data, size_t* size) {
+  temp_context_snapshot<sere_context_extended>
+    (ctx, reinterpret_cast<sere_context_extended*>(ctx)->kind, data, size);
+}
+
+int sere_context_extended_restore(void* ctx, const char* data, size_t size) {
+  int r = temp_context_restore<sere_context_extended>
+    (ctx, reinterpret_cast<sere_context_extended*>(ctx)->kind, data, size);
+  if (r == 0) {
+    // retained events are not a part of the snapshot
+    reinterpret_cast<sere_context_extended*>(ctx)->clearRetention();
+  }
+  return r;
+}
+
+void sere_keyed_snapshot(void* ctx, const char** data, size_t* size) {
+  temp_context_snapshot<sere_keyed>(ctx, rt::Snapshot_Keyed, data, size);
+}
+
+int sere_keyed_restore(void* ctx, const char* data, size_t size) {
+  return temp_context_restore<sere_keyed>(ctx, rt::Snapshot_Keyed, data, size);
+}
+
+int sere_scheduler_load(const char* rt,
+                        size_t sz,
+                        size_t threads,
+                        void (*visitor)(void* arg, uint64_t stream, int result),
+                        void* arg,
+                        void** sere) {
+  auto ref = std::make_unique<sere_scheduler>();
+  try {
+    ref->object = sere_object::load(rt, sz);
+  } catch(rt::LoadingFailed&) {
+    // corrupted image
+    return -1;
+  } catch(std::exception&) {
+    return -1;
+  }
+  // events have no time
+  if (ref->object->getWindow() != 0) {
+    return -1;
+  }
+
+  rt::StreamScheduler::Visitor results;
+  if (visitor) {
+    results = [visitor, arg](rt::StreamId stream, Match result) {
+      visitor(arg, stream, result);
+    };
+  }
+  auto object = ref->object;
+  ref->context = std::make_unique<rt::StreamScheduler>
+    ([object]() { return object->createExecutor(); },
+     object->getAtomics().size(), results, threads);
+  *sere = reinterpret_cast<void*>(ref.release());
+  return 0;
+}
+
+void sere_scheduler_release(void* sere) {
+  delete reinterpret_cast<sere_scheduler*>(sere);
+}
+
+void sere_scheduler_atomic_count(void* sere, size_t* count) {
+  temp_context_atomic_count<sere_scheduler>(sere, count);
+}
+
+int sere_scheduler_atomic_name(void* sere, size_t id, const char** name) {
+  auto ref = reinterpret_cast<sere_scheduler*>(sere);
+  if (id < ref->object->getAtomics().size()) {
+    *name = ref->object->getAtomics()[id].c_str();
+    return 0;
+  }
+  return -1;
+}
+
+int sere_scheduler_post(void* sere, uint64_t stream, const uint8_t* event, size_t stride) {
+  auto ref = reinterpret_cast<sere_scheduler*>(sere);
+  size_t atomics = ref->object->getAtomics().size();
+  if (stride * 8 < atomics) {
+    return -1;
+  }
+  if (stride >= ref->context->stride()) {
+    ref->context->post(stream, event);
+    return 0;
+  }
+  // no atomics, but the scheduler expects a byte
+  ref->context->post(stream, rt::Names(atomics));
+  return 0;
+}
+
+void sere_scheduler_wait(void* sere) {
+  reinterpret_cast<sere_scheduler*>(sere)->context->wait();
+}
+
+void sere_scheduler_get_result(void* sere, uint64_t stream, int* result) {
+  *result = reinterpret_cast<sere_scheduler*>(sere)->context->getResult(stream);
+}
+
+void sere_set_create(void** set) {
+  *set = reinterpret_cast<void*>(new sere_set);
+}
+
+void sere_set_release(void* set) {
+  delete reinterpret_cast<sere_set*>(set);
+}
+
+int sere_set_add(void* set,
+                 const char* rt, /** serialized *FASL */
+                 size_t sz, /** serialized *FASL size */
+                 size_t* rule) {
+  auto ref = reinterpret_cast<sere_set*>(set);
+  std::shared_ptr<sere_object> object;
+  try {
+    object = sere_object::load(rt, sz);
+  } catch(rt::LoadingFailed&) {
+    // corrupted image
+    return -1;
+  } catch(std::exception&) {
+    return -1;
+  }
+
+  // events have no time
+  if (object->counting() || object->getWindow() != 0) {
+    return -1;
+  }
+
+  rt::SereSet::AtomicMap atomics;
+  for (auto const& name : object->getAtomics()) {
+    auto r = ref->atomicIds.insert({ name, ref->atomics.size() });
+    if (r.second) {
+      ref->atomics.push_back(name);
+    }
+    atomics.push_back(r.first->second);
+  }
+  ref->vars.resize(ref->atomics.size());
+  *rule = object->addTo(ref->context, atomics);
+  ref->objects.push_back(object);
+  return 0;
+}
+
+void sere_set_rule_count(void* set, size_t* count) {
+  *count = reinterpret_cast<sere_set*>(set)->context.size();
+}
+
+void sere_set_atomic_count(void* set, size_t* count) {
+  *count = reinterpret_cast<sere_set*>(set)->atomics.size();
+}
+
+int sere_set_atomic_name(void* set, size_t id, const char** name) {
+  auto ref = reinterpret_cast<sere_set*>(set);
+  if (id < ref->atomics.size()) {
+    *name = ref->atomics[id].c_str();
+    return 0;
+  }
+  return -1;
+}
+
+void sere_set_reset(void* set) {
+  auto ref = reinterpret_cast<sere_set*>(set);
+  ref->context.reset();
+  ref->vars.reset();
+}
+
+int sere_set_set_atomic(void* set, size_t atomic) {
+  auto ref = reinterpret_cast<sere_set*>(set);
+  if (atomic < ref->vars.size()) {
+    ref->vars.set(atomic);
+    return 0;
+  }
+  return -1;
+}
+
+void sere_set_advance(void* set) {
+  auto ref = reinterpret_cast<sere_set*>(set);
+  ref->context.advance(ref->vars);
+  ref->vars.reset();
+}
+
+int sere_set_get_result(void* set, size_t rule, int* result) {
+  auto ref = reinterpret_cast<sere_set*>(set);
+  if (rule < ref->context.size()) {
+    *result = ref->context.getResult(rule);
+    return 0;
+  }
+  return -1;
+}
+
+void sere_set_get_changed(void* set, const size_t** rules, size_t* count) {
+  auto const& changed = reinterpret_cast<sere_set*>(set)->context.getChanged();
+  *rules = changed.data();
+  *count = changed.size();
+}
+
+int sere_matcher_create(int mode,
+                        void (*callback)(void* arg, size_t rule, uint64_t start, uint64_t end),
+                        void* arg,
+                        void** matcher) {
+  if (mode < SERE_MATCH_ALL || mode > SERE_MATCH_NON_OVERLAPPING || !callback) {
+    return -1;
+  }
+  auto ref = new sere_matcher;
+  ref->context = std::make_unique<rt::Matcher>
+    (rt::MatchMode(mode),
+     [callback, arg](size_t rule, uint64_t start, uint64_t end) {
+       callback(arg, rule, start, end);
+     });
+  *matcher = reinterpret_cast<void*>(ref);
+  return 0;
+}
+
+void sere_matcher_release(void* matcher) {
+  delete reinterpret_cast<sere_matcher*>(matcher);
+}
+
+int sere_matcher_add(void* matcher,
+                     const char* rt, /** serialized *FASL */
+                     size_t sz, /** serialized *FASL size */
+                     size_t* rule) {
+  auto ref = reinterpret_cast<sere_matcher*>(matcher);
+  std::shared_ptr<sere_object> object;
+  try {
+    object = sere_object::load(rt, sz);
+  } catch(rt::LoadingFailed&) {
+    // corrupted image
+    return -1;
+  } catch(std::exception&) {
+    return -1;
+  }
+  // events have no time
+  if (object->getWindow() != 0) {
+    return -1;
+  }
+
+  rt::Matcher::AtomicMap atomics;
+  for (auto const& name : object->getAtomics()) {
+    auto r = ref->atomicIds.insert({ name, ref->atomics.size() });
+    if (r.second) {
+      ref->atomics.push_back(name);
+    }
+    atomics.push_back(r.first->second);
+  }
+  ref->vars.resize(ref->atomics.size());
+  *rule = ref->context->add([object]() { return object->createExtendedExecutor(); }, atomics);
+  ref->objects.push_back(object);
+  return 0;
+}
+
+void sere_matcher_atomic_count(void* matcher, size_t* count) {
+  *count = reinterpret_cast<sere_matcher*>(matcher)->atomics.size();
+}
+
+int sere_matcher_atomic_name(void* matcher, size_t id, const char** name) {
+  auto ref = reinterpret_cast<sere_matcher*>(matcher);
+  if (id < ref->atomics.size()) {
+    *name = ref->atomics[id].c_str();
+    return 0;
+  }
+  return -1;
+}
+
+void sere_matcher_reset(void* matcher) {
+  auto ref = reinterpret_cast<sere_matcher*>(matcher);
+  ref->context->reset();
+  ref->vars.reset();
+}
+
+int sere_matcher_set_atomic(void* matcher, size_t atomic) {
+  auto ref = reinterpret_cast<sere_matcher*>(matcher);
+  if (atomic < ref->vars.size()) {
+    ref->vars.set(atomic);
+    return 0;
+  }
+  return -1;
+}
+
+void sere_matcher_advance(void* matcher) {
+  auto ref = reinterpret_cast<sere_matcher*>(matcher);
+  ref->context->advance(ref->vars);
+  ref->vars.reset();
+}
+
+int sere_matcher_advance_batch(void* matcher,
+                               const uint8_t* events,
+                               size_t stride,
+                               size_t count) {
+  auto ref = reinterpret_cast<sere_matcher*>(matcher);
+  if (stride * 8 < ref->vars.size()) {
+    return -1;
+  }
+  ref->vars.reset();
+  ref->context->advanceBatch({ events, stride, count, ref->vars.size() });
+  return 0;
+}
+
+void sere_matcher_flush(void* matcher) {
+  reinterpret_cast<sere_matcher*>(matcher)->context->flush();
+}
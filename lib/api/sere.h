@@ -14,6 +14,11 @@
 
 #define SERE_TARGET_NFASL 0 /** NFASL target */
 #define SERE_TARGET_DFASL 1 /** DFASL target */
+#define SERE_TARGET_LAZY_DFASL 2 /** NFASL target determinized at runtime */
+
+#define SERE_MATCH_ALL 0 /** every end of a match, with the leftmost start */
+#define SERE_MATCH_LEFTMOST_LONGEST 1 /** the leftmost start, then the longest end */
+#define SERE_MATCH_NON_OVERLAPPING 2 /** the earliest end, the next match starts after it */
 
 struct sere_ref;
 struct sere_context;
@@ -22,10 +27,12 @@ struct sere_context;
  * Options to control resource consumption
  */
 struct sere_options {
-  int target; /** target automata (SERE_TARGET_NFASL or SERE_TARGET_DFASL) */
-  int format; /** target format, only SERE_FORMAT_JSON supported */
+  int target; /** target automata (SERE_TARGET_NFASL, SERE_TARGET_DFASL or SERE_TARGET_LAZY_DFASL) */
+  int format; /** target format (SERE_FORMAT_JSON or SERE_FORMAT_RT) */
   size_t maxNfaslStates; /** abort if number of NFASL states exceeds the limit */
   size_t maxDfaslStates; /** abort if number of DFASL states exceeds the limit */
+  size_t maxCacheSize; /** memory limit (bytes) of SERE_TARGET_LAZY_DFASL cache, zero for default */
+  int unanchored; /** non-zero to match `true[*] ; expr`, see `sere_compile` */
 };
 
 /**
@@ -52,6 +59,20 @@ extern "C" {
 /**
  * Compile SERE expression
  *
+ * For `SERE_TARGET_NFASL`, a long bounded repetition of a boolean
+ * (`a{m,n}` with `n`, or `m` if unbounded, at least 16) takes a state
+ * with a counter instead of a copy of `a` per repetition. Such NFASL
+ * is not accepted by keyed contexts and sets.
+ *
+ * With `unanchored`, a match may start at any event: a context reports
+ * MATCH_OK after every event which ends a match of `expr`, as if it
+ * were `true[*] ; expr`. For `SERE_TARGET_DFASL` such an automaton is
+ * determinized directly and never fails; if it takes more than
+ * `maxDfaslStates` (when non-zero) states, `SERE_TARGET_LAZY_DFASL`
+ * is emitted instead. Extended contexts find their own starts, so
+ * the option is for `sere_context_*` only, and it is not combined
+ * with WITHIN.
+ *
  * @param[in] expr NUL terminated SERE expression
  * @param[in] opts options to control compilation
  * @param[out] result compilation results
@@ -81,6 +102,21 @@ int sere_context_load(const char* rt, /** serialized *FASL */
                       void** sere /** loaded SERE */
                       );
 
+/**
+ * Load binary SERE image (SERE_FORMAT_RT) in place
+ *
+ * Unlike `sere_context_load`, the image is not copied: the context
+ * runs directly on it, so the image may be a mapped file. The image
+ * must be aligned to 8 bytes and stay unchanged until the context
+ * is released.
+ *
+ * @param[in] image SERE image
+ * @param[in] image_size SERE image size
+ * @param[out] sere loaded SERE
+ * @returns non-zero in case of errors (including a corrupted image)
+ */
+int sere_context_load_image(const void* image, size_t image_size, void** sere);
+
 /**
  * Release resources, allocated for SERE
  *
@@ -134,6 +170,39 @@ int sere_context_set_atomic(void* sere, size_t id);
  */
 void sere_context_advance(void* sere);
 
+/**
+ * Advance SERE's automaton over an event which happened at `time`
+ *
+ * Only SERE with a time window (`WITHIN(r, limit)`) depends on time:
+ * its match lasts at most `limit`, the time of its last event minus
+ * the time of its first one. Times do not decrease, their unit is up
+ * to a client. Other advance functions keep the time of the previous event.
+ *
+ * @param[in] sere SERE context
+ * @param[in] time time of the event
+ */
+void sere_context_advance_at(void* sere, uint64_t time);
+
+/**
+ * Advance SERE's automaton over a batch of events
+ *
+ * Events are packed row-major: `count` rows of `stride` bytes,
+ * atomic predicate `id` of an event is bit `id % 8` of byte `id / 8`
+ * of its row. Atomics set before the call are discarded.
+ *
+ * @param[in] sere SERE context
+ * @param[in] events packed events
+ * @param[in] stride size of an event row in bytes
+ * @param[in] count number of events
+ * @param[out] results match result after every event (may be NULL)
+ * @returns non-zero in case of error (`stride` is too small for all atomics)
+ */
+int sere_context_advance_batch(void* sere,
+                               const uint8_t* events,
+                               size_t stride,
+                               size_t count,
+                               enum Match* results);
+
 /**
  * Get match results.
  *
@@ -142,6 +211,31 @@ void sere_context_advance(void* sere);
  */
 void sere_context_get_result(void* sere, int* result);
 
+/**
+ * Save state of SERE context
+ *
+ * The snapshot is bound to the loaded image: it can only
+ * be restored into a context loaded from the same image.
+ * The snapshot is owned by the context and is valid
+ * until the next snapshot or release.
+ *
+ * @param[in] sere SERE context
+ * @param[out] data snapshot
+ * @param[out] size snapshot size
+ */
+void sere_context_snapshot(void* sere, const char** data, size_t* size);
+
+/**
+ * Restore state of SERE context
+ *
+ * @param[in] sere SERE context
+ * @param[in] data snapshot
+ * @param[in] size snapshot size
+ * @returns non-zero in case of error (broken snapshot or another image),
+ *          the state is not changed then
+ */
+int sere_context_restore(void* sere, const char* data, size_t size);
+
 
 /**
  * Load compiled SERE expression
@@ -156,6 +250,38 @@ int sere_context_extended_load(const char* rt, /** serialized *FASL */
                                void** sere /** loaded extended SERE context */
                                );
 
+/**
+ * Load compiled SERE expression, starts of matches are found on demand
+ *
+ * The context only advances active states over events and retains
+ * events of active runs. When a match ends, the reverse automaton runs
+ * backwards over the retained events to find its starts, so a step
+ * without a match costs about as much as a step of `sere_context_load`,
+ * and a step with one a pass over retained events. Matches are the
+ * same as of `sere_context_extended_load` (with `WITHIN` the longest one
+ * is exact), `horizon` may be larger. DFASL and NFASL with a counted
+ * repetition are loaded as by `sere_context_extended_load`.
+ *
+ * At most 65536 latest events are retained, a run may stay active
+ * for good (as in `A ; true[*] ; B` after `A`). Lengths of a match
+ * which may start before them are not known, `longest` (and `shortest`
+ * if no match starts within them) is `horizon` then, an upper bound.
+ * With `WITHIN`, such runs expire.
+ *
+ * Snapshots of such context are restored only by such context, unless
+ * it was loaded as by `sere_context_extended_load`: its snapshots
+ * are those of `sere_context_extended_load` then.
+ *
+ * @param[in] rt SERE image
+ * @param[in] rt_size SERE image size
+ * @param[out] sere loaded extended SERE context
+ * @returns non-zero in case of errors
+ */
+int sere_context_extended_load_reverse(const char* rt, /** serialized *FASL */
+                                       size_t rt_size, /** serialized *FASL size */
+                                       void** sere /** loaded extended SERE context */
+                                       );
+
 /**
  * Release resources, allocated for SERE
  *
@@ -209,6 +335,39 @@ int sere_context_extended_set_atomic(void* sere, size_t id);
  */
 void sere_context_extended_advance(void* sere);
 
+/**
+ * Advance SERE's automaton over an event which happened at `time`
+ *
+ * See `sere_context_advance_at`. Runs out of the time window are
+ * dropped, a match is always within it, but `longest` is only
+ * the longest one known: runs which merged with an expired run
+ * are shortened to the latest of them.
+ *
+ * @param[in] sere SERE context
+ * @param[in] time time of the event
+ */
+void sere_context_extended_advance_at(void* sere, uint64_t time);
+
+/**
+ * Advance SERE's automaton over a batch of events
+ *
+ * Events are packed row-major: `count` rows of `stride` bytes,
+ * atomic predicate `id` of an event is bit `id % 8` of byte `id / 8`
+ * of its row. Atomics set before the call are discarded.
+ *
+ * @param[in] sere SERE context
+ * @param[in] events packed events
+ * @param[in] stride size of an event row in bytes
+ * @param[in] count number of events
+ * @param[out] results match result after every event (may be NULL)
+ * @returns non-zero in case of error (`stride` is too small for all atomics)
+ */
+int sere_context_extended_advance_batch(void* sere,
+                                        const uint8_t* events,
+                                        size_t stride,
+                                        size_t count,
+                                        struct ExtendedMatch* results);
+
 /**
  * Get match results.
  *
@@ -217,6 +376,572 @@ void sere_context_extended_advance(void* sere);
  */
 void sere_context_extended_get_result(void* sere, struct ExtendedMatch* result);
 
+/**
+ * Advance SERE's automaton over a batch of events with payloads
+ *
+ * The same as `sere_context_extended_advance_batch`, but retained
+ * events get the given payloads instead of their offsets.
+ *
+ * @param[in] sere SERE context
+ * @param[in] events packed events
+ * @param[in] stride size of an event row in bytes
+ * @param[in] count number of events
+ * @param[in] payloads payloads of events (may be NULL)
+ * @param[out] results match result after every event (may be NULL)
+ * @returns non-zero in case of error (`stride` is too small for all atomics)
+ */
+int sere_context_extended_advance_batch_payloads(void* sere,
+                                                 const uint8_t* events,
+                                                 size_t stride,
+                                                 size_t count,
+                                                 const uint64_t* payloads,
+                                                 struct ExtendedMatch* results);
+
+/**
+ * Retain events which may belong to a match
+ *
+ * An event is retained as a payload, opaque for the library:
+ * its offset in the stream (number of events since load or reset)
+ * or a value set by `sere_context_extended_set_payload`.
+ * Events past the horizon of the current result are dropped, so
+ * a client does not need to keep a stream itself. Retained events
+ * are dropped on reset and restore, they are not a part of snapshots.
+ *
+ * @param[in] sere SERE context
+ * @param[in] enable retain events (non-zero) or not
+ */
+void sere_context_extended_retain(void* sere, int enable);
+
+/**
+ * Set payload of the next event
+ *
+ * @param[in] sere SERE context
+ * @param[in] payload retained instead of the offset of the event
+ */
+void sere_context_extended_set_payload(void* sere, uint64_t payload);
+
+/**
+ * Get retained events
+ *
+ * Payloads are owned by the context and are valid until it advances.
+ *
+ * @param[in] sere SERE context
+ * @param[out] payloads payloads of events, the latest event is the last one
+ * @param[out] count number of events
+ */
+void sere_context_extended_retained(void* sere, const uint64_t** payloads, size_t* count);
+
+/**
+ * Get events of the current match
+ *
+ * A match is the latest `longest` (or `shortest`) events, see `ExtendedMatch`.
+ * Payloads are owned by the context and are valid until it advances.
+ *
+ * @param[in] sere SERE context
+ * @param[in] longest longest (non-zero) or shortest match
+ * @param[out] payloads payloads of events, the latest event is the last one
+ * @param[out] count number of events
+ * @returns non-zero if there is no match or its events are not retained
+ */
+int sere_context_extended_match_payloads(void* sere,
+                                         int longest,
+                                         const uint64_t** payloads,
+                                         size_t* count);
+
+/**
+ * Save state of extended SERE context
+ *
+ * The snapshot is bound to the loaded image: it can only
+ * be restored into a context loaded from the same image.
+ * The snapshot is owned by the context and is valid
+ * until the next snapshot or release.
+ *
+ * @param[in] sere extended SERE context
+ * @param[out] data snapshot
+ * @param[out] size snapshot size
+ */
+void sere_context_extended_snapshot(void* sere, const char** data, size_t* size);
+
+/**
+ * Restore state of extended SERE context
+ *
+ * @param[in] sere extended SERE context
+ * @param[in] data snapshot
+ * @param[in] size snapshot size
+ * @returns non-zero in case of error (broken snapshot or another image),
+ *          the state is not changed then
+ */
+int sere_context_extended_restore(void* sere, const char* data, size_t size);
+
+/**
+ * Load compiled SERE expression for keyed evaluation
+ *
+ * A keyed context keeps many independent instances of the SERE,
+ * one per 64-bit key. Only compact targets are supported:
+ * NFASL with at most 256 states (without counters) or DFASL in table form.
+ * Events have no time, so a SERE with a time window (`WITHIN`)
+ * is not accepted.
+ *
+ * @param[in] rt SERE image
+ * @param[in] rt_size SERE image size
+ * @param[out] sere loaded keyed SERE context
+ * @returns non-zero in case of errors (or unsupported target or a time window)
+ */
+int sere_keyed_load(const char* rt, size_t rt_size, void** sere);
+
+/**
+ * Release resources, allocated for keyed SERE context
+ *
+ * @param[in] sere keyed SERE context
+ */
+void sere_keyed_release(void* sere);
+
+/**
+ * Get number of atomic predicates in SERE
+ *
+ * @param[in] sere keyed SERE context
+ * @param[out] count number of atomic predicates
+ */
+void sere_keyed_atomic_count(void* sere, size_t* count);
+
+/**
+ * Get name of a given atomic predicate
+ *
+ * @param[in] sere keyed SERE context
+ * @param[in] id atomic predicate id
+ * @param[out] name predicate name
+ * @returns non-zero in case of errors
+ */
+int sere_keyed_atomic_name(void* sere, size_t id, const char** name);
+
+/**
+ * Set atomic predicate to TRUE
+ *
+ * All predicates are set to FALSE at every step.
+ *
+ * @param[in] sere keyed SERE context
+ * @param[in] id atomic predicate to set
+ * @returns non-zero in case of error (incorrect predicate id)
+ */
+int sere_keyed_set_atomic(void* sere, size_t id);
+
+/**
+ * Advance SERE instance of a key
+ *
+ * The instance is created if there is none.
+ *
+ * @param[in] sere keyed SERE context
+ * @param[in] key instance key
+ * @param[out] result match result of the instance
+ */
+void sere_keyed_advance(void* sere, uint64_t key, int* result);
+
+/**
+ * Get match results of a key
+ *
+ * @param[in] sere keyed SERE context
+ * @param[in] key instance key
+ * @param[out] result match result (initial one if there is no instance)
+ */
+void sere_keyed_get_result(void* sere, uint64_t key, int* result);
+
+/**
+ * Remove SERE instance of a key
+ *
+ * @param[in] sere keyed SERE context
+ * @param[in] key instance key
+ * @returns non-zero if there is no instance
+ */
+int sere_keyed_erase(void* sere, uint64_t key);
+
+/**
+ * Remove all SERE instances
+ *
+ * @param[in] sere keyed SERE context
+ */
+void sere_keyed_clear(void* sere);
+
+/**
+ * Preallocate space for SERE instances
+ *
+ * @param[in] sere keyed SERE context
+ * @param[in] count expected number of instances
+ */
+void sere_keyed_reserve(void* sere, size_t count);
+
+/**
+ * Get number of SERE instances
+ *
+ * @param[in] sere keyed SERE context
+ * @param[out] count number of instances
+ */
+void sere_keyed_count(void* sere, size_t* count);
+
+/**
+ * Visit all SERE instances
+ *
+ * @param[in] sere keyed SERE context
+ * @param[in] visitor called with `arg`, key and match result of every instance
+ * @param[in] arg user data
+ */
+void sere_keyed_for_each(void* sere,
+                         void (*visitor)(void* arg, uint64_t key, int result),
+                         void* arg);
+
+/**
+ * Configure automatic removal of SERE instances
+ *
+ * Removing an instance in the initial state does not change
+ * any results. Time is advanced by `sere_keyed_tick` and its unit
+ * is up to the client (events, milliseconds, etc.)
+ *
+ * @param[in] sere keyed SERE context
+ * @param[in] timeout remove instances not advanced for `timeout` ticks (0 - never)
+ * @param[in] drop_initial remove instances as soon as they are back in the initial state
+ */
+void sere_keyed_set_expiry(void* sere, uint64_t timeout, int drop_initial);
+
+/**
+ * Move time forward and remove expired SERE instances
+ *
+ * @param[in] sere keyed SERE context
+ * @param[in] now current time (not earlier than the previous one)
+ * @param[in] visitor called with `arg`, key and match result of every removed instance (may be NULL)
+ * @param[in] arg user data
+ * @returns number of removed instances
+ */
+size_t sere_keyed_tick(void* sere,
+                       uint64_t now,
+                       void (*visitor)(void* arg, uint64_t key, int result),
+                       void* arg);
+
+/**
+ * Save state of all instances of keyed SERE context
+ *
+ * The snapshot is bound to the loaded image: it can only
+ * be restored into a context loaded from the same image.
+ * The snapshot is owned by the context and is valid
+ * until the next snapshot or release.
+ *
+ * @param[in] sere keyed SERE context
+ * @param[out] data snapshot
+ * @param[out] size snapshot size
+ */
+void sere_keyed_snapshot(void* sere, const char** data, size_t* size);
+
+/**
+ * Restore state of all instances of keyed SERE context
+ *
+ * @param[in] sere keyed SERE context
+ * @param[in] data snapshot
+ * @param[in] size snapshot size
+ * @returns non-zero in case of error (broken snapshot or another image),
+ *          the state is not changed then
+ */
+int sere_keyed_restore(void* sere, const char* data, size_t size);
+
+/**
+ * Load compiled SERE expression for multi-threaded evaluation of streams
+ *
+ * Events are tagged by a 64-bit stream id; every stream has its own
+ * SERE instance and streams are evaluated by a pool of worker threads,
+ * which share the loaded image. Events of a stream are evaluated in order.
+ * Events have no time, so a SERE with a time window (`WITHIN`)
+ * is not accepted.
+ *
+ * @param[in] rt SERE image
+ * @param[in] rt_size SERE image size
+ * @param[in] threads number of worker threads (0 - one per core)
+ * @param[in] visitor called by a worker with `arg`, stream id and match result
+ *                    after every event (may be NULL); calls for a stream are
+ *                    ordered, calls for different streams may be concurrent
+ * @param[in] arg user data
+ * @param[out] sere loaded SERE scheduler
+ * @returns non-zero in case of errors
+ */
+int sere_scheduler_load(const char* rt,
+                        size_t rt_size,
+                        size_t threads,
+                        void (*visitor)(void* arg, uint64_t stream, int result),
+                        void* arg,
+                        void** sere);
+
+/**
+ * Wait for pending events and release resources of SERE scheduler
+ *
+ * @param[in] sere SERE scheduler
+ */
+void sere_scheduler_release(void* sere);
+
+/**
+ * Get number of atomic predicates in SERE
+ *
+ * @param[in] sere SERE scheduler
+ * @param[out] count number of atomic predicates
+ */
+void sere_scheduler_atomic_count(void* sere, size_t* count);
+
+/**
+ * Get name of a given atomic predicate
+ *
+ * @param[in] sere SERE scheduler
+ * @param[in] id atomic predicate id
+ * @param[out] name predicate name
+ * @returns non-zero in case of errors
+ */
+int sere_scheduler_atomic_name(void* sere, size_t id, const char** name);
+
+/**
+ * Queue an event of a stream
+ *
+ * The event is packed: atomic `i` is bit `i % 8` of byte `i / 8`.
+ * May be called from several threads.
+ *
+ * @param[in] sere SERE scheduler
+ * @param[in] stream stream id
+ * @param[in] event packed event of `stride` bytes
+ * @param[in] stride event size, at least (atomic count + 7) / 8
+ * @returns non-zero if `stride` is too small
+ */
+int sere_scheduler_post(void* sere, uint64_t stream, const uint8_t* event, size_t stride);
+
+/**
+ * Wait until all queued events are evaluated
+ *
+ * @param[in] sere SERE scheduler
+ */
+void sere_scheduler_wait(void* sere);
+
+/**
+ * Get match result of a stream after its evaluated events
+ *
+ * @param[in] sere SERE scheduler
+ * @param[in] stream stream id
+ * @param[out] result match result
+ */
+void sere_scheduler_get_result(void* sere, uint64_t stream, int* result);
+
+/**
+ * Create an empty set of SEREs
+ *
+ * All SEREs of a set are evaluated over the same event stream.
+ * Atomic predicates with the same name are shared by all SEREs.
+ *
+ * @param[out] set SERE set
+ */
+void sere_set_create(void** set);
+
+/**
+ * Release resources, allocated for SERE set
+ *
+ * @param[in] set SERE set
+ */
+void sere_set_release(void* set);
+
+/**
+ * Add compiled SERE expression to a set
+ *
+ * Rules are numbered from zero in the order they are added.
+ * New atomic predicates are appended to the set's atomics.
+ * Events have no time, so a SERE with a time window (`WITHIN`)
+ * is not accepted. Neither is a SERE compiled for `SERE_TARGET_NFASL`
+ * with a counted repetition (see `sere_compile`).
+ *
+ * @param[in] set SERE set
+ * @param[in] rt SERE image
+ * @param[in] rt_size SERE image size
+ * @param[out] rule rule id of the added SERE
+ * @returns non-zero in case of errors
+ */
+int sere_set_add(void* set, const char* rt, size_t rt_size, size_t* rule);
+
+/**
+ * Get number of rules in SERE set
+ *
+ * @param[in] set SERE set
+ * @param[out] count number of rules
+ */
+void sere_set_rule_count(void* set, size_t* count);
+
+/**
+ * Get number of atomic predicates in SERE set
+ *
+ * @param[in] set SERE set
+ * @param[out] count number of atomic predicates
+ */
+void sere_set_atomic_count(void* set, size_t* count);
+
+/**
+ * Get name of a given atomic predicate of SERE set
+ *
+ * @param[in] set SERE set
+ * @param[in] id atomic predicate id
+ * @param[out] name predicate name
+ * @returns non-zero in case of errors
+ */
+int sere_set_atomic_name(void* set, size_t id, const char** name);
+
+/**
+ * Reset all rules of SERE set to their initial state
+ *
+ * @param[in] set SERE set
+ */
+void sere_set_reset(void* set);
+
+/**
+ * Set atomic predicate to TRUE
+ *
+ * All predicates are set to FALSE at every step.
+ *
+ * @param[in] set SERE set
+ * @param[in] id atomic predicate to set
+ * @returns non-zero in case of error (incorrect predicate id)
+ */
+int sere_set_set_atomic(void* set, size_t id);
+
+/**
+ * Advance all rules of SERE set
+ *
+ * @param[in] set SERE set
+ */
+void sere_set_advance(void* set);
+
+/**
+ * Get match results of a rule
+ *
+ * @param[in] set SERE set
+ * @param[in] rule rule id
+ * @param[out] result match result
+ * @returns non-zero in case of error (incorrect rule id)
+ */
+int sere_set_get_result(void* set, size_t rule, int* result);
+
+/**
+ * Get rules whose match result was changed by the last advance
+ *
+ * The array is valid until the set is advanced or reset.
+ *
+ * @param[in] set SERE set
+ * @param[out] rules changed rule ids
+ * @param[out] count number of changed rules
+ */
+void sere_set_get_changed(void* set, const size_t** rules, size_t* count);
+
+/**
+ * Create an empty matcher
+ *
+ * A matcher searches an event stream for matches of many SEREs and
+ * reports every match to a callback, results of events are not polled.
+ * A match is events [start, end) of the stream, offsets count from
+ * the first event after creation or reset. Within a batch matches
+ * are reported rule by rule, in order of their offsets.
+ * Atomic predicates with the same name are shared by all SEREs.
+ *
+ * @param[in] mode SERE_MATCH_ALL, SERE_MATCH_LEFTMOST_LONGEST or SERE_MATCH_NON_OVERLAPPING
+ * @param[in] callback called with `arg`, rule id, start and end of every match
+ * @param[in] arg user data
+ * @param[out] matcher SERE matcher
+ * @returns non-zero in case of error (unknown mode or no callback)
+ */
+int sere_matcher_create(int mode,
+                        void (*callback)(void* arg, size_t rule, uint64_t start, uint64_t end),
+                        void* arg,
+                        void** matcher);
+
+/**
+ * Release resources, allocated for matcher
+ *
+ * @param[in] matcher SERE matcher
+ */
+void sere_matcher_release(void* matcher);
+
+/**
+ * Add compiled SERE expression to a matcher
+ *
+ * Rules are numbered from zero in the order they are added.
+ * New atomic predicates are appended to the matcher's atomics.
+ * Events have no time, so a SERE with a time window (`WITHIN`)
+ * is not accepted.
+ *
+ * @param[in] matcher SERE matcher
+ * @param[in] rt SERE image
+ * @param[in] rt_size SERE image size
+ * @param[out] rule rule id of the added SERE
+ * @returns non-zero in case of errors
+ */
+int sere_matcher_add(void* matcher, const char* rt, size_t rt_size, size_t* rule);
+
+/**
+ * Get number of atomic predicates in matcher
+ *
+ * @param[in] matcher SERE matcher
+ * @param[out] count number of atomic predicates
+ */
+void sere_matcher_atomic_count(void* matcher, size_t* count);
+
+/**
+ * Get name of a given atomic predicate of matcher
+ *
+ * @param[in] matcher SERE matcher
+ * @param[in] id atomic predicate id
+ * @param[out] name predicate name
+ * @returns non-zero in case of errors
+ */
+int sere_matcher_atomic_name(void* matcher, size_t id, const char** name);
+
+/**
+ * Reset matcher to the start of a stream
+ *
+ * Matches waiting for next events are dropped.
+ *
+ * @param[in] matcher SERE matcher
+ */
+void sere_matcher_reset(void* matcher);
+
+/**
+ * Set atomic predicate to TRUE
+ *
+ * All predicates are set to FALSE at every step.
+ *
+ * @param[in] matcher SERE matcher
+ * @param[in] id atomic predicate to set
+ * @returns non-zero in case of error (incorrect predicate id)
+ */
+int sere_matcher_set_atomic(void* matcher, size_t id);
+
+/**
+ * Advance matcher over an event
+ *
+ * @param[in] matcher SERE matcher
+ */
+void sere_matcher_advance(void* matcher);
+
+/**
+ * Advance matcher over a batch of events
+ *
+ * Events are packed as in `sere_context_advance_batch`.
+ *
+ * @param[in] matcher SERE matcher
+ * @param[in] events packed events
+ * @param[in] stride size of an event row in bytes
+ * @param[in] count number of events
+ * @returns non-zero in case of error (`stride` is too small for all atomics)
+ */
+int sere_matcher_advance_batch(void* matcher,
+                               const uint8_t* events,
+                               size_t stride,
+                               size_t count);
+
+/**
+ * Report matches which wait for next events
+ *
+ * SERE_MATCH_LEFTMOST_LONGEST reports a match when it cannot be
+ * extended anymore, call it at the end of a stream.
+ *
+ * @param[in] matcher SERE matcher
+ */
+void sere_matcher_flush(void* matcher);
+
   int sere_context_to_dot(void* ctx, const char* file);
   int sere_context_extended_to_dot(void* ctx, const char* file);
 
@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 
 #include "boolean/Expr.hpp"
 
@@ -103,6 +105,7 @@ namespace parser {
    */
   class ExprCollector : public SereBaseVisitor {
     std::map<std::string, size_t> vars;
+    uint64_t within = 0;
     FileName fileName;
   public:
     ExprCollector(const FileName& file) : fileName(file) {}
@@ -119,12 +122,34 @@ namespace parser {
     }
 
     std::map<std::string, size_t> getVars() const { return vars; }
+    uint64_t getWithin() const { return within; }
 
     virtual antlrcpp::Any visitSere(SereParser::SereContext *ctx) override {
-      Ptr<SereExpr> result = visit(ctx->sereExpr());
+      SereParser::SereExprContext* expr = ctx->sereExpr();
+      while (auto parens = dynamic_cast<SereParser::SereParensContext*>(expr)) {
+        expr = parens->sereExpr();
+      }
+      // a time window bounds the whole match, so it is not a part of the automaton
+      if (auto bounded = dynamic_cast<SereParser::SereWithinContext*>(expr)) {
+        assert(bounded->limit != nullptr);
+        try {
+          within = std::stoull(bounded->limit->getText());
+        } catch (std::out_of_range&) {
+          throw ParseError(toLocated(*bounded), "time window is too large");
+        }
+        if (within == 0) {
+          throw ParseError(toLocated(*bounded), "time window must be positive");
+        }
+        expr = bounded->arg;
+      }
+      Ptr<SereExpr> result = visit(expr);
       return result;
     }
 
+    virtual antlrcpp::Any visitSereWithin(SereParser::SereWithinContext *ctx) override {
+      throw ParseError(toLocated(*ctx), "WITHIN is only supported as the outermost operator");
+    }
+
     virtual antlrcpp::Any visitSereParens(SereParser::SereParensContext *ctx) override {
       Ptr<SereExpr> result = visit(ctx->sereExpr());
       return result;
@@ -225,34 +250,12 @@ namespace parser {
 
       Ptr<SereExpr> arg = visit(ctx->arg);
 
-      Ptr<SereExpr> opt = nullptr;
-      for (size_t ix = 0; ix < begin; ++ix) {
-        if (opt == nullptr) {
-          opt = arg;
-        } else {
-          opt = create<Concat>(ctx, opt, arg);
-        }
-      }
-
-      // Combine results: opt;(1 + v;(1 + v))
-
-      Ptr<SereExpr> rhs = nullptr;
-      for (size_t ix = begin; ix < end; ++ix) {
-        if (rhs == nullptr) {
-          rhs = create<Union>(ctx, create<SereEmpty>(ctx), arg);
-        } else {
-          rhs = create<Union>(ctx, create<SereEmpty>(ctx), create<Concat>(ctx, arg, rhs));
-        }
+      // `a{m,n}` with `n < m` is `a{m}`
+      end = std::max(begin, end);
+      if (begin == 1 && end == 1) {
+        return arg;
       }
-
-      Ptr<SereExpr> result =
-        rhs == nullptr
-        ? (opt == nullptr
-           ? create<SereEmpty>(ctx)
-           : opt)
-        : (opt == nullptr
-           ? rhs
-           : create<Concat>(ctx, opt, rhs));
+      Ptr<SereExpr> result = create<Repeat>(ctx, arg, begin, end);
       return result;
     }
 
@@ -265,12 +268,7 @@ namespace parser {
       case 0: return Ptr<SereExpr>{create<KleeneStar>(ctx, arg)};
       case 1: return Ptr<SereExpr>{create<KleenePlus>(ctx, arg)};
       }
-      Ptr<SereExpr> opt = arg;
-      for (size_t ix = 1; ix < begin; ++ix) {
-        opt = create<Concat>(ctx, opt, arg);
-      }
-      opt = create<Concat>(ctx, opt, create<KleeneStar>(ctx, arg));
-      return opt;
+      return Ptr<SereExpr>{create<Repeat>(ctx, arg, begin, Repeat::Unbounded)};
     }
 
     virtual antlrcpp::Any visitSereSingleRange(SereParser::SereSingleRangeContext *ctx) override {
@@ -288,11 +286,7 @@ namespace parser {
       if (count == 1) {
         return arg;
       }
-      Ptr<SereExpr> opt = arg;
-      for (size_t ix = 1; ix < count; ++ix) {
-        opt = create<Concat>(ctx, opt, arg);
-      }
-      return opt;
+      return Ptr<SereExpr>{create<Repeat>(ctx, arg, count, count)};
     }
 
     virtual antlrcpp::Any visitSereBoolExpr(SereParser::SereBoolExprContext *ctx) override {
@@ -361,6 +355,7 @@ namespace parser {
     ParseResult result;
     result.expr = visitor.visitSere(tree);
     result.vars = visitor.getVars();
+    result.within = visitor.getWithin();
 
     return result;
   }
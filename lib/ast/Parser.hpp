@@ -1,6 +1,7 @@
 #ifndef PARSER_HPP
 #define PARSER_HPP
 
+#include <cstdint>
 #include <map>
 #include <iostream>
 #include "ast/SereExpr.hpp"
@@ -17,6 +18,7 @@ namespace parser {
   struct ParseResult {
     Ptr<SereExpr> expr;
     AtomicNameMap vars;
+    uint64_t within = 0; /** time window of `WITHIN`, zero if none */
   };
 
   /**
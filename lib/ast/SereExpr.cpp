@@ -4,11 +4,15 @@
 
 using Nfasl = nfasl::Nfasl;
 
+/** Shorter repetitions are expanded, their NFASL is small anyway */
+static constexpr size_t minCounted = 16;
+
 class SereToNfasl : public SereVisitor {
 private:
   Nfasl result;
+  bool counters; /** see `sereToNfasl` */
 public:
-  SereToNfasl(SereExpr& expr) {
+  SereToNfasl(SereExpr& expr, bool counters_) : counters(counters_) {
     expr.accept(*this);
   }
 
@@ -25,8 +29,8 @@ public:
   }
 
   void visit(Union& v) override {
-    Nfasl lhs = sereToNfasl(*v.getLhs());
-    Nfasl rhs = sereToNfasl(*v.getRhs());
+    Nfasl lhs = sereToNfasl(*v.getLhs(), counters);
+    Nfasl rhs = sereToNfasl(*v.getRhs(), counters);
 
     result = nfasl::unions(lhs, rhs);
   }
@@ -39,8 +43,8 @@ public:
   }
 
   void visit(Concat& v) override {
-    Nfasl lhs = sereToNfasl(*v.getLhs());
-    Nfasl rhs = sereToNfasl(*v.getRhs());
+    Nfasl lhs = sereToNfasl(*v.getLhs(), counters);
+    Nfasl rhs = sereToNfasl(*v.getRhs(), counters);
 
     result = nfasl::concat(lhs, rhs);
   }
@@ -53,13 +57,13 @@ public:
   }
 
   void visit(KleeneStar& v) override {
-    Nfasl arg = sereToNfasl(*v.getArg());
+    Nfasl arg = sereToNfasl(*v.getArg(), counters);
 
     result = nfasl::kleeneStar(arg);
   }
 
   void visit(KleenePlus& v) override {
-    Nfasl arg = sereToNfasl(*v.getArg());
+    Nfasl arg = sereToNfasl(*v.getArg(), counters);
 
     result = nfasl::kleenePlus(arg);
   }
@@ -75,8 +79,20 @@ public:
 
     nfasl::complement(arg, result);
   }
+
+  void visit(Repeat& v) override {
+    bool unbounded = v.getMax() == Repeat::Unbounded;
+    size_t max = unbounded ? nfasl::unbounded : v.getMax();
+    size_t bound = unbounded ? v.getMin() : v.getMax();
+    auto arg = std::dynamic_pointer_cast<SereBool>(v.getArg());
+    if (counters && arg && bound >= minCounted && bound < rt::Counter::Unbounded) {
+      result = nfasl::count(boolExprToExpr(*arg->getExpr()), v.getMin(), max);
+    } else {
+      result = nfasl::repeat(sereToNfasl(*v.getArg(), counters), v.getMin(), max);
+    }
+  }
 };
 
-Nfasl sereToNfasl(SereExpr& expr) {
-  return SereToNfasl(expr).getResult();
+Nfasl sereToNfasl(SereExpr& expr, bool counters) {
+  return SereToNfasl(expr, counters).getResult();
 }
@@ -2,6 +2,7 @@
 #define AST_SEREEXPR_HPP
 
 #include <string>
+#include <limits>
 #include <memory>
 #include <boost/format.hpp>
 
@@ -19,6 +20,7 @@ class KleeneStar;
 class KleenePlus;
 class Complement;
 class Partial;
+class Repeat;
 
 class SereVisitor {
 public:
@@ -32,6 +34,7 @@ public:
   virtual void visit(KleenePlus& v) = 0;
   virtual void visit(Partial& v) = 0;
   virtual void visit(Complement& v) = 0;
+  virtual void visit(Repeat& v) = 0;
 };
 
 class SereExpr : public LocatedBase {
@@ -198,14 +201,54 @@ public:
   Ptr<SereExpr> getArg() const { return arg; }
 };
 
+/**
+ * Bounded repetition `arg{min,max}`
+ *
+ * It is kept whole, so the repetition of a boolean
+ * may be compiled into a counter (see `sereToNfasl`).
+ */
+class Repeat : public SereExpr {
+public:
+  static constexpr size_t Unbounded = std::numeric_limits<size_t>::max();
+
+private:
+  Ptr<SereExpr> arg;
+  size_t min;
+  size_t max;
+
+public:
+  Repeat(const Located& loc, Ptr<SereExpr> arg_, size_t min_, size_t max_)
+    : SereExpr(loc), arg(arg_), min(min_), max(max_) {}
+
+  void accept(SereVisitor& v) override { v.visit(*this); }
+
+  const String pretty() const override {
+    if (max == Unbounded) {
+      return (boost::format("(%1%){%2%,}") % arg->pretty() % min).str();
+    }
+    return (boost::format("(%1%){%2%,%3%}") % arg->pretty() % min % max).str();
+  }
+
+  Ptr<SereExpr> getArg() const { return arg; }
+  size_t getMin() const { return min; }
+  /** `Unbounded` if there is no upper bound */
+  size_t getMax() const { return max; }
+};
+
 namespace nfasl {
   class Nfasl;
 }
 
 /**
  * Convert SERE into NFASL
+ *
+ * With `counters`, a long repetition of a boolean (`Repeat`) takes
+ * a counting state (see `rt::Counter`) instead of a copy of its argument
+ * per repetition. Such NFASL is run only by `rt::NfaslContext` and
+ * `rt::NfaslExtendedContext`, operands of `Intersect`, `Fusion`,
+ * `Partial` and `Complement` are expanded anyway.
  */
-extern nfasl::Nfasl sereToNfasl(SereExpr& expr);
+extern nfasl::Nfasl sereToNfasl(SereExpr& expr, bool counters = false);
 
 #define RE_SEREBOOL(expr) std::make_shared<SereBool>(RE_LOC, expr)
 #define RE_EMPTY std::make_shared<SereEmpty>(RE_LOC)
@@ -217,5 +260,6 @@ extern nfasl::Nfasl sereToNfasl(SereExpr& expr);
 #define RE_PLUS(u) std::make_shared<KleenePlus>(RE_LOC, u)
 #define RE_PARTIAL(u) std::make_shared<Partial>(RE_LOC, u)
 #define RE_COMPLEMENT(u) std::make_shared<Complement>(RE_LOC, u)
+#define RE_REPEAT(u,m,n) std::make_shared<Repeat>(RE_LOC, u,m,n)
 
 #endif // AST_SEREEXPR_HPP
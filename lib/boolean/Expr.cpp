@@ -1,6 +1,11 @@
 #include "rt/RtPredicate.hpp"
+#include "rt/RtProgram.hpp"
 #include "boolean/Expr.hpp"
 
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
@@ -9,6 +14,33 @@ namespace boolean {
 
   Context Expr::context;
 
+  /** Operand `key` of a node of "dag", it refers to an earlier node */
+  static Expr dagArg(const json& j, const char* key, const std::vector<Expr>& nodes) {
+    size_t ix;
+    j.at(key).get_to(ix);
+    if (ix >= nodes.size()) {
+      throw std::invalid_argument("invalid expression DAG");
+    }
+    return nodes[ix];
+  }
+
+  static Expr fromDagNode(const json& j, const std::vector<Expr>& nodes) {
+    std::string kind;
+    j.at("kind").get_to(kind);
+    if (kind == "not") {
+      return !dagArg(j, "arg", nodes);
+    }
+    if (kind == "and") {
+      return dagArg(j, "arg0", nodes) && dagArg(j, "arg1", nodes);
+    }
+    if (kind == "or") {
+      return dagArg(j, "arg0", nodes) || dagArg(j, "arg1", nodes);
+    }
+    Expr e;
+    from_json(j, e);
+    return e;
+  }
+
   void from_json(const json& j, Expr& e) {
     std::string kind;
     j.at("kind").get_to(kind);
@@ -44,51 +76,137 @@ namespace boolean {
       e = arg0 || arg1;
       return;
     }
+    if (kind == "dag") {
+      std::vector<Expr> nodes;
+      for (auto const& node : j.at("nodes")) {
+        nodes.push_back(fromDagNode(node, nodes));
+      }
+      if (nodes.empty()) {
+        throw std::invalid_argument("invalid expression DAG");
+      }
+      e = nodes.back();
+      return;
+    }
     assert(false); // unreachable code
   }
 
-  void to_json(json& j, const Expr& e) {
-    bool v;
-    uint32_t var;
-    Expr arg0, arg1;
-
-    if (e.get_value(v)) {
-      j = json {
-                { "kind", "const" },
-                { "value", v } };
-      return;
+  /**
+   * Expression as a list of distinct subterms ("dag"),
+   * operands are indices of earlier subterms, the root is the last one
+   */
+  class ToDag {
+  public:
+    /** true if a subterm, but a variable or a constant, is used twice */
+    static bool shared(Expr expr) {
+      std::unordered_set<uint64_t> seen;
+      return shared(expr, seen);
     }
-    if (e.get_var(var)) {
-      j = json {
-                { "kind", "var" },
-                { "variable", var } };
-      return;
+
+    size_t add(Expr expr) {
+      auto i = index.find(expr.expr.value);
+      if (i != index.end()) {
+        return i->second;
+      }
+      Expr arg0, arg1;
+      json node;
+      if (expr.not_arg(arg0)) {
+        node = json { { "kind", "not" }, { "arg", add(arg0) } };
+      } else if (expr.and_args(arg0, arg1)) {
+        size_t lhs = add(arg0);
+        node = json { { "kind", "and" }, { "arg0", lhs }, { "arg1", add(arg1) } };
+      } else if (expr.or_args(arg0, arg1)) {
+        size_t lhs = add(arg0);
+        node = json { { "kind", "or" }, { "arg0", lhs }, { "arg1", add(arg1) } };
+      } else {
+        toTree(node, expr);
+      }
+      nodes.push_back(node);
+      index.insert({expr.expr.value, nodes.size() - 1});
+      return nodes.size() - 1;
     }
-    if (e.not_arg(arg0)) {
-      j = json {
-                { "kind", "not" },
-                { "arg", arg0 } };
-      return;
+
+    const json& getNodes() const { return nodes; }
+
+    /** Expression as a tree, see `to_json` */
+    static void toTree(json& j, Expr e) {
+      bool v;
+      uint32_t var;
+      Expr arg0, arg1;
+
+      if (e.get_value(v)) {
+        j = json {
+                  { "kind", "const" },
+                  { "value", v } };
+        return;
+      }
+      if (e.get_var(var)) {
+        j = json {
+                  { "kind", "var" },
+                  { "variable", var } };
+        return;
+      }
+      if (e.not_arg(arg0)) {
+        j = json { { "kind", "not" } };
+        toTree(j["arg"], arg0);
+        return;
+      }
+      if (e.and_args(arg0, arg1)) {
+        j = json { { "kind", "and" } };
+        toTree(j["arg0"], arg0);
+        toTree(j["arg1"], arg1);
+        return;
+      }
+      if (e.or_args(arg0, arg1)) {
+        j = json { { "kind", "or" } };
+        toTree(j["arg0"], arg0);
+        toTree(j["arg1"], arg1);
+        return;
+      }
+      assert(false); // unreachable code
     }
-    if (e.and_args(arg0, arg1)) {
-      j = json {
-                { "kind", "and" },
-                { "arg0", arg0 },
-                { "arg1", arg1 } };
-      return;
+
+  private:
+    static bool shared(Expr expr, std::unordered_set<uint64_t>& seen) {
+      bool tf;
+      uint32_t v;
+      Expr lhs, rhs;
+
+      if (expr.get_value(tf) || expr.get_var(v)) {
+        return false;
+      }
+      if (!seen.insert(expr.expr.value).second) {
+        return true;
+      }
+      if (expr.not_arg(lhs)) {
+        return shared(lhs, seen);
+      }
+      if (expr.and_args(lhs, rhs) || expr.or_args(lhs, rhs)) {
+        return shared(lhs, seen) || shared(rhs, seen);
+      }
+      assert(false); // unreachable code
+      return false;
     }
-    if (e.or_args(arg0, arg1)) {
-      j = json {
-                { "kind", "or" },
-                { "arg0", arg0 },
-                { "arg1", arg1 } };
+
+    json nodes = json::array();
+    std::unordered_map<uint64_t, size_t> index;
+  };
+
+  void to_json(json& j, const Expr& e) {
+    // a tree of a DAG may be exponentially larger
+    if (!ToDag::shared(e)) {
+      ToDag::toTree(j, e);
       return;
     }
-    assert(false); // unreachable code
+    ToDag dag;
+    dag.add(e);
+    j = json {
+              { "kind", "dag" },
+              { "nodes", dag.getNodes() } };
   }
 
   /**
-   * Serialize expression into runtime representation
+   * Serialize expression into runtime representation,
+   * a subterm shared in the DAG is written once (see `rt::Code::Ref`)
    */
   class FromExpr {
   public:
@@ -101,6 +219,7 @@ namespace boolean {
 
   private:
     std::vector<uint8_t> data;
+    std::unordered_map<uint64_t, rt::RefOffset> written; /** offsets of subterms */
 
     template <typename T>
     void writeValue(T t) {
@@ -111,7 +230,6 @@ namespace boolean {
     void write(Expr expr) {
       bool tf;
       uint32_t v;
-      Expr lhs, rhs;
 
       if (expr.get_value(tf)) {
         writeValue(tf ? rt::Code::True : rt::Code::False);
@@ -122,6 +240,21 @@ namespace boolean {
         writeValue(static_cast<rt::Offset>(v));
         return;
       }
+
+      auto i = written.find(expr.expr.value);
+      if (i != written.end()) {
+        writeValue(rt::Code::Ref);
+        writeValue(i->second);
+        return;
+      }
+      rt::RefOffset at = data.size();
+      writeSubterm(expr);
+      written.insert({expr.expr.value, at});
+    }
+
+    void writeSubterm(Expr expr) {
+      Expr lhs, rhs;
+
       if (expr.not_arg(lhs)) {
         writeValue(rt::Code::Not);
         write(lhs);
@@ -149,4 +282,56 @@ namespace boolean {
     data = be.getData();
   }
 
+  /**
+   * Compile expression into runtime program,
+   * expression DAG is traversed only once
+   */
+  class ToProgram {
+  public:
+    rt::ProgramBuilder::Node compile(Expr expr) {
+      bool tf;
+      uint32_t v;
+      Expr lhs, rhs;
+
+      if (expr.get_value(tf)) {
+        return builder.constant(tf);
+      }
+      if (expr.get_var(v)) {
+        return builder.var(v);
+      }
+
+      auto i = visited.find(expr.expr.value);
+      if (i != visited.end()) {
+        return i->second;
+      }
+
+      rt::ProgramBuilder::Node node;
+      if (expr.not_arg(lhs)) {
+        node = builder.negate(compile(lhs));
+      } else if (expr.and_args(lhs, rhs)) {
+        node = compile(lhs);
+        node = builder.conj(node, compile(rhs));
+      } else if (expr.or_args(lhs, rhs)) {
+        node = compile(lhs);
+        node = builder.disj(node, compile(rhs));
+      } else {
+        assert(false); // unreachable code
+      }
+      visited.insert({expr.expr.value, node});
+      return node;
+    }
+
+    rt::ProgramBuilder& getBuilder() { return builder; }
+
+  private:
+    rt::ProgramBuilder builder;
+    std::unordered_map<uint64_t, rt::ProgramBuilder::Node> visited;
+  };
+
+  void toRtProgram(Expr expr, rt::Program& program) {
+    ToProgram to;
+    rt::ProgramBuilder::Node root = to.compile(expr);
+    to.getBuilder().build(root, program);
+  }
+
 } // namespace boolean
@@ -13,6 +13,10 @@
 
 using json = nlohmann::json;
 
+namespace rt {
+  class Program;
+}
+
 namespace boolean {
 
   /*
@@ -357,6 +361,7 @@ extern void from_json(const json& j, Expr& e);
 extern void to_json(json& j, const Expr& a);
 extern void toRtPredicate(Expr expr,
                           std::vector<uint8_t>& data);
+extern void toRtProgram(Expr expr, rt::Program& program);
 } // boolean
 
 #endif // BOOLEAN_EXPR_HPP
@@ -48,11 +48,19 @@ namespace nfasl {
         for (auto rule : rules) {
           auto new_tgt = remapF(rule.state);
           if (new_tgt) {
-            new_rules.push_back(TransitionRule { rule.phi, *new_tgt });
+            rule.state = *new_tgt;
+            new_rules.push_back(rule);
           }
         }
       }
     }
+
+    if (!nfasl.counters.empty()) {
+      cleaned.counters.resize(cleaned.stateCount);
+      for (auto q : states) {
+        cleaned.counters[*remapF(q)] = nfasl.counters[q];
+      }
+    }
   }
 
   /**
@@ -123,8 +131,17 @@ namespace nfasl {
     b.initial = remapF(a.initial);
     b.transitions.resize(b.stateCount);
     for (State q = 0; q < a.stateCount; ++q) {
-      for (auto const& rule : a.transitions[q]) {
-        b.transitions[remapF(q)].push_back({ rule.phi, remapF(rule.state) });
+      for (auto rule : a.transitions[q]) {
+        rule.state = remapF(rule.state);
+        b.transitions[remapF(q)].push_back(rule);
+      }
+    }
+
+    // a counting state is a block of its own, see `greedyBisim`
+    if (!a.counters.empty()) {
+      b.counters.resize(b.stateCount);
+      for (State q = 0; q < a.stateCount; ++q) {
+        b.counters[remapF(q)] = a.counters[q];
       }
     }
 
@@ -369,9 +386,18 @@ namespace nfasl {
       Q->insert(q);
     }
 
-    Set::Ptr QsubF(Set::make(set_difference(Q->as_set(), a.finals)));
+    // a counting state is not joined: counters of joined states
+    // would have to be merged, and guards of its rules differ
+    States counting;
+    for (State q = 0; q < a.stateCount; ++q) {
+      if (rt::counting(a.counters, q)) {
+        counting.insert(q);
+      }
+    }
 
-    Set::Ptr finals{Set::make(a.finals)};
+    Set::Ptr QsubF(Set::make(set_difference(set_difference(Q->as_set(), a.finals), counting)));
+
+    Set::Ptr finals{Set::make(set_difference(a.finals, counting))};
 
     P.insert(finals);
     P.insert(QsubF);
@@ -385,6 +411,22 @@ namespace nfasl {
     finals->setSuper(Q);
     QsubF->setSuper(Q);
 
+    for (auto q : counting) {
+      Set::Ptr single{Set::make(States{ q })};
+      single->setSuper(Q);
+      P.insert(single);
+      W.insert(single);
+    }
+    // all finals (or all other states) may count
+    if (!counting.empty()) {
+      for (auto block : { finals, QsubF }) {
+        if (block->size() == 0) {
+          P.erase(block);
+          W.erase(block);
+        }
+      }
+    }
+
     while (!W.empty()) {
       Set::Ptr R = *W.begin();
       W.erase(W.begin());
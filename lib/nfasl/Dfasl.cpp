@@ -7,6 +7,7 @@
 #include "boolean/Expr.hpp"
 #include "Algo.hpp"
 
+#include <algorithm>
 #include <map>
 #include <set>
 #include <vector>
@@ -55,14 +56,18 @@ namespace dfasl {
 
   class Builder {
   public:
-    Builder(const nfasl::Nfasl& n_, Dfasl& a_)
-      : n(n_), a(a_) {
+    /** @param[in] search_ the initial state of `n` is in every subset */
+    Builder(const nfasl::Nfasl& n_, Dfasl& a_, bool search_ = false)
+      : n(n_), a(a_), search(search_) {
       a.atomicCount = n.atomicCount;
       a.initial = 0;
       a.stateCount = 0;
     }
 
-    State addCandidate(const nfasl::States& qs) {
+    State addCandidate(nfasl::States qs) {
+      if (search) {
+        qs.insert(n.initial);
+      }
       assert(!qs.empty());
       auto r = stateMap.insert({ qs, stateMap.size() });
       if (r.second) {
@@ -72,6 +77,10 @@ namespace dfasl {
       return r.first->second;
     }
 
+    size_t size() const {
+      return stateMap.size();
+    }
+
     void swapCandidates(Candidates& cs) {
       assert(cs.empty());
       std::swap(candidates, cs);
@@ -96,13 +105,16 @@ namespace dfasl {
   private:
     const nfasl::Nfasl& n;
     Dfasl& a;
+    bool search;
     std::map<nfasl::States, State> stateMap;
     Candidates candidates;
   };
 
-  void deeper(Builder& builder,
+  /** Rules of a DFASL state, by the subsets of their targets */
+  typedef std::vector<std::tuple<nfasl::States, boolean::Expr>> SubsetRules;
+
+  void deeper(SubsetRules& rules,
               const std::map<nfasl::State, boolean::Expr>& next,
-              State sourceNew,
               boolean::Expr upper,
               const nfasl::States& qs) {
     boolean::Expr e0 = upper;
@@ -115,8 +127,7 @@ namespace dfasl {
     boolean::Expr nextUpper;
     //if (sat(e0)) {
     if (e0 != boolean::Expr::value(false)) {
-      State targetNew = builder.addCandidate(qs);
-      builder.addTransitionRule(sourceNew, e0, targetNew);
+      rules.push_back({qs, e0});
 
       nextUpper = nnf(!e0);
       // short cut
@@ -133,15 +144,12 @@ namespace dfasl {
         States substates{qs};
         substates.erase(q);
 
-        deeper(builder, next, sourceNew, nextUpper, substates);
+        deeper(rules, next, nextUpper, substates);
       }
     }
   }
 
-  void nextState(const nfasl::Nfasl& a,
-                 Builder& builder,
-                 State sourceNew,
-                 const nfasl::States& sources) {
+  SubsetRules nextRules(const nfasl::Nfasl& a, const nfasl::States& sources) {
     // prepare mapping to target states
     nfasl::States targets;
     std::map<nfasl::State, boolean::Expr> next;
@@ -155,12 +163,25 @@ namespace dfasl {
       }
     }
 
+    SubsetRules rules;
     if (!targets.empty()) {
-      deeper(builder, next, sourceNew, boolean::Expr::value(true), targets);
+      deeper(rules, next, boolean::Expr::value(true), targets);
+    }
+    return rules;
+  }
+
+  void nextState(const nfasl::Nfasl& a,
+                 Builder& builder,
+                 State sourceNew,
+                 const nfasl::States& sources) {
+    for (auto& [qs,phi] : nextRules(a, sources)) {
+      builder.addTransitionRule(sourceNew, phi, builder.addCandidate(qs));
     }
   }
 
   void toDfasl(const nfasl::Nfasl& a, Dfasl& b) {
+    // subsets of states carry no counters
+    assert(a.counters.empty());
     Builder builder(a, b);
 
     builder.addCandidate({a.initial});
@@ -178,6 +199,64 @@ namespace dfasl {
     builder.finalize();
   }
 
+  /**
+   * Rules of `sourceNew` of a search DFASL, see `toSearchDfasl`
+   *
+   * The initial state is in `sources`, an event which starts
+   * no run from `sources` leaves the initial state alone.
+   *
+   * Conditions of rules of `deeper` overlap: a rule into a subset
+   * of the targets of an event may hold as well, so the rules are
+   * ordered by the size of their subsets and the first one holding
+   * is the exact one.
+   */
+  static void nextSearchState(const nfasl::Nfasl& a,
+                              Builder& builder,
+                              State sourceNew,
+                              const nfasl::States& sources) {
+    SubsetRules rules = nextRules(a, sources);
+    std::stable_sort(rules.begin(), rules.end(), [](auto const& r0, auto const& r1) {
+      return std::get<0>(r0).size() > std::get<0>(r1).size();
+    });
+    for (auto& [qs,phi] : rules) {
+      builder.addTransitionRule(sourceNew, phi, builder.addCandidate(qs));
+    }
+
+    boolean::Expr any = boolean::Expr::value(false);
+    for (auto s : sources) {
+      for (auto const& rule : a.transitions[s]) {
+        any = any || rule.phi;
+      }
+    }
+    boolean::Expr rest = simplify(nnf(!any));
+    if (rest != boolean::Expr::value(false)) {
+      builder.addTransitionRule(sourceNew, rest, builder.addCandidate({}));
+    }
+  }
+
+  bool toSearchDfasl(const nfasl::Nfasl& a, Dfasl& b, size_t maxStates) {
+    assert(a.counters.empty());
+    Builder builder(a, b, true);
+
+    builder.addCandidate({a.initial});
+    Candidates candidates;
+    builder.swapCandidates(candidates);
+
+    while (!candidates.empty()) {
+      for (auto& [u,vs] : candidates) {
+        nextSearchState(a, builder, u, vs);
+        if (maxStates && builder.size() > maxStates) {
+          return false;
+        }
+      }
+      candidates = Candidates{};
+      builder.swapCandidates(candidates);
+    }
+
+    builder.finalize();
+    return true;
+  }
+
   void complement(dfasl::Dfasl& a) {
     assert(a.stateCount != 0);
 
@@ -222,9 +301,13 @@ namespace dfasl {
       auto vRule = v.transitions[q].begin();
       for (auto& rule : uT) {
         boolean::toRtPredicate(rule.phi, vRule->phi);
+        rt::Program prog;
+        boolean::toRtProgram(rule.phi, prog);
+        vRule->pred = v.predicates.intern(prog);
         vRule->state = rule.state;
         ++vRule;
       }
     }
+    v.flags = rt::stateFlags(v);
   }
 } // namespace dfasl
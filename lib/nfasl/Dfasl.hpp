@@ -39,6 +39,18 @@ namespace dfasl {
 
   extern void complement(dfasl::Dfasl& a);
   extern void toDfasl(const nfasl::Nfasl& a, Dfasl& b);
+  /**
+   * DFASL of `true[*] ; a`, it accepts every event which ends a match of `a`
+   *
+   * Unlike `toDfasl(nfasl::search(a))`, no state loops on `true`:
+   * the initial state of `a` is added to every subset rather than
+   * enumerated with targets of a step, which halves the subsets looked
+   * at. Rules of every state cover all events, so a run never fails.
+   *
+   * @param[in] maxStates the limit of DFASL states, zero for no limit
+   * @returns false if the limit is exceeded, `b` is incomplete then
+   */
+  extern bool toSearchDfasl(const nfasl::Nfasl& a, Dfasl& b, size_t maxStates = 0);
   extern void from_json(const json& j, Dfasl& a);
   extern void to_json(json& j, const Dfasl& a);
   extern std::string pretty(const Dfasl& a);
@@ -2,6 +2,8 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <cassert>
+#include <stdexcept>
 #include <nlohmann/json.hpp>
 #include "sat/Z3.hpp"
 #include "rt/RtPredicate.hpp"
@@ -16,10 +18,40 @@ namespace nfasl {
   static void from_json(const json& j, TransitionRule& p) {
     j.at("phi").get_to(p.phi);
     j.at("state").get_to(p.state);
+    p.guard = rt::Guard(j.value("guard", 0));
+    p.action = rt::Action(j.value("action", 0));
   }
 
   static void to_json(json& j, const TransitionRule& p) {
     j = json{{"phi", p.phi}, {"state", p.state}};
+    if (p.guard != rt::Guard_None) {
+      j["guard"] = p.guard;
+    }
+    if (p.action != rt::Action_None) {
+      j["action"] = p.action;
+    }
+  }
+
+  /** Counters and annotations are consistent, see `Image::checkCounters` */
+  static void checkCounters(const Nfasl& a) {
+    auto ensure = [](bool cond) {
+      if (!cond) {
+        throw std::invalid_argument("inconsistent NFASL counters");
+      }
+    };
+    ensure(a.counters.empty() || a.counters.size() == a.stateCount);
+    ensure(!rt::counting(a.counters, a.initial));
+    for (State q = 0; q < a.stateCount; ++q) {
+      for (auto const& rule : a.transitions[q]) {
+        bool counting = rt::counting(a.counters, rule.state);
+        ensure(rule.guard <= rt::Guard_Exit);
+        ensure(rule.guard == rt::Guard_None || rt::counting(a.counters, q));
+        ensure(rule.action == rt::Action_None ? !counting
+               : rule.action == rt::Action_Enter ? counting
+               : rule.action == rt::Action_Increment && counting
+                 && rule.state == q && rule.guard == rt::Guard_Loop);
+      }
+    }
   }
 
   void from_json(const json& j, Nfasl& a) {
@@ -28,6 +60,16 @@ namespace nfasl {
     j.at("initial").get_to(a.initial);
     j.at("finals").get_to(a.finals);
     j.at("transitions").get_to(a.transitions);
+    a.counters.clear();
+    if (j.contains("counters")) {
+      for (auto const& c : j.at("counters")) {
+        rt::Counter counter;
+        c.at("min").get_to(counter.min);
+        c.at("max").get_to(counter.max);
+        a.counters.push_back(counter);
+      }
+    }
+    checkCounters(a);
   }
 
   void to_json(json& j, const Nfasl& a) {
@@ -38,6 +80,41 @@ namespace nfasl {
       {"finals",      a.finals},
       {"transitions", a.transitions}
     };
+    if (!a.counters.empty()) {
+      json counters = json::array();
+      for (auto const& counter : a.counters) {
+        counters.push_back({{"min", counter.min}, {"max", counter.max}});
+      }
+      j["counters"] = counters;
+    }
+  }
+
+  /** `rule` into `q` */
+  static TransitionRule moved(TransitionRule rule, State q) {
+    rule.state = q;
+    return rule;
+  }
+
+  /**
+   * Rule of an initial state, which continues a run from final `q` of `a`
+   *
+   * A counting state is final only if its counter reached `min`.
+   */
+  static TransitionRule continued(const Nfasl& a, State q, TransitionRule rule, State target) {
+    rule.state = target;
+    if (rt::counting(a.counters, q)) {
+      rule.guard = rt::Guard_Exit;
+    }
+    return rule;
+  }
+
+  /** Counters of `a0` are counters of `a` from state `offset` */
+  static void copyCounters(const Nfasl& a0, Nfasl& a, State offset) {
+    if (a0.counters.empty()) {
+      return;
+    }
+    a.counters.resize(a.stateCount);
+    std::copy(a0.counters.begin(), a0.counters.end(), a.counters.begin() + offset);
   }
 
   std::string pretty(const Nfasl& a) {
@@ -73,6 +150,8 @@ namespace nfasl {
   }
 
   Nfasl intersects(const Nfasl& a0, const Nfasl& a1) {
+    // runs of a product would need pairs of counters
+    assert(a0.counters.empty() && a1.counters.empty());
     Nfasl a;
     a.atomicCount = std::max(a0.atomicCount, a1.atomicCount);
     a.stateCount = a0.stateCount * a1.stateCount;
@@ -117,23 +196,25 @@ namespace nfasl {
     }
 
     a.transitions.resize(a.stateCount);
+    copyCounters(a0, a, remap0(0));
+    copyCounters(a1, a, remap1(0));
 
     for (State s0 = 0; s0 < a0.stateCount; ++s0) {
       for (auto const& rule : a0.transitions[s0]) {
-        a.transitions[remap0(s0)].push_back({ rule.phi, remap0(rule.state) });
+        a.transitions[remap0(s0)].push_back(moved(rule, remap0(rule.state)));
       }
     }
     for (State s1 = 0; s1 < a1.stateCount; ++s1) {
       for (auto const& rule : a1.transitions[s1]) {
-        a.transitions[remap1(s1)].push_back({ rule.phi, remap1(rule.state) });
+        a.transitions[remap1(s1)].push_back(moved(rule, remap1(rule.state)));
       }
     }
 
     for (auto const& rule : a0.transitions[a0.initial]) {
-      a.transitions[a.initial].push_back({ rule.phi, remap0(rule.state) });
+      a.transitions[a.initial].push_back(moved(rule, remap0(rule.state)));
     }
     for (auto const& rule : a1.transitions[a1.initial]) {
-      a.transitions[a.initial].push_back({ rule.phi, remap1(rule.state) });
+      a.transitions[a.initial].push_back(moved(rule, remap1(rule.state)));
     }
     return a;
   }
@@ -158,21 +239,23 @@ namespace nfasl {
     }
 
     a.transitions.resize(a.stateCount);
+    copyCounters(a0, a, remap0(0));
+    copyCounters(a1, a, remap1(0));
 
     for (State s0 = 0; s0 < a0.stateCount; ++s0) {
       for (auto const& rule : a0.transitions[s0]) {
-        a.transitions[remap0(s0)].push_back({ rule.phi, remap0(rule.state) });
+        a.transitions[remap0(s0)].push_back(moved(rule, remap0(rule.state)));
       }
       if (set_member(a0.finals, s0)) {
         for (auto const& rule : a1.transitions[a1.initial]) {
-          a.transitions[remap0(s0)].push_back({ rule.phi, remap1(rule.state) });
+          a.transitions[remap0(s0)].push_back(continued(a0, s0, rule, remap1(rule.state)));
         }
       }
     }
 
     for (State s1 = 0; s1 < a1.stateCount; ++s1) {
       for (auto const& rule : a1.transitions[s1]) {
-        a.transitions[remap1(s1)].push_back({ rule.phi, remap1(rule.state) });
+        a.transitions[remap1(s1)].push_back(moved(rule, remap1(rule.state)));
       }
     }
 
@@ -180,6 +263,8 @@ namespace nfasl {
   }
 
   Nfasl fuse(const Nfasl& a0, const Nfasl& a1) {
+    // rules are joined with predicates only, not with counters
+    assert(a0.counters.empty() && a1.counters.empty());
     Nfasl a;
     a.atomicCount = std::max(a0.atomicCount, a1.atomicCount);
     a.stateCount = a0.stateCount + a1.stateCount;
@@ -231,13 +316,15 @@ namespace nfasl {
     a.finals.insert(a.initial);
 
     a.transitions = a0.transitions;
+    a.counters = a0.counters;
 
     auto const& initialTransitions = a0.transitions[a0.initial];
     for (State s = 0; s < a.stateCount; ++s) {
       auto&  transitions = a.transitions[s];
       if (set_member(a0.finals, s)) {
-        transitions.insert(transitions.end(),
-                           initialTransitions.begin(), initialTransitions.end());
+        for (auto const& rule : initialTransitions) {
+          transitions.push_back(continued(a0, s, rule, rule.state));
+        }
       }
     }
 
@@ -253,13 +340,15 @@ namespace nfasl {
     a.finals = a0.finals;
 
     a.transitions = a0.transitions;
+    a.counters = a0.counters;
 
     auto const& initialTransitions = a0.transitions[a0.initial];
     for (State s = 0; s < a.stateCount; ++s) {
       auto&  transitions = a.transitions[s];
       if (set_member(a0.finals, s)) {
-        transitions.insert(transitions.end(),
-                           initialTransitions.begin(), initialTransitions.end());
+        for (auto const& rule : initialTransitions) {
+          transitions.push_back(continued(a0, s, rule, rule.state));
+        }
       }
     }
 
@@ -273,6 +362,8 @@ namespace nfasl {
    * So it is easier to clean automaton first.
    */
   Nfasl partial(const Nfasl& a0) {
+    // every state is final, whatever its counter
+    assert(a0.counters.empty());
     Nfasl a;
     clean(a0, a);
 
@@ -286,6 +377,102 @@ namespace nfasl {
     return a;
   }
 
+  Nfasl repeat(const Nfasl& a0, size_t min, size_t max) {
+    if (max == unbounded) {
+      if (min == 0) {
+        return kleeneStar(a0);
+      }
+      return concat(repeat(a0, min - 1, min - 1), kleenePlus(a0));
+    }
+    if (max == 0) {
+      return eps();
+    }
+    // `max` copies of `a0` in a chain, a run may stop past the `min`-th one;
+    // if `a0` accepts the empty word, it may stop anywhere
+    bool nullable = set_member(a0.finals, a0.initial);
+    size_t first = nullable ? 1 : std::max<size_t>(min, 1);
+    Nfasl a;
+    a.atomicCount = a0.atomicCount;
+    a.stateCount = a0.stateCount*max;
+    a.initial = a0.initial;
+    if (min == 0 || nullable) {
+      a.finals.insert(a.initial);
+    }
+    a.transitions.resize(a.stateCount);
+    for (size_t k = 0; k < max; ++k) {
+      State offset = k*a0.stateCount;
+      copyCounters(a0, a, offset);
+      for (State s0 = 0; s0 < a0.stateCount; ++s0) {
+        auto& transitions = a.transitions[offset + s0];
+        for (auto const& rule : a0.transitions[s0]) {
+          transitions.push_back(moved(rule, offset + rule.state));
+        }
+        if (!set_member(a0.finals, s0)) {
+          continue;
+        }
+        if (k + 1 >= first) {
+          a.finals.insert(offset + s0);
+        }
+        if (k + 1 < max) {
+          for (auto const& rule : a0.transitions[a0.initial]) {
+            transitions.push_back(continued(a0, s0, rule, offset + a0.stateCount + rule.state));
+          }
+        }
+      }
+    }
+    return a;
+  }
+
+  Nfasl count(Predicate expr, size_t min, size_t max) {
+    assert(min < rt::Counter::Unbounded);
+    assert(max == unbounded || (min <= max && max > 0 && max < rt::Counter::Unbounded));
+    Nfasl a;
+    constexpr State ini = 0;
+    constexpr State cnt = 1;
+
+    a.atomicCount = expr.var_count();
+    a.stateCount = 2;
+    a.initial = ini;
+    a.finals.insert(cnt);
+    if (min == 0) {
+      a.finals.insert(ini);
+    }
+    a.transitions.resize(a.stateCount);
+    a.counters.resize(a.stateCount);
+    a.counters[cnt].min = min;
+    a.counters[cnt].max = max == unbounded ? rt::Counter::Unbounded : max;
+
+    TransitionRule enter { expr, cnt };
+    enter.action = rt::Action_Enter;
+    a.transitions[ini].push_back(enter);
+    TransitionRule loop { expr, cnt };
+    loop.guard = rt::Guard_Loop;
+    loop.action = rt::Action_Increment;
+    a.transitions[cnt].push_back(loop);
+
+    return a;
+  }
+
+  Nfasl search(const Nfasl& a0) {
+    // a new initial state, it loops on every event and starts a run of `a0`
+    Nfasl a;
+    a.atomicCount = a0.atomicCount;
+    a.stateCount = a0.stateCount + 1;
+    a.initial = a0.stateCount;
+    a.finals = a0.finals;
+    if (set_member(a0.finals, a0.initial)) {
+      a.finals.insert(a.initial);
+    }
+    a.transitions = a0.transitions;
+    a.transitions.resize(a.stateCount);
+    a.transitions[a.initial].push_back({ Predicate::value(true), a.initial });
+    for (auto const& rule : a0.transitions[a0.initial]) {
+      a.transitions[a.initial].push_back(rule);
+    }
+    copyCounters(a0, a, 0);
+    return a;
+  }
+
   void toRt(const Nfasl& u, rt::Nfasl& v) {
     v.atomicCount = u.atomicCount;
     v.stateCount = u.stateCount;
@@ -302,10 +489,17 @@ namespace nfasl {
       auto vRule = v.transitions[q].begin();
       for (auto& rule : uT) {
         boolean::toRtPredicate(rule.phi, vRule->phi);
+        rt::Program prog;
+        boolean::toRtProgram(rule.phi, prog);
+        vRule->pred = v.predicates.intern(prog);
         vRule->state = rule.state;
+        vRule->guard = rule.guard;
+        vRule->action = rule.action;
         ++vRule;
       }
     }
+    v.counters = u.counters;
+    v.flags = rt::stateFlags(v);
   }
 
 } // namespace nfasl
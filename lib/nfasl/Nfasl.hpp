@@ -2,6 +2,7 @@
 #define NFASL_HPP
 
 #include <set>
+#include <limits>
 #include <memory>
 #include <vector>
 #include <string>
@@ -9,6 +10,7 @@
 #include <nlohmann/json.hpp>
 #include "sat/Z3.hpp"
 #include "boolean/Expr.hpp"
+#include "rt/RtCounter.hpp"
 
 using json = nlohmann::json;
 
@@ -24,6 +26,8 @@ namespace nfasl {
   struct TransitionRule {
     Predicate phi;
     State state;
+    rt::Guard guard = rt::Guard_None; /** on the counter of the source state */
+    rt::Action action = rt::Action_None; /** on the counter of `state` */
   };
 
   typedef std::vector<TransitionRule> TransitionRules;
@@ -35,8 +39,18 @@ namespace nfasl {
     State initial;
     States finals;
     std::vector<TransitionRules> transitions;
+    /**
+     * Counters of states, empty if no state counts (see `rt::Counter`)
+     *
+     * A counting state is never initial, it is final only
+     * when its counter reached `min`.
+     */
+    rt::Counters counters;
   };
 
+  /** No upper bound of `repeat` and `count` */
+  constexpr size_t unbounded = std::numeric_limits<size_t>::max();
+
   extern Nfasl eps();
   extern Nfasl phi(Predicate expr);
   extern Nfasl unions(const Nfasl& a0, const Nfasl& a1);
@@ -46,6 +60,12 @@ namespace nfasl {
   extern Nfasl kleeneStar(const Nfasl& a0);
   extern Nfasl kleenePlus(const Nfasl& a0);
   extern Nfasl partial(const Nfasl& a0);
+  /** `a0{min,max}`, states grow linearly with `max` */
+  extern Nfasl repeat(const Nfasl& a0, size_t min, size_t max);
+  /** `expr{min,max}` with a counting state, bounds are below `rt::Counter::Unbounded` */
+  extern Nfasl count(Predicate expr, size_t min, size_t max);
+  /** `true[*] ; a0`: an anchored run accepts every event which ends a match of `a0` */
+  extern Nfasl search(const Nfasl& a0);
 
   extern void from_json(const json& j, Nfasl& a);
   extern void to_json(json& j, const Nfasl& a);
@@ -2,18 +2,82 @@
 #define RTEXECUTOR_HPP
 
 #include "rt/RtPredicate.hpp"
+#include "rt/Snapshot.hpp"
 #include "Match.hpp"
 
+#include <algorithm>
+#include <cstdint>
+
 namespace rt {
 
+  /** Time of an event, its unit is up to a client */
+  typedef uint64_t Timestamp;
+
+  /**
+   * Batch of packed events
+   *
+   * Events are `count` rows of `stride` bytes (row-major).
+   * Atomic `i` of an event is bit `i % 8` of byte `i / 8` of its row.
+   */
+  struct Events {
+    const uint8_t* data;
+    size_t stride;
+    size_t count;
+    size_t atomicCount;
+
+    const uint8_t* row(size_t ix) const { return data + ix*stride; }
+
+    static bool test(const uint8_t* row, size_t atomic) {
+      return (row[atomic >> 3] >> (atomic & 7)) & 1;
+    }
+
+    /** Unpack a row into `vars`, which is resized to `atomicCount` */
+    void unpack(const uint8_t* row, Names& vars) const {
+      vars.reset();
+      vars.resize(atomicCount);
+      for (size_t ix = 0; ix < atomicCount; ix += 8) {
+        uint32_t byte = row[ix >> 3];
+        for (size_t b = 0; byte != 0; ++b, byte >>= 1) {
+          if ((byte & 1) && ix + b < atomicCount) {
+            vars.set(ix + b);
+          }
+        }
+      }
+    }
+  };
+
   class Executor {
   public:
     virtual Match getResult() const = 0;
 
     virtual void reset() = 0;
     virtual void advance(const Names& vars) = 0;
+    /**
+     * Advance over an event which happened at `time`
+     *
+     * Times of events do not decrease. Only automata with a time
+     * window (see `RtClock`) depend on it, `advance` keeps the time
+     * of the previous event.
+     */
+    virtual void advanceAt(const Names& vars, Timestamp /*time*/) { advance(vars); }
+
+    /**
+     * Advance over a batch of events
+     *
+     * @param[in] events packed events
+     * @param[out] results result after every event (may be nullptr)
+     */
+    virtual void advanceBatch(const Events& events, Match* results);
+
+    /** Append current state to a snapshot */
+    virtual void save(SnapshotWriter& writer) const = 0;
+    /** Restore state saved by `save`, throws `RestoreFailed` */
+    virtual void restore(SnapshotReader& reader) = 0;
 
     virtual ~Executor() {}
+
+  protected:
+    Names batchVars; /** buffer for `advanceBatch`, see `advanceEach` */
   };
 
   class ExtendedExecutor {
@@ -22,10 +86,85 @@ namespace rt {
 
     virtual void reset() = 0;
     virtual void advance(const Names& vars) = 0;
+    /** Advance over an event which happened at `time`, see `Executor::advanceAt` */
+    virtual void advanceAt(const Names& vars, Timestamp /*time*/) { advance(vars); }
+
+    /**
+     * Advance over a batch of events
+     *
+     * @param[in] events packed events
+     * @param[out] results result after every event (may be nullptr)
+     */
+    virtual void advanceBatch(const Events& events, ExtendedMatch* results);
+
+    /** Append current state to a snapshot */
+    virtual void save(SnapshotWriter& writer) const = 0;
+    /** Restore state saved by `save`, throws `RestoreFailed` */
+    virtual void restore(SnapshotReader& reader) = 0;
 
     virtual ~ExtendedExecutor() {}
+
+  protected:
+    Names batchVars; /** buffer for `advanceBatch`, see `advanceEach` */
   };
 
+  /**
+   * Batch loop for a concrete executor `Ctx`
+   *
+   * Calls are qualified, so there is no virtual dispatch per event.
+   * Failure is final, so the rest of the batch is not evaluated.
+   *
+   * @param[in] vars buffer of unpacked events, kept by the executor
+   */
+  template <typename Ctx>
+  void advanceEach(Ctx& ctx, const Events& events, Match* results, Names& vars) {
+    for (size_t ix = 0; ix < events.count; ++ix) {
+      events.unpack(events.row(ix), vars);
+      ctx.Ctx::advance(vars);
+      Match r = ctx.Ctx::getResult();
+      if (results) {
+        results[ix] = r;
+      }
+      if (r == Match_Failed) {
+        if (results) {
+          std::fill(results + ix + 1, results + events.count, Match_Failed);
+        }
+        break;
+      }
+    }
+  }
+
+  template <typename Ctx>
+  void advanceEach(Ctx& ctx, const Events& events, ExtendedMatch* results, Names& vars) {
+    for (size_t ix = 0; ix < events.count; ++ix) {
+      events.unpack(events.row(ix), vars);
+      ctx.Ctx::advance(vars);
+      if (results) {
+        results[ix] = ctx.Ctx::getResult();
+      }
+    }
+  }
+
+  inline void Executor::advanceBatch(const Events& events, Match* results) {
+    for (size_t ix = 0; ix < events.count; ++ix) {
+      events.unpack(events.row(ix), batchVars);
+      advance(batchVars);
+      if (results) {
+        results[ix] = getResult();
+      }
+    }
+  }
+
+  inline void ExtendedExecutor::advanceBatch(const Events& events, ExtendedMatch* results) {
+    for (size_t ix = 0; ix < events.count; ++ix) {
+      events.unpack(events.row(ix), batchVars);
+      advance(batchVars);
+      if (results) {
+        results[ix] = getResult();
+      }
+    }
+  }
+
 } // namespace rt
 
 #endif //RTEXECUTOR_HPP
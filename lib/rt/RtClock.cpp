@@ -0,0 +1,104 @@
+#include "rt/RtClock.hpp"
+
+#include <algorithm>
+
+namespace rt {
+
+  size_t RtClock::span() const {
+    if (times.empty()) {
+      return 0;
+    }
+    Timestamp latest = times.back();
+    Timestamp earliest = latest > window ? latest - window : 0;
+    // times do not decrease
+    auto first = std::lower_bound(times.begin(), times.end(), earliest);
+    return times.end() - first;
+  }
+
+  void RtClock::save(SnapshotWriter& writer) const {
+    writer.writeValue(uint64_t(now));
+    writer.writeValue(uint64_t(times.size()));
+    for (auto t : times) {
+      writer.writeValue(uint64_t(t));
+    }
+  }
+
+  void RtClock::restore(SnapshotReader& reader) {
+    uint64_t n, count;
+    reader.readValue(n);
+    reader.readValue(count);
+    std::deque<Timestamp> ts;
+    while (count--) {
+      uint64_t t;
+      reader.readValue(t);
+      reader.ensure(ts.empty() || ts.back() <= t);
+      ts.push_back(t);
+    }
+    reader.ensure(ts.empty() || ts.back() <= n);
+    now = n;
+    std::swap(times, ts);
+  }
+
+  void TimedContext::reset() {
+    executor->reset();
+    started = false;
+    expired = false;
+    first = 0;
+    now = 0;
+  }
+
+  void TimedContext::advanceAt(const Names& vars, Timestamp time) {
+    if (!started) {
+      started = true;
+      first = time;
+    }
+    now = time;
+    // the anchored run lasts longer than the window, failure is final
+    expired = expired || now - first > window;
+    if (!expired) {
+      executor->advance(vars);
+    }
+  }
+
+  void TimedContext::advanceBatch(const Events& events, Match* results) {
+    if (events.count == 0) {
+      return;
+    }
+    if (!started) {
+      started = true;
+      first = now;
+    }
+    // time does not move inside a batch, so it cannot expire there
+    if (expired) {
+      if (results) {
+        std::fill(results, results + events.count, Match_Failed);
+      }
+      return;
+    }
+    executor->advanceBatch(events, results);
+  }
+
+  void TimedContext::save(SnapshotWriter& writer) const {
+    writer.writeValue(uint8_t(started));
+    writer.writeValue(uint8_t(expired));
+    writer.writeValue(uint64_t(first));
+    writer.writeValue(uint64_t(now));
+    executor->save(writer);
+  }
+
+  void TimedContext::restore(SnapshotReader& reader) {
+    uint8_t s, e;
+    uint64_t f, n;
+    reader.readValue(s);
+    reader.readValue(e);
+    reader.readValue(f);
+    reader.readValue(n);
+    reader.ensure(s <= 1 && e <= 1 && f <= n);
+    executor->restore(reader);
+    started = s;
+    expired = e;
+    first = f;
+    now = n;
+  }
+
+} // namespace rt
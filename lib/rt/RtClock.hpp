@@ -0,0 +1,130 @@
+#ifndef RTCLOCK_HPP
+#define RTCLOCK_HPP
+
+#include "rt/Executor.hpp"
+#include "rt/RtContext.hpp"
+#include "rt/Snapshot.hpp"
+#include "Match.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+namespace rt {
+
+  /**
+   * Times of the latest events of an extended executor
+   *
+   * An automaton with a time window (`WITHIN(r, w)`) accepts a run
+   * only if its last event happened at most `window` after its first
+   * one. A run of length `k` started at the `k`-th latest event, so
+   * its start time is kept here, not in `RtContexts`: the clock keeps
+   * times of as many latest events as the longest active run has.
+   *
+   * Runs merged in a state keep only the earliest (`longest`) and the
+   * latest (`shortest`) start, see `prune`.
+   */
+  class RtClock {
+  public:
+    RtClock(Timestamp window_ = 0) : window(window_) {}
+
+    /** The automaton has a time window */
+    bool bounded() const { return window != 0; }
+    Timestamp getWindow() const { return window; }
+
+    void reset() {
+      now = 0;
+      times.clear();
+    }
+    /** Time of the next event, `tick` keeps the previous one by default */
+    void setTime(Timestamp time) { now = time; }
+    /** The next event happened */
+    void tick() { times.push_back(now); }
+
+    /** A run of the `length` latest events lasts at most `window` */
+    bool within(size_t length) const {
+      return length == 0 || times.back() - times[times.size() - length] <= window;
+    }
+    /** Number of the latest events within `window` of the latest one */
+    size_t span() const;
+    /** Number of kept times, no active run is longer */
+    size_t size() const { return times.size(); }
+    /** Keep times of the `length` latest events */
+    void trim(size_t length) {
+      if (times.size() > length) {
+        times.erase(times.begin(), times.end() - length);
+      }
+    }
+
+    /**
+     * Drop expired runs of state `q`
+     *
+     * A state is dropped when its latest run expires, so the result
+     * is exact. When only its earliest run expires, the runs between
+     * are not known and the latest one takes its place: `longest`
+     * is a match within the window, but not always the longest one.
+     *
+     * @returns false if no run of the state is left
+     */
+    bool prune(RtContexts& ctx, size_t q) const {
+      if (!prune(ctx.longest[q], ctx.shortest[q])) {
+        ctx.clear(q);
+        return false;
+      }
+      return true;
+    }
+    /** `prune` of runs kept apart from `RtContexts`, see `CountRuns` */
+    bool prune(size_t& longest, size_t& shortest) const {
+      if (!within(shortest)) {
+        return false;
+      }
+      if (!within(longest)) {
+        longest = shortest;
+      }
+      return true;
+    }
+
+    void save(SnapshotWriter& writer) const;
+    void restore(SnapshotReader& reader);
+
+  private:
+    Timestamp window;
+    Timestamp now = 0;
+    std::deque<Timestamp> times;
+  };
+
+  /**
+   * Anchored executor of an automaton with a time window
+   *
+   * The anchored run starts at the first event, so once an event
+   * happens later than `window` after it, the run fails for good.
+   */
+  class TimedContext : public Executor {
+  public:
+    TimedContext(std::shared_ptr<Executor> executor_, Timestamp window_)
+      : executor(executor_), window(window_) { reset(); }
+
+    Match getResult() const override {
+      return expired ? Match_Failed : executor->getResult();
+    }
+
+    void reset() override;
+    void advance(const Names& vars) override { advanceAt(vars, now); }
+    void advanceAt(const Names& vars, Timestamp time) override;
+    /** Events of a batch happen at the time of the previous one */
+    void advanceBatch(const Events& events, Match* results) override;
+    void save(SnapshotWriter& writer) const override;
+    void restore(SnapshotReader& reader) override;
+
+  private:
+    std::shared_ptr<Executor> executor;
+    Timestamp window;
+    bool started;
+    bool expired;
+    Timestamp first; /** time of the first event */
+    Timestamp now;
+  };
+
+} // namespace rt
+
+#endif // RTCLOCK_HPP
@@ -1,6 +1,11 @@
 #ifndef RT_RTCONTEXT_HPP
 #define RT_RTCONTEXT_HPP
 
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
 namespace rt {
 
 struct RtContext {
@@ -42,6 +47,43 @@ struct RtContext {
   }
 };
 
+/**
+ * Contexts of all states (see `RtContext`) as separate arrays
+ *
+ * An inactive state has `NoValue` in both arrays.
+ */
+struct RtContexts {
+  static constexpr size_t NoValue = RtContext::NoValue;
+
+  std::vector<size_t> longest;
+  std::vector<size_t> shortest;
+
+  void resize(size_t n) {
+    longest.assign(n, NoValue);
+    shortest.assign(n, NoValue);
+  }
+
+  bool active(size_t q) const { return longest[q] != NoValue; }
+
+  void clear(size_t q) {
+    longest[q] = NoValue;
+    shortest[q] = NoValue;
+  }
+
+  void started(size_t q) {
+    if (longest[q] == NoValue) {
+      longest[q] = 0;
+    }
+    shortest[q] = 0;
+  }
+
+  void merge(size_t q, size_t l, size_t s) {
+    size_t u = longest[q];
+    longest[q] = (u == NoValue || u < l) ? l : u;
+    shortest[q] = std::min(shortest[q], s);
+  }
+};
+
 } // namespace rt
 
 #endif // RT_RTCONTEXT_HPP
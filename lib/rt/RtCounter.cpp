@@ -0,0 +1,78 @@
+#include "rt/RtCounter.hpp"
+
+#include <cassert>
+
+namespace rt {
+
+  bool CountSet::passes(const Counter& counter, Guard guard) const {
+    switch (guard) {
+    case Guard_None:
+      break;
+    case Guard_Loop:
+      if (counter.bounded()) {
+        return bits.find_first() < counter.max;
+      }
+      break;
+    case Guard_Exit:
+      if (counter.min > 0) {
+        return bits.find_next(counter.min - 1) != boost::dynamic_bitset<>::npos;
+      }
+      break;
+    }
+    return bits.any();
+  }
+
+  void CountSet::increment(const Counter& counter, const CountSet& from) {
+    assert(bits.size() == from.bits.size());
+    // the value `max` is shifted out, it does not loop (in place, see `NfaslContext`)
+    for (size_t k = from.bits.find_first();
+         k != boost::dynamic_bitset<>::npos && k + 1 < bits.size();
+         k = from.bits.find_next(k)) {
+      bits.set(k + 1);
+    }
+    if (!counter.bounded() && from.bits.test(counter.top())) {
+      bits.set(counter.top());
+    }
+  }
+
+  bool CountRuns::passes(const Counter& counter, Guard guard,
+                         size_t& longest, size_t& shortest) const {
+    bool any = false;
+    for (auto& run : runs) {
+      if ((guard == Guard_Loop && !counter.loops(run.count))
+          || (guard == Guard_Exit && !counter.exits(run.count))) {
+        continue;
+      }
+      longest = any ? std::max(longest, run.longest) : run.longest;
+      shortest = any ? std::min(shortest, run.shortest) : run.shortest;
+      any = true;
+    }
+    return any;
+  }
+
+  void CountRuns::increment(const Counter& counter, const CountRuns& from) {
+    for (auto& run : from.runs) {
+      if (counter.loops(run.count)) {
+        add(counter.next(run.count), run.longest + 1, run.shortest + 1);
+      }
+    }
+  }
+
+  void CountRuns::normalize() {
+    std::sort(runs.begin(), runs.end(),
+              [](const CountRun& a, const CountRun& b) { return a.count < b.count; });
+    size_t last = 0;
+    for (size_t ix = 1; ix < runs.size(); ++ix) {
+      if (runs[ix].count == runs[last].count) {
+        runs[last].longest = std::max(runs[last].longest, runs[ix].longest);
+        runs[last].shortest = std::min(runs[last].shortest, runs[ix].shortest);
+      } else {
+        runs[++last] = runs[ix];
+      }
+    }
+    if (!runs.empty()) {
+      runs.resize(last + 1);
+    }
+  }
+
+} // namespace rt
@@ -0,0 +1,126 @@
+#ifndef RTCOUNTER_HPP
+#define RTCOUNTER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <boost/dynamic_bitset.hpp>
+
+namespace rt {
+
+  /** Condition of a rule on the counter of its source state */
+  enum Guard : uint8_t {
+    Guard_None = 0,
+    Guard_Loop = 1, /** the counter is below `Counter::max` */
+    Guard_Exit = 2, /** the counter reached `Counter::min` */
+  };
+
+  /** Update of the counter of the target state of a rule */
+  enum Action : uint8_t {
+    Action_None = 0,
+    Action_Enter = 1,     /** the counter starts at 1 */
+    Action_Increment = 2, /** the counter of a self-loop grows by 1 */
+  };
+
+  /**
+   * Bounds of the counter of a state
+   *
+   * A counting state stands for `p{min,max}` over a boolean `p`:
+   * it is entered on the first `p`, loops while the counter is
+   * below `max` and is final (or left by `Guard_Exit` rules) once
+   * the counter reached `min`. So `p{1,1000}` takes two states,
+   * not a thousand.
+   */
+  struct Counter {
+    static constexpr uint32_t Unbounded = UINT32_MAX;
+
+    uint32_t min = 0;
+    uint32_t max = 0; /** zero if the state does not count */
+
+    bool counting() const { return max != 0; }
+    bool bounded() const { return max != Unbounded; }
+    /** The largest value kept, values of an unbounded counter saturate at `min` */
+    uint32_t top() const { return bounded() ? max : std::max<uint32_t>(min, 1); }
+    bool loops(uint32_t k) const { return k < max; }
+    bool exits(uint32_t k) const { return k >= min; }
+    /** Value after `Action_Increment`, `loops(k)` holds */
+    uint32_t next(uint32_t k) const { return std::min(k + 1, top()); }
+  };
+
+  /** Counters of all states, empty if no state counts */
+  typedef std::vector<Counter> Counters;
+
+  inline bool counting(const Counters& counters, size_t q) {
+    return !counters.empty() && counters[q].counting();
+  }
+
+  /** Values of a counter in an anchored run (bit `k` is value `k`) */
+  class CountSet {
+  public:
+    bool empty() const { return bits.none(); }
+    void clear() { bits.reset(); }
+    void init(const Counter& counter) { bits.resize(size_t(counter.top()) + 1); }
+
+    /** Some value passes `guard` */
+    bool passes(const Counter& counter, Guard guard) const;
+    /** Some value makes a final state accepting */
+    bool accepts(const Counter& counter) const { return passes(counter, Guard_Exit); }
+    void enter() { bits.set(1); }
+    /** Add values of `from` after `Action_Increment` */
+    void increment(const Counter& counter, const CountSet& from);
+
+    const boost::dynamic_bitset<>& getBits() const { return bits; }
+    void setBits(const boost::dynamic_bitset<>& bits_) { bits = bits_; }
+
+  private:
+    boost::dynamic_bitset<> bits;
+  };
+
+  /** Runs with the same counter value, see `RtContexts` */
+  struct CountRun {
+    uint32_t count;
+    size_t longest;
+    size_t shortest;
+  };
+
+  /**
+   * Runs of a counting state in an extended executor
+   *
+   * Runs with different values have different futures, so they are
+   * merged only when their values are equal, and runs are kept
+   * in order of values (the latest started run has the least one).
+   */
+  class CountRuns {
+  public:
+    bool empty() const { return runs.empty(); }
+    void clear() { runs.clear(); }
+    /** Room for `n` runs, so adding them does not allocate */
+    void reserve(size_t n) { runs.reserve(n); }
+    const std::vector<CountRun>& get() const { return runs; }
+
+    /** Merged context of runs which pass `guard`, false if none does */
+    bool passes(const Counter& counter, Guard guard,
+                size_t& longest, size_t& shortest) const;
+    /** Add a run, `normalize` restores the order */
+    void add(uint32_t count, size_t longest, size_t shortest) {
+      runs.push_back({ count, longest, shortest });
+    }
+    /** Add runs of `from` advanced over an event by `Action_Increment` */
+    void increment(const Counter& counter, const CountRuns& from);
+    /** Sort runs by value and merge runs with equal values */
+    void normalize();
+    /** Drop runs `keep` rejects, it may change their contexts */
+    template <typename Keep>
+    void filter(Keep keep) {
+      runs.erase(std::remove_if(runs.begin(), runs.end(),
+                                [&](CountRun& run) { return !keep(run); }),
+                 runs.end());
+    }
+
+  private:
+    std::vector<CountRun> runs;
+  };
+
+} // namespace rt
+
+#endif // RTCOUNTER_HPP
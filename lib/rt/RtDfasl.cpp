@@ -3,6 +3,8 @@
 #include "rt/Loader.hpp"
 #include "rt/Saver.hpp"
 
+#include <algorithm>
+
 namespace rt {
 
   static void loadStates(Loader& loader, Dfasl::States& states) {
@@ -16,17 +18,22 @@ namespace rt {
     }
   }
 
-  static void loadStateTransition(Loader& loader, Dfasl::StateTransition& str) {
+  static void loadStateTransition(Loader& loader,
+                                  PredicatePool& predicates,
+                                  Dfasl::StateTransition& str) {
     loader.loadPredicate(str.phi);
+    str.pred = predicates.intern(str.phi);
     loader.readValue(str.state);
   }
 
-  static void loadStateTransitions(Loader& loader, Dfasl::StateTransitions& strs) {
+  static void loadStateTransitions(Loader& loader,
+                                   PredicatePool& predicates,
+                                   Dfasl::StateTransitions& strs) {
     uint32_t trsCount;
     loader.readValue(trsCount);
     strs.resize(trsCount);
     for (auto& str : strs) {
-      loadStateTransition(loader, str);
+      loadStateTransition(loader, predicates, str);
     }
   }
 
@@ -40,8 +47,9 @@ namespace rt {
     dfasl->transitions.resize(dfasl->stateCount);
 
     for (auto& t : dfasl->transitions) {
-      loadStateTransitions(loader, t);
+      loadStateTransitions(loader, dfasl->predicates, t);
     }
+    dfasl->flags = stateFlags(*dfasl);
 
     return std::make_shared<DfaslContext>(dfasl);
   }
@@ -91,6 +99,7 @@ namespace rt {
   }
 
   void DfaslContext::reset() {
+    result = Match_Partial;
     if (dfasl->finals.size() == 0) {
       fail();
     } else {
@@ -99,25 +108,208 @@ namespace rt {
     }
   }
 
-  void DfaslContext::advance(const rt::Names& vars) {
+  void DfaslContext::advanceCached() {
+    if (result == Match_Failed || idle()) {
+      return;
+    }
+
     bool advanced = false;
 
     Dfasl::State nextState;
     const Dfasl::StateTransitions& trs = dfasl->transitions[currentState];
+    // the first matching rule, in a batch its predicates are evaluated per block
     for (auto& tr : trs) {
-      if (eval(vars, &tr.phi[0], tr.phi.size())) {
+      if (cache.eval(tr.pred)) {
         advanced = true;
         nextState = tr.state;
         break;
       }
     }
 
-    currentState = nextState;
     if (advanced) {
+      currentState = nextState;
       checkFinals();
     } else {
       fail();
     }
   }
 
+  void DfaslContext::save(SnapshotWriter& writer) const {
+    writer.writeMatch(result);
+    writer.writeValue(uint32_t(result == Match_Failed ? 0 : currentState));
+  }
+
+  void DfaslContext::restore(SnapshotReader& reader) {
+    Match r = reader.readMatch();
+    uint32_t q;
+    reader.readValue(q);
+    reader.ensure(r == Match_Failed || q < dfasl->stateCount);
+    result = r;
+    currentState = q;
+  }
+
+  void DfaslExtendedContext::initial(States& qs, RtContexts& ctx) {
+    if (!ctx.active(dfasl->initial)) {
+      qs.push_back(dfasl->initial);
+    }
+    ctx.started(dfasl->initial);
+  }
+
+  void DfaslExtendedContext::finals() {
+    if (dfasl->finals.empty()) {
+      result.match = Match_Failed;
+      return;
+    }
+    size_t longest = 0;
+    size_t shortest = RtContexts::NoValue;
+    for (auto q : currentStates) {
+      if (dfasl->finals.count(q)) {
+        longest = std::max(longest, currentContext.longest[q]);
+        shortest = std::min(shortest, currentContext.shortest[q]);
+      }
+    }
+    if (shortest != RtContexts::NoValue) {
+      result.match = Match_Ok;
+      result.ok.shortest = shortest;
+      result.ok.longest = longest;
+      result.ok.horizon = horizon;
+    } else {
+      result.match = Match_Partial;
+      result.partial.horizon = horizon;
+    }
+  }
+
+  void DfaslExtendedContext::reset() {
+    horizon = 0;
+    clock.reset();
+    currentStates.clear();
+    currentStates.reserve(dfasl->stateCount);
+    currentContext.resize(dfasl->stateCount);
+    nextStates.clear();
+    nextStates.reserve(dfasl->stateCount);
+    nextContext.resize(dfasl->stateCount);
+    initial(currentStates, currentContext);
+    finals();
+  }
+
+  void DfaslExtendedContext::advanceCached() {
+    bool advanced = false;
+    // forget contexts left from the previous step
+    for (auto q : nextStates) {
+      nextContext.clear(q);
+    }
+    nextStates.clear();
+    initial(nextStates, nextContext);
+    for (auto q : currentStates) {
+      Dfasl::State t = 0;
+      bool found = false;
+      // the first matching rule wins, as in `DfaslContext`
+      for (auto& tr : dfasl->transitions[q]) {
+        if (cache.eval(tr.pred)) {
+          found = true;
+          t = tr.state;
+          break;
+        }
+      }
+      if (!found) {
+        continue;
+      }
+      // contexts of active states are always defined
+      size_t longest = currentContext.longest[q] + 1;
+      size_t shortest = currentContext.shortest[q] + 1;
+      if (!nextContext.active(t)) {
+        nextStates.push_back(t);
+      }
+      nextContext.merge(t, longest, shortest);
+      advanced = true;
+      horizon = std::max(horizon, longest);
+    }
+    std::swap(currentStates, nextStates);
+    std::swap(currentContext, nextContext);
+    if (!advanced) {
+      horizon = 0;
+    }
+    if (clock.bounded()) {
+      expire();
+    }
+    finals();
+  }
+
+  void DfaslExtendedContext::expire() {
+    clock.tick();
+    auto last = std::remove_if(currentStates.begin(), currentStates.end(), [this](Dfasl::State q) {
+      return !clock.prune(currentContext, q);
+    });
+    currentStates.erase(last, currentStates.end());
+    // no run is longer than the window
+    horizon = std::min(horizon, clock.span());
+    clock.trim(horizon);
+  }
+
+  void DfaslExtendedContext::save(SnapshotWriter& writer) const {
+    writer.writeValue(uint64_t(horizon));
+    writer.writeMatch(result.match);
+    writer.writeValue(uint64_t(result.ok.longest));
+    writer.writeValue(uint64_t(result.ok.shortest));
+    writer.writeValue(uint64_t(result.ok.horizon));
+    if (clock.bounded()) {
+      clock.save(writer);
+    }
+    writer.writeValue(uint32_t(currentStates.size()));
+    for (auto q : currentStates) {
+      writer.writeValue(uint32_t(q));
+      writer.writeValue(uint64_t(currentContext.longest[q]));
+      writer.writeValue(uint64_t(currentContext.shortest[q]));
+    }
+  }
+
+  void DfaslExtendedContext::restore(SnapshotReader& reader) {
+    uint64_t h, longest, shortest, okHorizon;
+    reader.readValue(h);
+    ExtendedMatch r;
+    r.match = reader.readMatch();
+    reader.readValue(longest);
+    reader.readValue(shortest);
+    reader.readValue(okHorizon);
+    r.ok.longest = longest;
+    r.ok.shortest = shortest;
+    r.ok.horizon = okHorizon;
+    RtClock c(clock.getWindow());
+    if (c.bounded()) {
+      c.restore(reader);
+    }
+
+    uint32_t count;
+    reader.readValue(count);
+    reader.ensure(count <= dfasl->stateCount);
+    States qs;
+    qs.reserve(dfasl->stateCount);
+    RtContexts ctx;
+    ctx.resize(dfasl->stateCount);
+    while (count--) {
+      uint32_t q;
+      uint64_t ctxLongest, ctxShortest;
+      reader.readValue(q);
+      reader.readValue(ctxLongest);
+      reader.readValue(ctxShortest);
+      reader.ensure(q < dfasl->stateCount && !ctx.active(q));
+      reader.ensure(ctxLongest != RtContexts::NoValue &&
+                    ctxShortest != RtContexts::NoValue);
+      // start times of runs are kept by the clock
+      reader.ensure(!c.bounded() || (ctxLongest <= c.size() && ctxShortest <= c.size()));
+      qs.push_back(q);
+      ctx.longest[q] = ctxLongest;
+      ctx.shortest[q] = ctxShortest;
+    }
+
+    horizon = h;
+    result = r;
+    clock = c;
+    std::swap(currentStates, qs);
+    std::swap(currentContext, ctx);
+    nextStates.clear();
+    nextStates.reserve(dfasl->stateCount);
+    nextContext.resize(dfasl->stateCount);
+  }
+
 } //namespace rt
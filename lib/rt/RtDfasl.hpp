@@ -6,9 +6,14 @@
 #include <unordered_set>
 
 #include "rt/RtPredicate.hpp"
+#include "rt/RtPredicatePool.hpp"
+#include "rt/RtSliced.hpp"
+#include "rt/RtStateFlags.hpp"
 #include "rt/Executor.hpp"
 #include "rt/Loader.hpp"
 #include "rt/Saver.hpp"
+#include "rt/RtContext.hpp"
+#include "rt/RtClock.hpp"
 #include "Match.hpp"
 
 namespace rt {
@@ -20,6 +25,7 @@ namespace rt {
     struct StateTransition {
       Phi phi;
       State state;
+      PredicateIndex pred; /** `phi` in `Dfasl::predicates` */
     };
 
     typedef std::vector<StateTransition> StateTransitions;
@@ -31,15 +37,36 @@ namespace rt {
     State initial;
     States finals;
     std::vector<StateTransitions> transitions;
+    PredicatePool predicates;
+    StateFlags flags; /** see `stateFlags`, empty if not known */
+    Timestamp window = 0; /** time bound of a match, zero if none (see `RtClock`) */
   };
 
   class DfaslContext : public Executor {
   public:
-    DfaslContext (std::shared_ptr<Dfasl> dfasl_) : dfasl(dfasl_) { reset(); }
+    DfaslContext (std::shared_ptr<Dfasl> dfasl_) : dfasl(dfasl_) {
+      cache.attach(dfasl->predicates);
+      reset();
+    }
     Match getResult() const override { return result; }
+    /** The state is absorbing, so a step changes nothing */
+    bool idle() const {
+      return result != Match_Failed && !dfasl->flags.empty()
+        && (dfasl->flags[currentState] & State_Absorbing);
+    }
 
     void reset() override ;
-    void advance(const Names& vars) override;
+    void advance(const Names& vars) override {
+      cache.next(vars);
+      advanceCached();
+    }
+    void advanceBatch(const Events& events, Match* results) override {
+      advanceSliced(*this, cache, events, results);
+    }
+    /** Advance over the event selected in `cache`, see `advanceSliced` */
+    void advanceCached();
+    void save(SnapshotWriter& writer) const override;
+    void restore(SnapshotReader& reader) override;
 
   private:
     void fail() { result = Match_Failed; }
@@ -56,9 +83,12 @@ namespace rt {
       }
     }
 
+    /** A dead state fails at once, no continuation matches */
     void checkFinals() {
       if (dfasl->finals.find(currentState) != dfasl->finals.end()) {
         ok();
+      } else if (!dfasl->flags.empty() && (dfasl->flags[currentState] & State_Dead)) {
+        fail();
       } else {
         partial();
       }
@@ -66,11 +96,86 @@ namespace rt {
 
   private:
     std::shared_ptr<Dfasl> dfasl;
+    SlicedPredicateCache cache;
     Dfasl::State currentState;
 
     Match result;
   };
 
+  /**
+   * Extended executor over DFASL
+   *
+   * A new run of the automaton is started on every event,
+   * runs which meet in the same state have the same future,
+   * so they are merged: only the earliest (`longest`) and
+   * the latest (`shortest`) start is kept per state.
+   * Results are the same as of `NfaslExtendedContext` over
+   * the source NFASL, but a step costs one rule lookup
+   * per distinct active state.
+   */
+  class DfaslExtendedContext : public ExtendedExecutor {
+  public:
+    DfaslExtendedContext (std::shared_ptr<Dfasl> dfasl_)
+      : dfasl(dfasl_), clock(dfasl_->window) {
+      cache.attach(dfasl->predicates);
+      if (dfasl->initial < dfasl->stateCount) {
+        for (auto& tr : dfasl->transitions[dfasl->initial]) {
+          wake.push_back(tr.pred);
+        }
+      }
+      reset();
+    }
+    const ExtendedMatch& getResult() const override {
+      return result;
+    }
+
+    void reset() override;
+    void advance(const Names& vars) override {
+      cache.next(vars);
+      advanceCached();
+    }
+    void advanceAt(const Names& vars, Timestamp time) override {
+      clock.setTime(time);
+      advance(vars);
+    }
+    void advanceBatch(const Events& events, ExtendedMatch* results) override {
+      advanceSliced(*this, cache, events, results);
+    }
+    /** Advance over the event selected in `cache`, see `advanceSliced` */
+    void advanceCached();
+    /** Only the initial state is live, no run has advanced */
+    bool quiescent() const { return horizon == 0; }
+    /** Events of the block on which the initial state moves */
+    Lanes wakeLanes() {
+      Lanes r = 0;
+      for (auto ix : wake) {
+        r |= cache.mask(ix);
+      }
+      return r;
+    }
+    void save(SnapshotWriter& writer) const override;
+    void restore(SnapshotReader& reader) override;
+
+  private:
+    typedef std::vector<Dfasl::State> States;
+
+    void initial(States& qs, RtContexts& ctx);
+    void finals();
+    /** Drop runs out of the time window, see `RtClock` */
+    void expire();
+
+    size_t horizon;
+    std::shared_ptr<Dfasl> dfasl;
+    RtClock clock;
+    SlicedPredicateCache cache;
+    std::vector<PredicateIndex> wake; /** predicates of rules of the initial state */
+    States currentStates; /** active states, in order of activation */
+    RtContexts currentContext;
+    States nextStates; /** buffers for `advance` */
+    RtContexts nextContext;
+    ExtendedMatch result;
+  };
+
   class DfaslExecutorFactory : public LoadCallback {
   public:
     std::shared_ptr<Executor> load(Loader& loader) override;
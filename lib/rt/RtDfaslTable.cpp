@@ -0,0 +1,519 @@
+#include "rt/RtDfaslTable.hpp"
+#include "rt/RtDfasl.hpp"
+
+#include <algorithm>
+#include <map>
+#include <optional>
+
+namespace rt {
+
+  /**
+   * Three-valued predicate evaluator
+   *
+   * Only atomics set in `known` have values (in `values`),
+   * the rest are unknown. The result is unknown
+   * if it depends on an unknown atomic.
+   */
+  class PartialEvaluator {
+  public:
+    enum Value : uint8_t {
+      False = 0,
+      True = 1,
+      Unknown = 2
+    };
+
+    PartialEvaluator(const Names& known_, const Names& values_,
+                     const uint8_t* data_, size_t len_)
+      : known(known_), values(values_), data(data_), len(len_), eip(data_) {}
+
+    Value eval() {
+      return eval0();
+    }
+
+  private:
+    template <typename T>
+    void readValue(T& t) {
+      assert(len >= (size_t)(eip + sizeof(T) - data));
+      t = *reinterpret_cast<const T*>(eip);
+      eip += sizeof(T);
+    }
+
+    Value eval0() {
+      Code c;
+
+      readValue(c);
+      switch (c) {
+      case Code::False:
+        return False;
+      case Code::True:
+        return True;
+      case Code::Name: {
+        Offset off;
+        readValue(off);
+        if (!known.test(off)) {
+          return Unknown;
+        }
+        return values.test(off) ? True : False;
+      }
+      case Code::Not: {
+        Value v = eval0();
+        return v == Unknown ? Unknown : Value(v ^ 1);
+      }
+      case Code::And: {
+        Value lhs = eval0();
+        Value rhs = eval0();
+        if (lhs == False || rhs == False) {
+          return False;
+        }
+        return lhs == True && rhs == True ? True : Unknown;
+      }
+      case Code::Or: {
+        Value lhs = eval0();
+        Value rhs = eval0();
+        if (lhs == True || rhs == True) {
+          return True;
+        }
+        return lhs == False && rhs == False ? False : Unknown;
+      }
+      case Code::Ref: {
+        RefOffset off;
+        readValue(off);
+        assert(off < size_t(eip - data));
+        auto i = refs.find(off);
+        if (i != refs.end()) {
+          return i->second;
+        }
+        const uint8_t* next = eip;
+        eip = data + off;
+        Value v = eval0();
+        eip = next;
+        refs.insert({ off, v });
+        return v;
+      }
+      }
+      assert(false);
+      return Unknown;
+    }
+
+  private:
+    const Names& known;
+    const Names& values;
+    std::map<RefOffset, Value> refs; /** values of shared subterms, see `Code::Ref` */
+    const uint8_t* data;
+    size_t len;
+
+    const uint8_t* eip;
+  };
+
+  /**
+   * Collect atomics referenced by a predicate
+   */
+  static void collectNames(const Dfasl::Phi& phi, std::vector<Offset>& names) {
+    const uint8_t* eip = &phi[0];
+    const uint8_t* end = eip + phi.size();
+    while (eip < end) {
+      Code c = static_cast<Code>(*eip++);
+      if (c == Code::Name) {
+        Offset off = *reinterpret_cast<const Offset*>(eip);
+        eip += sizeof(off);
+        names.push_back(off);
+      } else if (c == Code::Ref) {
+        eip += sizeof(RefOffset);
+      }
+    }
+  }
+
+  class TableBuilder {
+  public:
+    typedef std::vector<DfaslTable::State> Column;
+
+    TableBuilder(const Dfasl& u_, DfaslTable& v_, size_t maxNodes_, size_t maxEntries_)
+      : u(u_), v(v_), maxNodes(maxNodes_), maxEntries(maxEntries_) {
+      known.resize(u.atomicCount);
+      values.resize(u.atomicCount);
+
+      std::map<Dfasl::Phi, uint32_t> phiMap;
+      rules.resize(u.stateCount);
+      for (Dfasl::State q = 0; q < u.stateCount; ++q) {
+        for (auto const& tr : u.transitions[q]) {
+          auto r = phiMap.insert({ tr.phi, phis.size() });
+          if (r.second) {
+            phis.push_back(tr.phi);
+            names.emplace_back();
+            collectNames(tr.phi, names.back());
+          }
+          rules[q].push_back({ r.first->second, tr.state });
+        }
+      }
+      phiValues.resize(phis.size());
+    }
+
+    bool build() {
+      v.atomicCount = u.atomicCount;
+      v.stateCount = u.stateCount;
+      v.initial = u.initial;
+      v.window = u.window;
+      v.finals.resize(v.stateCount + 1);
+      for (auto q : u.finals) {
+        v.finals.set(q);
+      }
+      v.classifier.clear();
+
+      if (!build(v.root)) {
+        return false;
+      }
+
+      v.classCount = classes.size();
+      std::vector<DfaslTable::State> table(size_t(v.stateCount + 1)*v.classCount);
+      for (auto const& [column, c] : classes) {
+        for (DfaslTable::State q = 0; q < v.stateCount; ++q) {
+          table[size_t(q)*v.classCount + c] = column[q];
+        }
+        table[size_t(v.sink())*v.classCount + c] = v.sink();
+      }
+      v.table.assign(std::move(table));
+      v.flags = stateFlags(v);
+      return true;
+    }
+
+  private:
+    struct Rule {
+      uint32_t phi;
+      DfaslTable::State state;
+    };
+
+    PartialEvaluator::Value evalPhi(uint32_t ix) {
+      if (!phiValues[ix]) {
+        const Dfasl::Phi& phi = phis[ix];
+        phiValues[ix] = PartialEvaluator(known, values, &phi[0], phi.size()).eval();
+      }
+      return *phiValues[ix];
+    }
+
+    /**
+     * Find an atomic which must be split to decide the target of `q`
+     *
+     * @returns true if the target is decided (stored in `target`)
+     */
+    bool decide(Dfasl::State q, DfaslTable::State& target, Offset& split) {
+      for (auto const& rule : rules[q]) {
+        switch (evalPhi(rule.phi)) {
+        case PartialEvaluator::True:
+          target = rule.state;
+          return true;
+        case PartialEvaluator::False:
+          continue;
+        case PartialEvaluator::Unknown:
+          for (auto a : names[rule.phi]) {
+            if (!known.test(a)) {
+              split = a;
+              break;
+            }
+          }
+          return false;
+        }
+      }
+      target = v.sink();
+      return true;
+    }
+
+    bool build(DfaslTable::NodeRef& ref) {
+      std::fill(phiValues.begin(), phiValues.end(), std::nullopt);
+
+      Column column(u.stateCount);
+      for (Dfasl::State q = 0; q < u.stateCount; ++q) {
+        Offset split = 0;
+        if (!decide(q, column[q], split)) {
+          return buildNode(split, ref);
+        }
+      }
+
+      auto r = classes.insert({ column, classes.size() });
+      if (classes.size()*(size_t(u.stateCount) + 1) > maxEntries) {
+        return false;
+      }
+      ref = DfaslTable::Leaf | r.first->second;
+      return true;
+    }
+
+    bool buildNode(Offset split, DfaslTable::NodeRef& ref) {
+      if (v.classifier.size() >= maxNodes) {
+        return false;
+      }
+      ref = v.classifier.size();
+      v.classifier.push_back({ split, 0, 0 });
+
+      DfaslTable::NodeRef lo, hi;
+      known.set(split);
+      values.reset(split);
+      if (!build(lo)) {
+        return false;
+      }
+      values.set(split);
+      if (!build(hi)) {
+        return false;
+      }
+      known.reset(split);
+      values.reset(split);
+
+      v.classifier[ref].lo = lo;
+      v.classifier[ref].hi = hi;
+      return true;
+    }
+
+  private:
+    const Dfasl& u;
+    DfaslTable& v;
+    size_t maxNodes;
+    size_t maxEntries;
+
+    Names known;
+    Names values;
+
+    std::vector<Dfasl::Phi> phis;
+    std::vector<std::vector<Offset>> names;
+    std::vector<std::optional<PartialEvaluator::Value>> phiValues;
+    std::vector<std::vector<Rule>> rules;
+    std::map<Column, DfaslTable::Class> classes;
+  };
+
+  bool toTable(const Dfasl& u, DfaslTable& v, size_t maxNodes, size_t maxEntries) {
+    return TableBuilder(u, v, maxNodes, maxEntries).build();
+  }
+
+  void DfaslTableContext::reset() {
+    result = Match_Partial;
+    if (dfasl->finals.none()) {
+      currentState = dfasl->sink();
+      fail();
+    } else {
+      currentState = dfasl->initial;
+      checkFinals();
+    }
+  }
+
+  void DfaslTableContext::advance(const rt::Names& vars) {
+    if (idle()) {
+      return;
+    }
+    currentState = dfasl->next(currentState, dfasl->classify(vars));
+
+    if (currentState != dfasl->sink()) {
+      checkFinals();
+    } else {
+      fail();
+    }
+  }
+
+  void DfaslTableContext::advanceBatch(const Events& events, Match* results) {
+    // events are classified in place, without unpacking
+    size_t ix = 0;
+    for (; ix < events.count && !idle(); ++ix) {
+      currentState = dfasl->next(currentState, dfasl->classify(events.row(ix)));
+
+      if (currentState != dfasl->sink()) {
+        checkFinals();
+      } else {
+        fail();
+      }
+      if (results) {
+        results[ix] = result;
+      }
+    }
+    if (results) {
+      std::fill(results + ix, results + events.count, result);
+    }
+  }
+
+  void DfaslTableContext::save(SnapshotWriter& writer) const {
+    writer.writeMatch(result);
+    writer.writeValue(uint32_t(currentState));
+  }
+
+  void DfaslTableContext::restore(SnapshotReader& reader) {
+    Match r = reader.readMatch();
+    uint32_t q;
+    reader.readValue(q);
+    reader.ensure(q <= dfasl->sink());
+    result = r;
+    currentState = q;
+  }
+
+  DfaslTableExtendedContext::DfaslTableExtendedContext(std::shared_ptr<DfaslTable> dfasl_)
+    : dfasl(dfasl_), clock(dfasl_->window), wakes(dfasl_->classCount, 0) {
+    for (DfaslTable::Class c = 0; c < dfasl->classCount; ++c) {
+      wakes[c] = dfasl->next(dfasl->initial, c) != dfasl->sink();
+    }
+    reset();
+  }
+
+  void DfaslTableExtendedContext::initial(States& qs, RtContexts& ctx) {
+    if (!ctx.active(dfasl->initial)) {
+      qs.push_back(dfasl->initial);
+    }
+    ctx.started(dfasl->initial);
+  }
+
+  void DfaslTableExtendedContext::finals() {
+    if (dfasl->finals.none()) {
+      result.match = Match_Failed;
+      return;
+    }
+    size_t longest = 0;
+    size_t shortest = RtContexts::NoValue;
+    for (auto q : currentStates) {
+      if (dfasl->finals.test(q)) {
+        longest = std::max(longest, currentContext.longest[q]);
+        shortest = std::min(shortest, currentContext.shortest[q]);
+      }
+    }
+    if (shortest != RtContexts::NoValue) {
+      result.match = Match_Ok;
+      result.ok.shortest = shortest;
+      result.ok.longest = longest;
+      result.ok.horizon = horizon;
+    } else {
+      result.match = Match_Partial;
+      result.partial.horizon = horizon;
+    }
+  }
+
+  void DfaslTableExtendedContext::reset() {
+    horizon = 0;
+    clock.reset();
+    currentStates.clear();
+    currentStates.reserve(dfasl->stateCount);
+    currentContext.resize(dfasl->stateCount);
+    nextStates.clear();
+    nextStates.reserve(dfasl->stateCount);
+    nextContext.resize(dfasl->stateCount);
+    initial(currentStates, currentContext);
+    finals();
+  }
+
+  void DfaslTableExtendedContext::step(DfaslTable::Class c) {
+    // the initial configuration does not change
+    if (quiescent() && !wakes[c]) {
+      return;
+    }
+    bool advanced = false;
+    // forget contexts left from the previous step
+    for (auto q : nextStates) {
+      nextContext.clear(q);
+    }
+    nextStates.clear();
+    initial(nextStates, nextContext);
+    for (auto q : currentStates) {
+      DfaslTable::State t = dfasl->next(q, c);
+      if (t == dfasl->sink()) {
+        continue;
+      }
+      // contexts of active states are always defined
+      size_t longest = currentContext.longest[q] + 1;
+      size_t shortest = currentContext.shortest[q] + 1;
+      if (!nextContext.active(t)) {
+        nextStates.push_back(t);
+      }
+      nextContext.merge(t, longest, shortest);
+      advanced = true;
+      horizon = std::max(horizon, longest);
+    }
+    std::swap(currentStates, nextStates);
+    std::swap(currentContext, nextContext);
+    if (!advanced) {
+      horizon = 0;
+    }
+    if (clock.bounded()) {
+      expire();
+    }
+    finals();
+  }
+
+  void DfaslTableExtendedContext::expire() {
+    clock.tick();
+    auto last = std::remove_if(currentStates.begin(), currentStates.end(), [this](DfaslTable::State q) {
+      return !clock.prune(currentContext, q);
+    });
+    currentStates.erase(last, currentStates.end());
+    // no run is longer than the window
+    horizon = std::min(horizon, clock.span());
+    clock.trim(horizon);
+  }
+
+  void DfaslTableExtendedContext::advanceBatch(const Events& events, ExtendedMatch* results) {
+    // events are classified in place, without unpacking
+    for (size_t ix = 0; ix < events.count; ++ix) {
+      step(dfasl->classify(events.row(ix)));
+      if (results) {
+        results[ix] = result;
+      }
+    }
+  }
+
+  void DfaslTableExtendedContext::save(SnapshotWriter& writer) const {
+    writer.writeValue(uint64_t(horizon));
+    writer.writeMatch(result.match);
+    writer.writeValue(uint64_t(result.ok.longest));
+    writer.writeValue(uint64_t(result.ok.shortest));
+    writer.writeValue(uint64_t(result.ok.horizon));
+    if (clock.bounded()) {
+      clock.save(writer);
+    }
+    writer.writeValue(uint32_t(currentStates.size()));
+    for (auto q : currentStates) {
+      writer.writeValue(uint32_t(q));
+      writer.writeValue(uint64_t(currentContext.longest[q]));
+      writer.writeValue(uint64_t(currentContext.shortest[q]));
+    }
+  }
+
+  void DfaslTableExtendedContext::restore(SnapshotReader& reader) {
+    uint64_t h, longest, shortest, okHorizon;
+    reader.readValue(h);
+    ExtendedMatch r;
+    r.match = reader.readMatch();
+    reader.readValue(longest);
+    reader.readValue(shortest);
+    reader.readValue(okHorizon);
+    r.ok.longest = longest;
+    r.ok.shortest = shortest;
+    r.ok.horizon = okHorizon;
+    RtClock c(clock.getWindow());
+    if (c.bounded()) {
+      c.restore(reader);
+    }
+
+    uint32_t count;
+    reader.readValue(count);
+    reader.ensure(count <= dfasl->stateCount);
+    States qs;
+    qs.reserve(dfasl->stateCount);
+    RtContexts ctx;
+    ctx.resize(dfasl->stateCount);
+    while (count--) {
+      uint32_t q;
+      uint64_t ctxLongest, ctxShortest;
+      reader.readValue(q);
+      reader.readValue(ctxLongest);
+      reader.readValue(ctxShortest);
+      reader.ensure(q < dfasl->stateCount && !ctx.active(q));
+      reader.ensure(ctxLongest != RtContexts::NoValue &&
+                    ctxShortest != RtContexts::NoValue);
+      // start times of runs are kept by the clock
+      reader.ensure(!c.bounded() || (ctxLongest <= c.size() && ctxShortest <= c.size()));
+      qs.push_back(q);
+      ctx.longest[q] = ctxLongest;
+      ctx.shortest[q] = ctxShortest;
+    }
+
+    horizon = h;
+    result = r;
+    clock = c;
+    std::swap(currentStates, qs);
+    std::swap(currentContext, ctx);
+    nextStates.clear();
+    nextStates.reserve(dfasl->stateCount);
+    nextContext.resize(dfasl->stateCount);
+  }
+
+} //namespace rt
@@ -0,0 +1,252 @@
+#ifndef RTDFASLTABLE_HPP
+#define RTDFASLTABLE_HPP
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <boost/dynamic_bitset.hpp>
+
+#include "rt/RtPredicate.hpp"
+#include "rt/RtDfasl.hpp"
+#include "rt/RtContext.hpp"
+#include "rt/RtClock.hpp"
+#include "rt/RtStateFlags.hpp"
+#include "rt/Executor.hpp"
+#include "Match.hpp"
+
+namespace rt {
+  /**
+   * Dense (table driven) form of a runtime DFASL
+   *
+   * The atomic space is partitioned into event classes:
+   * two events belong to the same class iff every state
+   * of the automaton moves to the same target on both of them.
+   * An event is mapped to its class with a decision tree
+   * (`classifier`) over atomic predicates, so the cost of
+   * a step does not depend on the number of transition rules.
+   *
+   * The table has an extra (sink) state `stateCount`,
+   * which is entered when there is no matching rule.
+   */
+  class DfaslTable {
+  public:
+    typedef uint32_t State;
+    typedef uint32_t Class;
+    typedef uint32_t NodeRef;
+    typedef boost::dynamic_bitset<> States;
+
+    /** `NodeRef` with `Leaf` bit set refers to a class, not to a node */
+    static constexpr NodeRef Leaf = NodeRef(1) << 31;
+
+    struct Node {
+      Offset atomic;
+      NodeRef lo; /** `atomic` is false */
+      NodeRef hi; /** `atomic` is true */
+    };
+
+    /**
+     * Transition table, owned or kept in external memory (e.g. an image)
+     */
+    class Cells {
+    public:
+      Cells() = default;
+      Cells(const Cells& other) { *this = other; }
+      Cells(Cells&& other) noexcept { *this = std::move(other); }
+
+      Cells& operator= (const Cells& other) {
+        owned = other.owned;
+        owner = other.owner;
+        count = other.count;
+        cells = owner ? other.cells : owned.data();
+        return *this;
+      }
+
+      Cells& operator= (Cells&& other) noexcept {
+        owned = std::move(other.owned);
+        owner = std::move(other.owner);
+        count = other.count;
+        cells = owner ? other.cells : owned.data();
+        other.cells = nullptr;
+        other.count = 0;
+        return *this;
+      }
+
+      void assign(std::vector<State> table) {
+        owned = std::move(table);
+        owner = nullptr;
+        count = owned.size();
+        cells = owned.data();
+      }
+
+      /** Refer to cells in external memory, `owner_` keeps it alive */
+      void attach(const State* data, size_t size, std::shared_ptr<const void> owner_) {
+        owned.clear();
+        owner = owner_;
+        count = size;
+        cells = data;
+      }
+
+      size_t size() const { return count; }
+      const State* begin() const { return cells; }
+      const State* end() const { return cells + count; }
+      State operator[] (size_t ix) const { return cells[ix]; }
+
+    private:
+      std::vector<State> owned;
+      std::shared_ptr<const void> owner;
+      const State* cells = nullptr;
+      size_t count = 0;
+    };
+
+    uint16_t atomicCount;
+    State stateCount;
+    Class classCount;
+    State initial;
+    States finals;
+    NodeRef root;
+    std::vector<Node> classifier;
+    Cells table; /** (stateCount + 1) x classCount */
+    StateFlags flags; /** see `stateFlags`, with the sink, empty if not known */
+    Timestamp window = 0; /** time bound of a match, zero if none (see `RtClock`) */
+
+    State sink() const { return stateCount; }
+
+    Class classify(const Names& vars) const {
+      NodeRef r = root;
+      while (!(r & Leaf)) {
+        const Node& node = classifier[r];
+        r = vars.test(node.atomic) ? node.hi : node.lo;
+      }
+      return r & ~Leaf;
+    }
+
+    /** `classify` over a packed event, see `Events` */
+    Class classify(const uint8_t* row) const {
+      NodeRef r = root;
+      while (!(r & Leaf)) {
+        const Node& node = classifier[r];
+        r = Events::test(row, node.atomic) ? node.hi : node.lo;
+      }
+      return r & ~Leaf;
+    }
+
+    State next(State q, Class c) const {
+      return table[size_t(q)*classCount + c];
+    }
+  };
+
+  class DfaslTableContext : public Executor {
+  public:
+    DfaslTableContext (std::shared_ptr<DfaslTable> dfasl_) : dfasl(dfasl_) { reset(); }
+    Match getResult() const override { return result; }
+    /** The state is absorbing (or the sink), so a step changes nothing */
+    bool idle() const {
+      return currentState == dfasl->sink()
+        || (!dfasl->flags.empty() && (dfasl->flags[currentState] & State_Absorbing));
+    }
+
+    void reset() override;
+    void advance(const Names& vars) override;
+    void advanceBatch(const Events& events, Match* results) override;
+    void save(SnapshotWriter& writer) const override;
+    void restore(SnapshotReader& reader) override;
+
+  private:
+    void fail() { result = Match_Failed; }
+
+    void ok() {
+      if (result != Match_Failed) {
+        result = Match_Ok;
+      }
+    }
+
+    void partial() {
+      if (result != Match_Failed) {
+        result = Match_Partial;
+      }
+    }
+
+    /** A dead state fails at once and stops in the sink */
+    void checkFinals() {
+      if (dfasl->finals.test(currentState)) {
+        ok();
+      } else if (!dfasl->flags.empty() && (dfasl->flags[currentState] & State_Dead)) {
+        currentState = dfasl->sink();
+        fail();
+      } else {
+        partial();
+      }
+    }
+
+  private:
+    std::shared_ptr<DfaslTable> dfasl;
+    DfaslTable::State currentState;
+
+    Match result;
+  };
+
+  /** `DfaslExtendedContext` over table form */
+  class DfaslTableExtendedContext : public ExtendedExecutor {
+  public:
+    DfaslTableExtendedContext (std::shared_ptr<DfaslTable> dfasl_);
+    const ExtendedMatch& getResult() const override {
+      return result;
+    }
+
+    void reset() override;
+    void advance(const Names& vars) override {
+      step(dfasl->classify(vars));
+    }
+    void advanceAt(const Names& vars, Timestamp time) override {
+      clock.setTime(time);
+      advance(vars);
+    }
+    void advanceBatch(const Events& events, ExtendedMatch* results) override;
+    /** Only the initial state is live, no run has advanced */
+    bool quiescent() const { return horizon == 0; }
+    void save(SnapshotWriter& writer) const override;
+    void restore(SnapshotReader& reader) override;
+
+  private:
+    typedef std::vector<DfaslTable::State> States;
+
+    void step(DfaslTable::Class c);
+    void initial(States& qs, RtContexts& ctx);
+    void finals();
+    /** Drop runs out of the time window, see `RtClock` */
+    void expire();
+
+    size_t horizon;
+    std::shared_ptr<DfaslTable> dfasl;
+    RtClock clock;
+    std::vector<uint8_t> wakes; /** the initial state moves on a class */
+    States currentStates; /** active states, in order of activation */
+    RtContexts currentContext;
+    States nextStates; /** buffers for `step` */
+    RtContexts nextContext;
+    ExtendedMatch result;
+  };
+
+  /** Default limit of classifier nodes, see `toTable` */
+  constexpr size_t maxClassifierNodes = 1 << 16;
+  /** Default limit of table entries, see `toTable` */
+  constexpr size_t maxTableSize = 1 << 24;
+
+  /**
+   * Build dense table form of DFASL
+   *
+   * @param[in] u runtime DFASL
+   * @param[out] v table form
+   * @param[in] maxNodes limit of classifier decision nodes
+   * @param[in] maxEntries limit of table entries
+   * @returns false if any of the limits is exceeded
+   */
+  extern bool toTable(const Dfasl& u, DfaslTable& v,
+                      size_t maxNodes = maxClassifierNodes,
+                      size_t maxEntries = maxTableSize);
+
+} // namespace rt
+
+#endif //RTDFASLTABLE_HPP
@@ -0,0 +1,681 @@
+#include "rt/RtImage.hpp"
+#include "rt/Snapshot.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <memory.h>
+
+namespace rt {
+
+  /**
+   * Offsets of image sections, derived from header counts
+   *
+   * Counts are not trusted, `valid` is false if the image
+   * would not fit in addressable memory.
+   */
+  struct ImageLayout {
+    size_t initials;
+    size_t finals;
+    size_t stateIndex;
+    size_t transitions;
+    size_t predicates;
+    size_t code;
+    size_t classifier;
+    size_t table;
+    size_t names;
+    size_t flags;
+    size_t counters;
+    size_t annotations;
+    size_t size;
+    bool valid;
+
+    explicit ImageLayout(const ImageHeader& h) : size(sizeof(ImageHeader)), valid(true) {
+      uint64_t words = (uint64_t(h.stateCount) + 63) / 64;
+      uint64_t rows = h.classCount ? uint64_t(h.stateCount) + 1 : 0;
+      initials = section(words, sizeof(uint64_t));
+      finals = section(words, sizeof(uint64_t));
+      stateIndex = section(uint64_t(h.stateCount) + 1, sizeof(uint32_t));
+      transitions = section(h.transitionCount, sizeof(ImageTransition));
+      predicates = section(h.predicateCount, sizeof(ImagePredicate));
+      code = section(h.codeSize, sizeof(Program::Word));
+      classifier = section(h.nodeCount, sizeof(ImageNode));
+      table = section(rows, uint64_t(h.classCount)*sizeof(uint32_t));
+      names = section(h.namesSize, 1);
+      flags = section(h.version >= 2 ? h.stateCount : 0, 1);
+      bool counting = h.version >= 4 && h.counting;
+      counters = section(counting ? h.stateCount : 0, sizeof(Counter));
+      annotations = section(counting ? h.transitionCount : 0, sizeof(ImageAnnotation));
+    }
+
+  private:
+    static constexpr uint64_t maxSize = uint64_t(1) << 48;
+
+    size_t section(uint64_t count, uint64_t item) {
+      size_t offset = size;
+      if (count > 0 && item > maxSize / count) {
+        valid = false;
+        return offset;
+      }
+      uint64_t bytes = count*item;
+      bytes = (bytes + imageAlignment - 1) / imageAlignment * imageAlignment;
+      if (bytes > maxSize - size) {
+        valid = false;
+        return offset;
+      }
+      size += bytes;
+      return offset;
+    }
+  };
+
+  static uint64_t imageChecksum(const uint8_t* data, size_t size) {
+    size_t skip = offsetof(ImageHeader, checksum) + sizeof(uint64_t);
+    return fingerprint(data + skip, size - skip);
+  }
+
+  static void ensure(bool cond) {
+    if (!cond) {
+      throw LoadingFailed{};
+    }
+  }
+
+  bool Image::probe(const void* data, size_t size) {
+    uint32_t magic;
+    if (size < sizeof(ImageHeader)) {
+      return false;
+    }
+    memcpy(&magic, data, sizeof(magic));
+    return magic == imageMagic;
+  }
+
+  Image::Storage Image::copy(const void* data, size_t size) {
+    std::align_val_t alignment{ imageAlignment };
+    uint8_t* p = static_cast<uint8_t*>(::operator new(size, alignment));
+    memcpy(p, data, size);
+    return Storage(p, [alignment](const uint8_t* p) {
+      ::operator delete(const_cast<uint8_t*>(p), alignment);
+    });
+  }
+
+  Image::Image(Storage storage_, size_t size) : storage(storage_) {
+    const uint8_t* data = storage.get();
+    ensure(probe(data, size));
+    ensure(reinterpret_cast<uintptr_t>(data) % alignof(uint64_t) == 0);
+    header = reinterpret_cast<const ImageHeader*>(data);
+    ensure(header->version >= 1 && header->version <= imageVersion);
+    ensure(header->kind <= Image_LazyDfasl);
+    ensure(header->size == size);
+
+    ImageLayout layout(*header);
+    ensure(layout.valid && layout.size == size);
+    ensure(imageChecksum(data, size) == header->checksum);
+
+    initials = reinterpret_cast<const uint64_t*>(data + layout.initials);
+    finals = reinterpret_cast<const uint64_t*>(data + layout.finals);
+    stateIndex = reinterpret_cast<const uint32_t*>(data + layout.stateIndex);
+    transitions = reinterpret_cast<const ImageTransition*>(data + layout.transitions);
+    predicates.predicates = reinterpret_cast<const ImagePredicate*>(data + layout.predicates);
+    predicates.count = header->predicateCount;
+    predicates.code = reinterpret_cast<const Program::Word*>(data + layout.code);
+    classifier = reinterpret_cast<const ImageNode*>(data + layout.classifier);
+    table = reinterpret_cast<const uint32_t*>(data + layout.table);
+    nameOffsets = reinterpret_cast<const uint32_t*>(data + layout.names);
+    names = reinterpret_cast<const char*>(data + layout.names);
+    flags = header->version >= 2 ? data + layout.flags : nullptr;
+    bool counting = header->version >= 4 && header->counting;
+    counters = counting ? reinterpret_cast<const Counter*>(data + layout.counters) : nullptr;
+    annotations = counting
+      ? reinterpret_cast<const ImageAnnotation*>(data + layout.annotations) : nullptr;
+
+    check();
+  }
+
+  void Image::check() {
+    const ImageHeader& h = *header;
+    bool nfasl = h.kind != Image_Dfasl;
+
+    // runtime automata address atomics (and NFASL states) with 16 bits
+    ensure(h.atomicCount <= 0xffff);
+    ensure(!nfasl || h.stateCount <= 0xffff);
+    ensure(nfasl || h.stateCount == 0 || h.initial < h.stateCount);
+
+    size_t words = (size_t(h.stateCount) + 63) / 64;
+    anyFinal = false;
+    for (size_t ix = 0; ix < words; ++ix) {
+      anyFinal = anyFinal || finals[ix] != 0;
+    }
+    if (h.stateCount % 64) {
+      uint64_t tail = ~uint64_t(0) << (h.stateCount % 64);
+      ensure(!(initials[words - 1] & tail) && !(finals[words - 1] & tail));
+    }
+
+    ensure(stateIndex[0] == 0 && stateIndex[h.stateCount] == h.transitionCount);
+    for (size_t q = 0; q < h.stateCount; ++q) {
+      ensure(stateIndex[q] <= stateIndex[q + 1]);
+    }
+    for (size_t ix = 0; ix < h.transitionCount; ++ix) {
+      ensure(transitions[ix].state < h.stateCount);
+      ensure(transitions[ix].pred < h.predicateCount);
+    }
+
+    for (size_t ix = 0; ix < h.predicateCount; ++ix) {
+      const ImagePredicate& p = predicates.predicates[ix];
+      ensure(p.code <= h.codeSize && p.codeSize <= h.codeSize - p.code);
+      ensure(p.entries <= h.codeSize && p.entryCount <= h.codeSize - p.entries);
+      ensure(verify(predicates[ix], h.atomicCount));
+    }
+
+    if (h.classCount > 0) {
+      ensure(!nfasl);
+      // a node refers only to nodes with greater index, so there are no cycles
+      auto ref = [&](uint32_t r, size_t parent) {
+        return (r & DfaslTable::Leaf)
+          ? (r & ~DfaslTable::Leaf) < h.classCount
+          : r < h.nodeCount && (parent == h.nodeCount || r > parent);
+      };
+      ensure(ref(h.root, h.nodeCount));
+      for (size_t ix = 0; ix < h.nodeCount; ++ix) {
+        ensure(classifier[ix].atomic < h.atomicCount);
+        ensure(ref(classifier[ix].lo, ix) && ref(classifier[ix].hi, ix));
+      }
+      size_t entries = (size_t(h.stateCount) + 1)*h.classCount;
+      for (size_t ix = 0; ix < entries; ++ix) {
+        ensure(table[ix] <= h.stateCount);
+      }
+    } else {
+      ensure(h.nodeCount == 0);
+    }
+
+    size_t offsets = size_t(h.atomicCount)*sizeof(uint32_t);
+    ensure(offsets <= h.namesSize);
+    ensure(h.atomicCount == 0 || names[h.namesSize - 1] == 0);
+    for (size_t ix = 0; ix < h.atomicCount; ++ix) {
+      ensure(nameOffsets[ix] >= offsets && nameOffsets[ix] < h.namesSize);
+    }
+
+    if (counters) {
+      ensure(nfasl);
+      checkCounters();
+    }
+
+    // executors skip absorbing states and fail in dead ones, so these flags must hold
+    if (flags) {
+      boost::dynamic_bitset<> live = liveStates();
+      for (State q = 0; q < h.stateCount; ++q) {
+        ensure(flags[q] <= (State_Dead | State_Absorbing));
+        if (flags[q] & State_Absorbing) {
+          ensure(absorbing(q) && !(counters && counters[q].counting()));
+        }
+        if (flags[q] & State_Dead) {
+          ensure(!live[q]);
+        }
+      }
+    }
+  }
+
+  boost::dynamic_bitset<> Image::liveStates() const {
+    // rules and the table (with the sink)
+    size_t n = size_t(header->stateCount) + (hasTable() ? 1 : 0);
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    boost::dynamic_bitset<> finals(n);
+    for (State q = 0; q < header->stateCount; ++q) {
+      finals[q] = isFinal(q);
+      for (auto tr = begin(q); tr != end(q); ++tr) {
+        edges.push_back({ q, tr->state });
+      }
+    }
+    // a row repeats targets, edges are distinct (`seen` is stamped by row)
+    std::vector<State> seen(hasTable() ? n : 0, State(-1));
+    for (State q = 0; hasTable() && q <= sink(); ++q) {
+      for (Class c = 0; c < header->classCount; ++c) {
+        State t = next(q, c);
+        if (seen[t] != q) {
+          seen[t] = q;
+          edges.push_back({ q, t });
+        }
+      }
+    }
+    return rt::liveStates(edges, finals);
+  }
+
+  void Image::checkCounters() {
+    for (State q = 0; q < header->stateCount; ++q) {
+      const Counter& counter = counters[q];
+      ensure(counter.counting() ? counter.min <= counter.max && counter.min < Counter::Unbounded
+                                : counter.min == 0);
+      // a run starts outside of counting states
+      ensure(!counter.counting() || !isInitial(q));
+      for (auto tr = begin(q); tr != end(q); ++tr) {
+        const ImageAnnotation& a = annotation(tr);
+        const Counter& target = counters[tr->state];
+        ensure(a.guard == Guard_None || counter.counting());
+        ensure(a.guard <= Guard_Exit);
+        switch (a.action) {
+        case Action_None:
+          ensure(!target.counting());
+          break;
+        case Action_Enter:
+          ensure(target.counting());
+          break;
+        case Action_Increment:
+          ensure(tr->state == q && a.guard == Guard_Loop && counter.counting());
+          break;
+        default:
+          ensure(false);
+        }
+      }
+    }
+  }
+
+  bool Image::absorbing(State q) const {
+    if (hasTable()) {
+      for (Class c = 0; c < header->classCount; ++c) {
+        if (next(q, c) != q) {
+          return false;
+        }
+      }
+      return true;
+    }
+    // the first `true` rule, as in `stateFlags`
+    bool nfasl = header->kind != Image_Dfasl;
+    bool any = false;
+    for (auto tr = begin(q); tr != end(q) && !(any && !nfasl); ++tr) {
+      if (tr->state != q) {
+        return false;
+      }
+      any = any || isTrue(predicates[tr->pred]);
+    }
+    return any;
+  }
+
+  void ImageNfaslContext::checkFinals() {
+    for (size_t q = currentStates.find_first();
+         q != States::npos;
+         q = currentStates.find_next(q)) {
+      if (image->isFinal(q)) {
+        ok();
+        return;
+      }
+    }
+    partial();
+  }
+
+  void ImageNfaslContext::reset() {
+    result = Match_Partial;
+    currentStates.resize(image->stateCount());
+    if (!image->hasFinals()) {
+      currentStates.reset();
+      fail();
+    } else {
+      const uint64_t* first = image->getInitials();
+      boost::from_block_range(first, first + currentStates.num_blocks(), currentStates);
+      checkFinals();
+    }
+  }
+
+  void ImageNfaslContext::advanceCached() {
+    if (idle()) {
+      return;
+    }
+    bool advanced = false;
+    nextStates.resize(image->stateCount());
+    nextStates.reset();
+    for (size_t q = currentStates.find_first();
+         q != States::npos;
+         q = currentStates.find_next(q)) {
+      for (auto tr = image->begin(q); tr != image->end(q); ++tr) {
+        if (cache.eval(tr->pred)) {
+          advanced = true;
+          nextStates.set(tr->state);
+        }
+      }
+    }
+    std::swap(currentStates, nextStates);
+    if (advanced) {
+      checkFinals();
+    } else {
+      fail();
+    }
+  }
+
+  void ImageNfaslContext::save(SnapshotWriter& writer) const {
+    writer.writeMatch(result);
+    writer.writeStates(currentStates);
+  }
+
+  void ImageNfaslContext::restore(SnapshotReader& reader) {
+    Match r = reader.readMatch();
+    States qs;
+    reader.readStates(qs, image->stateCount());
+    result = r;
+    std::swap(currentStates, qs);
+  }
+
+  void ImageDfaslContext::reset() {
+    result = Match_Partial;
+    if (!image->hasFinals()) {
+      currentState = image->sink();
+      fail();
+    } else {
+      step(image->initial());
+    }
+  }
+
+  void ImageDfaslContext::advance(const rt::Names& vars) {
+    if (idle()) {
+      return;
+    }
+    if (image->hasTable()) {
+      step(image->next(currentState, image->classify(vars)));
+      return;
+    }
+    // only one state is active, so no predicate is evaluated twice per event
+    const ImagePredicates& predicates = image->getPredicates();
+    for (auto tr = image->begin(currentState); tr != image->end(currentState); ++tr) {
+      if (predicates[tr->pred].eval(vars)) {
+        step(tr->state);
+        return;
+      }
+    }
+    step(image->sink());
+  }
+
+  void ImageDfaslContext::advanceBatch(const Events& events, Match* results) {
+    if (!image->hasTable() && !idle()) {
+      advanceEach(*this, events, results, batchVars);
+      return;
+    }
+    // events are classified in place, without unpacking
+    size_t ix = 0;
+    for (; ix < events.count && !idle(); ++ix) {
+      step(image->next(currentState, image->classify(events.row(ix))));
+      if (results) {
+        results[ix] = result;
+      }
+    }
+    if (results) {
+      std::fill(results + ix, results + events.count, result);
+    }
+  }
+
+  void ImageDfaslContext::save(SnapshotWriter& writer) const {
+    writer.writeMatch(result);
+    writer.writeValue(uint32_t(currentState));
+  }
+
+  void ImageDfaslContext::restore(SnapshotReader& reader) {
+    Match r = reader.readMatch();
+    uint32_t q;
+    reader.readValue(q);
+    reader.ensure(q <= image->sink());
+    result = r;
+    currentState = q;
+  }
+
+  /** Builds sections of an image in place */
+  class ImageWriter {
+  public:
+    ImageWriter(ImageKind kind, const std::vector<std::string>& atomics_)
+      : atomics(atomics_) {
+      memset(&header, 0, sizeof(header));
+      header.magic = imageMagic;
+      header.version = imageVersion;
+      header.kind = kind;
+      header.atomicCount = atomics.size();
+      header.namesSize = atomics.size()*sizeof(uint32_t);
+      for (auto const& name : atomics) {
+        header.namesSize += name.size() + 1;
+      }
+    }
+
+    template <typename Automaton>
+    void count(const Automaton& u) {
+      header.stateCount = u.stateCount;
+      header.transitionCount = 0;
+      for (auto const& trs : u.transitions) {
+        header.transitionCount += trs.size();
+      }
+      header.predicateCount = u.predicates.size();
+      header.codeSize = 0;
+      for (size_t ix = 0; ix < u.predicates.size(); ++ix) {
+        header.codeSize += u.predicates[ix].codeSize + u.predicates[ix].entryCount;
+      }
+    }
+
+    /** Allocate the image, after all counts are known */
+    void allocate(std::vector<uint8_t>& data_) {
+      data = &data_;
+      layout = std::make_unique<ImageLayout>(header);
+      header.size = layout->size;
+      data->assign(layout->size, 0);
+    }
+
+    template <typename Automaton>
+    void rules(const Automaton& u) {
+      uint32_t* index = section<uint32_t>(layout->stateIndex);
+      ImageTransition* trs = section<ImageTransition>(layout->transitions);
+      size_t n = 0;
+      for (size_t q = 0; q < u.stateCount; ++q) {
+        index[q] = n;
+        for (auto const& tr : u.transitions[q]) {
+          trs[n++] = { uint32_t(tr.state), tr.pred };
+        }
+      }
+      index[u.stateCount] = n;
+
+      ImagePredicate* predicates = section<ImagePredicate>(layout->predicates);
+      Program::Word* code = section<Program::Word>(layout->code);
+      uint32_t at = 0;
+      for (size_t ix = 0; ix < u.predicates.size(); ++ix) {
+        const ProgramView& prog = u.predicates[ix];
+        predicates[ix] = { at, uint32_t(prog.codeSize),
+                           uint32_t(at + prog.codeSize), uint32_t(prog.entryCount) };
+        std::copy(prog.code, prog.code + prog.codeSize, code + at);
+        at += prog.codeSize;
+        std::copy(prog.entries, prog.entries + prog.entryCount, code + at);
+        at += prog.entryCount;
+      }
+    }
+
+    void initial(size_t q) { set(layout->initials, q); }
+    void final(size_t q) { set(layout->finals, q); }
+
+    void table(const DfaslTable& t) {
+      ImageNode* nodes = section<ImageNode>(layout->classifier);
+      for (size_t ix = 0; ix < t.classifier.size(); ++ix) {
+        const DfaslTable::Node& node = t.classifier[ix];
+        nodes[ix] = { node.atomic, node.lo, node.hi };
+      }
+      std::copy(t.table.begin(), t.table.end(), section<uint32_t>(layout->table));
+    }
+
+    /** Counters and rule annotations, `header.counting` is set */
+    void counters(const Nfasl& u) {
+      std::copy(u.counters.begin(), u.counters.end(), section<Counter>(layout->counters));
+      ImageAnnotation* annotations = section<ImageAnnotation>(layout->annotations);
+      for (auto const& trs : u.transitions) {
+        for (auto const& tr : trs) {
+          *annotations++ = { tr.guard, tr.action };
+        }
+      }
+    }
+
+    /** `StateFlag`s of states, the sink of a table is not stored */
+    void flags(const StateFlags& f) {
+      std::copy(f.begin(), f.begin() + header.stateCount, section<uint8_t>(layout->flags));
+    }
+
+    /** Write names and the header */
+    void finish() {
+      uint32_t* offsets = section<uint32_t>(layout->names);
+      char* chars = section<char>(layout->names);
+      size_t at = atomics.size()*sizeof(uint32_t);
+      for (size_t ix = 0; ix < atomics.size(); ++ix) {
+        offsets[ix] = at;
+        memcpy(chars + at, atomics[ix].c_str(), atomics[ix].size() + 1);
+        at += atomics[ix].size() + 1;
+      }
+      memcpy(data->data(), &header, sizeof(header));
+      header.checksum = imageChecksum(data->data(), data->size());
+      memcpy(data->data(), &header, sizeof(header));
+    }
+
+    ImageHeader header;
+
+  private:
+    template <typename T>
+    T* section(size_t offset) {
+      return reinterpret_cast<T*>(data->data() + offset);
+    }
+
+    void set(size_t offset, size_t q) {
+      section<uint64_t>(offset)[q >> 6] |= uint64_t(1) << (q & 63);
+    }
+
+    const std::vector<std::string>& atomics;
+    std::vector<uint8_t>* data = nullptr;
+    std::unique_ptr<ImageLayout> layout;
+  };
+
+  void writeImage(const Nfasl& nfasl,
+                  const std::vector<std::string>& atomics,
+                  std::vector<uint8_t>& data,
+                  ImageKind kind,
+                  size_t cacheSize) {
+    ImageWriter writer(kind, atomics);
+    writer.header.cacheSize = cacheSize;
+    writer.header.window = nfasl.window;
+    writer.header.counting = !nfasl.counters.empty();
+    writer.count(nfasl);
+    writer.allocate(data);
+    writer.rules(nfasl);
+    if (writer.header.counting) {
+      writer.counters(nfasl);
+    }
+    for (size_t q = 0; q < nfasl.stateCount; ++q) {
+      if (nfasl.initials.test(q)) {
+        writer.initial(q);
+      }
+      if (nfasl.finals.test(q)) {
+        writer.final(q);
+      }
+    }
+    writer.flags(stateFlags(nfasl));
+    writer.finish();
+  }
+
+  void writeImage(const Dfasl& dfasl,
+                  const DfaslTable* table,
+                  const std::vector<std::string>& atomics,
+                  std::vector<uint8_t>& data) {
+    ImageWriter writer(Image_Dfasl, atomics);
+    writer.header.initial = dfasl.initial;
+    writer.header.window = dfasl.window;
+    writer.count(dfasl);
+    if (table) {
+      writer.header.classCount = table->classCount;
+      writer.header.nodeCount = table->classifier.size();
+      writer.header.root = table->root;
+    }
+    writer.allocate(data);
+    writer.rules(dfasl);
+    if (dfasl.stateCount > 0) {
+      writer.initial(dfasl.initial);
+    }
+    for (auto q : dfasl.finals) {
+      writer.final(q);
+    }
+    if (table) {
+      writer.table(*table);
+    }
+    writer.flags(table ? stateFlags(*table) : stateFlags(dfasl));
+    writer.finish();
+  }
+
+  template <typename Automaton>
+  static void toRules(std::shared_ptr<const Image> image, Automaton& u) {
+    const ImagePredicates& predicates = image->getPredicates();
+    u.atomicCount = image->atomicCount();
+    u.stateCount = image->stateCount();
+    u.transitions.resize(u.stateCount);
+    // predicates of an image are distinct already
+    for (size_t ix = 0; ix < predicates.size(); ++ix) {
+      u.predicates.add(predicates[ix], image);
+    }
+    for (Image::State q = 0; q < image->stateCount(); ++q) {
+      for (auto tr = image->begin(q); tr != image->end(q); ++tr) {
+        u.transitions[q].push_back({ {}, decltype(u.stateCount)(tr->state), tr->pred });
+      }
+    }
+  }
+
+  std::shared_ptr<Nfasl> toNfasl(std::shared_ptr<const Image> image) {
+    ensure(image->kind() != Image_Dfasl);
+    auto nfasl = std::make_shared<Nfasl>();
+    toRules(image, *nfasl);
+    nfasl->initials.resize(nfasl->stateCount);
+    nfasl->finals.resize(nfasl->stateCount);
+    for (Image::State q = 0; q < image->stateCount(); ++q) {
+      nfasl->initials[q] = image->isInitial(q);
+      nfasl->finals[q] = image->isFinal(q);
+    }
+    if (image->counting()) {
+      nfasl->counters.resize(nfasl->stateCount);
+      for (Image::State q = 0; q < image->stateCount(); ++q) {
+        nfasl->counters[q] = image->counter(q);
+        auto rule = nfasl->transitions[q].begin();
+        for (auto tr = image->begin(q); tr != image->end(q); ++tr, ++rule) {
+          rule->guard = Guard(image->annotation(tr).guard);
+          rule->action = Action(image->annotation(tr).action);
+        }
+      }
+    }
+    nfasl->flags = stateFlags(*nfasl);
+    nfasl->window = image->window();
+    return nfasl;
+  }
+
+  std::shared_ptr<Dfasl> toDfasl(std::shared_ptr<const Image> image) {
+    ensure(image->kind() == Image_Dfasl);
+    auto dfasl = std::make_shared<Dfasl>();
+    toRules(image, *dfasl);
+    dfasl->initial = image->initial();
+    for (Image::State q = 0; q < image->stateCount(); ++q) {
+      if (image->isFinal(q)) {
+        dfasl->finals.insert(q);
+      }
+    }
+    dfasl->flags = stateFlags(*dfasl);
+    dfasl->window = image->window();
+    return dfasl;
+  }
+
+  std::shared_ptr<DfaslTable> toDfaslTable(std::shared_ptr<const Image> image) {
+    ensure(image->kind() == Image_Dfasl);
+    if (!image->hasTable()) {
+      return nullptr;
+    }
+    auto table = std::make_shared<DfaslTable>();
+    table->atomicCount = image->atomicCount();
+    table->stateCount = image->stateCount();
+    table->initial = image->initial();
+    table->finals.resize(table->stateCount + 1);
+    for (Image::State q = 0; q < image->stateCount(); ++q) {
+      table->finals[q] = image->isFinal(q);
+    }
+    table->classCount = image->classCount();
+    table->root = image->root();
+    // `Node` is narrower than `ImageNode`, the classifier is small
+    table->classifier.resize(image->nodeCount());
+    for (size_t ix = 0; ix < table->classifier.size(); ++ix) {
+      const ImageNode& node = image->node(ix);
+      table->classifier[ix] = { Offset(node.atomic), node.lo, node.hi };
+    }
+    table->table.attach(image->getTable(),
+                        (size_t(table->stateCount) + 1)*table->classCount, image);
+    table->flags = stateFlags(*table);
+    table->window = image->window();
+    return table;
+  }
+
+} // namespace rt
@@ -0,0 +1,385 @@
+#ifndef RTIMAGE_HPP
+#define RTIMAGE_HPP
+
+#include "rt/RtPredicate.hpp"
+#include "rt/RtPredicatePool.hpp"
+#include "rt/RtProgram.hpp"
+#include "rt/RtSliced.hpp"
+#include "rt/RtNfasl.hpp"
+#include "rt/RtDfasl.hpp"
+#include "rt/RtDfaslTable.hpp"
+#include "rt/Executor.hpp"
+#include "rt/Loader.hpp"
+#include "Match.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rt {
+
+  enum ImageKind : uint16_t {
+    Image_Nfasl = 0,
+    Image_Dfasl = 1,
+    Image_LazyDfasl = 2, /** NFASL, determinized at runtime */
+  };
+
+  constexpr uint32_t imageMagic = 0x67616d69;
+  constexpr uint16_t imageVersion = 4;
+  /** Alignment of an image and of each of its sections */
+  constexpr size_t imageAlignment = 64;
+
+  /**
+   * Header of a binary automaton image
+   *
+   * The header is followed by sections, each aligned to `imageAlignment`:
+   * initial states and final states (bitmaps of 64-bit words),
+   * transition index (`stateCount + 1` offsets into transitions),
+   * transitions, predicates, predicate code, classifier nodes and
+   * the transition table (only DFASL with table form), atomic names,
+   * since version 2, `StateFlag`s (a byte per state) and, since version 4
+   * and only if `counting` is set, `Counter`s of states and annotations
+   * of transitions (`ImageAnnotation`).
+   * Offsets of sections are derived from the counts below.
+   * `window` is zero in images before version 3.
+   */
+  struct ImageHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t kind;            /** `ImageKind` */
+    uint64_t checksum;        /** `fingerprint` of the image past this field */
+    uint64_t size;            /** size of the image (bytes) */
+    uint64_t cacheSize;       /** cache limit of `Image_LazyDfasl` executor */
+    uint32_t atomicCount;
+    uint32_t stateCount;
+    uint32_t initial;         /** initial state of DFASL */
+    uint32_t transitionCount;
+    uint32_t predicateCount;
+    uint32_t codeSize;        /** predicate code (words) */
+    uint32_t classCount;      /** DFASL table columns, zero without table form */
+    uint32_t nodeCount;       /** DFASL classifier nodes */
+    uint32_t root;            /** DFASL classifier root, see `DfaslTable::NodeRef` */
+    uint32_t namesSize;       /** atomic names (bytes) */
+    uint64_t window;          /** time window of a match, see `RtClock` */
+    uint32_t counting;        /** NFASL has counting states, see `Counter` */
+    uint8_t reserved[44];
+  };
+
+  static_assert(sizeof(ImageHeader) == 2*imageAlignment, "unexpected image header size");
+
+  struct ImageTransition {
+    uint32_t state;
+    PredicateIndex pred;
+  };
+
+  /** Counter guard and action of a transition, see `StateTransition` */
+  struct ImageAnnotation {
+    uint8_t guard;  /** `Guard` */
+    uint8_t action; /** `Action` */
+  };
+
+  /** Predicate program, offsets are in words of predicate code */
+  struct ImagePredicate {
+    uint32_t code;
+    uint32_t codeSize;
+    uint32_t entries;
+    uint32_t entryCount;
+  };
+
+  /** DFASL classifier node, see `DfaslTable::Node` */
+  struct ImageNode {
+    uint32_t atomic;
+    uint32_t lo;
+    uint32_t hi;
+  };
+
+  /** Predicates of an image, a pool for `BasicSlicedPredicateCache` */
+  class ImagePredicates {
+  public:
+    size_t size() const { return count; }
+    ProgramView operator[] (PredicateIndex ix) const {
+      const ImagePredicate& p = predicates[ix];
+      return { code + p.code, p.codeSize, code + p.entries, p.entryCount };
+    }
+
+  private:
+    friend class Image;
+
+    const ImagePredicate* predicates = nullptr;
+    size_t count = 0;
+    const Program::Word* code = nullptr;
+  };
+
+  typedef BasicSlicedPredicateCache<ImagePredicates> ImagePredicateCache;
+
+  /**
+   * Binary automaton image
+   *
+   * An image is checked once, when it is opened, and is used
+   * in place afterwards: executors read states, transitions and
+   * predicate code directly from the image, so it may be kept in
+   * mapped memory.
+   */
+  class Image {
+  public:
+    typedef uint32_t State;
+    typedef uint32_t Class;
+    /** Memory of an image, it must be aligned to 8 bytes */
+    typedef std::shared_ptr<const uint8_t> Storage;
+
+    /** Check an image, throws `LoadingFailed` */
+    Image(Storage storage, size_t size);
+
+    /** Check if data looks like an image (by magic only) */
+    static bool probe(const void* data, size_t size);
+    /** Copy data into storage aligned to `imageAlignment` */
+    static Storage copy(const void* data, size_t size);
+
+    /** Image memory, it is kept alive by the image */
+    const uint8_t* data() const { return storage.get(); }
+    size_t size() const { return header->size; }
+    ImageKind kind() const { return ImageKind(header->kind); }
+    uint64_t checksum() const { return header->checksum; }
+    size_t cacheSize() const { return header->cacheSize; }
+    /** Time window of a match, zero if none (see `RtClock`) */
+    Timestamp window() const { return header->version >= 3 ? header->window : 0; }
+    size_t atomicCount() const { return header->atomicCount; }
+    State stateCount() const { return header->stateCount; }
+    State initial() const { return header->initial; }
+    const char* atomicName(size_t ix) const { return names + nameOffsets[ix]; }
+
+    bool isInitial(State q) const { return (initials[q >> 6] >> (q & 63)) & 1; }
+    /** NFASL has counting states, `ImageNfaslContext` does not run it */
+    bool counting() const { return counters != nullptr; }
+    /** `Counter` of a state, the image is `counting` */
+    const Counter& counter(State q) const { return counters[q]; }
+    /** Annotation of a transition, the image is `counting` */
+    const ImageAnnotation& annotation(const ImageTransition* tr) const {
+      return annotations[tr - transitions];
+    }
+    /** `StateFlag`s of a state, none in images of version 1 */
+    uint8_t stateFlags(State q) const { return flags ? flags[q] : 0; }
+    bool isFinal(State q) const { return (finals[q >> 6] >> (q & 63)) & 1; }
+    bool hasFinals() const { return anyFinal; }
+    const uint64_t* getInitials() const { return initials; }
+
+    const ImageTransition* begin(State q) const { return transitions + stateIndex[q]; }
+    const ImageTransition* end(State q) const { return transitions + stateIndex[q + 1]; }
+    const ImagePredicates& getPredicates() const { return predicates; }
+
+    /** DFASL has table form, see `DfaslTable` */
+    bool hasTable() const { return header->classCount > 0; }
+    State sink() const { return header->stateCount; }
+    size_t classCount() const { return header->classCount; }
+    size_t nodeCount() const { return header->nodeCount; }
+    uint32_t root() const { return header->root; }
+    const ImageNode& node(size_t ix) const { return classifier[ix]; }
+
+    Class classify(const Names& vars) const {
+      uint32_t r = header->root;
+      while (!(r & DfaslTable::Leaf)) {
+        const ImageNode& node = classifier[r];
+        r = vars.test(node.atomic) ? node.hi : node.lo;
+      }
+      return r & ~DfaslTable::Leaf;
+    }
+
+    /** `classify` over a packed event, see `Events` */
+    Class classify(const uint8_t* row) const {
+      uint32_t r = header->root;
+      while (!(r & DfaslTable::Leaf)) {
+        const ImageNode& node = classifier[r];
+        r = Events::test(row, node.atomic) ? node.hi : node.lo;
+      }
+      return r & ~DfaslTable::Leaf;
+    }
+
+    State next(State q, Class c) const {
+      return table[size_t(q)*header->classCount + c];
+    }
+    /** Transition table, `(stateCount + 1) x classCount` cells */
+    const uint32_t* getTable() const { return table; }
+
+  private:
+    void check();
+    /** Counters of states and annotations of their rules are consistent */
+    void checkCounters();
+    /** `State_Absorbing` holds for `q` */
+    bool absorbing(State q) const;
+    /** States which reach a final state by rules or the table */
+    boost::dynamic_bitset<> liveStates() const;
+
+    Storage storage;
+    const ImageHeader* header;
+    const uint64_t* initials;
+    const uint64_t* finals;
+    const uint32_t* stateIndex;
+    const ImageTransition* transitions;
+    ImagePredicates predicates;
+    const ImageNode* classifier;
+    const uint32_t* table;
+    const uint32_t* nameOffsets;
+    const char* names;
+    const uint8_t* flags;
+    const Counter* counters;
+    const ImageAnnotation* annotations;
+    bool anyFinal;
+  };
+
+  /** `NfaslContext` over an image without counting states */
+  class ImageNfaslContext : public Executor {
+  public:
+    ImageNfaslContext (std::shared_ptr<const Image> image_) : image(image_) {
+      cache.attach(image->getPredicates());
+      absorbing.resize(image->stateCount());
+      for (Image::State q = 0; q < image->stateCount(); ++q) {
+        absorbing[q] = (image->stateFlags(q) & State_Absorbing) != 0;
+      }
+      reset();
+    }
+    Match getResult() const override { return result; }
+    /** All active states are absorbing, so a step changes nothing */
+    bool idle() const { return currentStates.is_subset_of(absorbing); }
+
+    void reset() override;
+    void advance(const Names& vars) override {
+      cache.next(vars);
+      advanceCached();
+    }
+    void advanceBatch(const Events& events, Match* results) override {
+      advanceSliced(*this, cache, events, results);
+    }
+    /** Advance over the event selected in `cache`, see `advanceSliced` */
+    void advanceCached();
+    void save(SnapshotWriter& writer) const override;
+    void restore(SnapshotReader& reader) override;
+
+  private:
+    void fail() { result = Match_Failed; }
+
+    void ok() {
+      if (result != Match_Failed) {
+        result = Match_Ok;
+      }
+    }
+
+    void partial() {
+      if (result != Match_Failed) {
+        result = Match_Partial;
+      }
+    }
+
+    void checkFinals();
+
+  private:
+    std::shared_ptr<const Image> image;
+    ImagePredicateCache cache;
+    States absorbing;
+    States currentStates;
+    States nextStates; /** buffer for `advance` */
+
+    Match result;
+  };
+
+  /**
+   * `DfaslTableContext` over an image
+   *
+   * Transition rules are interpreted if the image has no table form.
+   */
+  class ImageDfaslContext : public Executor {
+  public:
+    ImageDfaslContext (std::shared_ptr<const Image> image_) : image(image_) { reset(); }
+    Match getResult() const override { return result; }
+    /** The state is absorbing (or the sink), so a step changes nothing */
+    bool idle() const {
+      return currentState == image->sink()
+        || (image->stateFlags(currentState) & State_Absorbing);
+    }
+
+    void reset() override;
+    void advance(const Names& vars) override;
+    void advanceBatch(const Events& events, Match* results) override;
+    void save(SnapshotWriter& writer) const override;
+    void restore(SnapshotReader& reader) override;
+
+  private:
+    void fail() { result = Match_Failed; }
+
+    void ok() {
+      if (result != Match_Failed) {
+        result = Match_Ok;
+      }
+    }
+
+    void partial() {
+      if (result != Match_Failed) {
+        result = Match_Partial;
+      }
+    }
+
+    /** A dead state fails at once and stops in the sink */
+    void step(Image::State q) {
+      currentState = q;
+      if (currentState == image->sink()) {
+        fail();
+      } else if (image->isFinal(currentState)) {
+        ok();
+      } else if (image->stateFlags(currentState) & State_Dead) {
+        currentState = image->sink();
+        fail();
+      } else {
+        partial();
+      }
+    }
+
+  private:
+    std::shared_ptr<const Image> image;
+    Image::State currentState;
+
+    Match result;
+  };
+
+  /**
+   * Write NFASL image
+   *
+   * @param[in] nfasl runtime NFASL
+   * @param[in] atomics atomic names
+   * @param[out] data image
+   * @param[in] kind `Image_Nfasl` or `Image_LazyDfasl`
+   * @param[in] cacheSize cache limit of `Image_LazyDfasl` executor
+   */
+  extern void writeImage(const Nfasl& nfasl,
+                         const std::vector<std::string>& atomics,
+                         std::vector<uint8_t>& data,
+                         ImageKind kind = Image_Nfasl,
+                         size_t cacheSize = 0);
+
+  /**
+   * Write DFASL image
+   *
+   * @param[in] dfasl runtime DFASL
+   * @param[in] table its table form (may be nullptr)
+   * @param[in] atomics atomic names
+   * @param[out] data image
+   */
+  extern void writeImage(const Dfasl& dfasl,
+                         const DfaslTable* table,
+                         const std::vector<std::string>& atomics,
+                         std::vector<uint8_t>& data);
+
+  /**
+   * Rebuild runtime structures from an image
+   *
+   * Predicates are kept compiled only, `phi` of transitions is empty.
+   * Predicate code and the transition table are not copied, they are
+   * used in place and the result keeps the image alive.
+   */
+  extern std::shared_ptr<Nfasl> toNfasl(std::shared_ptr<const Image> image);
+  extern std::shared_ptr<Dfasl> toDfasl(std::shared_ptr<const Image> image);
+  /** @returns nullptr if the image has no table form */
+  extern std::shared_ptr<DfaslTable> toDfaslTable(std::shared_ptr<const Image> image);
+
+} // namespace rt
+
+#endif //RTIMAGE_HPP
@@ -0,0 +1,31 @@
+#include "rt/RtKeyed.hpp"
+
+namespace rt {
+
+  template <size_t N>
+  static KeyedExecutorPtr makeKeyed(const Nfasl& nfasl) {
+    return std::make_shared<KeyedMonitors<NfaslBitsMonitor<N>>>
+      (NfaslBitsMonitor<N>(NfaslBits<N>::make(nfasl)));
+  }
+
+  KeyedExecutorPtr createKeyedExecutor(std::shared_ptr<DfaslTable> dfasl) {
+    return std::make_shared<KeyedMonitors<DfaslTableMonitor>>(DfaslTableMonitor(dfasl));
+  }
+
+  KeyedExecutorPtr createKeyedExecutor(const Nfasl& nfasl) {
+    if (!nfasl.counters.empty()) {
+      return nullptr;
+    }
+    if (nfasl.stateCount <= StateBits<1>::Capacity) {
+      return makeKeyed<1>(nfasl);
+    }
+    if (nfasl.stateCount <= StateBits<2>::Capacity) {
+      return makeKeyed<2>(nfasl);
+    }
+    if (nfasl.stateCount <= StateBits<4>::Capacity) {
+      return makeKeyed<4>(nfasl);
+    }
+    return nullptr;
+  }
+
+} //namespace rt
@@ -0,0 +1,473 @@
+#ifndef RTKEYED_HPP
+#define RTKEYED_HPP
+
+#include "rt/RtPredicate.hpp"
+#include "rt/RtDfaslTable.hpp"
+#include "rt/RtNfaslBits.hpp"
+#include "rt/RtTimerWheel.hpp"
+#include "Match.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace rt {
+
+  typedef uint64_t MonitorKey;
+  typedef uint64_t MonitorTime; /** event count, clock ticks, etc. */
+
+  /**
+   * Many instances of one automaton, one per key
+   *
+   * The automaton is shared, an instance is just its state.
+   * An instance is created (in the initial state)
+   * when its key is advanced for the first time.
+   *
+   * An instance in the initial state carries no information,
+   * so it may be removed without changing any results.
+   * Idle instances may be expired, see `setExpiry`.
+   */
+  class KeyedExecutor {
+  public:
+    typedef std::function<void(MonitorKey, Match)> Visitor;
+
+    /** Result of an absent instance */
+    virtual Match getInitialResult() const = 0;
+    virtual Match getResult(MonitorKey key) const = 0;
+
+    virtual Match advance(MonitorKey key, const Names& vars) = 0;
+
+    virtual bool contains(MonitorKey key) const = 0;
+    /** @returns false if there is no such instance */
+    virtual bool erase(MonitorKey key) = 0;
+    virtual size_t size() const = 0;
+    virtual void clear() = 0;
+    virtual void reserve(size_t count) = 0;
+
+    /** call `visitor` for every instance */
+    virtual void forEach(const Visitor& visitor) const = 0;
+
+    /**
+     * Configure removal of instances
+     *
+     * Existing instances are considered active at `now()`.
+     *
+     * @param[in] timeout remove an instance not advanced for `timeout` ticks (0 - never)
+     * @param[in] dropInitial remove an instance as soon as it is back in the initial state
+     */
+    virtual void setExpiry(MonitorTime timeout, bool dropInitial) = 0;
+
+    /**
+     * Move time forward and remove expired instances
+     *
+     * @param[in] now current time (not earlier than the previous one)
+     * @param[in] expired called for every removed instance (may be empty)
+     * @returns number of removed instances
+     */
+    virtual size_t tick(MonitorTime now, const Visitor& expired = Visitor()) = 0;
+    virtual MonitorTime now() const = 0;
+
+    /** Append all instances to a snapshot */
+    virtual void save(SnapshotWriter& writer) const = 0;
+    /** Replace all instances with saved ones, throws `RestoreFailed` */
+    virtual void restore(SnapshotReader& reader) = 0;
+
+    virtual ~KeyedExecutor() {}
+  };
+
+  typedef std::shared_ptr<KeyedExecutor> KeyedExecutorPtr;
+
+  /**
+   * Instance state of a table driven DFASL: a state id
+   */
+  class DfaslTableMonitor {
+  public:
+    typedef DfaslTable::State State;
+
+    DfaslTableMonitor(std::shared_ptr<DfaslTable> dfasl_) : dfasl(dfasl_) {}
+
+    State initial() const {
+      return dfasl->finals.none() ? dfasl->sink() : dfasl->initial;
+    }
+
+    State next(State q, const Names& vars) const {
+      if (q == dfasl->sink()) {
+        return q;
+      }
+      return dfasl->next(q, dfasl->classify(vars));
+    }
+
+    bool valid(State q) const { return q <= dfasl->sink(); }
+
+    Match result(State q) const {
+      if (q == dfasl->sink()) {
+        return Match_Failed;
+      }
+      return dfasl->finals.test(q) ? Match_Ok : Match_Partial;
+    }
+
+  private:
+    std::shared_ptr<DfaslTable> dfasl;
+  };
+
+  /**
+   * Instance state of a small NFASL: an inline set of states
+   */
+  template <size_t N>
+  class NfaslBitsMonitor {
+  public:
+    typedef typename NfaslBits<N>::Bits State;
+
+    NfaslBitsMonitor(std::shared_ptr<NfaslBits<N>> nfasl_) : nfasl(nfasl_) {}
+
+    State initial() const {
+      return nfasl->finals.any() ? nfasl->initials : State{};
+    }
+
+    State next(const State& q, const Names& vars) const {
+      State nextStates;
+      const NfaslBits<N>& a = *nfasl;
+      q.forEach([&a, &vars, &nextStates](size_t p) {
+          for (uint32_t ix = a.edgeIndex[p]; ix < a.edgeIndex[p + 1]; ++ix) {
+            auto const& e = a.edges[ix];
+            if (!nextStates.includes(e.succ) && a.predicates[e.pred].eval(vars)) {
+              nextStates |= e.succ;
+            }
+          }
+        });
+      return nextStates;
+    }
+
+    bool valid(const State& q) const {
+      for (size_t p = nfasl->stateCount; p < State::Capacity; ++p) {
+        if (q.test(p)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    Match result(const State& q) const {
+      if (!q.any()) {
+        return Match_Failed;
+      }
+      return q.intersects(nfasl->finals) ? Match_Ok : Match_Partial;
+    }
+
+  private:
+    std::shared_ptr<NfaslBits<N>> nfasl;
+  };
+
+  /**
+   * Flat open addressing (linear probing) table of instances
+   *
+   * Keys, states and occupancy are kept in separate arrays,
+   * so an instance costs `sizeof(MonitorKey) + sizeof(State) + 1`
+   * bytes per slot (and two more timestamps if instances expire).
+   *
+   * Every expiring instance has a single timer in a timer wheel,
+   * at the time it would expire if it was not advanced since then.
+   * When the timer fires and the instance was advanced meanwhile,
+   * it is rescheduled, so advancing does not touch the wheel.
+   */
+  template <typename Monitor>
+  class KeyedMonitors : public KeyedExecutor {
+  public:
+    typedef typename Monitor::State State;
+
+    KeyedMonitors(Monitor monitor_)
+      : monitor(monitor_), initialState(monitor.initial()) {}
+
+    Match getInitialResult() const override {
+      return monitor.result(initialState);
+    }
+
+    Match getResult(MonitorKey key) const override {
+      size_t ix = find(key);
+      return monitor.result(ix == npos ? initialState : states[ix]);
+    }
+
+    Match advance(MonitorKey key, const Names& vars) override {
+      size_t ix = insert(key);
+      State& q = states[ix];
+      q = monitor.next(q, vars);
+      Match r = monitor.result(q);
+      if (dropInitial && q == initialState) {
+        remove(ix);
+      } else if (timeout) {
+        touched[ix] = wheel.now();
+      }
+      return r;
+    }
+
+    bool contains(MonitorKey key) const override {
+      return find(key) != npos;
+    }
+
+    bool erase(MonitorKey key) override {
+      size_t ix = find(key);
+      if (ix == npos) {
+        return false;
+      }
+      remove(ix);
+      return true;
+    }
+
+    size_t size() const override { return count; }
+
+    void clear() override {
+      std::fill(used.begin(), used.end(), 0);
+      count = 0;
+      wheel.clear();
+    }
+
+    void reserve(size_t n) override {
+      size_t capacity = minCapacity;
+      while (capacity*maxLoad < n*loadBase) {
+        capacity *= 2;
+      }
+      if (capacity > used.size()) {
+        rehash(capacity);
+      }
+    }
+
+    void forEach(const Visitor& visitor) const override {
+      for (size_t ix = 0; ix < used.size(); ++ix) {
+        if (used[ix]) {
+          visitor(keys[ix], monitor.result(states[ix]));
+        }
+      }
+    }
+
+    void setExpiry(MonitorTime timeout_, bool dropInitial_) override {
+      timeout = timeout_;
+      dropInitial = dropInitial_;
+      wheel.clear();
+      touched.assign(timeout ? used.size() : 0, wheel.now());
+      scheduled.assign(timeout ? used.size() : 0, 0);
+      for (size_t ix = 0; ix < used.size(); ++ix) {
+        if (!used[ix]) {
+          continue;
+        }
+        if (dropInitial && states[ix] == initialState) {
+          remove(ix);
+          --ix; // another instance might have been shifted here
+        } else if (timeout) {
+          schedule(ix);
+        }
+      }
+    }
+
+    size_t tick(MonitorTime now, const Visitor& expired) override {
+      size_t removed = 0;
+      wheel.advance(now, [this, now, &expired, &removed](MonitorKey key, MonitorTime at) {
+          size_t ix = find(key);
+          if (ix == npos || scheduled[ix] != at) {
+            return; // stale timer
+          }
+          if (touched[ix] + timeout > now) {
+            schedule(ix);
+            return;
+          }
+          if (expired) {
+            expired(key, monitor.result(states[ix]));
+          }
+          remove(ix);
+          ++removed;
+        });
+      return removed;
+    }
+
+    MonitorTime now() const override { return wheel.now(); }
+
+    void save(SnapshotWriter& writer) const override {
+      writer.writeValue(uint64_t(wheel.now()));
+      writer.writeValue(uint8_t(timeout != 0));
+      writer.writeValue(uint64_t(count));
+      for (size_t ix = 0; ix < used.size(); ++ix) {
+        if (used[ix]) {
+          writer.writeValue(keys[ix]);
+          writer.writeValue(states[ix]);
+          if (timeout) {
+            writer.writeValue(touched[ix]);
+          }
+        }
+      }
+    }
+
+    void restore(SnapshotReader& reader) override {
+      uint64_t now;
+      uint8_t timed;
+      uint64_t n;
+      reader.readValue(now);
+      reader.readValue(timed);
+      reader.readValue(n);
+
+      // nothing is changed if the snapshot is broken
+      KeyedMonitors fresh(monitor);
+      fresh.setExpiry(timeout, dropInitial);
+      fresh.wheel.advance(now, [](MonitorKey, MonitorTime) {});
+      fresh.reserve(n);
+      while (n--) {
+        MonitorKey key;
+        State q;
+        MonitorTime t = now;
+        reader.readValue(key);
+        reader.readValue(q);
+        if (timed) {
+          reader.readValue(t);
+        }
+        reader.ensure(monitor.valid(q) && !fresh.contains(key));
+        size_t ix = fresh.insert(key);
+        fresh.states[ix] = q;
+        if (timeout) {
+          // the pending timer is late, so it will just expire the instance
+          fresh.touched[ix] = std::min(t, now);
+        }
+      }
+      reader.ensure(reader.atEnd());
+      *this = std::move(fresh);
+    }
+
+  private:
+    static constexpr size_t npos = ~size_t(0);
+    static constexpr size_t minCapacity = 16;
+    /** maximal load factor is `maxLoad/loadBase` */
+    static constexpr size_t maxLoad = 7;
+    static constexpr size_t loadBase = 8;
+
+    static size_t hash(MonitorKey key) {
+      // splitmix64 finalizer
+      key ^= key >> 30;
+      key *= 0xbf58476d1ce4e5b9ull;
+      key ^= key >> 27;
+      key *= 0x94d049bb133111ebull;
+      key ^= key >> 31;
+      return key;
+    }
+
+    size_t mask() const { return used.size() - 1; }
+
+    size_t find(MonitorKey key) const {
+      if (count == 0) {
+        return npos;
+      }
+      for (size_t ix = hash(key) & mask(); used[ix]; ix = (ix + 1) & mask()) {
+        if (keys[ix] == key) {
+          return ix;
+        }
+      }
+      return npos;
+    }
+
+    size_t insert(MonitorKey key) {
+      if ((count + 1)*loadBase > used.size()*maxLoad) {
+        rehash(used.empty() ? minCapacity : used.size()*2);
+      }
+      size_t ix = hash(key) & mask();
+      for (; used[ix]; ix = (ix + 1) & mask()) {
+        if (keys[ix] == key) {
+          return ix;
+        }
+      }
+      used[ix] = 1;
+      keys[ix] = key;
+      states[ix] = initialState;
+      ++count;
+      if (timeout) {
+        touched[ix] = wheel.now();
+        schedule(ix);
+      }
+      return ix;
+    }
+
+    void schedule(size_t ix) {
+      scheduled[ix] = touched[ix] + timeout;
+      wheel.schedule(keys[ix], scheduled[ix]);
+    }
+
+    void move(size_t to, size_t from) {
+      keys[to] = keys[from];
+      states[to] = states[from];
+      if (timeout) {
+        touched[to] = touched[from];
+        scheduled[to] = scheduled[from];
+      }
+    }
+
+    /** backward shift deletion, so no tombstones are needed */
+    void remove(size_t ix) {
+      size_t hole = ix;
+      for (size_t j = (ix + 1) & mask(); used[j]; j = (j + 1) & mask()) {
+        size_t home = hash(keys[j]) & mask();
+        // move `j` into the hole unless its home is in (hole, j]
+        bool stays = hole <= j
+          ? (hole < home && home <= j)
+          : (hole < home || home <= j);
+        if (!stays) {
+          move(hole, j);
+          hole = j;
+        }
+      }
+      used[hole] = 0;
+      --count;
+    }
+
+    void rehash(size_t capacity) {
+      std::vector<MonitorKey> oldKeys(capacity);
+      std::vector<State> oldStates(capacity);
+      std::vector<uint8_t> oldUsed(capacity, 0);
+      std::vector<MonitorTime> oldTouched(timeout ? capacity : 0);
+      std::vector<MonitorTime> oldScheduled(timeout ? capacity : 0);
+      std::swap(keys, oldKeys);
+      std::swap(states, oldStates);
+      std::swap(used, oldUsed);
+      std::swap(touched, oldTouched);
+      std::swap(scheduled, oldScheduled);
+      for (size_t ix = 0; ix < oldUsed.size(); ++ix) {
+        if (oldUsed[ix]) {
+          size_t jx = hash(oldKeys[ix]) & mask();
+          while (used[jx]) {
+            jx = (jx + 1) & mask();
+          }
+          used[jx] = 1;
+          keys[jx] = oldKeys[ix];
+          states[jx] = oldStates[ix];
+          if (timeout) {
+            touched[jx] = oldTouched[ix];
+            scheduled[jx] = oldScheduled[ix];
+          }
+        }
+      }
+    }
+
+    Monitor monitor;
+    State initialState;
+
+    std::vector<MonitorKey> keys;
+    std::vector<State> states;
+    std::vector<uint8_t> used;
+    size_t count = 0;
+
+    MonitorTime timeout = 0;
+    bool dropInitial = false;
+    std::vector<MonitorTime> touched; /** time of the last advance */
+    std::vector<MonitorTime> scheduled; /** time of the pending timer */
+    TimerWheel<MonitorKey> wheel;
+  };
+
+  /** Create keyed instances of a table driven DFASL */
+  extern KeyedExecutorPtr createKeyedExecutor(std::shared_ptr<DfaslTable> dfasl);
+
+  /**
+   * Create keyed instances of a small NFASL
+   *
+   * @returns nullptr if NFASL has more than `maxNfaslBitsStates` states
+   *          or counting states (see `Counter`)
+   */
+  extern KeyedExecutorPtr createKeyedExecutor(const Nfasl& nfasl);
+
+} // namespace rt
+
+#endif // RTKEYED_HPP
@@ -0,0 +1,212 @@
+#include "rt/RtLazyDfasl.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace rt {
+
+  static size_t powerOfTwo(size_t n) {
+    size_t r = 1;
+    while (r < n) {
+      r <<= 1;
+    }
+    return r;
+  }
+
+  static uint64_t hashBlocks(const States::block_type* p, size_t words) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t ix = 0; ix < words; ++ix) {
+      h = (h ^ p[ix]) * 0x100000001b3ull;
+    }
+    return h ^ (h >> 32);
+  }
+
+  LazyDfaslContext::LazyDfaslContext(std::shared_ptr<Nfasl> nfasl_,
+                                     size_t cacheSize)
+    : nfasl(nfasl_), edgeCount(0), flushCount(0) {
+    assert(nfasl->atomicCount <= maxLazyAtomics);
+    cache.attach(nfasl->predicates);
+    currentStates.resize(nfasl->stateCount);
+    nextStates.resize(nfasl->stateCount);
+    words = currentStates.num_blocks();
+
+    // a half of the budget is spent on states, the other on transitions
+    size_t perState = words*sizeof(Block) + sizeof(uint8_t) + 2*sizeof(StateId);
+    maxStates = std::max<size_t>(4, cacheSize / 2 / perState);
+    size_t edgeSlots = std::max<size_t>(16, powerOfTwo(cacheSize / 2 / sizeof(Edge) + 1) / 2);
+    maxEdges = edgeSlots / 4 * 3;
+
+    sets.reserve((maxStates + 1)*words);
+    finals.reserve(maxStates);
+    index.assign(powerOfTwo(2*maxStates), NoState);
+    edges.assign(edgeSlots, Edge{0, NoState, NoState});
+    unpacked.resize(nfasl->atomicCount);
+    reset();
+  }
+
+  LazyDfaslContext::EventKey LazyDfaslContext::toKey(const Names& vars) const {
+    EventKey key = 0;
+    for (size_t ix = vars.find_first(); ix != Names::npos; ix = vars.find_next(ix)) {
+      key |= EventKey(1) << ix;
+    }
+    return key;
+  }
+
+  LazyDfaslContext::EventKey LazyDfaslContext::toKey(const uint8_t* row) const {
+    EventKey key = 0;
+    size_t bytes = (nfasl->atomicCount + 7) / 8;
+    for (size_t ix = 0; ix < bytes; ++ix) {
+      key |= EventKey(row[ix]) << (8*ix);
+    }
+    // bits beyond `atomicCount` are not a part of the event
+    if (nfasl->atomicCount < 64) {
+      key &= (EventKey(1) << nfasl->atomicCount) - 1;
+    }
+    return key;
+  }
+
+  void LazyDfaslContext::load(StateId q, States& qs) const {
+    auto first = sets.begin() + size_t(q)*words;
+    boost::from_block_range(first, first + words, qs);
+  }
+
+  LazyDfaslContext::StateId LazyDfaslContext::intern(const States& qs) {
+    size_t tail = sets.size();
+    boost::to_block_range(qs, std::back_inserter(sets));
+
+    size_t mask = index.size() - 1;
+    size_t ix = hashBlocks(sets.data() + tail, words) & mask;
+    for (; index[ix] != NoState; ix = (ix + 1) & mask) {
+      const Block* p = sets.data() + size_t(index[ix])*words;
+      if (std::equal(p, p + words, sets.data() + tail)) {
+        sets.resize(tail);
+        return index[ix];
+      }
+    }
+
+    if (finals.size() == maxStates) {
+      flush();
+      return intern(qs);
+    }
+
+    StateId q = StateId(finals.size());
+    index[ix] = q;
+    finals.push_back(qs.intersects(nfasl->finals));
+    return q;
+  }
+
+  void LazyDfaslContext::addEdge(StateId source, EventKey event, StateId target) {
+    size_t mask = edges.size() - 1;
+    size_t ix = hash(source, event) & mask;
+    while (edges[ix].source != NoState) {
+      ix = (ix + 1) & mask;
+    }
+    edges[ix] = Edge{event, source, target};
+    ++edgeCount;
+  }
+
+  void LazyDfaslContext::flush() {
+    sets.clear();
+    finals.clear();
+    std::fill(index.begin(), index.end(), NoState);
+    std::fill(edges.begin(), edges.end(), Edge{0, NoState, NoState});
+    edgeCount = 0;
+    ++flushCount;
+  }
+
+  LazyDfaslContext::StateId LazyDfaslContext::compute(EventKey event, const Names& vars) {
+    load(current, currentStates);
+    nextStates.reset();
+    cache.next(vars);
+    for (size_t q = currentStates.find_first();
+         q != States::npos;
+         q = currentStates.find_next(q)) {
+      const StateTransitions& trs = nfasl->transitions[q];
+      for (auto& tr : trs) {
+        if (cache.eval(tr.pred)) {
+          nextStates.set(tr.state);
+        }
+      }
+    }
+
+    size_t flushes = flushCount;
+    if (edgeCount == maxEdges) {
+      flush();
+    }
+    StateId target = nextStates.none() ? Dead : intern(nextStates);
+    // the source state is gone, if the cache has been flushed
+    if (flushes == flushCount) {
+      addEdge(current, event, target);
+    }
+    return target;
+  }
+
+  void LazyDfaslContext::reset() {
+    result = Match_Partial;
+    if (nfasl->finals.none()) {
+      current = Dead;
+      fail();
+    } else {
+      step(intern(nfasl->initials));
+    }
+  }
+
+  void LazyDfaslContext::advance(const Names& vars) {
+    if (current == Dead) {
+      return;
+    }
+    EventKey event = toKey(vars);
+    StateId target = lookup(current, event);
+    if (target == NoState) {
+      target = compute(event, vars);
+    }
+    step(target);
+  }
+
+  void LazyDfaslContext::advanceBatch(const Events& events, Match* results) {
+    // events are unpacked only to compute a new transition
+    size_t ix = 0;
+    for (; ix < events.count && current != Dead; ++ix) {
+      const uint8_t* row = events.row(ix);
+      EventKey event = toKey(row);
+      StateId target = lookup(current, event);
+      if (target == NoState) {
+        events.unpack(row, unpacked);
+        target = compute(event, unpacked);
+      }
+      step(target);
+      if (results) {
+        results[ix] = result;
+      }
+    }
+    if (results) {
+      std::fill(results + ix, results + events.count, result);
+    }
+  }
+
+  void LazyDfaslContext::save(SnapshotWriter& writer) const {
+    States qs(nfasl->stateCount);
+    if (current != Dead) {
+      load(current, qs);
+    }
+    writer.writeMatch(result);
+    writer.writeStates(qs);
+  }
+
+  void LazyDfaslContext::restore(SnapshotReader& reader) {
+    Match r = reader.readMatch();
+    States qs;
+    reader.readStates(qs, nfasl->stateCount);
+    reader.ensure(r == Match_Failed || qs.any());
+    result = r;
+    current = qs.none() ? Dead : intern(qs);
+  }
+
+  ExecutorPtr createLazyDfaslContext(std::shared_ptr<Nfasl> nfasl, size_t cacheSize) {
+    if (nfasl->atomicCount > maxLazyAtomics || !nfasl->counters.empty()) {
+      return nullptr;
+    }
+    return std::make_shared<LazyDfaslContext>(nfasl, cacheSize);
+  }
+
+} //namespace rt
@@ -0,0 +1,152 @@
+#ifndef RTLAZYDFASL_HPP
+#define RTLAZYDFASL_HPP
+
+#include "rt/RtNfasl.hpp"
+#include "rt/RtPredicatePool.hpp"
+#include "rt/Executor.hpp"
+#include "Match.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace rt {
+  /** Default memory limit of `LazyDfaslContext` cache (bytes) */
+  constexpr size_t defaultLazyCacheSize = 1 << 20;
+
+  /** Maximal number of atomics supported by `LazyDfaslContext` */
+  constexpr size_t maxLazyAtomics = 64;
+
+  /**
+   * NFASL executor, which determinizes the automaton on the fly
+   *
+   * Every reached set of NFASL states becomes a DFASL state.
+   * A transition is computed by an NFASL step on the first event
+   * with the same atomic values and is looked up afterwards,
+   * so hot paths run at DFASL speed while only reached subsets
+   * are ever built.
+   *
+   * The cache is limited by `cacheSize` bytes and is allocated
+   * up front; when it is full, it is flushed and rebuilt starting
+   * from the current state.
+   */
+  class LazyDfaslContext : public Executor {
+  public:
+    typedef uint32_t StateId;
+    typedef uint64_t EventKey; /** atomic values, atomic `i` is bit `i` */
+
+    LazyDfaslContext (std::shared_ptr<Nfasl> nfasl_,
+                      size_t cacheSize = defaultLazyCacheSize);
+    Match getResult() const override { return result; }
+
+    void reset() override;
+    void advance(const Names& vars) override;
+    void advanceBatch(const Events& events, Match* results) override;
+    void save(SnapshotWriter& writer) const override;
+    void restore(SnapshotReader& reader) override;
+
+    /** Number of cached states */
+    size_t size() const { return finals.size(); }
+    /** Number of cache flushes since construction */
+    size_t flushes() const { return flushCount; }
+
+  private:
+    typedef States::block_type Block;
+
+    /** The empty set of states, it is never cached */
+    static constexpr StateId Dead = ~StateId(0);
+    static constexpr StateId NoState = Dead - 1;
+
+    struct Edge {
+      EventKey event;
+      StateId source; /** `NoState` for an empty slot */
+      StateId target;
+    };
+
+    /** Find a cached transition, `NoState` if it is not known yet */
+    StateId lookup(StateId source, EventKey event) const {
+      size_t mask = edges.size() - 1;
+      for (size_t ix = hash(source, event) & mask; ; ix = (ix + 1) & mask) {
+        const Edge& edge = edges[ix];
+        if (edge.source == source && edge.event == event) {
+          return edge.target;
+        }
+        if (edge.source == NoState) {
+          return NoState;
+        }
+      }
+    }
+
+    void step(StateId target) {
+      current = target;
+      if (current == Dead) {
+        fail();
+      } else if (finals[current]) {
+        ok();
+      } else {
+        partial();
+      }
+    }
+
+    StateId compute(EventKey event, const Names& vars);
+    StateId intern(const States& qs);
+    void addEdge(StateId source, EventKey event, StateId target);
+    void flush();
+    void load(StateId q, States& qs) const;
+
+    static size_t hash(StateId source, EventKey event) {
+      uint64_t h = (event ^ (uint64_t(source) << 32 | source)) * 0x9e3779b97f4a7c15ull;
+      return size_t(h ^ (h >> 29));
+    }
+
+    EventKey toKey(const Names& vars) const;
+    EventKey toKey(const uint8_t* row) const;
+
+    void fail() { result = Match_Failed; }
+
+    void ok() {
+      if (result != Match_Failed) {
+        result = Match_Ok;
+      }
+    }
+
+    void partial() {
+      if (result != Match_Failed) {
+        result = Match_Partial;
+      }
+    }
+
+  private:
+    std::shared_ptr<Nfasl> nfasl;
+    PredicateCache cache;
+    size_t words; /** blocks per set of states */
+    size_t maxStates;
+    size_t maxEdges;
+    std::vector<Block> sets; /** sets of cached states, `words` blocks each */
+    std::vector<uint8_t> finals; /** cached state contains a final state */
+    std::vector<StateId> index; /** open addressing over `sets` */
+    std::vector<Edge> edges; /** open addressing over transitions */
+    size_t edgeCount;
+    size_t flushCount;
+    StateId current;
+    States currentStates; /** buffers for `compute` */
+    States nextStates;
+    Names unpacked; /** buffer for `advanceBatch` */
+
+    Match result;
+  };
+
+  /**
+   * Create lazily determinizing executor
+   *
+   * @param[in] nfasl runtime NFASL
+   * @param[in] cacheSize memory limit of the cache (bytes)
+   * @returns nullptr if NFASL has more than `maxLazyAtomics` atomics
+   *          or counting states (see `Counter`)
+   */
+  extern ExecutorPtr createLazyDfaslContext(std::shared_ptr<Nfasl> nfasl,
+                                            size_t cacheSize = defaultLazyCacheSize);
+
+} // namespace rt
+
+#endif //RTLAZYDFASL_HPP
@@ -0,0 +1,195 @@
+#include "rt/RtMatcher.hpp"
+#include "rt/Snapshot.hpp"
+
+namespace rt {
+
+  /** Length of the longest active run (an upper bound) */
+  static size_t horizon(const ExtendedMatch& r) {
+    switch (r.match) {
+    case Match_Ok:
+      return r.ok.horizon;
+    case Match_Partial:
+      return r.partial.horizon;
+    default:
+      return 0;
+    }
+  }
+
+  Matcher::RuleId Matcher::add(Factory factory, const AtomicMap& atomics) {
+    Rule rule;
+    rule.factory = factory;
+    rule.atomics = atomics;
+    rule.identity = true;
+    for (size_t ix = 0; ix < atomics.size(); ++ix) {
+      rule.identity = rule.identity && atomics[ix] == ix;
+    }
+    rule.vars.resize(atomics.size());
+    rules.push_back(std::move(rule));
+    pushStage(rules.back());
+    return rules.size() - 1;
+  }
+
+  void Matcher::pushStage(Rule& rule) {
+    Stage stage;
+    if (rule.spare.empty()) {
+      stage.executor = rule.factory();
+    } else {
+      stage.executor = rule.spare.back();
+      rule.spare.pop_back();
+      stage.executor->reset();
+    }
+    rule.stages.push_back(stage);
+  }
+
+  void Matcher::dropStages(Rule& rule, size_t from) {
+    while (rule.stages.size() > from) {
+      rule.spare.push_back(rule.stages.back().executor);
+      rule.stages.pop_back();
+    }
+  }
+
+  void Matcher::reset() {
+    position = 0;
+    for (auto& rule : rules) {
+      dropStages(rule, 0);
+      pushStage(rule);
+    }
+  }
+
+  void Matcher::advance(const Names& vars_) {
+    ++position;
+    for (RuleId id = 0; id < rules.size(); ++id) {
+      Rule& rule = rules[id];
+      for (size_t ix = 0; ix < rule.atomics.size(); ++ix) {
+        rule.vars[ix] = rule.atomics[ix] < vars_.size() && vars_.test(rule.atomics[ix]);
+      }
+      step(id, rule, rule.vars, position);
+    }
+  }
+
+  void Matcher::step(RuleId id, Rule& rule, const Names& vars_, uint64_t end) {
+    if (mode != MatchMode_LeftmostLongest) {
+      ExtendedExecutor& executor = *rule.stages.front().executor;
+      executor.advance(vars_);
+      const ExtendedMatch& r = executor.getResult();
+      if (r.match == Match_Ok) {
+        callback(id, end - r.ok.longest, end);
+        if (mode == MatchMode_NonOverlapping) {
+          executor.reset();
+        }
+      }
+      return;
+    }
+    for (size_t ix = 0; ix < rule.stages.size(); ++ix) {
+      Stage& stage = rule.stages[ix];
+      stage.executor->advance(vars_);
+      const ExtendedMatch& r = stage.executor->getResult();
+      // the same start or an earlier one
+      if (r.match == Match_Ok && (!stage.pending || end - r.ok.longest <= stage.start)) {
+        stage.pending = true;
+        stage.start = end - r.ok.longest;
+        stage.end = end;
+        // the rest of the chain started inside the match
+        dropStages(rule, ix + 1);
+        pushStage(rule);
+        break;
+      }
+    }
+    report(id, rule, end);
+  }
+
+  void Matcher::report(RuleId id, Rule& rule, uint64_t end) {
+    // a match is settled when no active run starts at its start or earlier
+    while (rule.stages.front().pending
+           && horizon(rule.stages.front().executor->getResult()) < end - rule.stages.front().start) {
+      callback(id, rule.stages.front().start, rule.stages.front().end);
+      rule.spare.push_back(rule.stages.front().executor);
+      rule.stages.pop_front();
+    }
+  }
+
+  void Matcher::flush() {
+    for (RuleId id = 0; id < rules.size(); ++id) {
+      Rule& rule = rules[id];
+      while (rule.stages.front().pending) {
+        callback(id, rule.stages.front().start, rule.stages.front().end);
+        rule.spare.push_back(rule.stages.front().executor);
+        rule.stages.pop_front();
+      }
+    }
+  }
+
+  void Matcher::advanceBatch(const Events& events) {
+    for (RuleId id = 0; id < rules.size(); ++id) {
+      advanceBatch(id, rules[id], events);
+    }
+    position += events.count;
+  }
+
+  size_t Matcher::skip(Rule& rule, const Events& events, size_t begin) {
+    ExtendedExecutor& executor = *rule.stages.front().executor;
+    Events rest{ events.row(begin), events.stride, events.count - begin, rule.atomics.size() };
+    bool rewind = mode == MatchMode_LeftmostLongest;
+    if (rewind) {
+      rule.snapshot.clear();
+      SnapshotWriter writer(rule.snapshot);
+      executor.save(writer);
+    }
+    rule.results.resize(rest.count);
+    executor.advanceBatch(rest, rule.results.data());
+    size_t found = 0;
+    while (found < rest.count && rule.results[found].match != Match_Ok) {
+      ++found;
+    }
+    if (rewind && found < rest.count) {
+      // back to the event before the match
+      SnapshotReader reader(rule.snapshot.data(), rule.snapshot.size());
+      executor.restore(reader);
+      executor.advanceBatch({ rest.data, rest.stride, found, rest.atomicCount }, nullptr);
+    }
+    return begin + found;
+  }
+
+  void Matcher::advanceBatch(RuleId id, Rule& rule, const Events& events) {
+    Events local{ events.data, events.stride, events.count, rule.atomics.size() };
+    size_t ix = 0;
+    while (ix < events.count) {
+      // nothing is pending, so only matches have to be stepped one by one
+      if (rule.identity && rule.stages.size() == 1) {
+        size_t found = skip(rule, events, ix);
+        if (mode == MatchMode_All) {
+          for (size_t k = found; k < events.count; ++k) {
+            const ExtendedMatch& r = rule.results[k - ix];
+            if (r.match == Match_Ok) {
+              uint64_t end = position + k + 1;
+              callback(id, end - r.ok.longest, end);
+            }
+          }
+          return;
+        }
+        if (found == events.count) {
+          return;
+        }
+        if (mode == MatchMode_NonOverlapping) {
+          uint64_t end = position + found + 1;
+          callback(id, end - rule.results[found - ix].ok.longest, end);
+          rule.stages.front().executor->reset();
+          ix = found + 1;
+          continue;
+        }
+        ix = found;
+      }
+      if (rule.identity) {
+        local.unpack(local.row(ix), rule.vars);
+      } else {
+        events.unpack(events.row(ix), vars);
+        for (size_t a = 0; a < rule.atomics.size(); ++a) {
+          rule.vars[a] = rule.atomics[a] < vars.size() && vars.test(rule.atomics[a]);
+        }
+      }
+      step(id, rule, rule.vars, position + ix + 1);
+      ++ix;
+    }
+  }
+
+} // namespace rt
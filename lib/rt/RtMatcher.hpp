@@ -0,0 +1,107 @@
+#ifndef RTMATCHER_HPP
+#define RTMATCHER_HPP
+
+#include "rt/RtPredicate.hpp"
+#include "rt/Executor.hpp"
+#include "rt/Loader.hpp"
+#include "Match.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace rt {
+
+  enum MatchMode : uint8_t {
+    /** every event which ends a match, with the leftmost start */
+    MatchMode_All = 0,
+    /** the leftmost start, then the longest end, matches do not overlap */
+    MatchMode_LeftmostLongest = 1,
+    /** the earliest end, the next match starts after it */
+    MatchMode_NonOverlapping = 2,
+  };
+
+  /**
+   * Push-style search for matches of many rules in one event stream
+   *
+   * A match is reported as (rule, start, end): events [start, end)
+   * of the stream, offsets count from the first event after `reset`.
+   * Only matches are reported, the results of every event are not
+   * visible, so rules are advanced over batches (see `Executor`)
+   * while nothing is found.
+   *
+   * `MatchMode_LeftmostLongest` can only report a match when no active
+   * run starts as early as it does (see `ExtendedMatch::horizon`), so it
+   * keeps a chain of candidates: every candidate is followed by an
+   * executor started at its end, which searches for the next match.
+   * A candidate which is extended drops the rest of the chain.
+   */
+  class Matcher {
+  public:
+    typedef size_t RuleId;
+    typedef std::function<void(RuleId, uint64_t start, uint64_t end)> Callback;
+    /** Creates an executor of a rule in its initial state */
+    typedef std::function<ExtendedExecutorPtr()> Factory;
+    /** Local atomic `i` of a rule is atomic `atomics[i]` of the stream */
+    typedef std::vector<Offset> AtomicMap;
+
+    Matcher(MatchMode mode_, Callback callback_)
+      : mode(mode_), callback(callback_) {}
+
+    RuleId add(Factory factory, const AtomicMap& atomics);
+    size_t size() const { return rules.size(); }
+    MatchMode getMode() const { return mode; }
+    /** Number of events since `reset` */
+    uint64_t offset() const { return position; }
+
+    void reset();
+    void advance(const Names& vars);
+    void advanceBatch(const Events& events);
+    /** The stream is over, report matches which wait for next events */
+    void flush();
+
+  private:
+    struct Stage {
+      ExtendedExecutorPtr executor;
+      bool pending = false; /** [start, end) is the best match so far */
+      uint64_t start = 0;
+      uint64_t end = 0;
+    };
+
+    struct Rule {
+      Factory factory;
+      AtomicMap atomics;
+      bool identity; /** local atomics are the first atomics of the stream */
+      std::deque<Stage> stages; /** the chain of candidates, one stage for other modes */
+      std::vector<ExtendedExecutorPtr> spare; /** executors of dropped stages */
+      Names vars;
+      std::vector<ExtendedMatch> results; /** buffer for `advanceBatch` */
+      std::vector<uint8_t> snapshot;  /** buffer for `advanceBatch` */
+    };
+
+    /** Advance a rule over an event, `end` is offset past the event */
+    void step(RuleId id, Rule& rule, const Names& vars, uint64_t end);
+    /**
+     * Advance an `identity` rule over events from `begin` in a batch
+     *
+     * @returns the first event with a match or `events.count`,
+     *          `MatchMode_LeftmostLongest` is rewound to this event
+     */
+    size_t skip(Rule& rule, const Events& events, size_t begin);
+    void advanceBatch(RuleId id, Rule& rule, const Events& events);
+
+    void pushStage(Rule& rule);
+    void dropStages(Rule& rule, size_t from);
+    void report(RuleId id, Rule& rule, uint64_t end);
+
+    MatchMode mode;
+    Callback callback;
+    std::vector<Rule> rules;
+    uint64_t position = 0;
+    Names vars; /** buffer for `advanceBatch` */
+  };
+
+} // namespace rt
+
+#endif // RTMATCHER_HPP
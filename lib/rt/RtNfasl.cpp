@@ -3,6 +3,7 @@
 #include "rt/Loader.hpp"
 #include "rt/Saver.hpp"
 
+#include <algorithm>
 #include <memory.h>
 
 namespace rt {
@@ -20,17 +21,22 @@ namespace rt {
     }
   }
 
-  static void loadStateTransition(Loader& loader, StateTransition& str) {
+  static void loadStateTransition(Loader& loader,
+                                  PredicatePool& predicates,
+                                  StateTransition& str) {
     loader.loadPredicate(str.phi);
+    str.pred = predicates.intern(str.phi);
     loader.readValue(str.state);
   }
 
-  static void loadStateTransitions(Loader& loader, StateTransitions& strs) {
+  static void loadStateTransitions(Loader& loader,
+                                   PredicatePool& predicates,
+                                   StateTransitions& strs) {
     uint32_t trsCount;
     loader.readValue(trsCount);
     strs.resize(trsCount);
     for (auto& str : strs) {
-      loadStateTransition(loader, str);
+      loadStateTransition(loader, predicates, str);
     }
   }
 
@@ -42,6 +48,12 @@ namespace rt {
     loadStates(loader, nfasl->initials);
     loadStates(loader, nfasl->finals);
     nfasl->transitions.resize(nfasl->stateCount);
+
+    for (auto& t : nfasl->transitions) {
+      loadStateTransitions(loader, nfasl->predicates, t);
+    }
+    nfasl->flags = stateFlags(*nfasl);
+
     return nfasl;
   }
 
@@ -78,6 +90,8 @@ namespace rt {
       hdr.kind = Kind::NFASL;
       hdr.atomicCount = nfasl.atomicCount;
       hdr.stateCount = nfasl.stateCount;
+      // the format has no counters, see `writeImage`
+      assert(nfasl.counters.empty());
       writeValue(hdr);
       saveStates(nfasl.initials);
       saveStates(nfasl.finals);
@@ -92,8 +106,26 @@ namespace rt {
     NfaslSaver(data).save(nfasl);
   }
 
+  /** Counter values of counting states, nothing if no state counts */
+  static void initCounts(const Nfasl& nfasl, std::vector<CountSet>& counts) {
+    if (nfasl.counters.empty()) {
+      return;
+    }
+    counts.resize(nfasl.stateCount);
+    for (State q = 0; q < nfasl.stateCount; ++q) {
+      counts[q].init(nfasl.counters[q]);
+      counts[q].clear();
+    }
+  }
+
   void NfaslContext::reset() {
+    result = Match_Partial;
+    initCounts(*nfasl, currentCounts);
+    initCounts(*nfasl, nextCounts);
+    nextStates.clear();
     if (nfasl->finals.count() == 0) {
+      currentStates.clear();
+      currentStates.resize(nfasl->stateCount);
       fail();
     } else {
       currentStates = nfasl->initials;
@@ -101,17 +133,24 @@ namespace rt {
     }
   }
 
-  void NfaslContext::advance(const rt::Names& vars) {
+  void NfaslContext::advanceCached() {
+    if (idle()) {
+      return;
+    }
+    if (!nfasl->counters.empty()) {
+      advanceCounted();
+      return;
+    }
     bool advanced = false;
     // iterate over current state
-    rt::Names nextStates;
     nextStates.resize(nfasl->stateCount);
+    nextStates.reset();
     for (size_t q = currentStates.find_first();
          q != States::npos;
          q = currentStates.find_next(q)) {
       const StateTransitions& trs = nfasl->transitions[q];
       for (auto& tr : trs) {
-        if (eval(vars, &tr.phi[0], tr.phi.size())) {
+        if (cache.eval(tr.pred)) {
           advanced = true;
           nextStates.set(tr.state);
         }
@@ -125,12 +164,83 @@ namespace rt {
     }
   }
 
-  void NfaslExtendedContext::initials(States& qs, StateMap& map) {
+  void NfaslContext::advanceCounted() {
+    const Counters& counters = nfasl->counters;
+    bool advanced = false;
+    // forget values left from the previous step
+    for (size_t q = nextStates.find_first();
+         q != States::npos;
+         q = nextStates.find_next(q)) {
+      nextCounts[q].clear();
+    }
+    nextStates.resize(nfasl->stateCount);
+    nextStates.reset();
+    for (size_t q = currentStates.find_first();
+         q != States::npos;
+         q = currentStates.find_next(q)) {
+      for (auto& tr : nfasl->transitions[q]) {
+        if (!cache.eval(tr.pred)) {
+          continue;
+        }
+        if (tr.guard != Guard_None && !currentCounts[q].passes(counters[q], tr.guard)) {
+          continue;
+        }
+        switch (tr.action) {
+        case Action_Enter:
+          nextCounts[tr.state].enter();
+          break;
+        case Action_Increment:
+          nextCounts[tr.state].increment(counters[tr.state], currentCounts[q]);
+          break;
+        case Action_None:
+          break;
+        }
+        advanced = true;
+        nextStates.set(tr.state);
+      }
+    }
+    std::swap(currentStates, nextStates);
+    std::swap(currentCounts, nextCounts);
+    if (advanced) {
+      checkFinals();
+    } else {
+      fail();
+    }
+  }
+
+  bool NfaslContext::accepts() const {
+    for (size_t q = currentStates.find_first();
+         q != States::npos;
+         q = currentStates.find_next(q)) {
+      if (nfasl->finals.test(q)
+          && (!counting(nfasl->counters, q) || currentCounts[q].accepts(nfasl->counters[q]))) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  NfaslExtendedContext::NfaslExtendedContext(std::shared_ptr<Nfasl> nfasl_)
+    : nfasl(nfasl_), clock(nfasl_->window) {
+    cache.attach(nfasl->predicates);
+    for (size_t q = nfasl->initials.find_first();
+         q != States::npos;
+         q = nfasl->initials.find_next(q)) {
+      for (auto& tr : nfasl->transitions[q]) {
+        wake.push_back(tr.pred);
+      }
+    }
+    std::sort(wake.begin(), wake.end());
+    wake.erase(std::unique(wake.begin(), wake.end()), wake.end());
+    reset();
+  }
+
+  void NfaslExtendedContext::initials(States& qs, RtContexts& ctx) {
     for (size_t q = nfasl->initials.find_first();
          q != States::npos;
          q = nfasl->initials.find_next(q)) {
       qs.set(q);
-      map[q].started();
+      ctx.started(q);
     }
   }
 
@@ -139,19 +249,29 @@ namespace rt {
       result.match = Match_Failed;
       return;
     }
-    RtContext ctx;
+    size_t longest = 0;
+    size_t shortest = RtContexts::NoValue;
     for (size_t q = nfasl->finals.find_first();
          q != States::npos;
          q = nfasl->finals.find_next(q)) {
-      auto i = currentContext.find(q);
-      if (i != currentContext.end()) {
-        ctx.merge(i->second);
+      if (!currentStates.test(q)) {
+        continue;
+      }
+      if (counting(nfasl->counters, q)) {
+        size_t l, s;
+        if (currentRuns[q].passes(nfasl->counters[q], Guard_Exit, l, s)) {
+          longest = std::max(longest, l);
+          shortest = std::min(shortest, s);
+        }
+      } else {
+        longest = std::max(longest, currentContext.longest[q]);
+        shortest = std::min(shortest, currentContext.shortest[q]);
       }
     }
-    if (ctx.defined()) {
+    if (shortest != RtContexts::NoValue) {
       result.match = Match_Ok;
-      result.ok.shortest = ctx.shortest;
-      result.ok.longest = ctx.longest;
+      result.ok.shortest = shortest;
+      result.ok.longest = longest;
       result.ok.horizon = horizon;
     } else {
       result.match = Match_Partial;
@@ -159,43 +279,301 @@ namespace rt {
     }
   }
 
+  /** Runs of counting states, with room for all runs a step adds */
+  static void initRuns(const Nfasl& nfasl, std::vector<CountRuns>& runs) {
+    std::vector<size_t> added(nfasl.stateCount, 0);
+    for (State q = 0; q < nfasl.stateCount; ++q) {
+      for (auto& tr : nfasl.transitions[q]) {
+        if (tr.action == Action_Increment) {
+          added[tr.state] += nfasl.counters[q].top();
+        } else if (tr.action == Action_Enter) {
+          ++added[tr.state];
+        }
+      }
+    }
+    runs.assign(nfasl.stateCount, CountRuns());
+    for (State q = 0; q < nfasl.stateCount; ++q) {
+      runs[q].reserve(added[q]);
+    }
+  }
+
   void NfaslExtendedContext::reset() {
     horizon = 0;
+    clock.reset();
+    currentStates.clear();
     currentStates.resize(nfasl->stateCount);
+    currentContext.resize(nfasl->stateCount);
+    nextStates.clear();
+    nextStates.resize(nfasl->stateCount);
+    nextContext.resize(nfasl->stateCount);
+    if (!nfasl->counters.empty()) {
+      initRuns(*nfasl, currentRuns);
+      initRuns(*nfasl, nextRuns);
+    }
     initials(currentStates, currentContext);
     finals();
   }
 
-  void NfaslExtendedContext::advance(const rt::Names& vars) {
+  void NfaslExtendedContext::advanceCached() {
+    if (!nfasl->counters.empty()) {
+      advanceCounted();
+      return;
+    }
     bool advanced = false;
-    rt::Names nextStates;
-    StateMap nextContext;
-    nextStates.resize(nfasl->stateCount);
+    // forget contexts left from the previous step
+    for (size_t q = nextStates.find_first();
+         q != States::npos;
+         q = nextStates.find_next(q)) {
+      nextContext.clear(q);
+    }
+    nextStates.reset();
     initials(nextStates, nextContext);
     for (size_t q = currentStates.find_first();
          q != States::npos;
          q = currentStates.find_next(q)) {
       bool advancedState = false;
-      auto const& advancedCtx = RtContext::advance(currentContext[q]);
+      // contexts of active states are always defined
+      size_t longest = currentContext.longest[q] + 1;
+      size_t shortest = currentContext.shortest[q] + 1;
       const StateTransitions& trs = nfasl->transitions[q];
       for (auto& tr : trs) {
-        if (eval(vars, &tr.phi[0], tr.phi.size())) {
+        if (cache.eval(tr.pred)) {
           advancedState = true;
           nextStates.set(tr.state);
-          nextContext[tr.state].merge(advancedCtx);
+          nextContext.merge(tr.state, longest, shortest);
         }
       }
       if (advancedState) {
         advanced = true;
-        horizon = std::max(horizon, advancedCtx.longest);
+        horizon = std::max(horizon, longest);
+      }
+    }
+    std::swap(currentStates, nextStates);
+    std::swap(currentContext, nextContext);
+    if (!advanced) {
+      horizon = 0;
+    }
+    if (clock.bounded()) {
+      expire();
+    }
+    finals();
+  }
+
+  void NfaslExtendedContext::advanceCounted() {
+    const Counters& counters = nfasl->counters;
+    bool advanced = false;
+    // forget contexts and runs left from the previous step
+    for (size_t q = nextStates.find_first();
+         q != States::npos;
+         q = nextStates.find_next(q)) {
+      nextContext.clear(q);
+      nextRuns[q].clear();
+    }
+    nextStates.reset();
+    initials(nextStates, nextContext);
+    for (size_t q = currentStates.find_first();
+         q != States::npos;
+         q = currentStates.find_next(q)) {
+      bool counts = counting(counters, q);
+      size_t stepLongest = 0;
+      for (auto& tr : nfasl->transitions[q]) {
+        if (!cache.eval(tr.pred)) {
+          continue;
+        }
+        // contexts of runs which take the rule, before the step
+        size_t longest = currentContext.longest[q];
+        size_t shortest = currentContext.shortest[q];
+        if (counts && !currentRuns[q].passes(counters[q], tr.guard, longest, shortest)) {
+          continue;
+        }
+        stepLongest = std::max(stepLongest, longest + 1);
+        nextStates.set(tr.state);
+        switch (tr.action) {
+        case Action_Enter:
+          nextRuns[tr.state].add(1, longest + 1, shortest + 1);
+          break;
+        case Action_Increment:
+          nextRuns[tr.state].increment(counters[tr.state], currentRuns[q]);
+          break;
+        case Action_None:
+          nextContext.merge(tr.state, longest + 1, shortest + 1);
+          break;
+        }
+      }
+      if (stepLongest != 0) {
+        advanced = true;
+        horizon = std::max(horizon, stepLongest);
       }
     }
+    for (size_t q = nextStates.find_first();
+         q != States::npos;
+         q = nextStates.find_next(q)) {
+      nextRuns[q].normalize();
+    }
     std::swap(currentStates, nextStates);
     std::swap(currentContext, nextContext);
+    std::swap(currentRuns, nextRuns);
     if (!advanced) {
       horizon = 0;
     }
+    if (clock.bounded()) {
+      expire();
+    }
     finals();
   }
 
+  void NfaslExtendedContext::expire() {
+    clock.tick();
+    for (size_t q = currentStates.find_first();
+         q != States::npos;
+         q = currentStates.find_next(q)) {
+      if (counting(nfasl->counters, q)) {
+        currentRuns[q].filter([&](CountRun& run) {
+          return clock.prune(run.longest, run.shortest);
+        });
+        if (currentRuns[q].empty()) {
+          currentStates.reset(q);
+        }
+      } else if (!clock.prune(currentContext, q)) {
+        currentStates.reset(q);
+      }
+    }
+    // no run is longer than the window
+    horizon = std::min(horizon, clock.span());
+    clock.trim(horizon);
+  }
+
+  void NfaslContext::save(SnapshotWriter& writer) const {
+    writer.writeMatch(result);
+    writer.writeStates(currentStates);
+    for (size_t q = currentStates.find_first();
+         q != States::npos;
+         q = currentStates.find_next(q)) {
+      if (counting(nfasl->counters, q)) {
+        writer.writeStates(currentCounts[q].getBits());
+      }
+    }
+  }
+
+  void NfaslContext::restore(SnapshotReader& reader) {
+    Match r = reader.readMatch();
+    States qs;
+    reader.readStates(qs, nfasl->stateCount);
+    std::vector<CountSet> counts;
+    initCounts(*nfasl, counts);
+    for (size_t q = qs.find_first(); q != States::npos; q = qs.find_next(q)) {
+      if (counting(nfasl->counters, q)) {
+        States values;
+        reader.readStates(values, size_t(nfasl->counters[q].top()) + 1);
+        // values start at 1
+        reader.ensure(values.any() && !values.test(0));
+        counts[q].setBits(values);
+      }
+    }
+    result = r;
+    std::swap(currentStates, qs);
+    std::swap(currentCounts, counts);
+    initCounts(*nfasl, nextCounts);
+    nextStates.clear();
+  }
+
+  void NfaslExtendedContext::save(SnapshotWriter& writer) const {
+    writer.writeValue(uint64_t(horizon));
+    writer.writeMatch(result.match);
+    writer.writeValue(uint64_t(result.ok.longest));
+    writer.writeValue(uint64_t(result.ok.shortest));
+    writer.writeValue(uint64_t(result.ok.horizon));
+    if (clock.bounded()) {
+      clock.save(writer);
+    }
+    writer.writeStates(currentStates);
+    for (size_t q = currentStates.find_first();
+         q != States::npos;
+         q = currentStates.find_next(q)) {
+      if (counting(nfasl->counters, q)) {
+        auto& runs = currentRuns[q].get();
+        writer.writeValue(uint64_t(runs.size()));
+        for (auto& run : runs) {
+          writer.writeValue(uint64_t(run.count));
+          writer.writeValue(uint64_t(run.longest));
+          writer.writeValue(uint64_t(run.shortest));
+        }
+        continue;
+      }
+      writer.writeValue(uint64_t(currentContext.longest[q]));
+      writer.writeValue(uint64_t(currentContext.shortest[q]));
+    }
+  }
+
+  void NfaslExtendedContext::restore(SnapshotReader& reader) {
+    uint64_t h, longest, shortest, okHorizon;
+    reader.readValue(h);
+    ExtendedMatch r;
+    r.match = reader.readMatch();
+    reader.readValue(longest);
+    reader.readValue(shortest);
+    reader.readValue(okHorizon);
+    r.ok.longest = longest;
+    r.ok.shortest = shortest;
+    r.ok.horizon = okHorizon;
+    RtClock c(clock.getWindow());
+    if (c.bounded()) {
+      c.restore(reader);
+    }
+
+    States qs;
+    reader.readStates(qs, nfasl->stateCount);
+
+    RtContexts ctx;
+    ctx.resize(nfasl->stateCount);
+    std::vector<CountRuns> runs;
+    if (!nfasl->counters.empty()) {
+      initRuns(*nfasl, runs);
+    }
+    for (size_t q = qs.find_first(); q != States::npos; q = qs.find_next(q)) {
+      if (counting(nfasl->counters, q)) {
+        const Counter& counter = nfasl->counters[q];
+        uint64_t count;
+        reader.readValue(count);
+        reader.ensure(count > 0 && count <= counter.top());
+        uint64_t last = 0;
+        while (count--) {
+          uint64_t value, runLongest, runShortest;
+          reader.readValue(value);
+          reader.readValue(runLongest);
+          reader.readValue(runShortest);
+          // runs are ordered by distinct values
+          reader.ensure(value > last && value <= counter.top());
+          reader.ensure(runShortest <= runLongest);
+          reader.ensure(!c.bounded() || runLongest <= c.size());
+          runs[q].add(value, runLongest, runShortest);
+          last = value;
+        }
+        continue;
+      }
+      uint64_t ctxLongest, ctxShortest;
+      reader.readValue(ctxLongest);
+      reader.readValue(ctxShortest);
+      reader.ensure(ctxLongest != RtContexts::NoValue &&
+                    ctxShortest != RtContexts::NoValue);
+      // start times of runs are kept by the clock
+      reader.ensure(!c.bounded() || (ctxLongest <= c.size() && ctxShortest <= c.size()));
+      ctx.longest[q] = ctxLongest;
+      ctx.shortest[q] = ctxShortest;
+    }
+
+    horizon = h;
+    result = r;
+    clock = c;
+    std::swap(currentStates, qs);
+    std::swap(currentContext, ctx);
+    std::swap(currentRuns, runs);
+    nextStates.clear();
+    nextStates.resize(nfasl->stateCount);
+    nextContext.resize(nfasl->stateCount);
+    if (!nfasl->counters.empty()) {
+      initRuns(*nfasl, nextRuns);
+    }
+  }
+
 } //namespace rt
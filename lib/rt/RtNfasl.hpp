@@ -2,15 +2,19 @@
 #define RTNFASL_HPP
 
 #include "rt/RtPredicate.hpp"
+#include "rt/RtPredicatePool.hpp"
+#include "rt/RtSliced.hpp"
+#include "rt/RtStateFlags.hpp"
 #include "rt/Executor.hpp"
 #include "rt/Loader.hpp"
 #include "rt/Saver.hpp"
 #include "rt/RtContext.hpp"
+#include "rt/RtClock.hpp"
+#include "rt/RtCounter.hpp"
 #include "Match.hpp"
 
 #include <cstdint>
 #include <vector>
-#include <unordered_map>
 #include <boost/dynamic_bitset.hpp>
 
 namespace rt {
@@ -20,6 +24,9 @@ namespace rt {
   struct StateTransition {
     Phi phi;
     State state;
+    PredicateIndex pred; /** `phi` in `Nfasl::predicates` */
+    Guard guard = Guard_None; /** on the counter of the source state */
+    Action action = Action_None; /** on the counter of `state` */
   };
 
   typedef std::vector<StateTransition> StateTransitions;
@@ -33,15 +40,35 @@ namespace rt {
     States initials;
     States finals;
     std::vector<StateTransitions> transitions;
+    PredicatePool predicates;
+    StateFlags flags; /** see `stateFlags`, empty if not known */
+    Timestamp window = 0; /** time bound of a match, zero if none (see `RtClock`) */
+    Counters counters; /** see `Counter`, empty if no state counts */
   };
 
   class NfaslContext : public Executor {
   public:
-    NfaslContext (std::shared_ptr<Nfasl> nfasl_) : nfasl(nfasl_) { reset(); }
+    NfaslContext (std::shared_ptr<Nfasl> nfasl_)
+      : nfasl(nfasl_), absorbing(absorbingStates(nfasl_->flags, nfasl_->stateCount)) {
+      cache.attach(nfasl->predicates);
+      reset();
+    }
     Match getResult() const override { return result; }
+    /** All active states are absorbing, so a step changes nothing */
+    bool idle() const { return currentStates.is_subset_of(absorbing); }
 
     void reset() override;
-    void advance(const Names& vars) override;
+    void advance(const Names& vars) override {
+      cache.next(vars);
+      advanceCached();
+    }
+    void advanceBatch(const Events& events, Match* results) override {
+      advanceSliced(*this, cache, events, results);
+    }
+    /** Advance over the event selected in `cache`, see `advanceSliced` */
+    void advanceCached();
+    void save(SnapshotWriter& writer) const override;
+    void restore(SnapshotReader& reader) override;
 
   private:
     void fail() { result = Match_Failed; }
@@ -59,40 +86,84 @@ namespace rt {
     }
 
     void checkFinals() {
-      if (currentStates.intersects(nfasl->finals)) {
+      if (nfasl->counters.empty() ? currentStates.intersects(nfasl->finals) : accepts()) {
         ok();
       } else {
         partial();
       }
     }
 
+    /** `advanceCached` of an automaton with counting states */
+    void advanceCounted();
+    /** A final state is active, a counting one with a value past `min` */
+    bool accepts() const;
+
   private:
     std::shared_ptr<Nfasl> nfasl;
+    States absorbing;
+    SlicedPredicateCache cache;
     States currentStates;
+    States nextStates; /** buffer for `advance` */
+    std::vector<CountSet> currentCounts; /** values of active counting states */
+    std::vector<CountSet> nextCounts; /** buffer for `advance` */
 
     Match result;
   };
 
-  typedef std::unordered_map<State, RtContext> StateMap;
-
   class NfaslExtendedContext : public ExtendedExecutor {
   public:
-    NfaslExtendedContext (std::shared_ptr<Nfasl> nfasl_) : nfasl(nfasl_) { reset(); }
+    NfaslExtendedContext (std::shared_ptr<Nfasl> nfasl_);
     const ExtendedMatch& getResult() const override {
       return result;
     }
 
     void reset() override;
-    void advance(const Names& vars) override;
+    void advance(const Names& vars) override {
+      cache.next(vars);
+      advanceCached();
+    }
+    void advanceAt(const Names& vars, Timestamp time) override {
+      clock.setTime(time);
+      advance(vars);
+    }
+    void advanceBatch(const Events& events, ExtendedMatch* results) override {
+      advanceSliced(*this, cache, events, results);
+    }
+    /** Advance over the event selected in `cache`, see `advanceSliced` */
+    void advanceCached();
+    /** Only initial states are live, no run has advanced */
+    bool quiescent() const { return horizon == 0; }
+    /** Events of the block on which an initial state moves */
+    Lanes wakeLanes() {
+      Lanes r = 0;
+      for (auto ix : wake) {
+        r |= cache.mask(ix);
+      }
+      return r;
+    }
+    void save(SnapshotWriter& writer) const override;
+    void restore(SnapshotReader& reader) override;
 
   private:
-    void initials(States& qs, StateMap& map);
+    void initials(States& qs, RtContexts& ctx);
     void finals();
+    /** Drop runs out of the time window, see `RtClock` */
+    void expire();
+    /** `advanceCached` of an automaton with counting states */
+    void advanceCounted();
 
     size_t horizon;
     std::shared_ptr<Nfasl> nfasl;
-    States currentStates;
-    StateMap currentContext;
+    RtClock clock;
+    SlicedPredicateCache cache;
+    std::vector<PredicateIndex> wake; /** predicates of rules of initial states */
+    States currentStates; /** active states, to iterate over them */
+    RtContexts currentContext;
+    States nextStates; /** buffers for `advance` */
+    RtContexts nextContext;
+    /** runs of active counting states, their `RtContexts` are not used */
+    std::vector<CountRuns> currentRuns;
+    std::vector<CountRuns> nextRuns; /** buffer for `advance` */
     ExtendedMatch result;
   };
 
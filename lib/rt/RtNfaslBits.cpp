@@ -0,0 +1,37 @@
+#include "rt/RtNfaslBits.hpp"
+
+namespace rt {
+
+  template <size_t N, typename Vars>
+  static ExecutorPtr makeContext(const Nfasl& nfasl) {
+    return std::make_shared<NfaslBitsContext<N, Vars>>(NfaslBits<N>::make(nfasl));
+  }
+
+  template <size_t N>
+  static ExecutorPtr makeContext(const Nfasl& nfasl) {
+    if (nfasl.atomicCount <= AtomBits<1>::Capacity) {
+      return makeContext<N, AtomBits<1>>(nfasl);
+    }
+    if (nfasl.atomicCount <= AtomBits<4>::Capacity) {
+      return makeContext<N, AtomBits<4>>(nfasl);
+    }
+    return makeContext<N, Names>(nfasl);
+  }
+
+  ExecutorPtr createNfaslBitsContext(const Nfasl& nfasl) {
+    if (!nfasl.counters.empty()) {
+      return nullptr;
+    }
+    if (nfasl.stateCount <= StateBits<1>::Capacity) {
+      return makeContext<1>(nfasl);
+    }
+    if (nfasl.stateCount <= StateBits<2>::Capacity) {
+      return makeContext<2>(nfasl);
+    }
+    if (nfasl.stateCount <= StateBits<4>::Capacity) {
+      return makeContext<4>(nfasl);
+    }
+    return nullptr;
+  }
+
+} //namespace rt
@@ -0,0 +1,365 @@
+#ifndef RTNFASLBITS_HPP
+#define RTNFASLBITS_HPP
+
+#include "rt/RtPredicate.hpp"
+#include "rt/RtNfasl.hpp"
+#include "rt/Executor.hpp"
+#include "rt/Loader.hpp"
+#include "Match.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace rt {
+
+  /**
+   * Fixed size set of states packed into machine words
+   */
+  template <size_t N>
+  struct StateBits {
+    static constexpr size_t Bits = 64;
+    static constexpr size_t Capacity = N*Bits;
+
+    std::array<uint64_t, N> words;
+
+    StateBits() : words{} {}
+
+    void set(size_t q) { words[q / Bits] |= uint64_t(1) << (q % Bits); }
+    bool test(size_t q) const { return (words[q / Bits] >> (q % Bits)) & 1; }
+
+    bool operator== (const StateBits& u) const { return words == u.words; }
+    bool operator!= (const StateBits& u) const { return words != u.words; }
+
+    bool any() const {
+      uint64_t r = 0;
+      for (size_t i = 0; i < N; ++i) {
+        r |= words[i];
+      }
+      return r != 0;
+    }
+
+    bool intersects(const StateBits& u) const {
+      uint64_t r = 0;
+      for (size_t i = 0; i < N; ++i) {
+        r |= words[i] & u.words[i];
+      }
+      return r != 0;
+    }
+
+    /** true if `u` is a subset of this set */
+    bool includes(const StateBits& u) const {
+      uint64_t r = 0;
+      for (size_t i = 0; i < N; ++i) {
+        r |= u.words[i] & ~words[i];
+      }
+      return r == 0;
+    }
+
+    StateBits& operator|= (const StateBits& u) {
+      for (size_t i = 0; i < N; ++i) {
+        words[i] |= u.words[i];
+      }
+      return *this;
+    }
+
+    /** call `f` for every state in the set */
+    template <typename F>
+    void forEach(F f) const {
+      for (size_t i = 0; i < N; ++i) {
+        for (uint64_t w = words[i]; w != 0; w &= w - 1) {
+          f(i*Bits + __builtin_ctzll(w));
+        }
+      }
+    }
+  };
+
+  /**
+   * Fixed size set of atomics of an event, see `Program::run`
+   *
+   * Unlike `Names` it is kept inline and `test` has no size checks.
+   */
+  template <size_t A>
+  struct AtomBits {
+    static constexpr size_t Bits = 64;
+    static constexpr size_t Capacity = A*Bits;
+
+    std::array<uint64_t, A> words;
+
+    AtomBits() : words{} {}
+
+    bool test(size_t a) const { return (words[a / Bits] >> (a % Bits)) & 1; }
+
+    /** atomics past `Capacity` are dropped */
+    void assign(const Names& vars) {
+      words.fill(0);
+      if (Names::bits_per_block == Bits && vars.num_blocks() <= A) {
+        boost::to_block_range(vars, words.begin());
+        return;
+      }
+      for (size_t a = vars.find_first(); a < Capacity; a = vars.find_next(a)) {
+        words[a / Bits] |= uint64_t(1) << (a % Bits);
+      }
+    }
+
+    /** Load a packed `row` of `events` as is, atomics past `Capacity` are dropped */
+    void assign(const Events& events, const uint8_t* row) {
+      words.fill(0);
+      size_t n = std::min(events.atomicCount, Capacity);
+      for (size_t b = 0; b*8 < n; ++b) {
+        uint64_t byte = row[b];
+        if (n - b*8 < 8) {
+          byte &= (uint64_t(1) << (n - b*8)) - 1;
+        }
+        words[b / 8] |= byte << (b % 8 * 8);
+      }
+    }
+  };
+
+  /** An event as `Vars` (`Names` or `AtomBits`), `buffer` keeps the copy */
+  inline const Names& toVars(const Names& vars, Names&) {
+    return vars;
+  }
+
+  template <size_t A>
+  const AtomBits<A>& toVars(const Names& vars, AtomBits<A>& buffer) {
+    buffer.assign(vars);
+    return buffer;
+  }
+
+  /** A packed row of `events` as `Vars` */
+  inline const Names& toVars(const Events& events, const uint8_t* row, Names& buffer) {
+    events.unpack(row, buffer);
+    return buffer;
+  }
+
+  template <size_t A>
+  const AtomBits<A>& toVars(const Events& events, const uint8_t* row, AtomBits<A>& buffer) {
+    buffer.assign(events, row);
+    return buffer;
+  }
+
+  /**
+   * Runtime NFASL with states packed into `N` machine words
+   *
+   * Rules of a state with the same predicate are merged
+   * into a single edge with a successor mask.
+   * Predicate indices are those of the source `Nfasl`.
+   */
+  template <size_t N>
+  class NfaslBits {
+  public:
+    typedef StateBits<N> Bits;
+
+    struct Edge {
+      PredicateIndex pred;
+      Bits succ;
+    };
+
+    uint16_t atomicCount;
+    State stateCount;
+    Bits initials;
+    Bits finals;
+    Bits absorbing; /** see `StateFlags` */
+    std::vector<uint32_t> edgeIndex; /** edges of `q` are [edgeIndex[q], edgeIndex[q+1]) */
+    std::vector<Edge> edges;
+    PredicatePool predicates;
+
+    static std::shared_ptr<NfaslBits> make(const Nfasl& u) {
+      assert(u.stateCount <= Bits::Capacity);
+      auto v = std::make_shared<NfaslBits>();
+      v->atomicCount = u.atomicCount;
+      v->stateCount = u.stateCount;
+      v->predicates = u.predicates;
+      for (State q = 0; q < u.stateCount; ++q) {
+        if (u.initials.test(q)) {
+          v->initials.set(q);
+        }
+        if (u.finals.test(q)) {
+          v->finals.set(q);
+        }
+        if (q < u.flags.size() && (u.flags[q] & State_Absorbing)) {
+          v->absorbing.set(q);
+        }
+      }
+      v->edgeIndex.reserve(u.stateCount + 1);
+      for (State q = 0; q < u.stateCount; ++q) {
+        size_t first = v->edges.size();
+        v->edgeIndex.push_back(first);
+        for (auto const& tr : u.transitions[q]) {
+          auto e = v->edges.begin() + first;
+          while (e != v->edges.end() && e->pred != tr.pred) {
+            ++e;
+          }
+          if (e == v->edges.end()) {
+            v->edges.push_back({ tr.pred, Bits{} });
+            e = v->edges.end() - 1;
+          }
+          e->succ.set(tr.state);
+        }
+      }
+      v->edgeIndex.push_back(v->edges.size());
+      return v;
+    }
+  };
+
+  /**
+   * Bit-parallel executor, an event is `Vars` in the single-event path
+   *
+   * `advanceEvent` takes such event as is, `advanceRows` loads packed
+   * rows into it directly.
+   */
+  template <size_t N, typename Vars = Names>
+  class NfaslBitsContext : public Executor {
+  public:
+    typedef typename NfaslBits<N>::Bits Bits;
+    typedef BasicSlicedPredicateCache<PredicatePool, Vars> Cache;
+
+    NfaslBitsContext (std::shared_ptr<NfaslBits<N>> nfasl_) : nfasl(nfasl_) {
+      cache.attach(nfasl->predicates);
+      reset();
+    }
+    Match getResult() const override { return result; }
+    /** All active states are absorbing, so a step changes nothing */
+    bool idle() const { return nfasl->absorbing.includes(currentStates); }
+
+    void reset() override {
+      result = Match_Partial;
+      if (!nfasl->finals.any()) {
+        fail();
+      } else {
+        currentStates = nfasl->initials;
+        checkFinals();
+      }
+    }
+
+    void advance(const Names& vars) override {
+      advanceEvent(toVars(vars, event));
+    }
+
+    /** Advance over an event which is already `Vars`, there is no conversion */
+    void advanceEvent(const Vars& vars) {
+      cache.next(vars);
+      advanceCached();
+    }
+
+    /** Advance over the event selected in `cache`, see `advanceSliced` */
+    void advanceCached() {
+      if (idle()) {
+        return;
+      }
+      Bits nextStates;
+      const NfaslBits<N>& a = *nfasl;
+      Cache& c = cache;
+      currentStates.forEach([&a, &c, &nextStates](size_t q) {
+          for (uint32_t ix = a.edgeIndex[q]; ix < a.edgeIndex[q + 1]; ++ix) {
+            auto const& e = a.edges[ix];
+            // no need to evaluate predicate if it adds nothing
+            if (!nextStates.includes(e.succ) && c.eval(e.pred)) {
+              nextStates |= e.succ;
+            }
+          }
+        });
+      currentStates = nextStates;
+      if (currentStates.any()) {
+        checkFinals();
+      } else {
+        fail();
+      }
+    }
+
+    /** Shorter batches are not worth transposing, see `advanceRows` */
+    static constexpr size_t slicedMinEvents = 4;
+
+    void advanceBatch(const Events& events, Match* results) override {
+      if (events.count < slicedMinEvents) {
+        advanceRows(events, results);
+      } else {
+        advanceSliced(*this, cache, events, results);
+      }
+    }
+
+    /** Advance over packed rows one by one, loaded as `Vars` without `Names` */
+    void advanceRows(const Events& events, Match* results) {
+      for (size_t ix = 0; ix < events.count; ++ix) {
+        advanceEvent(toVars(events, events.row(ix), event));
+        if (results) {
+          results[ix] = result;
+        }
+        if (result == Match_Failed) {
+          if (results) {
+            std::fill(results + ix + 1, results + events.count, Match_Failed);
+          }
+          break;
+        }
+      }
+    }
+
+    void save(SnapshotWriter& writer) const override {
+      writer.writeMatch(result);
+      writer.writeValue(currentStates.words);
+    }
+
+    void restore(SnapshotReader& reader) override {
+      Match r = reader.readMatch();
+      Bits qs;
+      reader.readValue(qs.words);
+      for (size_t q = nfasl->stateCount; q < Bits::Capacity; ++q) {
+        reader.ensure(!qs.test(q));
+      }
+      result = r;
+      currentStates = qs;
+    }
+
+  private:
+    void fail() { result = Match_Failed; }
+
+    void ok() {
+      if (result != Match_Failed) {
+        result = Match_Ok;
+      }
+    }
+
+    void partial() {
+      if (result != Match_Failed) {
+        result = Match_Partial;
+      }
+    }
+
+    void checkFinals() {
+      if (currentStates.intersects(nfasl->finals)) {
+        ok();
+      } else {
+        partial();
+      }
+    }
+
+  private:
+    std::shared_ptr<NfaslBits<N>> nfasl;
+    Cache cache;
+    Vars event; /** buffer for `advance` and `advanceRows` */
+    Bits currentStates;
+
+    Match result;
+  };
+
+  /** Maximal number of states supported by bit-parallel executor */
+  constexpr size_t maxNfaslBitsStates = StateBits<4>::Capacity;
+
+  /**
+   * Create bit-parallel executor for small NFASL
+   *
+   * Both states and (if there are at most 256) atomics of an event
+   * are kept in fixed arrays of words, the executor is instantiated
+   * for the smallest width which fits.
+   *
+   * @returns nullptr if NFASL has more than `maxNfaslBitsStates` states
+   *          or counting states (see `Counter`)
+   */
+  extern ExecutorPtr createNfaslBitsContext(const Nfasl& nfasl);
+
+} // namespace rt
+
+#endif //RTNFASLBITS_HPP
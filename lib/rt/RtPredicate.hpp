@@ -9,15 +9,25 @@ namespace rt {
   typedef uint16_t Offset;
   typedef boost::dynamic_bitset<> Names;
 
+  /**
+   * Predicate bytecode, an expression in prefix form
+   *
+   * `Name` is followed by `Offset` of the atomic, `Ref` by `RefOffset`
+   * of an earlier complete subterm (in bytes from the start), which it
+   * stands for, so a subterm shared in a DAG is written once.
+   */
   enum class Code : uint8_t {
     False = 0,
     True = 1,
     Name = 2,
     Not = 3,
     And = 4,
-    Or = 5
+    Or = 5,
+    Ref = 6
   };
 
+  typedef uint32_t RefOffset;
+
   // static constexpr uint32_t magic = 0xec342a4f;
 
   class Evaluator {
@@ -56,10 +66,27 @@ namespace rt {
         return names.test(off);
       case Code::Not:
         return eval0() ^ 1;
-      case Code::And:
-        return eval0() && eval0();
-      case Code::Or:
-        return eval0() || eval0();
+      case Code::And: {
+        // both operands must be read: prefix code cannot skip a subtree
+        int lhs = eval0();
+        int rhs = eval0();
+        return lhs && rhs;
+      }
+      case Code::Or: {
+        int lhs = eval0();
+        int rhs = eval0();
+        return lhs || rhs;
+      }
+      case Code::Ref: {
+        RefOffset off;
+        readValue(off);
+        assert(off < size_t(eip - data));
+        const uint8_t* next = eip;
+        eip = data + off;
+        int r = eval0();
+        eip = next;
+        return r;
+      }
       }
       assert(false);
       return 0;
@@ -0,0 +1,117 @@
+#ifndef RTPREDICATEPOOL_HPP
+#define RTPREDICATEPOOL_HPP
+
+#include "rt/RtPredicate.hpp"
+#include "rt/RtProgram.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace rt {
+
+  typedef uint32_t PredicateIndex;
+
+  /**
+   * Distinct predicates of an automaton
+   *
+   * Transitions refer to predicates by index, so a predicate
+   * copied over many transitions is stored (and evaluated) once.
+   * Predicates are either owned by the pool or kept in external
+   * memory (e.g. an image, see `add`). A copy of a pool shares them,
+   * they are never changed after they are added.
+   */
+  class PredicatePool {
+  public:
+    PredicateIndex intern(const Program& prog) {
+      auto r = index.insert({ Key{ prog.code, prog.entries }, views.size() });
+      if (r.second) {
+        auto owned = std::make_shared<const Program>(prog);
+        views.push_back({ owned->code.data(), owned->code.size(),
+                          owned->entries.data(), owned->entries.size() });
+        storage.push_back(owned);
+      }
+      return r.first->second;
+    }
+
+    PredicateIndex intern(const std::vector<uint8_t>& phi) {
+      Program prog;
+      compile(phi, prog);
+      return intern(prog);
+    }
+
+    /**
+     * Add a predicate kept in external memory, it is not interned
+     *
+     * @param[in] view the predicate
+     * @param[in] owner keeps memory of `view` alive
+     */
+    PredicateIndex add(const ProgramView& view, std::shared_ptr<const void> owner) {
+      if (storage.empty() || storage.back() != owner) {
+        storage.push_back(owner);
+      }
+      views.push_back(view);
+      return views.size() - 1;
+    }
+
+    size_t size() const { return views.size(); }
+    const ProgramView& operator[] (PredicateIndex ix) const { return views[ix]; }
+
+  private:
+    typedef std::pair<std::vector<Program::Word>, std::vector<Program::Word>> Key;
+
+    std::vector<ProgramView> views;
+    std::vector<std::shared_ptr<const void>> storage; /** owned programs and external memory */
+    std::map<Key, PredicateIndex> index;
+  };
+
+  /**
+   * Results of pool predicates for the current event
+   *
+   * A predicate is evaluated on demand, at most once per event.
+   * `Pool` is indexed by `PredicateIndex` and its items have `eval`,
+   * an event is `Vars` (see `Program::run`).
+   */
+  template <typename Pool, typename Vars = Names>
+  class BasicPredicateCache {
+  public:
+    void attach(const Pool& pool_) {
+      pool = &pool_;
+      stamps.assign(pool->size(), 0);
+      values.assign(pool->size(), 0);
+      epoch = 0;
+    }
+
+    /** forget results of the previous event */
+    void next(const Vars& vars_) {
+      vars = &vars_;
+      if (++epoch == 0) {
+        std::fill(stamps.begin(), stamps.end(), 0);
+        epoch = 1;
+      }
+    }
+
+    bool eval(PredicateIndex ix) {
+      if (stamps[ix] != epoch) {
+        stamps[ix] = epoch;
+        values[ix] = (*pool)[ix].eval(*vars);
+      }
+      return values[ix];
+    }
+
+  private:
+    const Pool* pool = nullptr;
+    const Vars* vars = nullptr;
+    std::vector<uint32_t> stamps;
+    std::vector<uint8_t> values;
+    uint32_t epoch = 0;
+  };
+
+  typedef BasicPredicateCache<PredicatePool> PredicateCache;
+
+} // namespace rt
+
+#endif // RTPREDICATEPOOL_HPP
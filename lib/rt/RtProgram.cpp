@@ -0,0 +1,232 @@
+#include "rt/RtProgram.hpp"
+
+namespace rt {
+
+  void ProgramBuilder::count(Node u, std::vector<uint32_t>& refs) {
+    if (refs[u]++ > 0) {
+      return;
+    }
+    auto [kind, arg0, arg1] = nodes[u];
+    switch (kind) {
+    case Kind::Const:
+    case Kind::Var:
+      break;
+    case Kind::Not:
+      count(arg0, refs);
+      break;
+    case Kind::And:
+    case Kind::Or:
+      count(arg0, refs);
+      count(arg1, refs);
+      break;
+    }
+  }
+
+  void ProgramBuilder::emit(Node u, Program& program, bool inlined) {
+    if (!inlined && slots[u] != NoSlot) {
+      emit(program, Program::Call, slots[u]);
+      return;
+    }
+
+    auto [kind, arg0, arg1] = nodes[u];
+    switch (kind) {
+    case Kind::Const:
+      emit(program, Program::Const, arg0);
+      break;
+    case Kind::Var:
+      emit(program, Program::Load, arg0);
+      break;
+    case Kind::Not:
+      if (std::get<0>(nodes[arg0]) == Kind::Var) {
+        emit(program, Program::LoadNot, std::get<1>(nodes[arg0]));
+      } else {
+        emit(arg0, program, false);
+        emit(program, Program::Not, 0);
+      }
+      break;
+    case Kind::And:
+    case Kind::Or: {
+      emit(arg0, program, false);
+      size_t jump = program.code.size();
+      emit(program, Program::Const, 0); // placeholder
+      emit(arg1, program, false);
+      Program::Op op = kind == Kind::And ? Program::JumpIfFalse : Program::JumpIfTrue;
+      program.code[jump] = Program::encode(op, program.code.size());
+      break;
+    }
+    }
+  }
+
+  void ProgramBuilder::build(Node root, Program& program) {
+    program.code.clear();
+    program.entries.clear();
+
+    std::vector<uint32_t> refs(nodes.size(), 0);
+    count(root, refs);
+
+    // Nodes are created bottom-up, so operands of a shared node
+    // get greater slots and a subroutine only calls greater slots
+    slots.assign(nodes.size(), NoSlot);
+    std::vector<Node> shared;
+    for (Node u = nodes.size(); u-- > 0; ) {
+      auto [kind, arg0, arg1] = nodes[u];
+      bool compound = kind == Kind::And || kind == Kind::Or
+        || (kind == Kind::Not && std::get<0>(nodes[arg0]) != Kind::Var);
+      if (u != root && compound && refs[u] > 1) {
+        slots[u] = shared.size();
+        shared.push_back(u);
+      }
+    }
+
+    emit(root, program, true);
+    emit(program, Program::Return, 0);
+    program.entries.resize(shared.size());
+    for (size_t s = 0; s < shared.size(); ++s) {
+      program.entries[s] = program.code.size();
+      emit(shared[s], program, true);
+      emit(program, Program::Return, 0);
+    }
+  }
+
+  bool verify(const ProgramView& program, size_t atomicCount) {
+    // subroutine `r` spans [begin, end), main program is `r == entryCount`
+    for (size_t r = 0; r <= program.entryCount; ++r) {
+      bool main = r == program.entryCount;
+      size_t begin = main ? 0 : program.entries[r];
+      size_t end = program.codeSize;
+      if (main && program.entryCount > 0) {
+        end = program.entries[0];
+      } else if (!main && r + 1 < program.entryCount) {
+        end = program.entries[r + 1];
+      }
+      if (begin >= end || end > program.codeSize) {
+        return false;
+      }
+      if ((program.code[end - 1] & 0xff) != Program::Return) {
+        return false;
+      }
+      for (size_t pc = begin; pc < end; ++pc) {
+        Program::Word arg = program.code[pc] >> Program::OpBits;
+        switch (program.code[pc] & 0xff) {
+        case Program::Const:
+        case Program::Not:
+        case Program::Return:
+          break;
+        case Program::Load:
+        case Program::LoadNot:
+          if (arg >= atomicCount) {
+            return false;
+          }
+          break;
+        case Program::JumpIfFalse:
+        case Program::JumpIfTrue:
+          if (arg <= pc || arg >= end) {
+            return false;
+          }
+          break;
+        case Program::Call:
+          if (arg >= program.entryCount || (!main && arg <= r)) {
+            return false;
+          }
+          break;
+        default:
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Predicate bytecode reader
+   */
+  class ProgramCompiler {
+  public:
+    ProgramCompiler(const uint8_t* data_, size_t len_)
+      : data(data_), len(len_), eip(data_) {}
+
+    ProgramBuilder::Node compile() {
+      RefOffset at = eip - data;
+      ProgramBuilder::Node node = compile0();
+      subterms.insert({ at, node });
+      return node;
+    }
+
+    ProgramBuilder& getBuilder() { return builder; }
+
+  private:
+    ProgramBuilder::Node compile0() {
+      Code c;
+
+      readValue(c);
+      switch (c) {
+      case Code::False:
+        return builder.constant(false);
+      case Code::True:
+        return builder.constant(true);
+      case Code::Name: {
+        Offset off;
+        readValue(off);
+        return builder.var(off);
+      }
+      case Code::Not:
+        return builder.negate(compile());
+      case Code::And: {
+        ProgramBuilder::Node lhs = compile();
+        return builder.conj(lhs, compile());
+      }
+      case Code::Or: {
+        ProgramBuilder::Node lhs = compile();
+        return builder.disj(lhs, compile());
+      }
+      case Code::Ref: {
+        // only complete subterms are known, so there are no cycles
+        RefOffset off;
+        readValue(off);
+        auto i = subterms.find(off);
+        assert(i != subterms.end());
+        return i == subterms.end() ? builder.constant(false) : i->second;
+      }
+      }
+      assert(false);
+      return builder.constant(false);
+    }
+
+    template <typename T>
+    void readValue(T& t) {
+      assert(len >= (size_t)(eip + sizeof(T) - data));
+      t = *reinterpret_cast<const T*>(eip);
+      eip += sizeof(T);
+    }
+
+    ProgramBuilder builder;
+    std::map<RefOffset, ProgramBuilder::Node> subterms; /** by offset, see `Code::Ref` */
+    const uint8_t* data;
+    size_t len;
+
+    const uint8_t* eip;
+  };
+
+  void compile(const uint8_t* data, size_t len, Program& program) {
+    ProgramCompiler compiler(data, len);
+    ProgramBuilder::Node root = compiler.compile();
+    compiler.getBuilder().build(root, program);
+  }
+
+  void remap(const std::vector<Offset>& atomics, Program& program) {
+    for (auto& w : program.code) {
+      Program::Word arg = w >> Program::OpBits;
+      switch (static_cast<Program::Op>(w & ((1 << Program::OpBits) - 1))) {
+      case Program::Load:
+      case Program::LoadNot:
+        assert(arg < atomics.size());
+        w = Program::encode(static_cast<Program::Op>(w & ((1 << Program::OpBits) - 1)),
+                            atomics[arg]);
+        break;
+      default:
+        break;
+      }
+    }
+  }
+
+} //namespace rt
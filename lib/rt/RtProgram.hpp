@@ -0,0 +1,256 @@
+#ifndef RTPROGRAM_HPP
+#define RTPROGRAM_HPP
+
+#include "rt/RtPredicate.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+#include <memory.h>
+
+namespace rt {
+
+  /**
+   * Compiled predicate
+   *
+   * A flat program for an accumulator machine. Every instruction is
+   * a 32-bit word: opcode in the lower 8 bits, argument in the rest.
+   * `And`/`Or` are compiled into conditional jumps (short-circuiting).
+   *
+   * Subexpressions shared in a DAG are compiled once, as subroutines.
+   * A subroutine is run at most once per evaluation: its result is kept
+   * in a slot and `Call` reuses it afterwards. The number of slots is
+   * not bounded, so the code stays linear in the size of the DAG.
+   */
+  class Program {
+  public:
+    enum Op : uint8_t {
+      Const = 0,       /** acc = arg */
+      Load = 1,        /** acc = names[arg] */
+      LoadNot = 2,     /** acc = !names[arg] */
+      Not = 3,         /** acc = !acc */
+      JumpIfFalse = 4, /** if (!acc) pc = arg */
+      JumpIfTrue = 5,  /** if (acc) pc = arg */
+      Call = 6,        /** acc = slot[arg] (run subroutine `arg` if not yet known) */
+      Return = 7,      /** store acc into the slot being computed (or finish) */
+    };
+
+    typedef uint32_t Word;
+
+    static constexpr size_t OpBits = 8;
+    static constexpr Word MaxArg = (Word(1) << (32 - OpBits)) - 1;
+    /** Slots kept on the stack of `run`, more slots are allocated */
+    static constexpr size_t MaxSlots = 64;
+
+    std::vector<Word> code;
+    std::vector<Word> entries; /** subroutine entry point per slot */
+
+    static Word encode(Op op, Word arg) {
+      assert(arg <= MaxArg);
+      return (arg << OpBits) | op;
+    }
+
+    template <typename Vars>
+    bool eval(const Vars& names) const {
+      return run(code.data(), entries.data(), entries.size(), names);
+    }
+
+    /**
+     * Evaluate a program stored elsewhere (see `ProgramView`)
+     *
+     * @param[in] c instructions
+     * @param[in] entries subroutine entry points
+     * @param[in] entryCount number of subroutines
+     * @param[in] names atomic values, `Names` or a fixed size
+     *                  set with `test` (see `AtomBits`)
+     */
+    template <typename Vars>
+    static bool run(const Word* c, const Word* entries, size_t entryCount,
+                    const Vars& names) {
+      struct Frame {
+        Word pc;
+        Word slot;
+      };
+      // a subroutine calls greater slots only, so calls nest at most `entryCount` deep
+      uint8_t local[MaxSlots]; // 0 - unknown, 1 - false, 2 - true
+      Frame localStack[MaxSlots];
+      std::unique_ptr<uint8_t[]> allocated;
+      std::unique_ptr<Frame[]> allocatedStack;
+      uint8_t* slots = local;
+      Frame* stack = localStack;
+      if (entryCount > MaxSlots) {
+        allocated.reset(new uint8_t[entryCount]);
+        allocatedStack.reset(new Frame[entryCount]);
+        slots = allocated.get();
+        stack = allocatedStack.get();
+      }
+
+      memset(slots, 0, entryCount);
+
+      size_t sp = 0;
+      Word pc = 0;
+      bool acc = false;
+
+      while (true) {
+        Word w = c[pc++];
+        Word arg = w >> OpBits;
+        switch (static_cast<Op>(w & ((1 << OpBits) - 1))) {
+        case Const:
+          acc = arg;
+          break;
+        case Load:
+          acc = names.test(arg);
+          break;
+        case LoadNot:
+          acc = !names.test(arg);
+          break;
+        case Not:
+          acc = !acc;
+          break;
+        case JumpIfFalse:
+          if (!acc) {
+            pc = arg;
+          }
+          break;
+        case JumpIfTrue:
+          if (acc) {
+            pc = arg;
+          }
+          break;
+        case Call:
+          if (slots[arg]) {
+            acc = slots[arg] - 1;
+          } else {
+            stack[sp++] = { pc, arg };
+            pc = entries[arg];
+          }
+          break;
+        case Return:
+          if (sp == 0) {
+            return acc;
+          }
+          --sp;
+          slots[stack[sp].slot] = acc + 1;
+          pc = stack[sp].pc;
+          break;
+        default:
+          assert(false);
+          return false;
+        }
+      }
+    }
+
+    friend bool operator== (const Program& u, const Program& v) {
+      return u.code == v.code && u.entries == v.entries;
+    }
+    friend bool operator!= (const Program& u, const Program& v) {
+      return !(u == v);
+    }
+  };
+
+  /**
+   * `Program` kept in external memory (e.g. a mapped image)
+   */
+  struct ProgramView {
+    const Program::Word* code;
+    size_t codeSize;
+    const Program::Word* entries;
+    size_t entryCount;
+
+    template <typename Vars>
+    bool eval(const Vars& names) const {
+      return Program::run(code, entries, entryCount, names);
+    }
+
+    /** Copy into an owned `Program` */
+    Program copy() const {
+      Program program;
+      program.code.assign(code, code + codeSize);
+      program.entries.assign(entries, entries + entryCount);
+      return program;
+    }
+  };
+
+  /**
+   * Check that a program from an untrusted source is safe to run
+   *
+   * Every subroutine ends with `Return`, jumps are forward and stay
+   * within their subroutine, a subroutine only calls subroutines
+   * with greater slots and atomics are below `atomicCount`.
+   */
+  extern bool verify(const ProgramView& program, size_t atomicCount);
+
+  /**
+   * Build `Program` from a predicate DAG
+   *
+   * Nodes are hash-consed, so equal subexpressions
+   * are represented by the same node.
+   */
+  class ProgramBuilder {
+  public:
+    typedef uint32_t Node;
+
+    Node constant(bool v) { return node(Kind::Const, v, 0); }
+    Node var(uint32_t v) { return node(Kind::Var, v, 0); }
+    Node negate(Node u) { return node(Kind::Not, u, 0); }
+    Node conj(Node u, Node v) { return node(Kind::And, u, v); }
+    Node disj(Node u, Node v) { return node(Kind::Or, u, v); }
+
+    void build(Node root, Program& program);
+
+  private:
+    enum class Kind : uint8_t {
+      Const,
+      Var,
+      Not,
+      And,
+      Or
+    };
+
+    typedef std::tuple<Kind, uint32_t, uint32_t> Key;
+
+    static constexpr uint32_t NoSlot = ~uint32_t(0);
+
+    Node node(Kind kind, uint32_t arg0, uint32_t arg1) {
+      auto r = nodeMap.insert({ Key{ kind, arg0, arg1 }, nodes.size() });
+      if (r.second) {
+        nodes.push_back(r.first->first);
+      }
+      return r.first->second;
+    }
+
+    void count(Node u, std::vector<uint32_t>& refs);
+    void emit(Node u, Program& program, bool inlined);
+    void emit(Program& program, Program::Op op, uint32_t arg) {
+      program.code.push_back(Program::encode(op, arg));
+    }
+
+    std::vector<Key> nodes;
+    std::map<Key, Node> nodeMap;
+    std::vector<uint32_t> slots;
+  };
+
+  /**
+   * Compile predicate bytecode (see `Evaluator`) into `Program`
+   *
+   * Equal subtrees of the predicate are compiled only once.
+   */
+  extern void compile(const uint8_t* data, size_t len, Program& program);
+
+  inline void compile(const std::vector<uint8_t>& phi, Program& program) {
+    compile(&phi[0], phi.size(), program);
+  }
+
+  /**
+   * Rename atomics of a compiled predicate
+   *
+   * Atomic `i` becomes `atomics[i]`.
+   */
+  extern void remap(const std::vector<Offset>& atomics, Program& program);
+
+} // namespace rt
+
+#endif // RTPROGRAM_HPP
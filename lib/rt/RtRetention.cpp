@@ -0,0 +1,31 @@
+#include "rt/RtRetention.hpp"
+
+#include <algorithm>
+
+namespace rt {
+
+  void EventRetention::append(const Payload* payloads, size_t count, const ExtendedMatch& result) {
+    size_t keep = retained(result);
+    // events of the batch past the horizon are not copied at all
+    size_t fresh = std::min(count, keep);
+    size_t old = std::min(size(), keep - fresh);
+    begin = end - old;
+    reserve(fresh);
+    std::copy(payloads + count - fresh, payloads + count, buffer.begin() + end);
+    end += fresh;
+  }
+
+  void EventRetention::reserve(size_t count) {
+    if (end + count <= buffer.size()) {
+      return;
+    }
+    size_t live = size();
+    if (2*(live + count) > buffer.size()) {
+      buffer.resize(std::max<size_t>(16, 2*(live + count)));
+    }
+    std::copy(buffer.begin() + begin, buffer.begin() + end, buffer.begin());
+    begin = 0;
+    end = live;
+  }
+
+} // namespace rt
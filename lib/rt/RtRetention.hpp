@@ -0,0 +1,107 @@
+#ifndef RTRETENTION_HPP
+#define RTRETENTION_HPP
+
+#include "Match.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace rt {
+
+  /**
+   * Payloads of the latest events of a stream
+   *
+   * Only events which may still belong to a match are kept:
+   * after every append the buffer is trimmed to the horizon
+   * of the current `ExtendedMatch`. Payloads are opaque for the
+   * library (offsets, pointers, ids of events kept by a client).
+   *
+   * Retained payloads are contiguous, so a match is returned in
+   * place: the window slides over a buffer and it is moved back to
+   * the front when it reaches the end (the buffer is at least twice
+   * as large as the window, so a payload is moved at most once
+   * on average).
+   */
+  class EventRetention {
+  public:
+    typedef uint64_t Payload;
+
+    void clear() {
+      begin = 0;
+      end = 0;
+    }
+
+    /**
+     * Append payload of the next event
+     *
+     * @param[in] payload payload of the event
+     * @param[in] result result after the event
+     */
+    void append(Payload payload, const ExtendedMatch& result) {
+      append(&payload, 1, result);
+    }
+
+    /**
+     * Append payloads of a batch of events
+     *
+     * Only events within the horizon of the result after the last one
+     * are kept, so matches found inside the batch are not retained.
+     *
+     * @param[in] payloads payloads of events
+     * @param[in] count number of events
+     * @param[in] result result after the last event
+     */
+    void append(const Payload* payloads, size_t count, const ExtendedMatch& result);
+
+    /** Number of retained events */
+    size_t size() const { return end - begin; }
+    /** Retained payloads, the latest event is the last one */
+    const Payload* data() const { return buffer.data() + begin; }
+
+    /**
+     * Payloads of a match (the latest events)
+     *
+     * @param[in] result current result
+     * @param[in] longest longest or shortest match
+     * @param[out] payloads payloads of events of the match
+     * @param[out] count number of events of the match
+     * @returns false if there is no match or it is not retained
+     */
+    bool match(const ExtendedMatch& result, bool longest,
+               const Payload*& payloads, size_t& count) const {
+      if (result.match != Match_Ok) {
+        return false;
+      }
+      count = longest ? result.ok.longest : result.ok.shortest;
+      if (count > size()) {
+        return false;
+      }
+      payloads = data() + size() - count;
+      return true;
+    }
+
+    /** Number of events which may belong to a match after `result` */
+    static size_t retained(const ExtendedMatch& result) {
+      switch (result.match) {
+      case Match_Ok:
+        return std::max(result.ok.horizon, result.ok.longest);
+      case Match_Partial:
+        return result.partial.horizon;
+      default:
+        return 0;
+      }
+    }
+
+  private:
+    /** make room for `count` payloads past the end */
+    void reserve(size_t count);
+
+    std::vector<Payload> buffer;
+    size_t begin = 0;
+    size_t end = 0;
+  };
+
+} // namespace rt
+
+#endif // RTRETENTION_HPP
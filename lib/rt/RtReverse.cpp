@@ -0,0 +1,351 @@
+#include "rt/RtReverse.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace rt {
+
+  std::shared_ptr<Nfasl> reverse(const Nfasl& nfasl) {
+    // a counter is entered and left in the other order
+    assert(nfasl.counters.empty());
+    auto r = std::make_shared<Nfasl>();
+    r->atomicCount = nfasl.atomicCount;
+    r->stateCount = nfasl.stateCount;
+    r->initials = nfasl.finals;
+    r->finals = nfasl.initials;
+    r->predicates = nfasl.predicates;
+    r->window = nfasl.window;
+    r->transitions.resize(nfasl.stateCount);
+    for (State q = 0; q < nfasl.stateCount; ++q) {
+      for (auto& tr : nfasl.transitions[q]) {
+        StateTransition back;
+        back.phi = tr.phi;
+        back.state = q;
+        back.pred = tr.pred;
+        r->transitions[tr.state].push_back(back);
+      }
+    }
+    return r;
+  }
+
+  NfaslReverseContext::NfaslReverseContext(std::shared_ptr<Nfasl> nfasl_,
+                                           std::shared_ptr<Nfasl> reversed_,
+                                           size_t maxRetained_)
+    : nfasl(nfasl_), reversed(reversed_),
+      stride(std::max<size_t>(1, (nfasl_->atomicCount + 7) / 8)),
+      maxRetained(std::max<size_t>(1, maxRetained_)),
+      clock(nfasl_->window), capacity(0), head(0), count(0) {
+    assert(nfasl->counters.empty());
+    assert(reversed->stateCount == nfasl->stateCount);
+    cache.attach(nfasl->predicates);
+    reverseCache.attach(reversed->predicates);
+    for (size_t q = nfasl->initials.find_first();
+         q != States::npos;
+         q = nfasl->initials.find_next(q)) {
+      for (auto& tr : nfasl->transitions[q]) {
+        wake.push_back(tr.pred);
+      }
+    }
+    std::sort(wake.begin(), wake.end());
+    wake.erase(std::unique(wake.begin(), wake.end()), wake.end());
+    row.resize(stride);
+    reset();
+  }
+
+  void NfaslReverseContext::reset() {
+    horizon = 0;
+    settled = 0;
+    head = 0;
+    count = 0;
+    clock.reset();
+    currentStates = nfasl->initials;
+    currentStates.resize(nfasl->stateCount);
+    nextStates.resize(nfasl->stateCount);
+    reverseStates.resize(nfasl->stateCount);
+    reverseNext.resize(nfasl->stateCount);
+    finals();
+  }
+
+  void NfaslReverseContext::advance(const Names& vars_) {
+    std::fill(row.begin(), row.end(), 0);
+    for (size_t a = vars_.find_first();
+         a != Names::npos && a < nfasl->atomicCount;
+         a = vars_.find_next(a)) {
+      row[a >> 3] |= 1 << (a & 7);
+    }
+    cache.next(vars_);
+    advanceCached(row.data());
+  }
+
+  void NfaslReverseContext::advanceBatch(const Events& events, ExtendedMatch* results) {
+    size_t bytes = std::min(stride, (events.atomicCount + 7) / 8);
+    for (size_t begin = 0; begin < events.count; begin += laneCount) {
+      size_t n = cache.next(events, begin);
+      Lanes woken = 0;
+      bool known = false; /** `woken` is known for the block */
+      for (size_t lane = 0; lane < n; ++lane) {
+        // only initial states are active, nothing is retained
+        if (horizon == 0) {
+          if (!known) {
+            for (auto ix : wake) {
+              woken |= cache.mask(ix);
+            }
+            known = true;
+          }
+          Lanes rest = woken >> lane;
+          size_t skip = rest ? std::min<size_t>(__builtin_ctzll(rest), n - lane) : n - lane;
+          if (results) {
+            std::fill(results + begin + lane, results + begin + lane + skip, result);
+          }
+          lane += skip;
+          if (lane == n) {
+            break;
+          }
+        }
+        std::fill(row.begin(), row.end(), 0);
+        memcpy(row.data(), events.row(begin + lane), bytes);
+        cache.select(lane);
+        advanceCached(row.data());
+        if (results) {
+          results[begin + lane] = result;
+        }
+      }
+    }
+  }
+
+  void NfaslReverseContext::advanceCached(const uint8_t* event) {
+    retain(event);
+    bool advanced = false;
+    nextStates.reset();
+    nextStates |= nfasl->initials;
+    for (size_t q = currentStates.find_first();
+         q != States::npos;
+         q = currentStates.find_next(q)) {
+      for (auto& tr : nfasl->transitions[q]) {
+        if (cache.eval(tr.pred)) {
+          advanced = true;
+          nextStates.set(tr.state);
+        }
+      }
+    }
+    std::swap(currentStates, nextStates);
+    if (advanced) {
+      ++horizon;
+    } else {
+      horizon = 0;
+      settled = 0;
+    }
+    if (clock.bounded()) {
+      // no run is longer than the window
+      horizon = std::min(horizon, clock.span());
+      settled = std::min(settled, horizon);
+    }
+    if (horizon >= 2*settled + minSettle) {
+      settle();
+    }
+    trim(horizon);
+    finals();
+  }
+
+  void NfaslReverseContext::retain(const uint8_t* event) {
+    if (count == capacity && capacity < maxRetained) {
+      size_t grown = std::max<size_t>(16, 2*capacity);
+      std::vector<uint8_t> ring(grown*stride);
+      for (size_t k = count; k > 0; --k) {
+        memcpy(ring.data() + (count - k)*stride, retained(k), stride);
+      }
+      std::swap(rows, ring);
+      capacity = grown;
+      head = count;
+    }
+    // the earliest event is dropped past the limit
+    memcpy(rows.data() + (head & (capacity - 1))*stride, event, stride);
+    ++head;
+    count = std::min(count + 1, maxRetained);
+    if (clock.bounded()) {
+      clock.tick();
+      clock.trim(count);
+    }
+  }
+
+  void NfaslReverseContext::trim(size_t length) {
+    count = std::min(count, length);
+    if (clock.bounded()) {
+      clock.trim(count);
+    }
+  }
+
+  template <typename Found>
+  bool NfaslReverseContext::scan(const States& from, Found found) {
+    Events events{ nullptr, stride, 0, nfasl->atomicCount };
+    reverseStates = from;
+    if (reverseStates.intersects(nfasl->initials)) {
+      found(0);
+    }
+    for (size_t k = 1; k <= count && reverseStates.any(); ++k) {
+      // a run of the `k` latest events is out of the window
+      if (clock.bounded() && !clock.within(k)) {
+        return false;
+      }
+      events.unpack(retained(k), vars);
+      reverseCache.next(vars);
+      reverseNext.reset();
+      for (size_t q = reverseStates.find_first();
+           q != States::npos;
+           q = reverseStates.find_next(q)) {
+        for (auto& tr : reversed->transitions[q]) {
+          if (reverseCache.eval(tr.pred)) {
+            reverseNext.set(tr.state);
+          }
+        }
+      }
+      std::swap(reverseStates, reverseNext);
+      if (reverseStates.intersects(nfasl->initials)) {
+        found(k);
+      }
+    }
+    // with a time window, runs older than retained events expire
+    return !clock.bounded() && truncated() && reverseStates.any();
+  }
+
+  void NfaslReverseContext::settle() {
+    size_t exact = 0;
+    if (scan(currentStates, [&](size_t k) { exact = k; })) {
+      // the earliest active run is not retained, `horizon` stays
+      settled = horizon;
+      return;
+    }
+    horizon = exact;
+    settled = exact;
+    if (exact == 0) {
+      // runs left are out of the window
+      currentStates = nfasl->initials;
+    }
+  }
+
+  void NfaslReverseContext::finals() {
+    if (nfasl->finals.count() == 0) {
+      result.match = Match_Failed;
+      return;
+    }
+    bool any = false;
+    size_t longest = 0;
+    size_t shortest = 0;
+    if (currentStates.intersects(nfasl->finals)) {
+      nextStates = currentStates;
+      nextStates &= nfasl->finals;
+      // lengths are found in increasing order
+      bool beyond = scan(nextStates, [&](size_t k) {
+        if (!any) {
+          shortest = k;
+        }
+        longest = k;
+        any = true;
+      });
+      // a match starts before retained events, see `maxRetained`
+      if (beyond) {
+        shortest = any ? shortest : horizon;
+        longest = horizon;
+        any = true;
+      }
+    }
+    if (any) {
+      result.match = Match_Ok;
+      result.ok.shortest = shortest;
+      result.ok.longest = longest;
+      result.ok.horizon = horizon;
+    } else {
+      result.match = Match_Partial;
+      result.partial.horizon = horizon;
+    }
+  }
+
+  void NfaslReverseContext::save(SnapshotWriter& writer) const {
+    writer.writeValue(uint64_t(horizon));
+    writer.writeValue(uint64_t(settled));
+    writer.writeValue(uint64_t(count));
+    writer.writeMatch(result.match);
+    writer.writeValue(uint64_t(result.ok.longest));
+    writer.writeValue(uint64_t(result.ok.shortest));
+    writer.writeValue(uint64_t(result.ok.horizon));
+    if (clock.bounded()) {
+      clock.save(writer);
+    }
+    writer.writeStates(currentStates);
+    // retained events, the earliest first
+    for (size_t k = count; k > 0; --k) {
+      writer.writeData(retained(k), stride);
+    }
+  }
+
+  void NfaslReverseContext::restore(SnapshotReader& reader) {
+    uint64_t h, s, n, longest, shortest, okHorizon;
+    reader.readValue(h);
+    reader.readValue(s);
+    reader.readValue(n);
+    reader.ensure(s <= h && n <= h && (h == 0 || n > 0));
+    ExtendedMatch r;
+    r.match = reader.readMatch();
+    reader.readValue(longest);
+    reader.readValue(shortest);
+    reader.readValue(okHorizon);
+    r.ok.longest = longest;
+    r.ok.shortest = shortest;
+    r.ok.horizon = okHorizon;
+    RtClock c(clock.getWindow());
+    if (c.bounded()) {
+      c.restore(reader);
+      // a time per retained event, all active runs are retained
+      reader.ensure(c.size() == n && n == h);
+    }
+
+    States qs;
+    reader.readStates(qs, nfasl->stateCount);
+    // initial states are always active, other ones only with retained events
+    reader.ensure(nfasl->initials.is_subset_of(qs));
+    reader.ensure(h > 0 || qs == nfasl->initials);
+
+    // events are read one by one, so a wrong count fails before allocation
+    std::vector<uint8_t> ring;
+    for (uint64_t k = 0; k < n; ++k) {
+      ring.resize(ring.size() + stride);
+      reader.readData(ring.data() + ring.size() - stride, stride);
+    }
+    // the limit may be less than of the saved context
+    size_t kept = std::min<size_t>(n, maxRetained);
+    ring.erase(ring.begin(), ring.begin() + (n - kept)*stride);
+    if (c.bounded()) {
+      // runs older than retained events expire
+      c.trim(kept);
+      h = kept;
+      s = std::min<uint64_t>(s, h);
+    }
+    size_t grown = 16;
+    while (grown < kept) {
+      grown *= 2;
+    }
+    ring.resize(grown*stride);
+
+    horizon = h;
+    settled = s;
+    result = r;
+    clock = c;
+    std::swap(currentStates, qs);
+    std::swap(rows, ring);
+    capacity = grown;
+    head = kept;
+    count = kept;
+  }
+
+  ExtendedExecutorPtr createNfaslReverseContext(std::shared_ptr<Nfasl> nfasl,
+                                                std::shared_ptr<Nfasl> reversed,
+                                                size_t maxRetained) {
+    // runs with different counter values are not told apart
+    if (!nfasl->counters.empty()) {
+      return nullptr;
+    }
+    return std::make_shared<NfaslReverseContext>(nfasl, reversed, maxRetained);
+  }
+
+} // namespace rt
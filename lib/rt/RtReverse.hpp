@@ -0,0 +1,144 @@
+#ifndef RTREVERSE_HPP
+#define RTREVERSE_HPP
+
+#include "rt/RtNfasl.hpp"
+#include "rt/RtPredicatePool.hpp"
+#include "rt/RtSliced.hpp"
+#include "rt/RtClock.hpp"
+#include "rt/Executor.hpp"
+#include "rt/Loader.hpp"
+#include "Match.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace rt {
+
+  /**
+   * Reverse of NFASL: rules go backwards, initial and final states swap
+   *
+   * Rules keep predicates of the source automaton, so `PredicateIndex`
+   * of a rule is the same in both.
+   */
+  extern std::shared_ptr<Nfasl> reverse(const Nfasl& nfasl);
+
+  /**
+   * Extended executor which finds starts of matches by a reverse pass
+   *
+   * A new run is started on every event, as in `NfaslExtendedContext`,
+   * but runs are not told apart: a step only advances the set of active
+   * states. Events are retained back to the earliest active run and
+   * once a final state is reached the reverse automaton is run backwards
+   * over them from the final states: every event where it reaches
+   * an initial state of the source automaton starts a match.
+   * So only matching events pay for `longest` and `shortest`.
+   *
+   * The earliest active run is found by the reverse pass as well, from
+   * all active states, when the number of retained events doubled since
+   * the previous one, so `horizon` is an upper bound (at most twice
+   * the exact one, plus `minSettle` events).
+   *
+   * Matches and their lengths are the same as of `NfaslExtendedContext`,
+   * with a time window (see `RtClock`) `longest` is exact as well.
+   * Counting states (see `Counter`) are not supported.
+   *
+   * A run may stay active for good (`a ; true[*] ; b` after `a`), so
+   * at most `maxRetained` latest events are retained. A match which
+   * may start before them is still reported, but its length is not
+   * known: `longest` is `horizon` then (an upper bound), so is `shortest`
+   * if no match starts within retained events. With a time window such
+   * runs expire.
+   * A step which ends a match scans back over retained events, so
+   * the limit bounds its cost as well.
+   */
+  class NfaslReverseContext : public ExtendedExecutor {
+  public:
+    /** Retained events before the earliest active run is looked for */
+    static constexpr size_t minSettle = 32;
+    /** Default limit of retained events */
+    static constexpr size_t defaultMaxRetained = size_t(1) << 16;
+
+    NfaslReverseContext(std::shared_ptr<Nfasl> nfasl_, std::shared_ptr<Nfasl> reversed_,
+                        size_t maxRetained_ = defaultMaxRetained);
+    const ExtendedMatch& getResult() const override {
+      return result;
+    }
+
+    void reset() override;
+    void advance(const Names& vars) override;
+    void advanceAt(const Names& vars, Timestamp time) override {
+      clock.setTime(time);
+      advance(vars);
+    }
+    /** See `advanceSliced`, events are retained as they are */
+    void advanceBatch(const Events& events, ExtendedMatch* results) override;
+    void save(SnapshotWriter& writer) const override;
+    void restore(SnapshotReader& reader) override;
+
+    /** Number of retained events, at most `maxRetained` */
+    size_t retainedCount() const { return count; }
+
+  private:
+    /** Advance over the event selected in `cache`, its atomics are `row` */
+    void advanceCached(const uint8_t* row);
+    /** Retain an event, the latest one is `retained(1)` */
+    void retain(const uint8_t* row);
+    /** Keep the `length` latest events */
+    void trim(size_t length);
+    const uint8_t* retained(size_t k) const {
+      return rows.data() + ((head - k) & (capacity - 1))*stride;
+    }
+    /** Runs may be older than retained events, see `maxRetained` */
+    bool truncated() const { return count < horizon; }
+    /**
+     * Run the reverse automaton from `from` back over retained events
+     *
+     * @param[in] from active states of the source automaton
+     * @param[in] found called with the length of every run from an initial state
+     * @returns true if runs may start before retained events
+     */
+    template <typename Found>
+    bool scan(const States& from, Found found);
+    /** Find the earliest active run, see `horizon` */
+    void settle();
+    void finals();
+
+    std::shared_ptr<Nfasl> nfasl;
+    std::shared_ptr<Nfasl> reversed;
+    size_t stride; /** bytes of a retained event */
+    size_t horizon; /** no active run is longer, all its events are retained */
+    size_t settled; /** `horizon` found by the latest `settle` */
+    size_t maxRetained;
+    RtClock clock;
+    SlicedPredicateCache cache;
+    PredicateCache reverseCache;
+    std::vector<PredicateIndex> wake; /** predicates of rules of initial states */
+    States currentStates;
+    States nextStates; /** buffer for `advance` */
+    States reverseStates; /** buffers for `scan` */
+    States reverseNext;
+    std::vector<uint8_t> rows; /** ring of the `count` latest events */
+    size_t capacity; /** events in `rows`, a power of 2 */
+    size_t head; /** position past the latest event */
+    size_t count; /** retained events, `horizon` up to `maxRetained` after a step */
+    std::vector<uint8_t> row; /** buffer for `advance` */
+    Names vars; /** buffer for `scan` */
+    ExtendedMatch result;
+  };
+
+  /**
+   * Create a reverse-pass extended executor (see `NfaslReverseContext`)
+   *
+   * @param[in] reversed `reverse(*nfasl)`, it may be shared by executors
+   * @param[in] maxRetained the limit of retained events
+   * @returns nullptr if NFASL has counting states (see `Counter`)
+   */
+  extern ExtendedExecutorPtr createNfaslReverseContext(std::shared_ptr<Nfasl> nfasl,
+                                                       std::shared_ptr<Nfasl> reversed,
+                                                       size_t maxRetained
+                                                       = NfaslReverseContext::defaultMaxRetained);
+
+} // namespace rt
+
+#endif // RTREVERSE_HPP
@@ -0,0 +1,220 @@
+#include "rt/RtScan.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace rt {
+
+  /** `DfaslTable` stepped over classes of events */
+  class TableStepper {
+  public:
+    typedef DfaslTable::State State;
+    typedef DfaslTable::Class Symbol;
+
+    TableStepper(const DfaslTable& dfasl_, const Events& events_)
+      : dfasl(dfasl_), events(events_) {}
+
+    State sink() const { return dfasl.sink(); }
+    State initial() const { return dfasl.initial; }
+    bool hasFinals() const { return dfasl.finals.any(); }
+    bool isFinal(State q) const { return dfasl.finals.test(q); }
+
+    void symbol(size_t ix, Symbol& c) const { c = dfasl.classify(events.row(ix)); }
+    State next(State q, Symbol c) const { return dfasl.next(q, c); }
+
+  private:
+    const DfaslTable& dfasl;
+    const Events& events;
+  };
+
+  /** `Dfasl` stepped over unpacked events, `stateCount` is a sink */
+  class RuleStepper {
+  public:
+    typedef Dfasl::State State;
+    typedef Names Symbol;
+
+    RuleStepper(const Dfasl& dfasl_, const Events& events_)
+      : dfasl(dfasl_), events(events_) {}
+
+    State sink() const { return dfasl.stateCount; }
+    State initial() const { return dfasl.initial; }
+    bool hasFinals() const { return !dfasl.finals.empty(); }
+    bool isFinal(State q) const { return dfasl.finals.count(q) != 0; }
+
+    void symbol(size_t ix, Symbol& vars) const { events.unpack(events.row(ix), vars); }
+
+    State next(State q, const Symbol& vars) const {
+      if (q == sink()) {
+        return q;
+      }
+      for (auto& tr : dfasl.transitions[q]) {
+        if (dfasl.predicates[tr.pred].eval(vars)) {
+          return tr.state;
+        }
+      }
+      return sink();
+    }
+
+  private:
+    const Dfasl& dfasl;
+    const Events& events;
+  };
+
+  template <typename Stepper>
+  static Match toMatch(const Stepper& u, typename Stepper::State q) {
+    if (q == u.sink()) {
+      return Match_Failed;
+    }
+    return u.isFinal(q) ? Match_Ok : Match_Partial;
+  }
+
+  /** Run events [begin, end) from `q`, @returns the last state */
+  template <typename Stepper>
+  static typename Stepper::State run(const Stepper& u, typename Stepper::State q,
+                                     size_t begin, size_t end, Match* results) {
+    typename Stepper::Symbol c;
+    for (size_t ix = begin; ix < end; ++ix) {
+      u.symbol(ix, c);
+      q = u.next(q, c);
+      if (results) {
+        results[ix] = toMatch(u, q);
+      }
+    }
+    return q;
+  }
+
+  /**
+   * Transition function of events [begin, end)
+   *
+   * Every state (and the sink) is a start of a run. Runs which
+   * reach the same state are merged, so only distinct states
+   * are stepped: `parent` links a merged run to the surviving one.
+   */
+  template <typename Stepper>
+  static void compose(const Stepper& u, size_t begin, size_t end,
+                      std::vector<typename Stepper::State>& map) {
+    typedef typename Stepper::State State;
+    constexpr State None = ~State(0);
+
+    size_t n = size_t(u.sink()) + 1;
+    std::vector<State> states(n);
+    std::vector<State> parent(n);
+    std::vector<State> alive(n);
+    std::vector<State> seen(n, None);
+    for (State q = 0; q < n; ++q) {
+      states[q] = parent[q] = alive[q] = q;
+    }
+
+    typename Stepper::Symbol c;
+    size_t ix = begin;
+    for (; ix < end && alive.size() > 1; ++ix) {
+      u.symbol(ix, c);
+      size_t kept = 0;
+      for (auto run : alive) {
+        State t = u.next(states[run], c);
+        if (seen[t] == None) {
+          seen[t] = run;
+          states[run] = t;
+          alive[kept++] = run;
+        } else {
+          parent[run] = seen[t];
+        }
+      }
+      alive.resize(kept);
+      for (auto run : alive) {
+        seen[states[run]] = None;
+      }
+    }
+    // all runs are merged, the rest is a single run
+    if (alive.size() == 1) {
+      State run = alive.front();
+      states[run] = ::rt::run(u, states[run], ix, end, nullptr);
+    }
+
+    map.resize(n);
+    for (State q = 0; q < n; ++q) {
+      State run = q;
+      while (parent[run] != run) {
+        run = parent[run];
+      }
+      map[q] = states[run];
+    }
+  }
+
+  /** Run `f(ix)` for `ix` in [0, n), `f(0)` on the calling thread */
+  template <typename F>
+  static void parallel(size_t n, F f) {
+    std::vector<std::thread> threads;
+    for (size_t ix = 1; ix < n; ++ix) {
+      threads.emplace_back(f, ix);
+    }
+    f(0);
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+
+  template <typename Stepper>
+  static Match scan(const Stepper& u, const Events& events, Match* results,
+                    size_t threads, size_t minChunk) {
+    typedef typename Stepper::State State;
+
+    if (!u.hasFinals()) {
+      if (results) {
+        std::fill(results, results + events.count, Match_Failed);
+      }
+      return Match_Failed;
+    }
+    if (events.count == 0) {
+      return toMatch(u, u.initial());
+    }
+
+    if (threads == 0) {
+      threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    size_t chunks = std::max<size_t>(1, std::min(threads, events.count / std::max<size_t>(1, minChunk)));
+    if (chunks == 1) {
+      return toMatch(u, run(u, u.initial(), 0, events.count, results));
+    }
+
+    auto bound = [&](size_t chunk) { return events.count*chunk / chunks; };
+
+    // the first chunk starts from the known state, others from all
+    std::vector<std::vector<State>> maps(chunks);
+    State first = u.initial();
+    parallel(chunks, [&](size_t chunk) {
+      if (chunk == 0) {
+        first = run(u, u.initial(), 0, bound(1), results);
+      } else {
+        compose(u, bound(chunk), bound(chunk + 1), maps[chunk]);
+      }
+    });
+
+    std::vector<State> entries(chunks);
+    State q = first;
+    for (size_t chunk = 1; chunk < chunks; ++chunk) {
+      entries[chunk] = q;
+      q = maps[chunk][q];
+    }
+
+    if (results) {
+      parallel(chunks - 1, [&](size_t ix) {
+        size_t chunk = ix + 1;
+        run(u, entries[chunk], bound(chunk), bound(chunk + 1), results);
+      });
+    }
+    return toMatch(u, q);
+  }
+
+  Match scan(const DfaslTable& dfasl, const Events& events, Match* results,
+             size_t threads, size_t minChunk) {
+    return scan(TableStepper(dfasl, events), events, results, threads, minChunk);
+  }
+
+  Match scan(const Dfasl& dfasl, const Events& events, Match* results,
+             size_t threads, size_t minChunk) {
+    return scan(RuleStepper(dfasl, events), events, results, threads, minChunk);
+  }
+
+} // namespace rt
@@ -0,0 +1,42 @@
+#ifndef RTSCAN_HPP
+#define RTSCAN_HPP
+
+#include "rt/RtDfasl.hpp"
+#include "rt/RtDfaslTable.hpp"
+#include "rt/Executor.hpp"
+#include "Match.hpp"
+
+#include <cstdint>
+
+namespace rt {
+  /** Shorter sequences are not split, see `scan` */
+  constexpr size_t minScanChunk = 1 << 12;
+
+  /**
+   * Evaluate a long sequence of events on several threads
+   *
+   * Transition functions of a DFASL compose associatively, so events
+   * are split into chunks and the function of every chunk is computed
+   * in parallel: a chunk is run from all states at once, but only
+   * distinct states are stepped, which quickly converge in practice.
+   * Chunks are stitched together from the initial state and, if results
+   * are requested, rerun (again in parallel) from their entry states.
+   *
+   * Results are the same as of `DfaslContext` (`DfaslTableContext`)
+   * after `reset`, advanced over the events.
+   *
+   * @param[in] dfasl automaton
+   * @param[in] events packed events
+   * @param[out] results result after every event (may be nullptr)
+   * @param[in] threads number of threads, zero for a thread per core
+   * @param[in] minChunk do not split into chunks of fewer events
+   * @returns result after the last event
+   */
+  extern Match scan(const DfaslTable& dfasl, const Events& events, Match* results,
+                    size_t threads = 0, size_t minChunk = minScanChunk);
+  extern Match scan(const Dfasl& dfasl, const Events& events, Match* results,
+                    size_t threads = 0, size_t minChunk = minScanChunk);
+
+} // namespace rt
+
+#endif //RTSCAN_HPP
@@ -0,0 +1,230 @@
+#include "rt/RtScheduler.hpp"
+
+#include <algorithm>
+
+namespace rt {
+
+  /** The scheduler and the index of a worker running on this thread */
+  static thread_local const StreamScheduler* localScheduler = nullptr;
+  static thread_local size_t localWorker = 0;
+
+  StreamScheduler::StreamScheduler(Factory factory_, size_t atomicCount_,
+                                   Visitor visitor_, size_t threads)
+    : factory(factory_), atomicCount(atomicCount_),
+      eventStride(std::max<size_t>(1, (atomicCount_ + 7) / 8)),
+      visitor(visitor_), initialResult(factory_()->getResult()),
+      queued(0), sleepers(0), stopping(false), inflight(0) {
+    if (threads == 0) {
+      threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    for (size_t ix = 0; ix < threads; ++ix) {
+      pool.push_back(std::make_unique<Worker>());
+    }
+    for (size_t ix = 0; ix < threads; ++ix) {
+      workers.emplace_back([this, ix]() { work(ix); });
+    }
+  }
+
+  StreamScheduler::~StreamScheduler() {
+    {
+      std::lock_guard<std::mutex> lock(idleMutex);
+      stopping = true;
+    }
+    idle.notify_all();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  StreamScheduler::Stream& StreamScheduler::find(StreamId stream) {
+    Shard& shard = shards[stream % shardCount];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto r = shard.streams.insert({ stream, nullptr });
+    if (r.second) {
+      r.first->second = std::make_unique<Stream>();
+      Stream& s = *r.first->second;
+      s.id = stream;
+      s.executor = factory();
+      s.home = stream % pool.size();
+      s.result = s.executor->getResult();
+    }
+    return *r.first->second;
+  }
+
+  const StreamScheduler::Stream* StreamScheduler::lookup(StreamId stream) const {
+    const Shard& shard = shards[stream % shardCount];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.streams.find(stream);
+    return it == shard.streams.end() ? nullptr : it->second.get();
+  }
+
+  void StreamScheduler::post(StreamId stream, const uint8_t* event) {
+    enqueue(find(stream), event);
+  }
+
+  void StreamScheduler::post(StreamId stream, const Names& vars) {
+    thread_local std::vector<uint8_t> event;
+    event.assign(eventStride, 0);
+    for (size_t ix = vars.find_first(); ix != Names::npos; ix = vars.find_next(ix)) {
+      if (ix < atomicCount) {
+        event[ix >> 3] |= 1 << (ix & 7);
+      }
+    }
+    enqueue(find(stream), event.data());
+  }
+
+  void StreamScheduler::enqueue(Stream& s, const uint8_t* event) {
+    ++inflight;
+    bool wake = false;
+    {
+      std::lock_guard<std::mutex> lock(s.mutex);
+      s.pending.insert(s.pending.end(), event, event + eventStride);
+      if (!s.scheduled) {
+        s.scheduled = true;
+        wake = true;
+      }
+    }
+    if (wake) {
+      schedule(&s);
+    }
+  }
+
+  void StreamScheduler::schedule(Stream* s) {
+    // the task is counted before it may be taken
+    ++queued;
+    if (localScheduler == this) {
+      pool[localWorker]->deque.push(s);
+    } else {
+      pool[s->home]->inbox.push(s);
+    }
+    wake();
+  }
+
+  void StreamScheduler::wake() {
+    // a worker counts itself as a sleeper under the mutex before it checks
+    // `queued`, so either it sees the task or it is already waiting here
+    if (sleepers > 0) {
+      { std::lock_guard<std::mutex> lock(idleMutex); }
+      idle.notify_one();
+    }
+  }
+
+  StreamScheduler::Stream* StreamScheduler::drain(Worker& self, Worker& from) {
+    Stream* s = from.inbox.take();
+    if (s) {
+      // a pushed task may be stolen and linked again, so `next` goes first
+      for (Stream* t = s->next; t; ) {
+        Stream* u = t->next;
+        self.deque.push(t);
+        t = u;
+      }
+    }
+    return s;
+  }
+
+  StreamScheduler::Stream* StreamScheduler::take(size_t self) {
+    Worker& w = *pool[self];
+    Stream* s = w.deque.pop();
+    if (!s) {
+      s = drain(w, w);
+    }
+    for (size_t ix = 1; !s && ix < pool.size(); ++ix) {
+      Worker& v = *pool[(self + ix) % pool.size()];
+      s = v.deque.steal();
+      if (!s) {
+        s = drain(w, v);
+      }
+    }
+    if (s) {
+      --queued;
+    }
+    return s;
+  }
+
+  void StreamScheduler::work(size_t self) {
+    localScheduler = this;
+    localWorker = self;
+    while (true) {
+      Stream* s = take(self);
+      if (s) {
+        run(*pool[self], s);
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(idleMutex);
+      ++sleepers;
+      idle.wait(lock, [this]() { return stopping || queued > 0; });
+      --sleepers;
+      if (stopping && queued == 0) {
+        return;
+      }
+    }
+  }
+
+  void StreamScheduler::run(Worker& worker, Stream* s) {
+    std::vector<uint8_t>& batch = worker.batch;
+    std::vector<Match>& results = worker.results;
+
+    // the mailbox gets the (empty) buffer of the worker
+    batch.clear();
+    {
+      std::lock_guard<std::mutex> lock(s->mutex);
+      batch.swap(s->pending);
+    }
+    size_t count = batch.size() / eventStride;
+    results.resize(count);
+    s->executor->advanceBatch({ batch.data(), eventStride, count, atomicCount }, results.data());
+    if (visitor) {
+      for (size_t ix = 0; ix < count; ++ix) {
+        visitor(s->id, results[ix]);
+      }
+    }
+
+    bool again = false;
+    {
+      std::lock_guard<std::mutex> lock(s->mutex);
+      s->result = s->executor->getResult();
+      if (s->pending.empty()) {
+        s->scheduled = false;
+      } else {
+        again = true;
+      }
+    }
+    if (again) {
+      // other tasks of the worker go first, so a busy stream
+      // does not starve them (and other workers may take it)
+      ++queued;
+      worker.inbox.push(s);
+      wake();
+    }
+
+    if (inflight.fetch_sub(count) == count) {
+      std::lock_guard<std::mutex> lock(doneMutex);
+      done.notify_all();
+    }
+  }
+
+  void StreamScheduler::wait() {
+    std::unique_lock<std::mutex> lock(doneMutex);
+    done.wait(lock, [this]() { return inflight == 0; });
+  }
+
+  Match StreamScheduler::getResult(StreamId stream) const {
+    const Stream* s = lookup(stream);
+    if (!s) {
+      // no events yet
+      return initialResult;
+    }
+    std::lock_guard<std::mutex> lock(s->mutex);
+    return s->result;
+  }
+
+  size_t StreamScheduler::size() const {
+    size_t n = 0;
+    for (auto const& shard : shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      n += shard.streams.size();
+    }
+    return n;
+  }
+
+} // namespace rt
@@ -0,0 +1,250 @@
+#ifndef RTSCHEDULER_HPP
+#define RTSCHEDULER_HPP
+
+#include "rt/RtPredicate.hpp"
+#include "rt/Executor.hpp"
+#include "rt/Loader.hpp"
+#include "Match.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace rt {
+  typedef uint64_t StreamId;
+
+  /**
+   * Evaluation of many independent event streams on a pool of threads
+   *
+   * Every stream has its own executor, created by `factory`, so the
+   * compiled automaton is shared by all streams and threads and is
+   * never modified. Events of a stream are queued in its mailbox (packed,
+   * see `Events`) and a stream with pending events is a task: it is run
+   * by a single worker at a time, so events of a stream are evaluated
+   * (and reported) in order of `post`.
+   *
+   * Each worker keeps a deque of tasks: it runs its own tasks from the
+   * back and, when it is out of work, steals from the front of another
+   * deque, so a few busy streams do not stall the rest. Tasks from other
+   * threads land in the inbox of the home worker of a stream. Workers
+   * only take a mutex to sleep when there are no tasks at all.
+   */
+  class StreamScheduler {
+  public:
+    typedef std::function<ExecutorPtr()> Factory;
+    /** Called by a worker after every event, in order within a stream */
+    typedef std::function<void(StreamId, Match)> Visitor;
+
+    /**
+     * @param[in] factory creates an executor for a new stream, it is called
+     *                    from threads calling `post` and must be thread safe
+     *                    (and once here, for the initial result)
+     * @param[in] atomicCount number of atomics of an event
+     * @param[in] visitor receives results (may be empty)
+     * @param[in] threads number of workers, zero for a worker per core
+     */
+    StreamScheduler(Factory factory, size_t atomicCount,
+                    Visitor visitor = Visitor(), size_t threads = 0);
+    /** Pending events are evaluated before workers stop */
+    ~StreamScheduler();
+
+    StreamScheduler(const StreamScheduler&) = delete;
+    StreamScheduler& operator= (const StreamScheduler&) = delete;
+
+    /** Bytes of a packed event */
+    size_t stride() const { return eventStride; }
+    size_t threads() const { return workers.size(); }
+
+    /** Queue a packed event of `stride()` bytes */
+    void post(StreamId stream, const uint8_t* event);
+    void post(StreamId stream, const Names& vars);
+
+    /** Block until all posted events are evaluated */
+    void wait();
+
+    /** Result of a stream after its evaluated events, initial one for unknown stream */
+    Match getResult(StreamId stream) const;
+    /** Number of known streams */
+    size_t size() const;
+
+  private:
+    struct Stream {
+      StreamId id;
+      ExecutorPtr executor;
+      size_t home; /** worker which gets the stream from other threads */
+      Stream* next = nullptr; /** link in `Inbox` */
+      mutable std::mutex mutex;
+      std::vector<uint8_t> pending; /** mailbox, `stride` bytes per event */
+      bool scheduled = false; /** queued or running */
+      Match result;
+    };
+
+    /**
+     * A deque of tasks, owner works at the back, thieves at the front
+     *
+     * Lock-free (Chase-Lev): only the owner calls `push` and `pop`,
+     * any thread may `steal`. Arrays outgrown by the owner are kept,
+     * since a thief may still read them.
+     */
+    class WorkDeque {
+    public:
+      WorkDeque() : top(0), bottom(0) {
+        arrays.push_back(std::make_unique<Array>(64));
+        array = arrays.back().get();
+      }
+
+      void push(Stream* s) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Array* a = array.load(std::memory_order_relaxed);
+        if (b - t >= int64_t(a->size)) {
+          a = grow(a, t, b);
+        }
+        a->put(b, s);
+        bottom.store(b + 1, std::memory_order_release);
+      }
+
+      Stream* pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Array* a = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+          bottom.store(b + 1, std::memory_order_relaxed);
+          return nullptr;
+        }
+        Stream* s = a->get(b);
+        if (t == b) {
+          // the last task, a thief may race for it
+          if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                           std::memory_order_relaxed)) {
+            s = nullptr;
+          }
+          bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return s;
+      }
+
+      /** nullptr if empty or lost a race for the front */
+      Stream* steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+          return nullptr;
+        }
+        Stream* s = array.load(std::memory_order_acquire)->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) {
+          return nullptr;
+        }
+        return s;
+      }
+
+    private:
+      struct Array {
+        size_t size; /** a power of 2 */
+        std::unique_ptr<std::atomic<Stream*>[]> slots;
+
+        Array(size_t size_) : size(size_), slots(new std::atomic<Stream*>[size_]) {}
+
+        Stream* get(int64_t ix) const {
+          return slots[ix & (size - 1)].load(std::memory_order_relaxed);
+        }
+        void put(int64_t ix, Stream* s) {
+          slots[ix & (size - 1)].store(s, std::memory_order_relaxed);
+        }
+      };
+
+      Array* grow(Array* a, int64_t t, int64_t b) {
+        arrays.push_back(std::make_unique<Array>(a->size * 2));
+        Array* u = arrays.back().get();
+        for (int64_t ix = t; ix < b; ++ix) {
+          u->put(ix, a->get(ix));
+        }
+        array.store(u, std::memory_order_release);
+        return u;
+      }
+
+      std::atomic<int64_t> top;
+      std::atomic<int64_t> bottom;
+      std::atomic<Array*> array;
+      std::vector<std::unique_ptr<Array>> arrays; /** owned by the owner */
+    };
+
+    /** Tasks for a worker from other threads, a lock-free stack */
+    class Inbox {
+    public:
+      Inbox() : head(nullptr) {}
+
+      void push(Stream* s) {
+        s->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(s->next, s, std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+        }
+      }
+
+      /** Take all the tasks, linked by `Stream::next` */
+      Stream* take() { return head.exchange(nullptr, std::memory_order_acquire); }
+
+    private:
+      std::atomic<Stream*> head;
+    };
+
+    /** Streams are sharded, so posting threads rarely contend */
+    struct Shard {
+      mutable std::mutex mutex;
+      std::unordered_map<StreamId, std::unique_ptr<Stream>> streams;
+    };
+
+    struct Worker {
+      WorkDeque deque;
+      Inbox inbox;
+      std::vector<uint8_t> batch; /** buffers for `run` */
+      std::vector<Match> results;
+    };
+
+    static constexpr size_t shardCount = 64;
+
+    Stream& find(StreamId stream);
+    const Stream* lookup(StreamId stream) const;
+    void enqueue(Stream& s, const uint8_t* event);
+    void schedule(Stream* s);
+    void wake();
+    /** Move the inbox of `from` to the deque of `self`, @returns a task of it */
+    Stream* drain(Worker& self, Worker& from);
+    Stream* take(size_t self);
+    void run(Worker& worker, Stream* s);
+    void work(size_t self);
+
+    Factory factory;
+    size_t atomicCount;
+    size_t eventStride;
+    Visitor visitor;
+    Match initialResult; /** of a stream without events */
+
+    Shard shards[shardCount];
+    std::vector<std::unique_ptr<Worker>> pool;
+    std::vector<std::thread> workers;
+
+    std::atomic<size_t> queued; /** tasks in deques and inboxes */
+    std::atomic<size_t> sleepers; /** workers waiting for `idle` */
+    std::mutex idleMutex;
+    std::condition_variable idle;
+    bool stopping; /** guarded by `idleMutex` */
+
+    std::mutex doneMutex;
+    std::condition_variable done;
+    std::atomic<size_t> inflight; /** posted, but not evaluated events */
+  };
+
+} // namespace rt
+
+#endif //RTSCHEDULER_HPP
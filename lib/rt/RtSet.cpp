@@ -0,0 +1,130 @@
+#include "rt/RtSet.hpp"
+#include "rt/RtProgram.hpp"
+
+namespace rt {
+
+  PredicateIndex SereSet::intern(const PredicatePool& local,
+                                 PredicateIndex pred,
+                                 const AtomicMap& atomics) {
+    Program prog = local[pred].copy();
+    remap(atomics, prog);
+    return predicates.intern(prog);
+  }
+
+  SereSet::RuleId SereSet::add(const Nfasl& nfasl, const AtomicMap& atomics) {
+    assert(atomics.size() >= nfasl.atomicCount);
+    // edges have no counters, see `Counter`
+    assert(nfasl.counters.empty());
+    Rule rule;
+    rule.deterministic = false;
+    rule.initials = nfasl.initials;
+    rule.finals = nfasl.finals;
+    for (State q = 0; q < nfasl.stateCount; ++q) {
+      rule.edgeIndex.push_back(rule.edges.size());
+      for (auto const& tr : nfasl.transitions[q]) {
+        rule.edges.push_back({ intern(nfasl.predicates, tr.pred, atomics), tr.state });
+      }
+    }
+    rule.edgeIndex.push_back(rule.edges.size());
+    return add(std::move(rule));
+  }
+
+  SereSet::RuleId SereSet::add(const Dfasl& dfasl, const AtomicMap& atomics) {
+    assert(atomics.size() >= dfasl.atomicCount);
+    Rule rule;
+    rule.deterministic = true;
+    rule.initials.resize(dfasl.stateCount);
+    rule.finals.resize(dfasl.stateCount);
+    rule.initials.set(dfasl.initial);
+    for (auto q : dfasl.finals) {
+      rule.finals.set(q);
+    }
+    for (Dfasl::State q = 0; q < dfasl.stateCount; ++q) {
+      rule.edgeIndex.push_back(rule.edges.size());
+      for (auto const& tr : dfasl.transitions[q]) {
+        rule.edges.push_back({ intern(dfasl.predicates, tr.pred, atomics), tr.state });
+      }
+    }
+    rule.edgeIndex.push_back(rule.edges.size());
+    return add(std::move(rule));
+  }
+
+  SereSet::RuleId SereSet::add(Rule&& rule) {
+    RuleId id = rules.size();
+    rules.push_back(std::move(rule));
+    reset(rules.back());
+    if (rules.back().result != Match_Failed) {
+      active.push_back(id);
+    }
+    // pool might have grown
+    cache.attach(predicates);
+    return id;
+  }
+
+  void SereSet::reset(Rule& rule) {
+    rule.currentStates = rule.initials;
+    if (rule.finals.none()) {
+      rule.result = Match_Failed;
+    } else if (rule.currentStates.intersects(rule.finals)) {
+      rule.result = Match_Ok;
+    } else {
+      rule.result = Match_Partial;
+    }
+  }
+
+  void SereSet::reset() {
+    active.clear();
+    changed.clear();
+    for (RuleId id = 0; id < rules.size(); ++id) {
+      reset(rules[id]);
+      if (rules[id].result != Match_Failed) {
+        active.push_back(id);
+      }
+    }
+  }
+
+  void SereSet::advance(Rule& rule) {
+    nextStates.resize(rule.currentStates.size());
+    nextStates.reset();
+    for (size_t q = rule.currentStates.find_first();
+         q != States::npos;
+         q = rule.currentStates.find_next(q)) {
+      for (uint32_t ix = rule.edgeIndex[q]; ix < rule.edgeIndex[q + 1]; ++ix) {
+        auto const& e = rule.edges[ix];
+        if (!nextStates.test(e.state) && cache.eval(e.pred)) {
+          nextStates.set(e.state);
+          if (rule.deterministic) {
+            break;
+          }
+        }
+      }
+    }
+    std::swap(rule.currentStates, nextStates);
+    if (rule.currentStates.none()) {
+      rule.result = Match_Failed;
+    } else if (rule.currentStates.intersects(rule.finals)) {
+      rule.result = Match_Ok;
+    } else {
+      rule.result = Match_Partial;
+    }
+  }
+
+  void SereSet::advance(const Names& vars) {
+    changed.clear();
+    cache.next(vars);
+    size_t alive = 0;
+    for (RuleId id : active) {
+      Rule& rule = rules[id];
+      Match before = rule.result;
+      advance(rule);
+      if (rule.result != before) {
+        changed.push_back(id);
+      }
+      if (rule.result != Match_Failed) {
+        active[alive++] = id;
+      }
+    }
+    active.resize(alive);
+  }
+
+} //namespace rt
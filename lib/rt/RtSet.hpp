@@ -0,0 +1,78 @@
+#ifndef RTSET_HPP
+#define RTSET_HPP
+
+#include "rt/RtPredicate.hpp"
+#include "rt/RtPredicatePool.hpp"
+#include "rt/RtDfasl.hpp"
+#include "rt/RtNfasl.hpp"
+#include "Match.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <boost/dynamic_bitset.hpp>
+
+namespace rt {
+
+  /**
+   * Many automata evaluated over one event stream
+   *
+   * Atomics of every rule are mapped into one namespace and
+   * predicates of all rules are interned into a single pool,
+   * so a predicate shared by many rules is evaluated once per event.
+   * Failed rules are not stepped anymore (failure is final).
+   */
+  class SereSet {
+  public:
+    typedef size_t RuleId;
+    /** Local atomic `i` of a rule is atomic `atomics[i]` of the set */
+    typedef std::vector<Offset> AtomicMap;
+
+    /** NFASL has no counting states (see `Counter`) */
+    RuleId add(const Nfasl& nfasl, const AtomicMap& atomics);
+    RuleId add(const Dfasl& dfasl, const AtomicMap& atomics);
+
+    size_t size() const { return rules.size(); }
+    Match getResult(RuleId rule) const { return rules[rule].result; }
+
+    void reset();
+    void advance(const Names& vars);
+
+    /** Rules whose result was changed by the last `advance` */
+    const std::vector<RuleId>& getChanged() const { return changed; }
+
+  private:
+    struct Edge {
+      PredicateIndex pred;
+      uint32_t state;
+    };
+
+    struct Rule {
+      bool deterministic; /** at most one rule of a state is satisfied */
+      States initials;
+      States finals;
+      std::vector<uint32_t> edgeIndex; /** edges of `q` are [edgeIndex[q], edgeIndex[q+1]) */
+      std::vector<Edge> edges;
+
+      States currentStates;
+      Match result;
+    };
+
+    RuleId add(Rule&& rule);
+    void reset(Rule& rule);
+    void advance(Rule& rule);
+
+    PredicateIndex intern(const PredicatePool& local,
+                          PredicateIndex pred,
+                          const AtomicMap& atomics);
+
+    PredicatePool predicates;
+    PredicateCache cache;
+    std::vector<Rule> rules;
+    std::vector<RuleId> active; /** rules that have not failed */
+    std::vector<RuleId> changed;
+    States nextStates;
+  };
+
+} // namespace rt
+
+#endif // RTSET_HPP
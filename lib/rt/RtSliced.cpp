@@ -0,0 +1,106 @@
+#include "rt/RtSliced.hpp"
+
+#include <cstring>
+
+namespace rt {
+
+  size_t transpose(const Events& events, size_t begin, std::vector<Lanes>& columns) {
+    columns.assign(events.atomicCount, 0);
+    size_t n = std::min(laneCount, events.count - begin);
+    for (size_t k = 0; k < n; ++k) {
+      const uint8_t* row = events.row(begin + k);
+      for (size_t ix = 0; ix < events.atomicCount; ix += 8) {
+        uint32_t byte = row[ix >> 3];
+        for (size_t b = 0; byte != 0 && ix + b < events.atomicCount; ++b, byte >>= 1) {
+          columns[ix + b] |= Lanes(byte & 1) << k;
+        }
+      }
+    }
+    return n;
+  }
+
+  Lanes SlicedEvaluator::run(const Program::Word* c, const Program::Word* entries,
+                             size_t entryCount, const Lanes* columns) {
+    Lanes local[Program::MaxSlots];
+    uint8_t localKnown[Program::MaxSlots];
+    Frame localStack[Program::MaxSlots];
+    Lanes* slots = local;
+    uint8_t* known = localKnown;
+    Frame* stack = localStack;
+    if (entryCount > Program::MaxSlots) {
+      allocated.resize(entryCount);
+      allocatedKnown.resize(entryCount);
+      allocatedStack.resize(entryCount);
+      slots = allocated.data();
+      known = allocatedKnown.data();
+      stack = allocatedStack.data();
+    }
+    memset(known, 0, entryCount);
+
+    size_t sp = 0;
+    Program::Word pc = 0;
+    Lanes acc = 0;
+    pending.clear();
+
+    while (true) {
+      // operands waiting for this point, innermost first
+      while (!pending.empty() && pending.back().target == pc) {
+        const Pending& p = pending.back();
+        acc = p.conj ? (p.lhs & acc) : (p.lhs | acc);
+        pending.pop_back();
+      }
+
+      Program::Word w = c[pc++];
+      Program::Word arg = w >> Program::OpBits;
+      switch (static_cast<Program::Op>(w & ((1 << Program::OpBits) - 1))) {
+      case Program::Const:
+        acc = arg ? ~Lanes(0) : 0;
+        break;
+      case Program::Load:
+        acc = columns[arg];
+        break;
+      case Program::LoadNot:
+        acc = ~columns[arg];
+        break;
+      case Program::Not:
+        acc = ~acc;
+        break;
+      case Program::JumpIfFalse:
+        if (acc == 0) {
+          pc = arg;
+        } else {
+          pending.push_back({ arg, true, acc });
+        }
+        break;
+      case Program::JumpIfTrue:
+        if (acc == ~Lanes(0)) {
+          pc = arg;
+        } else {
+          pending.push_back({ arg, false, acc });
+        }
+        break;
+      case Program::Call:
+        if (known[arg]) {
+          acc = slots[arg];
+        } else {
+          stack[sp++] = { pc, arg };
+          pc = entries[arg];
+        }
+        break;
+      case Program::Return:
+        if (sp == 0) {
+          return acc;
+        }
+        --sp;
+        slots[stack[sp].slot] = acc;
+        known[stack[sp].slot] = 1;
+        pc = stack[sp].pc;
+        break;
+      default:
+        assert(false);
+        return 0;
+      }
+    }
+  }
+
+} // namespace rt
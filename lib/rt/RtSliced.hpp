@@ -0,0 +1,220 @@
+#ifndef RTSLICED_HPP
+#define RTSLICED_HPP
+
+#include "rt/RtPredicate.hpp"
+#include "rt/RtPredicatePool.hpp"
+#include "rt/RtProgram.hpp"
+#include "rt/Executor.hpp"
+#include "Match.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace rt {
+  /** A bit per event of a block of consecutive events */
+  typedef uint64_t Lanes;
+
+  constexpr size_t laneCount = 64;
+
+  /**
+   * Columnar (bit-sliced) form of a block of events
+   *
+   * `columns[i]` gets atomic `i` of events [begin, begin + laneCount):
+   * bit `k` is the atomic of event `begin + k`, events past the end
+   * of `events` are zero.
+   *
+   * @returns number of events in the block
+   */
+  extern size_t transpose(const Events& events, size_t begin, std::vector<Lanes>& columns);
+
+  /**
+   * Evaluation of `Program` over a block of events at once
+   *
+   * Instructions work on lane masks instead of booleans. A conditional
+   * jump skips the right operand only if it is known for all lanes,
+   * otherwise the left operand waits at the jump target, where it is
+   * combined with the right one (jumps are forward and nested).
+   */
+  class SlicedEvaluator {
+  public:
+    Lanes eval(const Program& program, const Lanes* columns) {
+      return run(program.code.data(), program.entries.data(), program.entries.size(), columns);
+    }
+
+    Lanes eval(const ProgramView& program, const Lanes* columns) {
+      return run(program.code, program.entries, program.entryCount, columns);
+    }
+
+    /**
+     * @param[in] c instructions
+     * @param[in] entries subroutine entry points
+     * @param[in] entryCount number of subroutines
+     * @param[in] columns atomic values, see `transpose`
+     */
+    Lanes run(const Program::Word* c, const Program::Word* entries, size_t entryCount,
+              const Lanes* columns);
+
+  private:
+    struct Pending {
+      Program::Word target;
+      bool conj;
+      Lanes lhs;
+    };
+
+    struct Frame {
+      Program::Word pc;
+      Program::Word slot;
+    };
+
+    std::vector<Pending> pending;
+    /** slots past `Program::MaxSlots` */
+    std::vector<Lanes> allocated;
+    std::vector<uint8_t> allocatedKnown;
+    std::vector<Frame> allocatedStack;
+  };
+
+  /**
+   * `BasicPredicateCache` which also evaluates blocks of events
+   *
+   * After `next(vars)` predicates are evaluated for a single event.
+   * After `next(events, begin)` a predicate is evaluated (on demand)
+   * for the whole block at once and `select` picks an event of it.
+   */
+  template <typename Pool, typename Vars = Names>
+  class BasicSlicedPredicateCache {
+  public:
+    void attach(const Pool& pool_) {
+      pool = &pool_;
+      single.attach(pool_);
+      stamps.assign(pool->size(), 0);
+      masks.assign(pool->size(), 0);
+      epoch = 0;
+      sliced = false;
+    }
+
+    void next(const Vars& vars) {
+      sliced = false;
+      single.next(vars);
+    }
+
+    /** forget results of the previous block, @returns its size */
+    size_t next(const Events& events, size_t begin) {
+      sliced = true;
+      lane = 0;
+      if (++epoch == 0) {
+        std::fill(stamps.begin(), stamps.end(), 0);
+        epoch = 1;
+      }
+      return transpose(events, begin, columns);
+    }
+
+    void select(size_t lane_) { lane = lane_; }
+
+    /** Values of a predicate for the whole block */
+    Lanes mask(PredicateIndex ix) {
+      if (stamps[ix] != epoch) {
+        stamps[ix] = epoch;
+        masks[ix] = evaluator.eval((*pool)[ix], columns.data());
+      }
+      return masks[ix];
+    }
+
+    bool eval(PredicateIndex ix) {
+      if (!sliced) {
+        return single.eval(ix);
+      }
+      return (mask(ix) >> lane) & 1;
+    }
+
+  private:
+    const Pool* pool = nullptr;
+    BasicPredicateCache<Pool, Vars> single;
+    SlicedEvaluator evaluator;
+    std::vector<Lanes> columns;
+    std::vector<uint32_t> stamps;
+    std::vector<Lanes> masks;
+    uint32_t epoch = 0;
+    size_t lane = 0;
+    bool sliced = false;
+  };
+
+  typedef BasicSlicedPredicateCache<PredicatePool> SlicedPredicateCache;
+
+  /**
+   * Batch loop for a concrete executor `Ctx` over a sliced cache
+   *
+   * `Ctx::advanceCached` advances over the event selected in `cache`,
+   * so predicates are evaluated once per block instead of once per event.
+   * Failure is final and so is `Ctx::idle` (see `StateFlags`),
+   * so the rest of the batch is not evaluated.
+   */
+  template <typename Ctx, typename Cache>
+  void advanceSliced(Ctx& ctx, Cache& cache, const Events& events, Match* results) {
+    if (ctx.Ctx::idle()) {
+      if (results) {
+        std::fill(results, results + events.count, ctx.Ctx::getResult());
+      }
+      return;
+    }
+    for (size_t begin = 0; begin < events.count; begin += laneCount) {
+      size_t n = cache.next(events, begin);
+      for (size_t lane = 0; lane < n; ++lane) {
+        cache.select(lane);
+        ctx.Ctx::advanceCached();
+        Match r = ctx.Ctx::getResult();
+        size_t ix = begin + lane;
+        if (results) {
+          results[ix] = r;
+        }
+        if (r == Match_Failed || ctx.Ctx::idle()) {
+          if (results) {
+            std::fill(results + ix + 1, results + events.count, r);
+          }
+          return;
+        }
+      }
+    }
+  }
+
+  /**
+   * Batch loop for a concrete extended executor `Ctx` over a sliced cache
+   *
+   * While `Ctx::quiescent`, only the initial configuration is live and
+   * an event changes nothing unless it is in `Ctx::wakeLanes` (initial
+   * states move on it), so the executor is fast-forwarded to such event.
+   */
+  template <typename Ctx, typename Cache>
+  void advanceSliced(Ctx& ctx, Cache& cache, const Events& events, ExtendedMatch* results) {
+    for (size_t begin = 0; begin < events.count; begin += laneCount) {
+      size_t n = cache.next(events, begin);
+      Lanes wake = 0;
+      bool woken = false; /** `wake` is known for the block */
+      for (size_t lane = 0; lane < n; ++lane) {
+        if (ctx.Ctx::quiescent()) {
+          if (!woken) {
+            wake = ctx.Ctx::wakeLanes();
+            woken = true;
+          }
+          Lanes rest = wake >> lane;
+          size_t skip = rest ? std::min<size_t>(__builtin_ctzll(rest), n - lane) : n - lane;
+          if (results) {
+            std::fill(results + begin + lane, results + begin + lane + skip, ctx.Ctx::getResult());
+          }
+          lane += skip;
+          if (lane == n) {
+            break;
+          }
+        }
+        cache.select(lane);
+        ctx.Ctx::advanceCached();
+        if (results) {
+          results[begin + lane] = ctx.Ctx::getResult();
+        }
+      }
+    }
+  }
+
+} // namespace rt
+
+#endif // RTSLICED_HPP
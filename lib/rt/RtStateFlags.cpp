@@ -0,0 +1,123 @@
+#include "rt/RtStateFlags.hpp"
+#include "rt/RtNfasl.hpp"
+#include "rt/RtDfasl.hpp"
+#include "rt/RtDfaslTable.hpp"
+
+namespace rt {
+
+  boost::dynamic_bitset<> liveStates(const std::vector<std::pair<uint32_t, uint32_t>>& edges,
+                                     const boost::dynamic_bitset<>& finals) {
+    size_t n = finals.size();
+    // predecessors, grouped by target
+    std::vector<uint32_t> first(n + 1, 0);
+    for (auto& e : edges) {
+      ++first[e.second + 1];
+    }
+    for (size_t q = 0; q < n; ++q) {
+      first[q + 1] += first[q];
+    }
+    std::vector<uint32_t> preds(edges.size());
+    std::vector<uint32_t> at(first.begin(), first.end() - 1);
+    for (auto& e : edges) {
+      preds[at[e.second]++] = e.first;
+    }
+
+    std::vector<uint32_t> queue;
+    boost::dynamic_bitset<> live = finals;
+    for (size_t q = finals.find_first(); q != finals.npos; q = finals.find_next(q)) {
+      queue.push_back(q);
+    }
+    while (!queue.empty()) {
+      uint32_t q = queue.back();
+      queue.pop_back();
+      for (uint32_t ix = first[q]; ix < first[q + 1]; ++ix) {
+        if (!live[preds[ix]]) {
+          live[preds[ix]] = true;
+          queue.push_back(preds[ix]);
+        }
+      }
+    }
+    return live;
+  }
+
+  /** Mark states which do not reach `finals` as dead */
+  static void markDead(StateFlags& flags,
+                       const std::vector<std::pair<uint32_t, uint32_t>>& edges,
+                       const boost::dynamic_bitset<>& finals) {
+    boost::dynamic_bitset<> live = liveStates(edges, finals);
+    for (size_t q = 0; q < flags.size(); ++q) {
+      if (!live[q]) {
+        flags[q] |= State_Dead;
+      }
+    }
+  }
+
+  StateFlags stateFlags(const Nfasl& nfasl) {
+    StateFlags flags(nfasl.stateCount, 0);
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    for (State q = 0; q < nfasl.stateCount; ++q) {
+      bool loops = true;
+      bool any = false;
+      for (auto& tr : nfasl.transitions[q]) {
+        edges.push_back({ q, tr.state });
+        loops = loops && tr.state == q;
+        any = any || isTrue(nfasl.predicates[tr.pred]);
+      }
+      // a counting state changes its counter, even on a self-loop
+      if (loops && any && !counting(nfasl.counters, q)) {
+        flags[q] |= State_Absorbing;
+      }
+    }
+    markDead(flags, edges, nfasl.finals);
+    return flags;
+  }
+
+  StateFlags stateFlags(const Dfasl& dfasl) {
+    StateFlags flags(dfasl.stateCount, 0);
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    for (Dfasl::State q = 0; q < dfasl.stateCount; ++q) {
+      bool loops = true;
+      for (auto& tr : dfasl.transitions[q]) {
+        edges.push_back({ q, tr.state });
+        loops = loops && tr.state == q;
+        // rules past the first `true` one never match
+        if (isTrue(dfasl.predicates[tr.pred])) {
+          if (loops) {
+            flags[q] |= State_Absorbing;
+          }
+          break;
+        }
+      }
+    }
+    boost::dynamic_bitset<> finals(dfasl.stateCount);
+    for (auto q : dfasl.finals) {
+      finals.set(q);
+    }
+    markDead(flags, edges, finals);
+    return flags;
+  }
+
+  StateFlags stateFlags(const DfaslTable& dfasl) {
+    StateFlags flags(size_t(dfasl.stateCount) + 1, 0);
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    // a row repeats targets, edges are distinct (`seen` is stamped by row)
+    std::vector<DfaslTable::State> seen(flags.size(), DfaslTable::State(-1));
+    for (DfaslTable::State q = 0; q <= dfasl.stateCount; ++q) {
+      bool loops = true;
+      for (DfaslTable::Class c = 0; c < dfasl.classCount; ++c) {
+        DfaslTable::State t = dfasl.next(q, c);
+        if (seen[t] != q) {
+          seen[t] = q;
+          edges.push_back({ q, t });
+        }
+        loops = loops && t == q;
+      }
+      if (loops) {
+        flags[q] |= State_Absorbing;
+      }
+    }
+    markDead(flags, edges, dfasl.finals);
+    return flags;
+  }
+
+} // namespace rt
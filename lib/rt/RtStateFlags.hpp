@@ -0,0 +1,69 @@
+#ifndef RTSTATEFLAGS_HPP
+#define RTSTATEFLAGS_HPP
+
+#include "rt/RtProgram.hpp"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <boost/dynamic_bitset.hpp>
+
+namespace rt {
+  class Nfasl;
+  class Dfasl;
+  class DfaslTable;
+
+  enum StateFlag : uint8_t {
+    State_Dead = 1,      /** no final state is reachable */
+    State_Absorbing = 2, /** the state is never left, whatever the event */
+  };
+
+  /**
+   * `StateFlag`s of every state of an automaton
+   *
+   * An automaton keeps its flags next to its transitions, they are
+   * derived from them and are empty if they are not known. A set of
+   * absorbing states is a fixed point of a step, so executors skip
+   * steps (and predicates) while all their active states are absorbing.
+   */
+  typedef std::vector<uint8_t> StateFlags;
+
+  /** Absorbing states of `stateCount` states (none if `flags` are not known) */
+  inline boost::dynamic_bitset<> absorbingStates(const StateFlags& flags, size_t stateCount) {
+    boost::dynamic_bitset<> states(stateCount);
+    for (size_t q = 0; q < flags.size() && q < stateCount; ++q) {
+      states[q] = (flags[q] & State_Absorbing) != 0;
+    }
+    return states;
+  }
+
+  /** Predicate is the constant `true` (only syntactically) */
+  inline bool isTrue(const ProgramView& program) {
+    return program.codeSize == 2
+      && program.code[0] == Program::encode(Program::Const, 1)
+      && program.code[1] == Program::encode(Program::Return, 0);
+  }
+
+  inline bool isTrue(const Program& program) {
+    return isTrue({ program.code.data(), program.code.size(),
+                    program.entries.data(), program.entries.size() });
+  }
+
+  /**
+   * States from which a state of `finals` is reachable
+   *
+   * @param[in] edges (source, target) pairs of states below `finals.size()`
+   */
+  extern boost::dynamic_bitset<> liveStates(const std::vector<std::pair<uint32_t, uint32_t>>& edges,
+                                            const boost::dynamic_bitset<>& finals);
+
+  /** Every rule of a state is a self-loop and one of them is `true`, the state does not count */
+  extern StateFlags stateFlags(const Nfasl& nfasl);
+  /** Rules of a state up to the first `true` one are self-loops */
+  extern StateFlags stateFlags(const Dfasl& dfasl);
+  /** A row of the table is the state itself, the sink is included */
+  extern StateFlags stateFlags(const DfaslTable& dfasl);
+
+} // namespace rt
+
+#endif // RTSTATEFLAGS_HPP
@@ -0,0 +1,147 @@
+#ifndef RTTIMERWHEEL_HPP
+#define RTTIMERWHEEL_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace rt {
+
+  /**
+   * Hierarchical timer wheel
+   *
+   * Level `k` has `Slots` buckets of `Slots^k` ticks each,
+   * timers that are too far away wait in an overflow list.
+   * A bucket of level `k` is redistributed to lower levels
+   * when the wheel reaches its first tick, so a timer is moved
+   * at most `Levels` times. Timers can't be cancelled: clients
+   * are expected to ignore stale ones when they expire.
+   */
+  template <typename T>
+  class TimerWheel {
+  public:
+    typedef uint64_t Time;
+
+    static constexpr size_t SlotBits = 8;
+    static constexpr size_t Slots = size_t(1) << SlotBits;
+    static constexpr size_t Levels = 4;
+
+    struct Timer {
+      T value;
+      Time at;
+    };
+
+    Time now() const { return current; }
+    size_t size() const { return count; }
+
+    /** Schedule `value` at `at` (timers in the past expire at the next tick) */
+    void schedule(const T& value, Time at) {
+      place(Timer{ value, at }, current + 1);
+      ++count;
+    }
+
+    /**
+     * Move the wheel to `now`
+     *
+     * @param[in] now new time (not earlier than `now()`)
+     * @param[in] expired called with every timer scheduled not later than `now`
+     */
+    template <typename F>
+    void advance(Time now, F expired) {
+      while (current < now) {
+        if (count == 0) {
+          current = now;
+          break;
+        }
+        size_t empty = 0;
+        while (empty < Levels && counts[empty] == 0) {
+          ++empty;
+        }
+        if (empty > 0) {
+          // nothing to expire or cascade till the end of lower levels
+          Time last = current | low(empty);
+          if (last >= now) {
+            current = now;
+            break;
+          }
+          current = last;
+        }
+        ++current;
+        cascade();
+        std::vector<Timer> due;
+        std::swap(due, levels[0][current & (Slots - 1)]);
+        counts[0] -= due.size();
+        count -= due.size();
+        for (auto const& timer : due) {
+          expired(timer.value, timer.at);
+        }
+      }
+    }
+
+    void clear() {
+      for (auto& level : levels) {
+        for (auto& bucket : level) {
+          bucket.clear();
+        }
+      }
+      overflow.clear();
+      counts.fill(0);
+      count = 0;
+    }
+
+  private:
+    static constexpr Time low(size_t k) { return (Time(1) << (SlotBits*k)) - 1; }
+
+    /** place a timer that expires not earlier than `earliest` */
+    void place(const Timer& timer, Time earliest) {
+      Time at = timer.at > earliest ? timer.at : earliest;
+      for (size_t k = 0; k < Levels; ++k) {
+        size_t shift = SlotBits*(k + 1);
+        if ((at >> shift) == (current >> shift)) {
+          levels[k][(at >> (SlotBits*k)) & (Slots - 1)].push_back(timer);
+          ++counts[k];
+          return;
+        }
+      }
+      overflow.push_back(timer);
+    }
+
+    void redistribute(std::vector<Timer>& bucket) {
+      std::vector<Timer> timers;
+      std::swap(timers, bucket);
+      for (auto const& timer : timers) {
+        place(timer, current);
+      }
+    }
+
+    /** redistribute buckets that start at `current`, higher levels first */
+    void cascade() {
+      if (current & low(1)) {
+        return;
+      }
+      size_t top = 1;
+      while (top + 1 < Levels && (current & low(top + 1)) == 0) {
+        ++top;
+      }
+      if (top + 1 == Levels && (current & low(Levels)) == 0) {
+        redistribute(overflow);
+      }
+      for (size_t k = top; k >= 1; --k) {
+        auto& bucket = levels[k][(current >> (SlotBits*k)) & (Slots - 1)];
+        counts[k] -= bucket.size();
+        redistribute(bucket);
+      }
+    }
+
+    std::array<std::array<std::vector<Timer>, Slots>, Levels> levels;
+    std::array<size_t, Levels> counts{};
+    std::vector<Timer> overflow;
+    size_t count = 0;
+    Time current = 0;
+  };
+
+} // namespace rt
+
+#endif // RTTIMERWHEEL_HPP
@@ -0,0 +1,137 @@
+#ifndef RTSNAPSHOT_HPP
+#define RTSNAPSHOT_HPP
+
+#include "Match.hpp"
+
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <vector>
+#include <memory.h>
+#include <boost/dynamic_bitset.hpp>
+
+namespace rt {
+  class RestoreFailed : std::exception {
+    virtual const char* what() const throw() {
+      return "restoring failed";
+    }
+  };
+
+  enum SnapshotKind : uint16_t {
+    Snapshot_Executor = 0,
+    Snapshot_ExtendedExecutor = 1,
+    Snapshot_Keyed = 2,
+    Snapshot_ReverseExecutor = 3, /** see `NfaslReverseContext` */
+  };
+
+  /**
+   * Snapshot of executor state
+   *
+   * A snapshot is only valid for the same automaton,
+   * `fingerprint` identifies the automaton image.
+   */
+  struct SnapshotHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t kind;
+    uint64_t fingerprint;
+  } __attribute__((packed));
+
+  constexpr uint32_t snapshotMagic = 0x70616e73;
+  constexpr uint16_t snapshotVersion = 1;
+
+  /** 64-bit FNV-1a hash */
+  inline uint64_t fingerprint(const uint8_t* data, size_t len) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t ix = 0; ix < len; ++ix) {
+      h ^= data[ix];
+      h *= 0x100000001b3ull;
+    }
+    return h;
+  }
+
+  class SnapshotWriter {
+  public:
+    SnapshotWriter(std::vector<uint8_t>& data_) : data(data_) {}
+
+    void writeData(const uint8_t* d, size_t len) {
+      data.insert(data.end(), d, d + len);
+    }
+
+    template <typename T>
+    void writeValue(const T& t) {
+      writeData((const uint8_t*)(&t), sizeof(t));
+    }
+
+    void writeMatch(Match m) {
+      writeValue(uint8_t(m));
+    }
+
+    void writeStates(const boost::dynamic_bitset<>& states) {
+      writeValue(uint32_t(states.size()));
+      std::vector<boost::dynamic_bitset<>::block_type> blocks;
+      boost::to_block_range(states, std::back_inserter(blocks));
+      writeData((const uint8_t*)blocks.data(), blocks.size()*sizeof(blocks[0]));
+    }
+
+  private:
+    std::vector<uint8_t>& data;
+  };
+
+  class SnapshotReader {
+  public:
+    SnapshotReader(const uint8_t* data, size_t len)
+      : curr(data), end(data + len) {}
+
+    void ensure(bool cond) {
+      if (!cond) {
+        throw RestoreFailed{};
+      }
+    }
+
+    bool atEnd() const { return curr == end; }
+
+    void readData(uint8_t* d, size_t len) {
+      ensure(len <= size_t(end - curr));
+      memcpy(d, curr, len);
+      curr += len;
+    }
+
+    template <typename T>
+    void readValue(T& t) {
+      readData((uint8_t*)(&t), sizeof(t));
+    }
+
+    Match readMatch() {
+      uint8_t m;
+      readValue(m);
+      ensure(m <= Match_Failed);
+      return Match(m);
+    }
+
+    /** read a set of states, it must have `size` states */
+    void readStates(boost::dynamic_bitset<>& states, size_t size) {
+      uint32_t actual;
+      readValue(actual);
+      ensure(actual == size);
+      typedef boost::dynamic_bitset<>::block_type Block;
+      constexpr size_t blockBits = boost::dynamic_bitset<>::bits_per_block;
+      std::vector<Block> blocks((size + blockBits - 1) / blockBits);
+      readData((uint8_t*)blocks.data(), blocks.size()*sizeof(Block));
+      states.clear();
+      states.append(blocks.begin(), blocks.end());
+      // bits beyond `size` must be clear
+      for (size_t ix = size; ix < states.size(); ++ix) {
+        ensure(!states.test(ix));
+      }
+      states.resize(size);
+    }
+
+  private:
+    const uint8_t* curr;
+    const uint8_t* end;
+  };
+
+} //namespace rt
+
+#endif // RTSNAPSHOT_HPP
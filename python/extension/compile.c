@@ -43,20 +43,33 @@ PyObject *
 sere_compile_expr(PyObject *self, PyObject *args) {
   const char *expr;
   const char *target;
+  const char *format = "json";
   struct sere_options opts
     = {
        SERE_TARGET_DFASL,
        SERE_FORMAT_JSON,
        0,
+       0,
+       0,
        0 };
 
-  if (!PyArg_ParseTuple(args, "ss", &expr, &target))
+  if (!PyArg_ParseTuple(args, "ss|s", &expr, &target, &format))
     return NULL;
 
   if (strcmp(target, "nfasl") == 0) {
     opts.target = SERE_TARGET_NFASL;
   } else if (strcmp(target, "dfasl") == 0) {
     opts.target = SERE_TARGET_DFASL;
+  } else if (strcmp(target, "lazy") == 0) {
+    opts.target = SERE_TARGET_LAZY_DFASL;
+  } else {
+    return NULL;
+  }
+
+  if (strcmp(format, "json") == 0) {
+    opts.format = SERE_FORMAT_JSON;
+  } else if (strcmp(format, "rt") == 0) {
+    opts.format = SERE_FORMAT_RT;
   } else {
     return NULL;
   }
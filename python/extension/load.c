@@ -39,6 +39,44 @@ ContextSere_advance(ContextSere *self, PyObject *Py_UNUSED(ignored)) {
   return PyLong_FromLong(1);
 }
 
+static PyObject *
+ContextSere_advance_batch(ContextSere *self, PyObject *args) {
+  const char* events;
+  Py_ssize_t events_size;
+  Py_ssize_t stride;
+
+  if (!PyArg_ParseTuple(args, "y#n", &events, &events_size, &stride))
+    return NULL;
+
+  if (stride <= 0 || events_size % stride != 0) {
+    PyErr_SetString(PyExc_ValueError, "incorrect event row size");
+    return NULL;
+  }
+
+  size_t count = (size_t)(events_size / stride);
+  enum Match* results = PyMem_New(enum Match, count);
+  if (results == NULL)
+    return PyErr_NoMemory();
+
+  int r = sere_context_advance_batch(self->sere,
+                                     (const uint8_t*)events,
+                                     (size_t)stride,
+                                     count,
+                                     results);
+  if (r != 0) {
+    PyMem_Free(results);
+    PyErr_SetString(PyExc_ValueError, "incorrect event row size");
+    return NULL;
+  }
+
+  PyObject* list = PyList_New((Py_ssize_t)count);
+  for (size_t ix = 0; list != NULL && ix < count; ++ix) {
+    PyList_SET_ITEM(list, (Py_ssize_t)ix, PyLong_FromLong(results[ix]));
+  }
+  PyMem_Free(results);
+  return list;
+}
+
 static PyObject *
 ContextSere_get_result(ContextSere *self, PyObject *Py_UNUSED(ignored)) {
   if (!self)
@@ -128,6 +166,11 @@ static PyMethodDef ContextSere_methods[] = {
      (PyCFunction) ContextSere_advance,
      METH_NOARGS,
      "Feeds SERE context with new event"
+    }, {
+     "advance_batch",
+     (PyCFunction) ContextSere_advance_batch,
+     METH_VARARGS,
+     "Feeds SERE context with packed events, returns results per event"
     }, {
      "get_result",
      (PyCFunction) ContextSere_get_result,
@@ -56,6 +56,75 @@ ExtendedContextSere_advance(ExtendedContextSere *self, PyObject *Py_UNUSED(ignor
   return PyLong_FromLong(1);
 }
 
+static PyObject *
+ExtendedMatch_from(const struct ExtendedMatch* result) {
+  ExtendedMatchObject* match = ALLOC_PY_OBJECT(ExtendedMatchObject);
+
+  if (match == NULL) {
+    return NULL;
+  }
+
+  match->match = result->match;
+  switch (result->match) {
+  case Match_Ok:
+    match->shortest = result->ok.shortest;
+    match->longest = result->ok.longest;
+    match->horizon = result->ok.horizon;
+    break;
+  case Match_Partial:
+    match->horizon = result->partial.horizon;
+    break;
+  case Match_Failed:
+    break;
+  }
+
+  return (PyObject *)match;
+}
+
+static PyObject *
+ExtendedContextSere_advance_batch(ExtendedContextSere *self, PyObject *args) {
+  const char* events;
+  Py_ssize_t events_size;
+  Py_ssize_t stride;
+
+  if (!PyArg_ParseTuple(args, "y#n", &events, &events_size, &stride))
+    return NULL;
+
+  if (stride <= 0 || events_size % stride != 0) {
+    PyErr_SetString(PyExc_ValueError, "incorrect event row size");
+    return NULL;
+  }
+
+  size_t count = (size_t)(events_size / stride);
+  struct ExtendedMatch* results = PyMem_New(struct ExtendedMatch, count);
+  if (results == NULL)
+    return PyErr_NoMemory();
+
+  int r = sere_context_extended_advance_batch(self->sere,
+                                              (const uint8_t*)events,
+                                              (size_t)stride,
+                                              count,
+                                              results);
+  if (r != 0) {
+    PyMem_Free(results);
+    PyErr_SetString(PyExc_ValueError, "incorrect event row size");
+    return NULL;
+  }
+
+  PyObject* list = PyList_New((Py_ssize_t)count);
+  for (size_t ix = 0; list != NULL && ix < count; ++ix) {
+    PyObject* match = ExtendedMatch_from(&results[ix]);
+    if (match == NULL) {
+      Py_DECREF(list);
+      list = NULL;
+      break;
+    }
+    PyList_SET_ITEM(list, (Py_ssize_t)ix, match);
+  }
+  PyMem_Free(results);
+  return list;
+}
+
 static PyObject *
 ExtendedContextSere_to_dot(ExtendedContextSere *self, PyObject *args) {
   const char* file;
@@ -76,28 +145,10 @@ ExtendedContextSere_get_result(ExtendedContextSere *self, PyObject *Py_UNUSED(ig
   if (!self)
     return NULL;
 
-  ExtendedMatchObject* match = ALLOC_PY_OBJECT(ExtendedMatchObject);
-
-  if (match == NULL) {
-    return NULL;
-  }
-
   struct ExtendedMatch result = {0};
   sere_context_extended_get_result(self->sere, &result);
 
-  match->match = result.match;
-  switch (result.match) {
-  case Match_Ok:
-    match->shortest = result.ok.shortest;
-    match->longest = result.ok.longest;
-    match->horizon = result.ok.horizon;
-    break;
-  case Match_Partial:
-    match->horizon = result.partial.horizon;
-    break;
-  }
-
-  return (PyObject *)match;
+  return ExtendedMatch_from(&result);
 }
 
 static PyObject *
@@ -180,6 +231,11 @@ static PyMethodDef ExtendedContextSere_methods[] = {
      (PyCFunction) ExtendedContextSere_advance,
      METH_NOARGS,
      "Feeds SERE context with new event"
+    }, {
+     "advance_batch",
+     (PyCFunction) ExtendedContextSere_advance_batch,
+     METH_VARARGS,
+     "Feeds SERE context with packed events, returns results per event"
     }, {
      "get_result",
      (PyCFunction) ExtendedContextSere_get_result,
@@ -9,8 +9,8 @@ __version__   = '0.1'
 
 logging.basicConfig(stream=sys.stdout, level=logging.INFO)
 
-def compile(expr, target = 'dfasl'):
-    return serec.compile(expr, target)
+def compile(expr, target = 'dfasl', format = 'json'):
+    return serec.compile(expr, target, format)
 
 def load(content):
     return Sere(serec.load(content))
@@ -24,12 +24,22 @@ class Sere:
         self.remap = dict(
             [(str(ctx.atomic_name(i), 'utf-8'),i)
              for i in range(0,ctx.atomic_count())])
+        self.stride = max(1, (ctx.atomic_count() + 7) // 8)
 
     def _pack_event(self, event):
         for k,v in event.items():
             if v:
                 self.ctx.set_atomic(self.remap.get(k))
 
+    def _pack_events(self, events):
+        data = bytearray(self.stride * len(events))
+        for row, event in enumerate(events):
+            for k,v in event.items():
+                if v:
+                    i = self.remap.get(k)
+                    data[row * self.stride + i // 8] |= 1 << (i % 8)
+        return bytes(data)
+
     def reset(self):
         self.ctx.reset()
 
@@ -43,6 +53,9 @@ class Sere:
         self._pack_event(event)
         self.ctx.advance()
 
+    def feed_batch(self, events):
+        return self.ctx.advance_batch(self._pack_events(events), self.stride)
+
     def match(self, events):
         self.reset()
         for e in events:
@@ -70,7 +70,7 @@ def purchase():
 
 expression = purchase()
 
-# Compile the expression into NFASL (for a while, it is the only supported target for extended processing).
+# Compile the expression into NFASL (DFASL is supported by extended processing as well).
 compiled = sere.compile(expression, "nfasl")
 
 # `compiled.content()` is just a plain JSON file with NFASL inside - you can serialize it or use immediately.
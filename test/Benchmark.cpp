@@ -1,10 +1,13 @@
 #include "ast/Parser.hpp"
 #include "nfasl/Nfasl.hpp"
 #include "nfasl/BisimNfasl.hpp"
+#include "rt/RtNfaslBits.hpp"
 
 #include <benchmark/benchmark.h>
 
+#include <random>
 #include <string>
+#include <vector>
 
 static void generate(size_t word_count, std::string& nm) {
   constexpr size_t word_size = 5;
@@ -62,4 +65,85 @@ static void BM_NfaslMinimization(benchmark::State& state) {
 BENCHMARK(BM_NfaslMinimization)->Arg(10)->Arg(20)->Arg(40)->Arg(80)->Arg(160);
 //BENCHMARK(BM_NfaslMinimization)->Arg(100);
 
+// search for a chain of steps over 16 atomics, small enough for one state word
+static std::shared_ptr<rt::NfaslBits<1>> nfaslBitsChain() {
+  constexpr uint32_t atoms = 16;
+  auto step = [](uint32_t i) {
+                auto v = [](uint32_t k) { return boolean::Expr::var(k % atoms); };
+                return nfasl::phi((v(i) && !v(i + 1)) || v(i + 2));
+              };
+  nfasl::Nfasl a = step(0);
+  for (uint32_t i = 1; i < 8; ++i) {
+    a = nfasl::concat(a, step(i));
+  }
+  rt::Nfasl r;
+  nfasl::toRt(nfasl::search(a), r);
+  r.atomicCount = atoms;
+  return rt::NfaslBits<1>::make(r);
+}
+
+static void packedEvents(size_t count, std::vector<uint8_t>& data, rt::Events& events) {
+  std::mt19937 gen(42);
+  data.resize(count*2);
+  for (auto& byte : data) {
+    byte = gen();
+  }
+  events = { data.data(), 2, count, 16 };
+}
+
+// single events given as `Names`, converted by the executor if `Vars` differs
+template <typename Vars>
+static void BM_NfaslBitsAdvance(benchmark::State& state) {
+  rt::NfaslBitsContext<1, Vars> ctx(nfaslBitsChain());
+  std::vector<uint8_t> data;
+  rt::Events events;
+  packedEvents(1024, data, events);
+  std::vector<rt::Names> word(events.count);
+  for (size_t ix = 0; ix < events.count; ++ix) {
+    events.unpack(events.row(ix), word[ix]);
+  }
+  for (auto _ : state) {
+    for (auto const& vars : word) {
+      ctx.advance(vars);
+    }
+    benchmark::DoNotOptimize(ctx.getResult());
+  }
+  state.SetItemsProcessed(state.iterations()*events.count);
+}
+
+BENCHMARK_TEMPLATE(BM_NfaslBitsAdvance, rt::Names);
+BENCHMARK_TEMPLATE(BM_NfaslBitsAdvance, rt::AtomBits<1>);
+
+// single packed events, loaded into fixed width events without `Names`
+static void BM_NfaslBitsRows(benchmark::State& state) {
+  rt::NfaslBitsContext<1, rt::AtomBits<1>> ctx(nfaslBitsChain());
+  std::vector<uint8_t> data;
+  rt::Events events;
+  packedEvents(state.range(0), data, events);
+  rt::AtomBits<1> vars;
+  for (auto _ : state) {
+    for (size_t ix = 0; ix < events.count; ++ix) {
+      ctx.advanceEvent(rt::toVars(events, events.row(ix), vars));
+    }
+    benchmark::DoNotOptimize(ctx.getResult());
+  }
+  state.SetItemsProcessed(state.iterations()*events.count);
+}
+
+// batches of packed events, evaluated bit-sliced
+static void BM_NfaslBitsBatch(benchmark::State& state) {
+  rt::NfaslBitsContext<1, rt::AtomBits<1>> ctx(nfaslBitsChain());
+  std::vector<uint8_t> data;
+  rt::Events events;
+  packedEvents(state.range(0), data, events);
+  for (auto _ : state) {
+    ctx.advanceBatch(events, nullptr);
+    benchmark::DoNotOptimize(ctx.getResult());
+  }
+  state.SetItemsProcessed(state.iterations()*events.count);
+}
+
+BENCHMARK(BM_NfaslBitsRows)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Arg(64)->Arg(1024);
+BENCHMARK(BM_NfaslBitsBatch)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Arg(64)->Arg(1024);
+
 BENCHMARK_MAIN();
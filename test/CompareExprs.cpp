@@ -66,6 +66,9 @@ public:
   void visit(Complement& v) override {
     v.getArg()->accept(*this);
   }
+  void visit(Repeat& v) override {
+    v.getArg()->accept(*this);
+  }
 };
 
 void prepareExpr(Ptr<SereExpr> expr, rt::Nfasl& rtNfasl) {
@@ -1,5 +1,6 @@
 #include "test/Letter.hpp"
 #include "rt/RtDfasl.hpp"
+#include "rt/RtDfaslTable.hpp"
 #include "rt/RtNfasl.hpp"
 #include "Match.hpp"
 
@@ -19,6 +20,14 @@ Match evalRtDfasl(const rt::Dfasl& dfasl, const Word& word) {
   return context.getResult();
 }
 
+Match evalRtDfaslTable(const rt::DfaslTable& dfasl, const Word& word) {
+  rt::DfaslTableContext context{std::make_shared<rt::DfaslTable>(dfasl)};
+  for (auto& letter : word) {
+    context.advance(letter);
+  }
+  return context.getResult();
+}
+
 ExtendedMatch evalExtendedRtNfasl(const rt::Nfasl& nfasl, const Word& word) {
   rt::NfaslExtendedContext context{std::make_shared<rt::Nfasl>(nfasl)};
   for (auto& letter : word) {
@@ -27,6 +36,22 @@ ExtendedMatch evalExtendedRtNfasl(const rt::Nfasl& nfasl, const Word& word) {
   return context.getResult();
 }
 
+ExtendedMatch evalExtendedRtDfasl(const rt::Dfasl& dfasl, const Word& word) {
+  rt::DfaslExtendedContext context{std::make_shared<rt::Dfasl>(dfasl)};
+  for (auto& letter : word) {
+    context.advance(letter);
+  }
+  return context.getResult();
+}
+
+ExtendedMatch evalExtendedRtDfaslTable(const rt::DfaslTable& dfasl, const Word& word) {
+  rt::DfaslTableExtendedContext context{std::make_shared<rt::DfaslTable>(dfasl)};
+  for (auto& letter : word) {
+    context.advance(letter);
+  }
+  return context.getResult();
+}
+
 Match evalRt(rt::ExecutorPtr executor, const Word& word) {
   for (auto& letter : word) {
     executor->advance(letter);
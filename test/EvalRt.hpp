@@ -3,12 +3,16 @@
 
 #include "test/Letter.hpp"
 #include "rt/RtDfasl.hpp"
+#include "rt/RtDfaslTable.hpp"
 #include "rt/RtNfasl.hpp"
 #include "Match.hpp"
 
 extern Match evalRtDfasl(const rt::Dfasl& dfasl, const Word& word);
+extern Match evalRtDfaslTable(const rt::DfaslTable& dfasl, const Word& word);
 extern Match evalRtNfasl(const rt::Nfasl& nfasl, const Word& word);
 extern ExtendedMatch evalExtendedRtNfasl(const rt::Nfasl& nfasl, const Word& word);
+extern ExtendedMatch evalExtendedRtDfasl(const rt::Dfasl& dfasl, const Word& word);
+extern ExtendedMatch evalExtendedRtDfaslTable(const rt::DfaslTable& dfasl, const Word& word);
 extern Match evalRt(rt::ExecutorPtr executor, const Word& word);
 
 #endif // EVALRT_HPP
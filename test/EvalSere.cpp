@@ -162,6 +162,28 @@ public:
     result = eval(*RE_CONCAT(v.getArg(), RE_STAR(v.getArg())), word);
   }
 
+  /**
+   * `a{m,n}` is `a;a{m-1,n-1}`, or is empty if `m` is 0
+   */
+  void visit(Repeat& v) override {
+    size_t min = v.getMin();
+    size_t max = v.getMax();
+    if (max == Repeat::Unbounded && min == 0) {
+      result = eval(*RE_STAR(v.getArg()), word);
+      return;
+    }
+    if (max == 0) {
+      result = eval(*RE_EMPTY, word);
+      return;
+    }
+    size_t rest = max == Repeat::Unbounded ? max : max - 1;
+    Ptr<SereExpr> next = RE_CONCAT(v.getArg(), RE_REPEAT(v.getArg(), min ? min - 1 : 0, rest));
+    if (min == 0) {
+      next = RE_UNION(RE_EMPTY, next);
+    }
+    result = eval(*next, word);
+  }
+
   /**
    * I know no reasonable way to evaluate complementation...
    */
@@ -0,0 +1,154 @@
+#include "catch2/catch.hpp"
+
+#include "test/Tools.hpp"
+#include "test/GenNfasl.hpp"
+#include "test/GenLetter.hpp"
+
+#include "test/Letter.hpp"
+
+#include "nfasl/BisimNfasl.hpp"
+#include "nfasl/Dfasl.hpp"
+#include "rt/RtDfasl.hpp"
+#include "rt/RtDfaslTable.hpp"
+#include "rt/RtLazyDfasl.hpp"
+#include "rt/RtNfasl.hpp"
+#include "rt/RtNfaslBits.hpp"
+
+#include <cstdlib>
+#include <new>
+
+/*
+ * Count heap allocations made while `counting` is set,
+ * the rest of the program is not affected
+ */
+
+static bool counting = false;
+static size_t allocations = 0;
+
+void* operator new(std::size_t size) {
+  if (counting) {
+    ++allocations;
+  }
+  void* p = std::malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+// GCC pairs inlined `std::free` with `new` expressions, but `operator new` is `malloc` above
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+#pragma GCC diagnostic pop
+
+/** allocations made by `f` */
+template <typename F>
+static size_t countAllocations(F f) {
+  allocations = 0;
+  counting = true;
+  f();
+  counting = false;
+  return allocations;
+}
+
+/** Events of streams, long enough to reach sizes of all buffers */
+static constexpr size_t streamLength = 1000;
+
+/** steady state: after a warm-up stream, another random stream must not allocate */
+template <typename Executor>
+static size_t steadyAllocations(Executor& exec, size_t atoms) {
+  Word warmup = WordGenerator::make(atoms, streamLength, streamLength);
+  Word stream = WordGenerator::make(atoms, streamLength, streamLength);
+  for (auto const& letter : warmup) {
+    exec.advance(letter);
+  }
+  return countAllocations([&exec, &stream]() {
+      for (auto const& letter : stream) {
+        exec.advance(letter);
+      }
+    });
+}
+
+TEST_CASE("rt executors do not allocate") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 8;
+  constexpr size_t maxTrs = 3;
+
+  auto expr0 = GENERATE(Catch2::take(20, genNfasl(depth, atoms, states, maxTrs)));
+
+  auto rtNfasl = std::make_shared<rt::Nfasl>();
+  nfasl::toRt(*expr0, *rtNfasl);
+  // an anchored run of a random automaton soon fails, a search one does not
+  auto rtSearch = std::make_shared<rt::Nfasl>();
+  nfasl::toRt(nfasl::search(*expr0), *rtSearch);
+
+  rt::NfaslContext nfaslContext(rtSearch);
+  CHECK(steadyAllocations(nfaslContext, atoms) == 0);
+
+  rt::NfaslExtendedContext extendedContext(rtNfasl);
+  CHECK(steadyAllocations(extendedContext, atoms) == 0);
+
+  // including cache misses and flushes
+  rt::LazyDfaslContext lazyContext(rtSearch, 0);
+  CHECK(steadyAllocations(lazyContext, atoms) == 0);
+
+  rt::ExecutorPtr bits = rt::createNfaslBitsContext(*rtSearch);
+  REQUIRE(bits != nullptr);
+  CHECK(steadyAllocations(*bits, atoms) == 0);
+
+  nfasl::Nfasl cleaned;
+  nfasl::clean(*expr0, cleaned);
+  dfasl::Dfasl search;
+  REQUIRE(dfasl::toSearchDfasl(cleaned, search));
+  auto rtSearchDfasl = std::make_shared<rt::Dfasl>();
+  dfasl::toRt(search, *rtSearchDfasl);
+
+  rt::DfaslContext dfaslContext(rtSearchDfasl);
+  CHECK(steadyAllocations(dfaslContext, atoms) == 0);
+
+  auto searchTable = std::make_shared<rt::DfaslTable>();
+  REQUIRE(rt::toTable(*rtSearchDfasl, *searchTable));
+  rt::DfaslTableContext tableContext(searchTable);
+  CHECK(steadyAllocations(tableContext, atoms) == 0);
+
+  dfasl::Dfasl dfa;
+  dfasl::toDfasl(cleaned, dfa);
+  auto rtDfasl = std::make_shared<rt::Dfasl>();
+  dfasl::toRt(dfa, *rtDfasl);
+  auto table = std::make_shared<rt::DfaslTable>();
+  REQUIRE(rt::toTable(*rtDfasl, *table));
+
+  rt::DfaslExtendedContext dfaslExtendedContext(rtDfasl);
+  CHECK(steadyAllocations(dfaslExtendedContext, atoms) == 0);
+
+  rt::DfaslTableExtendedContext tableExtendedContext(table);
+  CHECK(steadyAllocations(tableExtendedContext, atoms) == 0);
+}
+
+TEST_CASE("rt executors with counters do not allocate") {
+  constexpr size_t atoms = 2;
+  // a0 ; a1{3,100} ; a0, the counting state is active most of the time
+  boolean::Expr a0 = boolean::Expr::var(0);
+  boolean::Expr a1 = boolean::Expr::var(1);
+  nfasl::Nfasl counted = nfasl::concat(nfasl::concat(nfasl::phi(a0), nfasl::count(a1, 3, 100)),
+                                       nfasl::phi(a0));
+  REQUIRE(!counted.counters.empty());
+  auto rtNfasl = std::make_shared<rt::Nfasl>();
+  nfasl::toRt(counted, *rtNfasl);
+  auto rtSearch = std::make_shared<rt::Nfasl>();
+  nfasl::toRt(nfasl::search(counted), *rtSearch);
+
+  rt::NfaslContext nfaslContext(rtSearch);
+  CHECK(steadyAllocations(nfaslContext, atoms) == 0);
+
+  rt::NfaslExtendedContext extendedContext(rtNfasl);
+  CHECK(steadyAllocations(extendedContext, atoms) == 0);
+}
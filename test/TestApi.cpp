@@ -1,16 +1,21 @@
 #include "catch2/catch.hpp"
 
 #include "api/sere.hpp"
+#include "rt/RtImage.hpp"
+#include "boolean/Expr.hpp"
 
 #include <map>
+#include <mutex>
 #include <string>
+#include <tuple>
+#include <vector>
 #include <memory.h>
 
 TEST_CASE("Sere API") {
   //const char expr[] = "(A ; B[*] ; ~(C | D) ; E) & F[+]";
   const char expr[] = "(A ; B[*]) & F[+]";
 
-  struct sere_options opts = { SERE_TARGET_DFASL, SERE_FORMAT_JSON, 0, 0 };
+  struct sere_options opts = { SERE_TARGET_DFASL, SERE_FORMAT_JSON, 0, 0, 0, 0 };
   struct sere_compiled compiled;
   int r = sere_compile(expr, &opts, &compiled);
 
@@ -51,8 +56,9 @@ TEST_CASE("Sere API") {
 
 TEST_CASE("Sere Extended API") {
   const char expr[] = "(A ; B) | B";
+  int target = GENERATE(SERE_TARGET_NFASL, SERE_TARGET_DFASL);
 
-  struct sere_options opts = { SERE_TARGET_NFASL, SERE_FORMAT_JSON, 0, 0 };
+  struct sere_options opts = { target, SERE_FORMAT_JSON, 0, 0, 0, 0 };
   struct sere_compiled compiled;
   int r = sere_compile(expr, &opts, &compiled);
 
@@ -92,3 +98,640 @@ TEST_CASE("Sere Extended API") {
   sere_context_extended_release(sere);
   sere_release(&compiled);
 }
+
+TEST_CASE("Sere Extended API, retention") {
+  const char expr[] = "(A ; B) | B";
+  int target = GENERATE(SERE_TARGET_NFASL, SERE_TARGET_DFASL);
+
+  struct sere_options opts = { target, SERE_FORMAT_JSON, 0, 0, 0, 0 };
+  struct sere_compiled compiled;
+  CHECK(sere_compile(expr, &opts, &compiled) == 0);
+
+  void* sere = nullptr;
+  void* batch = nullptr;
+  CHECK(sere_context_extended_load(compiled.content, compiled.content_size, &sere) == 0);
+  CHECK(sere_context_extended_load(compiled.content, compiled.content_size, &batch) == 0);
+
+  size_t atomic_count;
+  sere_context_extended_atomic_count(sere, &atomic_count);
+  std::map<char, size_t> remap;
+  for (size_t ix = 0; ix < atomic_count; ++ix) {
+    const char* name = nullptr;
+    sere_context_extended_atomic_name(sere, ix, &name);
+    remap[name[0]] = ix;
+  }
+
+  std::string word = "AAABAB";
+  const uint64_t* payloads = nullptr;
+  size_t count = 0;
+
+  // nothing is retained by default
+  for (auto s : word) {
+    sere_context_extended_set_atomic(sere, remap[s]);
+    sere_context_extended_advance(sere);
+  }
+  CHECK(sere_context_extended_match_payloads(sere, 1, &payloads, &count) != 0);
+
+  sere_context_extended_reset(sere);
+  sere_context_extended_retain(sere, 1);
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    sere_context_extended_set_atomic(sere, remap[word[ix]]);
+    sere_context_extended_set_payload(sere, 100 + ix);
+    sere_context_extended_advance(sere);
+    sere_context_extended_retained(sere, &payloads, &count);
+    // the latest `horizon` events at most
+    CHECK(count <= 2);
+  }
+  CHECK(sere_context_extended_match_payloads(sere, 1, &payloads, &count) == 0);
+  REQUIRE(count == 2);
+  CHECK(payloads[0] == 104);
+  CHECK(payloads[1] == 105);
+  CHECK(sere_context_extended_match_payloads(sere, 0, &payloads, &count) == 0);
+  REQUIRE(count == 1);
+  CHECK(payloads[0] == 105);
+
+  // offsets of events, if there are no payloads
+  uint8_t events[6] = {};
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    events[ix] = 1 << remap[word[ix]];
+  }
+  sere_context_extended_retain(batch, 1);
+  CHECK(sere_context_extended_advance_batch(batch, events, 1, word.size(), nullptr) == 0);
+  CHECK(sere_context_extended_match_payloads(batch, 1, &payloads, &count) == 0);
+  REQUIRE(count == 2);
+  CHECK(payloads[0] == 4);
+  CHECK(payloads[1] == 5);
+
+  sere_context_extended_release(sere);
+  sere_context_extended_release(batch);
+  sere_release(&compiled);
+}
+
+TEST_CASE("Sere Extended API, reverse") {
+  const char expr[] = "(A ; B[*] ; C) | (B ; C)";
+  int target = GENERATE(SERE_TARGET_NFASL, SERE_TARGET_DFASL);
+
+  struct sere_options opts = { target, SERE_FORMAT_JSON, 0, 0, 0, 0 };
+  struct sere_compiled compiled;
+  CHECK(sere_compile(expr, &opts, &compiled) == 0);
+
+  void* sere = nullptr;
+  void* reverse = nullptr;
+  void* restored = nullptr;
+  CHECK(sere_context_extended_load(compiled.content, compiled.content_size, &sere) == 0);
+  CHECK(sere_context_extended_load_reverse(compiled.content, compiled.content_size, &reverse) == 0);
+  CHECK(sere_context_extended_load_reverse(compiled.content, compiled.content_size, &restored) == 0);
+
+  std::map<char, size_t> remap;
+  size_t atomic_count;
+  sere_context_extended_atomic_count(sere, &atomic_count);
+  for (size_t ix = 0; ix < atomic_count; ++ix) {
+    const char* name = nullptr;
+    sere_context_extended_atomic_name(sere, ix, &name);
+    remap[name[0]] = ix;
+  }
+
+  std::string word = "CABBC";
+  ExtendedMatch r0, r1;
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    sere_context_extended_set_atomic(sere, remap[word[ix]]);
+    sere_context_extended_advance(sere);
+    sere_context_extended_set_atomic(reverse, remap[word[ix]]);
+    sere_context_extended_advance(reverse);
+    sere_context_extended_get_result(sere, &r0);
+    sere_context_extended_get_result(reverse, &r1);
+    REQUIRE(r0.match == r1.match);
+    if (r0.match == MATCH_OK) {
+      CHECK(r0.ok.longest == r1.ok.longest);
+      CHECK(r0.ok.shortest == r1.ok.shortest);
+    }
+    if (ix == 2) {
+      // retained events are restored with the state
+      const char* data = nullptr;
+      size_t size = 0;
+      sere_context_extended_snapshot(reverse, &data, &size);
+      std::string snapshot(data, size);
+      // DFASL is loaded by the plain extended executor, so are its snapshots
+      int plain = sere_context_extended_restore(sere, snapshot.data(), snapshot.size());
+      CHECK((plain == 0) == (target == SERE_TARGET_DFASL));
+      CHECK(sere_context_extended_restore(restored, snapshot.data(), snapshot.size()) == 0);
+    }
+  }
+  CHECK(r1.match == MATCH_OK);
+  CHECK(r1.ok.longest == 4);
+  CHECK(r1.ok.shortest == 2);
+
+  for (auto s : word.substr(3)) {
+    sere_context_extended_set_atomic(restored, remap[s]);
+    sere_context_extended_advance(restored);
+  }
+  sere_context_extended_get_result(restored, &r0);
+  CHECK(r0.match == MATCH_OK);
+  CHECK(r0.ok.longest == r1.ok.longest);
+  CHECK(r0.ok.shortest == r1.ok.shortest);
+
+  sere_context_extended_release(sere);
+  sere_context_extended_release(reverse);
+  sere_context_extended_release(restored);
+  sere_release(&compiled);
+}
+
+TEST_CASE("Sere API, time window") {
+  const char expr[] = "WITHIN(A ; B[*] ; C, 10)";
+  int target = GENERATE(SERE_TARGET_NFASL, SERE_TARGET_DFASL);
+  int format = GENERATE(SERE_FORMAT_JSON, SERE_FORMAT_RT);
+
+  struct sere_options opts = { target, format, 0, 0, 0, 0 };
+  struct sere_compiled compiled;
+  REQUIRE(sere_compile(expr, &opts, &compiled) == 0);
+
+  void* sere = nullptr;
+  void* extended = nullptr;
+  REQUIRE(sere_context_load(compiled.content, compiled.content_size, &sere) == 0);
+  REQUIRE(sere_context_extended_load(compiled.content, compiled.content_size, &extended) == 0);
+
+  size_t atomic_count;
+  sere_context_atomic_count(sere, &atomic_count);
+  std::map<char, size_t> remap;
+  for (size_t ix = 0; ix < atomic_count; ++ix) {
+    const char* name = nullptr;
+    sere_context_atomic_name(sere, ix, &name);
+    remap[name[0]] = ix;
+  }
+
+  int result;
+  auto run = [&](const std::string& word, const std::vector<uint64_t>& times) {
+    sere_context_reset(sere);
+    for (size_t ix = 0; ix < word.size(); ++ix) {
+      sere_context_set_atomic(sere, remap[word[ix]]);
+      sere_context_advance_at(sere, times[ix]);
+    }
+    sere_context_get_result(sere, &result);
+    return result;
+  };
+  CHECK(run("ABC", { 100, 105, 110 }) == MATCH_OK);
+  CHECK(run("ABC", { 100, 105, 111 }) == MATCH_FAILED);
+  // without times every event happens at once
+  sere_context_reset(sere);
+  for (auto s : std::string("ABBBC")) {
+    sere_context_set_atomic(sere, remap[s]);
+    sere_context_advance(sere);
+  }
+  sere_context_get_result(sere, &result);
+  CHECK(result == MATCH_OK);
+
+  // the run started at the first `A` is out of the window
+  std::string word = "ABABC";
+  std::vector<uint64_t> times = { 0, 4, 6, 9, 12 };
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    sere_context_extended_set_atomic(extended, remap[word[ix]]);
+    sere_context_extended_advance_at(extended, times[ix]);
+  }
+  ExtendedMatch match;
+  sere_context_extended_get_result(extended, &match);
+  CHECK(match.match == MATCH_OK);
+  CHECK(match.ok.shortest == 3);
+  CHECK(match.ok.longest == 3);
+
+  sere_context_release(sere);
+  sere_context_extended_release(extended);
+  sere_release(&compiled);
+}
+
+TEST_CASE("Sere API, batch") {
+  const char expr[] = "(A ; B[*]) & F[+]";
+  int target = GENERATE(SERE_TARGET_DFASL, SERE_TARGET_NFASL, SERE_TARGET_LAZY_DFASL);
+
+  struct sere_options opts = { target, SERE_FORMAT_JSON, 0, 0, 0, 0 };
+  struct sere_compiled compiled;
+  int r = sere_compile(expr, &opts, &compiled);
+
+  CHECK(r == 0);
+
+  void* sere = nullptr;
+  void* batch = nullptr;
+  CHECK(sere_context_load(compiled.content, compiled.content_size, &sere) == 0);
+  CHECK(sere_context_load(compiled.content, compiled.content_size, &batch) == 0);
+
+  size_t atomic_count;
+  sere_context_atomic_count(sere, &atomic_count);
+
+  std::map<char, size_t> remap;
+
+  for (size_t ix = 0; ix < atomic_count; ++ix) {
+    const char* name = nullptr;
+    sere_context_atomic_name(sere, ix, &name);
+    remap[name[0]] = ix;
+  }
+
+  std::string word[] = { "AF", "BF", "F", "BF", "A", "BF" };
+  constexpr size_t count = sizeof(word)/sizeof(word[0]);
+  constexpr size_t stride = 2;
+
+  uint8_t events[count*stride] = {};
+  for (size_t il = 0; il < count; ++il) {
+    for (auto s : word[il]) {
+      events[il*stride + remap[s]/8] |= 1 << (remap[s] % 8);
+    }
+  }
+
+  Match results[count];
+  CHECK(sere_context_advance_batch(batch, events, stride, count, results) == 0);
+  CHECK(sere_context_advance_batch(batch, events, 0, count, nullptr) != 0);
+
+  for (size_t il = 0; il < count; ++il) {
+    for (auto s : word[il]) {
+      sere_context_set_atomic(sere, remap[s]);
+    }
+    sere_context_advance(sere);
+    int result;
+    sere_context_get_result(sere, &result);
+    CHECK(result == results[il]);
+  }
+  CHECK(results[count - 1] == MATCH_FAILED);
+
+  sere_context_release(sere);
+  sere_context_release(batch);
+  sere_release(&compiled);
+}
+
+TEST_CASE("Sere API, snapshot") {
+  const char expr[] = "(A ; B[*] ; C) | (B ; C)";
+  int target = GENERATE(SERE_TARGET_DFASL, SERE_TARGET_NFASL, SERE_TARGET_LAZY_DFASL);
+
+  struct sere_options opts = { target, SERE_FORMAT_JSON, 0, 0, 0, 0 };
+  struct sere_compiled compiled, other;
+  CHECK(sere_compile(expr, &opts, &compiled) == 0);
+  CHECK(sere_compile("A ; C", &opts, &other) == 0);
+
+  void* sere = nullptr;
+  void* restored = nullptr;
+  void* wrong = nullptr;
+  CHECK(sere_context_load(compiled.content, compiled.content_size, &sere) == 0);
+  CHECK(sere_context_load(compiled.content, compiled.content_size, &restored) == 0);
+  CHECK(sere_context_load(other.content, other.content_size, &wrong) == 0);
+
+  std::map<char, size_t> remap;
+  size_t atomic_count;
+  sere_context_atomic_count(sere, &atomic_count);
+  for (size_t ix = 0; ix < atomic_count; ++ix) {
+    const char* name = nullptr;
+    sere_context_atomic_name(sere, ix, &name);
+    remap[name[0]] = ix;
+  }
+
+  sere_context_set_atomic(sere, remap['A']);
+  sere_context_advance(sere);
+  sere_context_set_atomic(sere, remap['B']);
+  sere_context_advance(sere);
+
+  const char* data = nullptr;
+  size_t size = 0;
+  sere_context_snapshot(sere, &data, &size);
+  std::string snapshot(data, size);
+
+  CHECK(sere_context_restore(wrong, snapshot.data(), snapshot.size()) != 0);
+  CHECK(sere_context_restore(restored, snapshot.data(), snapshot.size() - 1) != 0);
+  CHECK(sere_context_restore(restored, snapshot.data(), snapshot.size()) == 0);
+
+  int r0, r1;
+  sere_context_get_result(sere, &r0);
+  sere_context_get_result(restored, &r1);
+  CHECK(r0 == MATCH_PARTIAL);
+  CHECK(r0 == r1);
+
+  sere_context_set_atomic(sere, remap['C']);
+  sere_context_advance(sere);
+  sere_context_set_atomic(restored, remap['C']);
+  sere_context_advance(restored);
+  sere_context_get_result(sere, &r0);
+  sere_context_get_result(restored, &r1);
+  CHECK(r0 == MATCH_OK);
+  CHECK(r0 == r1);
+
+  sere_context_release(sere);
+  sere_context_release(restored);
+  sere_context_release(wrong);
+  sere_release(&compiled);
+  sere_release(&other);
+}
+
+TEST_CASE("Sere API, image") {
+  const char expr[] = "(A ; B[*] ; C) | (B ; C)";
+  int target = GENERATE(SERE_TARGET_DFASL, SERE_TARGET_NFASL, SERE_TARGET_LAZY_DFASL);
+
+  struct sere_options opts = { target, SERE_FORMAT_JSON, 0, 0, 0, 0 };
+  struct sere_compiled compiled, image;
+  CHECK(sere_compile(expr, &opts, &compiled) == 0);
+  opts.format = SERE_FORMAT_RT;
+  CHECK(sere_compile(expr, &opts, &image) == 0);
+
+  void* sere = nullptr;
+  void* copied = nullptr;
+  void* mapped = nullptr;
+  CHECK(sere_context_load(compiled.content, compiled.content_size, &sere) == 0);
+  CHECK(sere_context_load(image.content, image.content_size, &copied) == 0);
+  CHECK(sere_context_load_image(image.content, image.content_size, &mapped) == 0);
+  // contexts of the same image share it, but not their state
+  void* again = nullptr;
+  CHECK(sere_context_load_image(image.content, image.content_size, &again) == 0);
+
+  size_t atomic_count;
+  sere_context_atomic_count(mapped, &atomic_count);
+  std::map<char, size_t> remap;
+  for (size_t ix = 0; ix < atomic_count; ++ix) {
+    const char* name = nullptr;
+    sere_context_atomic_name(mapped, ix, &name);
+    remap[name[0]] = ix;
+  }
+
+  // no match starts with C
+  sere_context_set_atomic(again, remap['C']);
+  sere_context_advance(again);
+  int failed;
+  sere_context_get_result(again, &failed);
+  CHECK(failed == MATCH_FAILED);
+  sere_context_reset(again);
+
+  std::string word[] = { "A", "B", "B", "C", "B" };
+  for (auto const& letter : word) {
+    for (void* ctx : { sere, copied, mapped, again }) {
+      for (auto s : letter) {
+        sere_context_set_atomic(ctx, remap[s]);
+      }
+      sere_context_advance(ctx);
+    }
+    int expected, r0, r1, r2;
+    sere_context_get_result(sere, &expected);
+    sere_context_get_result(copied, &r0);
+    sere_context_get_result(mapped, &r1);
+    sere_context_get_result(again, &r2);
+    CHECK(r0 == expected);
+    CHECK(r1 == expected);
+    CHECK(r2 == expected);
+  }
+
+  // a damaged image is rejected
+  std::string broken(image.content, image.content_size);
+  broken[broken.size() / 2] ^= 1;
+  void* rejected = nullptr;
+  CHECK(sere_context_load(broken.data(), broken.size(), &rejected) != 0);
+
+  sere_context_release(sere);
+  sere_context_release(copied);
+  sere_context_release(mapped);
+  sere_context_release(again);
+  sere_release(&compiled);
+  sere_release(&image);
+}
+
+/** Image of `A ; B` (built without the parser) */
+static std::vector<uint8_t> imageAB(rt::Timestamp window = 0) {
+  rt::Nfasl a;
+  a.atomicCount = 2;
+  a.stateCount = 3;
+  a.initials.resize(a.stateCount);
+  a.finals.resize(a.stateCount);
+  a.transitions.resize(a.stateCount);
+  a.initials.set(0);
+  a.finals.set(2);
+  for (rt::State q = 0; q < 2; ++q) {
+    rt::Program prog;
+    boolean::toRtProgram(boolean::Expr::var(q), prog);
+    a.transitions[q].push_back({ {}, rt::State(q + 1), a.predicates.intern(prog) });
+  }
+  a.window = window;
+  std::vector<uint8_t> data;
+  rt::writeImage(a, { "A", "B" }, data);
+  return data;
+}
+
+TEST_CASE("Sere API, image lifetime") {
+  std::vector<uint8_t> data = imageAB();
+
+  // images of callers, aligned to 8 bytes
+  size_t words = (data.size() + 7) / 8;
+  auto first = std::make_unique<uint64_t[]>(words);
+  auto second = std::make_unique<uint64_t[]>(words);
+  memcpy(first.get(), data.data(), data.size());
+  memcpy(second.get(), data.data(), data.size());
+
+  void* inPlace = nullptr;
+  void* copied = nullptr;
+  void* other = nullptr;
+  CHECK(sere_context_load_image(first.get(), data.size(), &inPlace) == 0);
+  CHECK(sere_context_load(reinterpret_cast<const char*>(data.data()), data.size(), &copied) == 0);
+  CHECK(sere_context_load_image(second.get(), data.size(), &other) == 0);
+
+  // the first image is gone with its context, other loads never refer to it
+  sere_context_release(inPlace);
+  memset(first.get(), 0xff, data.size());
+  first.reset();
+
+  for (void* ctx : { copied, other }) {
+    int r;
+    sere_context_set_atomic(ctx, 0);
+    sere_context_advance(ctx);
+    sere_context_get_result(ctx, &r);
+    CHECK(r == MATCH_PARTIAL);
+    sere_context_set_atomic(ctx, 1);
+    sere_context_advance(ctx);
+    sere_context_get_result(ctx, &r);
+    CHECK(r == MATCH_OK);
+  }
+
+  sere_context_release(copied);
+  sere_context_release(other);
+}
+
+TEST_CASE("Sere API, time window without time") {
+  // events of these contexts have no time, a windowed SERE is rejected
+  for (rt::Timestamp window : { 0, 30 }) {
+    std::vector<uint8_t> data = imageAB(window);
+    const char* rt = reinterpret_cast<const char*>(data.data());
+    bool accepted = window == 0;
+
+    void* keyed = nullptr;
+    CHECK((sere_keyed_load(rt, data.size(), &keyed) == 0) == accepted);
+    if (keyed) {
+      sere_keyed_release(keyed);
+    }
+
+    void* scheduler = nullptr;
+    CHECK((sere_scheduler_load(rt, data.size(), 1, nullptr, nullptr, &scheduler) == 0) == accepted);
+    if (scheduler) {
+      sere_scheduler_release(scheduler);
+    }
+
+    void* set = nullptr;
+    size_t rule;
+    sere_set_create(&set);
+    CHECK((sere_set_add(set, rt, data.size(), &rule) == 0) == accepted);
+    sere_set_release(set);
+
+    void* matcher = nullptr;
+    auto callback = [](void*, size_t, uint64_t, uint64_t) {};
+    REQUIRE(sere_matcher_create(SERE_MATCH_ALL, callback, nullptr, &matcher) == 0);
+    CHECK((sere_matcher_add(matcher, rt, data.size(), &rule) == 0) == accepted);
+    sere_matcher_release(matcher);
+
+    // a plain context runs it
+    void* sere = nullptr;
+    CHECK(sere_context_load(rt, data.size(), &sere) == 0);
+    sere_context_release(sere);
+  }
+}
+
+static void collectResult(void* arg, uint64_t stream, int result) {
+  auto seen = reinterpret_cast<std::map<uint64_t, std::vector<int>>*>(arg);
+  // streams are evaluated concurrently
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  (*seen)[stream].push_back(result);
+}
+
+TEST_CASE("Sere API, scheduler") {
+  const char expr[] = "(A ; B[*] ; C) | (B ; C)";
+  struct sere_options opts = { SERE_TARGET_DFASL, SERE_FORMAT_JSON, 0, 0, 0, 0 };
+  struct sere_compiled compiled;
+  CHECK(sere_compile(expr, &opts, &compiled) == 0);
+
+  std::map<uint64_t, std::vector<int>> seen;
+  void* sere = nullptr;
+  CHECK(sere_scheduler_load(compiled.content, compiled.content_size,
+                            2, collectResult, &seen, &sere) == 0);
+
+  size_t atomic_count;
+  sere_scheduler_atomic_count(sere, &atomic_count);
+  std::map<char, size_t> remap;
+  for (size_t ix = 0; ix < atomic_count; ++ix) {
+    const char* name = nullptr;
+    sere_scheduler_atomic_name(sere, ix, &name);
+    remap[name[0]] = ix;
+  }
+
+  // stream `k` gets "A", "B" x k, "C"
+  constexpr uint64_t streams = 10;
+  for (uint64_t k = 0; k < streams; ++k) {
+    std::string word = "A" + std::string(k, 'B') + "C";
+    for (auto s : word) {
+      uint8_t event = 1 << remap[s];
+      CHECK(sere_scheduler_post(sere, k, &event, 1) == 0);
+    }
+  }
+  sere_scheduler_wait(sere);
+
+  for (uint64_t k = 0; k < streams; ++k) {
+    int result;
+    sere_scheduler_get_result(sere, k, &result);
+    CHECK(result == MATCH_OK);
+    CHECK(seen[k].size() == k + 2);
+  }
+  sere_scheduler_release(sere);
+  sere_release(&compiled);
+}
+
+TEST_CASE("Sere API, matcher") {
+  int target = GENERATE(SERE_TARGET_NFASL, SERE_TARGET_DFASL);
+  struct sere_options opts = { target, SERE_FORMAT_RT, 0, 0, 0, 0 };
+  struct sere_compiled first, second;
+  CHECK(sere_compile("A ; B", &opts, &first) == 0);
+  CHECK(sere_compile("B ; C", &opts, &second) == 0);
+
+  typedef std::tuple<size_t, uint64_t, uint64_t> Found;
+  std::vector<Found> found;
+  auto callback = [](void* arg, size_t rule, uint64_t start, uint64_t end) {
+    reinterpret_cast<std::vector<Found>*>(arg)->push_back({ rule, start, end });
+  };
+
+  void* matcher = nullptr;
+  CHECK(sere_matcher_create(3, callback, &found, &matcher) != 0);
+  CHECK(sere_matcher_create(SERE_MATCH_ALL, nullptr, &found, &matcher) != 0);
+  CHECK(sere_matcher_create(SERE_MATCH_ALL, callback, &found, &matcher) == 0);
+  size_t rule = 0;
+  CHECK(sere_matcher_add(matcher, first.content, first.content_size, &rule) == 0);
+  CHECK(rule == 0);
+  CHECK(sere_matcher_add(matcher, second.content, second.content_size, &rule) == 0);
+  CHECK(rule == 1);
+
+  // `B` is shared
+  size_t atomic_count;
+  sere_matcher_atomic_count(matcher, &atomic_count);
+  CHECK(atomic_count == 3);
+  std::map<char, size_t> remap;
+  for (size_t ix = 0; ix < atomic_count; ++ix) {
+    const char* name = nullptr;
+    sere_matcher_atomic_name(matcher, ix, &name);
+    remap[name[0]] = ix;
+  }
+
+  std::string word = "ABCAB";
+  for (auto s : word) {
+    sere_matcher_set_atomic(matcher, remap[s]);
+    sere_matcher_advance(matcher);
+  }
+  sere_matcher_flush(matcher);
+  CHECK(found == std::vector<Found>{ Found{ 0, 0, 2 }, Found{ 1, 1, 3 }, Found{ 0, 3, 5 } });
+
+  // rule by rule within a batch
+  std::vector<uint8_t> events;
+  for (auto s : word) {
+    events.push_back(1 << remap[s]);
+  }
+  sere_matcher_reset(matcher);
+  found.clear();
+  CHECK(sere_matcher_advance_batch(matcher, events.data(), 1, events.size()) == 0);
+  CHECK(found == std::vector<Found>{ Found{ 0, 0, 2 }, Found{ 0, 3, 5 }, Found{ 1, 1, 3 } });
+
+  sere_matcher_release(matcher);
+  sere_release(&first);
+  sere_release(&second);
+}
+
+TEST_CASE("Sere API, unanchored") {
+  const char expr[] = "A ; B ; C";
+  int target = GENERATE(SERE_TARGET_NFASL, SERE_TARGET_DFASL, SERE_TARGET_LAZY_DFASL);
+  // a DFASL over 2 states falls back to the lazy one
+  size_t maxDfaslStates = GENERATE(0, 2);
+
+  struct sere_options opts = { target, SERE_FORMAT_JSON, 0, maxDfaslStates, 0, 1 };
+  struct sere_compiled compiled;
+  int r = sere_compile(expr, &opts, &compiled);
+
+  CHECK(r == 0);
+
+  void* sere = nullptr;
+  r = sere_context_load(compiled.content, compiled.content_size, &sere);
+
+  CHECK(r == 0);
+
+  size_t atomic_count;
+  sere_context_atomic_count(sere, &atomic_count);
+
+  std::map<char, size_t> remap;
+
+  for (size_t ix = 0; ix < atomic_count; ++ix) {
+    const char* name = nullptr;
+    sere_context_atomic_name(sere, ix, &name);
+    remap[name[0]] = ix;
+  }
+
+  // a match ends at every `C` after `A ; B`
+  std::string word = "CABCAABCBC";
+  std::string ends = "...o...o..";
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    sere_context_set_atomic(sere, remap[word[ix]]);
+    sere_context_advance(sere);
+    int result;
+    sere_context_get_result(sere, &result);
+    CHECK(result == (ends[ix] == 'o' ? MATCH_OK : MATCH_PARTIAL));
+  }
+  sere_context_release(sere);
+  sere_release(&compiled);
+
+  // a window bounds a match, not events before it
+  const char within[] = "WITHIN(A ; B, 10)";
+  r = sere_compile(within, &opts, &compiled);
+  CHECK(r != 0);
+  sere_release(&compiled);
+}
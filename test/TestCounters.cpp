@@ -0,0 +1,233 @@
+#include "catch2/catch.hpp"
+
+#include "test/Tools.hpp"
+#include "test/Letter.hpp"
+#include "test/EvalNfasl.hpp"
+#include "test/EvalSere.hpp"
+
+#include "ast/SereExpr.hpp"
+#include "nfasl/Nfasl.hpp"
+#include "nfasl/BisimNfasl.hpp"
+#include "rt/RtNfasl.hpp"
+#include "rt/RtNfaslBits.hpp"
+#include "rt/RtKeyed.hpp"
+#include "rt/RtLazyDfasl.hpp"
+#include "rt/RtImage.hpp"
+
+#include <cstdlib>
+
+/** Events with long runs of `a0` */
+static Word makeWord(size_t length) {
+  Word word(length);
+  for (auto& letter : word) {
+    letter.resize(2);
+    letter.set(0, std::rand() % 10 != 0);
+    letter.set(1, std::rand() % 3 == 0);
+  }
+  return word;
+}
+
+static std::shared_ptr<rt::Nfasl> toRt(const nfasl::Nfasl& a) {
+  auto r = std::make_shared<rt::Nfasl>();
+  nfasl::toRt(a, *r);
+  return r;
+}
+
+/** Results of `Ctx` over `word` */
+template <typename Ctx, typename Result, typename Automaton>
+static std::vector<Result> run(Automaton automaton, const Word& word) {
+  Ctx context(automaton);
+  std::vector<Result> results;
+  for (auto& letter : word) {
+    context.advance(letter);
+    results.push_back(context.getResult());
+  }
+  return results;
+}
+
+/** Results of `Ctx` with a snapshot taken and restored halfway */
+template <typename Ctx, typename Result>
+static std::vector<Result> runRestored(std::shared_ptr<rt::Nfasl> automaton, const Word& word) {
+  Ctx context(automaton);
+  std::vector<Result> results;
+  size_t half = word.size() / 2;
+  for (size_t ix = 0; ix < half; ++ix) {
+    context.advance(word[ix]);
+    results.push_back(context.getResult());
+  }
+  std::vector<uint8_t> data;
+  rt::SnapshotWriter writer(data);
+  context.save(writer);
+  Ctx restored(automaton);
+  rt::SnapshotReader reader(data.data(), data.size());
+  restored.restore(reader);
+  for (size_t ix = half; ix < word.size(); ++ix) {
+    restored.advance(word[ix]);
+    results.push_back(restored.getResult());
+  }
+  return results;
+}
+
+static Ptr<SereExpr> a0() { return RE_SEREBOOL(RE_VAR(0)); }
+static Ptr<SereExpr> a1() { return RE_SEREBOOL(RE_VAR(1)); }
+
+TEST_CASE("Counters, expressions") {
+  auto expr = GENERATE(
+    as<Ptr<SereExpr>>(),
+    RE_REPEAT(a0(), 16, 20),
+    RE_REPEAT(a0(), 18, 18),
+    RE_REPEAT(a0(), 0, 17),
+    RE_REPEAT(a0(), 17, Repeat::Unbounded),
+    RE_CONCAT(a1(), RE_CONCAT(RE_REPEAT(a0(), 16, 19), a1())),
+    RE_STAR(RE_REPEAT(a0(), 16, 18)),
+    RE_UNION(RE_REPEAT(RE_SEREBOOL(RE_AND(RE_VAR(0), RE_NOT(RE_VAR(1)))), 16, Repeat::Unbounded),
+             RE_CONCAT(a1(), a1())),
+    RE_REPEAT(RE_CONCAT(a1(), RE_REPEAT(a0(), 16, 17)), 2, 2),
+    RE_CONCAT(RE_REPEAT(a0(), 0, 16), RE_PLUS(a1())));
+
+  nfasl::Nfasl counted0 = sereToNfasl(*expr, true);
+  REQUIRE(!counted0.counters.empty());
+  nfasl::Nfasl counted;
+  nfasl::minimize(counted0, counted);
+  REQUIRE(!counted.counters.empty());
+  nfasl::Nfasl expanded = sereToNfasl(*expr);
+  REQUIRE(expanded.counters.empty());
+
+  auto u = toRt(counted);
+  auto v = toRt(expanded);
+
+  for (size_t ix = 0; ix < 20; ++ix) {
+    Word word = makeWord(std::rand() % 48);
+
+    auto anchored = run<rt::NfaslContext, Match>(v, word);
+    CHECK(run<rt::NfaslContext, Match>(u, word) == anchored);
+    CHECK(run<rt::NfaslContext, Match>(toRt(counted0), word) == anchored);
+    CHECK(runRestored<rt::NfaslContext, Match>(u, word) == anchored);
+
+    auto extended = run<rt::NfaslExtendedContext, ExtendedMatch>(v, word);
+    CHECK(run<rt::NfaslExtendedContext, ExtendedMatch>(u, word) == extended);
+    CHECK(runRestored<rt::NfaslExtendedContext, ExtendedMatch>(u, word) == extended);
+  }
+}
+
+TEST_CASE("Counters, time window") {
+  auto expr = GENERATE(
+    as<Ptr<SereExpr>>(),
+    RE_REPEAT(a0(), 0, 16),
+    RE_CONCAT(a1(), RE_REPEAT(a0(), 16, Repeat::Unbounded)));
+  auto u = toRt(sereToNfasl(*expr, true));
+  auto v = toRt(sereToNfasl(*expr));
+  u->window = v->window = 20;
+
+  for (size_t ix = 0; ix < 20; ++ix) {
+    Word word = makeWord(std::rand() % 48);
+    rt::NfaslExtendedContext cu(u), cv(v);
+    rt::Timestamp t = 0;
+    for (auto& letter : word) {
+      t += std::rand() % 3;
+      cu.advanceAt(letter, t);
+      cv.advanceAt(letter, t);
+      // the longest match within the window is approximate, see `RtClock::prune`
+      REQUIRE(cu.getResult().match == cv.getResult().match);
+      if (cv.getResult().match == Match_Ok) {
+        CHECK(cu.getResult().ok.shortest == cv.getResult().ok.shortest);
+      }
+    }
+  }
+}
+
+TEST_CASE("Counters, repeat") {
+  // `repeat` is the expansion of `Repeat` without counters
+  auto expr = GENERATE(
+    as<Ptr<SereExpr>>(),
+    RE_REPEAT(a0(), 2, 4),
+    RE_REPEAT(a0(), 0, 3),
+    RE_REPEAT(a0(), 3, Repeat::Unbounded),
+    RE_REPEAT(RE_CONCAT(a0(), a1()), 1, 3),
+    RE_REPEAT(RE_UNION(RE_EMPTY, RE_CONCAT(a1(), a0())), 2, 3),
+    RE_REPEAT(RE_STAR(a1()), 2, 2));
+  auto u = toRt(sereToNfasl(*expr));
+
+  for (size_t ix = 0; ix < 30; ++ix) {
+    Word word = makeWord(std::rand() % 8);
+    auto results = run<rt::NfaslContext, Match>(u, word);
+    for (size_t end = 1; end <= word.size(); ++end) {
+      Word prefix(word.begin(), word.begin() + end);
+      CHECK((results[end - 1] == Match_Ok) == (evalSere(*expr, prefix) == Match_Ok));
+    }
+  }
+}
+
+TEST_CASE("Counters, state count") {
+  nfasl::Nfasl counted;
+  nfasl::minimize(sereToNfasl(*RE_REPEAT(a0(), 1, 1000), true), counted);
+  CHECK(counted.stateCount == 2);
+  REQUIRE(counted.counters.size() == 2);
+  // operands of a fusion are expanded
+  CHECK(sereToNfasl(*RE_FUSION(RE_REPEAT(a0(), 16, 20), a1()), true).counters.empty());
+
+  // only rule interpretation runs counters
+  auto u = toRt(counted);
+  CHECK(rt::createNfaslBitsContext(*u) == nullptr);
+  CHECK(rt::createKeyedExecutor(*u) == nullptr);
+  CHECK(rt::createLazyDfaslContext(u, rt::defaultLazyCacheSize) == nullptr);
+
+  rt::Names letter;
+  letter.resize(2);
+  letter.set(0);
+  rt::NfaslContext context(u);
+  for (size_t ix = 0; ix < 1000; ++ix) {
+    context.advance(letter);
+    REQUIRE(context.getResult() == Match_Ok);
+  }
+  context.advance(letter);
+  CHECK(context.getResult() == Match_Failed);
+}
+
+TEST_CASE("Counters, persistence") {
+  auto expr = RE_STAR(RE_CONCAT(a1(), RE_REPEAT(a0(), 16, 20)));
+  nfasl::Nfasl counted;
+  nfasl::minimize(sereToNfasl(*expr, true), counted);
+  auto u = toRt(counted);
+
+  SECTION("JSON") {
+    json j = counted;
+    nfasl::Nfasl loaded;
+    from_json(j, loaded);
+    CHECK(json(loaded) == j);
+
+    // a counter is entered only by `Action_Enter`
+    for (auto& trs : j["transitions"]) {
+      for (auto& tr : trs) {
+        tr.erase("action");
+      }
+    }
+    CHECK_THROWS(from_json(j, loaded));
+  }
+
+  SECTION("Image") {
+    std::vector<uint8_t> data;
+    rt::writeImage(*u, { "a0", "a1" }, data);
+    auto image = std::make_shared<rt::Image>(rt::Image::copy(data.data(), data.size()), data.size());
+    REQUIRE(image->counting());
+    auto loaded = rt::toNfasl(image);
+    REQUIRE(loaded->counters.size() == u->counters.size());
+    for (size_t ix = 0; ix < 20; ++ix) {
+      Word word = makeWord(std::rand() % 48);
+      CHECK(run<rt::NfaslContext, Match>(loaded, word) == run<rt::NfaslContext, Match>(u, word));
+    }
+
+    // the checksum is right, but a counting state is initial
+    auto storage = rt::Image::copy(data.data(), data.size());
+    size_t offset = reinterpret_cast<const uint8_t*>(&rt::Image(storage, data.size()).counter(counted.initial))
+      - storage.get();
+    std::vector<uint8_t> unsafe = data;
+    rt::ImageHeader header;
+    memcpy(&header, unsafe.data(), sizeof(header));
+    reinterpret_cast<rt::Counter*>(unsafe.data() + offset)->max = 20;
+    header.checksum = rt::fingerprint(unsafe.data() + 16, unsafe.size() - 16);
+    memcpy(unsafe.data(), &header, sizeof(header));
+    CHECK_THROWS_AS(rt::Image(rt::Image::copy(unsafe.data(), unsafe.size()), unsafe.size()),
+                    rt::LoadingFailed);
+  }
+}
@@ -0,0 +1,97 @@
+#include "catch2/catch.hpp"
+
+#include "test/GenBoolExpr.hpp"
+#include "test/GenNfasl.hpp"
+#include "test/GenLetter.hpp"
+#include "test/EvalRt.hpp"
+#include "test/EvalExpr.hpp"
+
+#include "test/Tools.hpp"
+#include "test/Letter.hpp"
+
+#include "nfasl/BisimNfasl.hpp"
+#include "nfasl/Dfasl.hpp"
+#include "rt/RtDfaslTable.hpp"
+
+using namespace nfasl;
+using namespace dfasl;
+
+TEST_CASE("RtDfasl to table") {
+  constexpr size_t atoms = 4;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 4;
+  constexpr size_t maxTrs = 3;
+
+  auto expr0 = GENERATE(Catch2::take(100, genNfasl(depth, atoms, states, maxTrs)));
+  auto word0 = GENERATE(Catch2::take(5, genWord(atoms, 0, 5)));
+
+  Nfasl cleaned;
+  clean(*expr0, cleaned);
+
+  Dfasl dfa;
+  toDfasl(cleaned, dfa);
+
+  rt::Dfasl rtDfasl;
+  toRt(dfa, rtDfasl);
+
+  rt::DfaslTable table;
+  REQUIRE(rt::toTable(rtDfasl, table));
+  CHECK(table.classCount <= (1u << atoms));
+
+  Match r0 = evalRtDfasl(rtDfasl, word0);
+  Match r1 = evalRtDfaslTable(table, word0);
+
+  CHECK(r0 == r1);
+}
+
+TEST_CASE("RtDfasl to table, limits") {
+  rt::Dfasl dfa;
+  dfa.atomicCount = 2;
+  dfa.stateCount = 2;
+  dfa.initial = 0;
+  dfa.finals = { 1 };
+  dfa.transitions.resize(dfa.stateCount);
+  dfa.transitions[0].push_back({ {}, 1, 0 });
+  boolean::toRtPredicate(boolean::Expr::var(0) && !boolean::Expr::var(1),
+                         dfa.transitions[0][0].phi);
+
+  rt::DfaslTable table;
+  CHECK(!rt::toTable(dfa, table, 1));
+  REQUIRE(rt::toTable(dfa, table));
+  CHECK(table.classCount == 2);
+  CHECK(table.classifier.size() == 2);
+
+  CHECK(evalRtDfaslTable(table, {}) == Match_Partial);
+  CHECK(evalRtDfaslTable(table, { makeNames({0}, {1}) }) == Match_Ok);
+  CHECK(evalRtDfaslTable(table, { makeNames({0, 1}, {}) }) == Match_Failed);
+  CHECK(evalRtDfaslTable(table, { makeNames({0}, {1}), makeNames({0}, {1}) }) == Match_Failed);
+}
+
+TEST_CASE("RtDfasl to table, shared predicate") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 8;
+
+  boolean::Expr x = boolean::Expr::var(0);
+  boolean::Expr y = boolean::Expr::var(1);
+  boolean::Expr e = boolean::Expr::var(2);
+  for (size_t d = 0; d < depth; ++d) {
+    e = (e && x) || (!e && y);
+  }
+
+  rt::Dfasl dfa;
+  dfa.atomicCount = atoms;
+  dfa.stateCount = 2;
+  dfa.initial = 0;
+  dfa.finals = { 1 };
+  dfa.transitions.resize(dfa.stateCount);
+  dfa.transitions[0].push_back({ {}, 1, 0 });
+  boolean::toRtPredicate(e, dfa.transitions[0][0].phi);
+
+  rt::DfaslTable table;
+  REQUIRE(rt::toTable(dfa, table));
+  for (uint32_t v = 0; v < (1u << atoms); ++v) {
+    rt::Names names(atoms, v);
+    Match expected = evalBool(e, names) ? Match_Ok : Match_Failed;
+    CHECK(evalRtDfaslTable(table, { names }) == expected);
+  }
+}
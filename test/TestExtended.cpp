@@ -2,10 +2,13 @@
 #include "ast/Parser.hpp"
 #include "nfasl/Nfasl.hpp"
 #include "nfasl/BisimNfasl.hpp"
+#include "nfasl/Dfasl.hpp"
+#include "rt/RtDfaslTable.hpp"
 
 #include "test/Tools.hpp"
 #include "test/Letter.hpp"
 #include "test/GenLetter.hpp"
+#include "test/GenNfasl.hpp"
 #include "test/EvalRt.hpp"
 #include "test/EvalNfasl.hpp"
 
@@ -90,3 +93,72 @@ TEST_CASE("Nfasl Extended") {
     }
   }
 }
+
+/**
+ * Extended match as seen by separate DFASL runs,
+ * one run is started before every event
+ */
+static
+ExtendedMatch evalExtendedRuns(const rt::Dfasl& dfasl, const Word& word) {
+  ExtendedMatch match;
+  size_t horizon = 0;
+  for (size_t sz = 0; sz <= word.size(); ++sz) {
+    size_t longest = 0;
+    size_t shortest = rt::RtContexts::NoValue;
+    bool advanced = false;
+    for (size_t start = 0; start <= sz; ++start) {
+      Word run(word.begin() + start, word.begin() + sz);
+      Match r = evalRtDfasl(dfasl, run);
+      if (r != Match_Failed && run.size() > 0) {
+        advanced = true;
+        horizon = std::max(horizon, run.size());
+      }
+      if (r == Match_Ok) {
+        longest = std::max(longest, run.size());
+        shortest = std::min(shortest, run.size());
+      }
+    }
+    if (!advanced) {
+      horizon = 0;
+    }
+    if (dfasl.finals.empty()) {
+      match.match = Match_Failed;
+    } else if (shortest != rt::RtContexts::NoValue) {
+      match.match = Match_Ok;
+      match.ok.longest = longest;
+      match.ok.shortest = shortest;
+      match.ok.horizon = horizon;
+    } else {
+      match.match = Match_Partial;
+      match.partial.horizon = horizon;
+    }
+  }
+  return match;
+}
+
+TEST_CASE("Dfasl Extended") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 6;
+  constexpr size_t maxTrs = 3;
+
+  auto expr0 = GENERATE(Catch2::take(50, genNfasl(depth, atoms, states, maxTrs)));
+  auto word0 = GENERATE(Catch2::take(5, genWord(atoms, 0, 10)));
+
+  nfasl::Nfasl cleaned;
+  nfasl::clean(*expr0, cleaned);
+  dfasl::Dfasl dfa;
+  dfasl::toDfasl(cleaned, dfa);
+  rt::Dfasl rtDfasl;
+  dfasl::toRt(dfa, rtDfasl);
+  rt::DfaslTable table;
+  REQUIRE(rt::toTable(rtDfasl, table));
+
+  for (size_t sz = 0; sz <= word0.size(); ++sz) {
+    Word word(word0.begin(), word0.begin() + sz);
+    ExtendedMatch match = evalExtendedRuns(rtDfasl, word);
+
+    CHECK(match == evalExtendedRtDfasl(rtDfasl, word));
+    CHECK(match == evalExtendedRtDfaslTable(table, word));
+  }
+}
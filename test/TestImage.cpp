@@ -0,0 +1,218 @@
+#include "catch2/catch.hpp"
+
+#include "test/Tools.hpp"
+#include "test/GenNfasl.hpp"
+#include "test/GenLetter.hpp"
+#include "test/EvalRt.hpp"
+#include "test/EvalNfasl.hpp"
+#include "test/Letter.hpp"
+
+#include "nfasl/BisimNfasl.hpp"
+#include "nfasl/Dfasl.hpp"
+#include "rt/RtImage.hpp"
+#include "boolean/Expr.hpp"
+
+using namespace nfasl;
+using namespace dfasl;
+
+static std::vector<std::string> atomicNames(size_t count) {
+  std::vector<std::string> names;
+  for (size_t ix = 0; ix < count; ++ix) {
+    names.push_back("a" + std::to_string(ix));
+  }
+  return names;
+}
+
+static std::shared_ptr<const rt::Image> openImage(const std::vector<uint8_t>& data) {
+  return std::make_shared<const rt::Image>(rt::Image::copy(data.data(), data.size()),
+                                           data.size());
+}
+
+static void checkBatch(rt::Executor& executor, const Word& word, size_t atomicCount) {
+  size_t stride = std::max<size_t>(1, (atomicCount + 7) / 8);
+  std::vector<uint8_t> rows(word.size()*stride, 0);
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    for (size_t a = 0; a < atomicCount; ++a) {
+      if (word[ix].test(a)) {
+        rows[ix*stride + a/8] |= 1 << (a % 8);
+      }
+    }
+  }
+  std::vector<Match> results(word.size());
+  executor.reset();
+  executor.advanceBatch({ rows.data(), stride, word.size(), atomicCount }, results.data());
+  executor.reset();
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    executor.advance(word[ix]);
+    CHECK(results[ix] == executor.getResult());
+  }
+}
+
+TEST_CASE("RtImage, Nfasl") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t maxTrs = 3;
+
+  auto states = GENERATE(as<size_t>(), 4, 100);
+  auto expr0 = GENERATE_COPY(Catch2::take(30, genNfasl(depth, atoms, states, maxTrs)));
+  auto word0 = GENERATE(Catch2::take(5, genWord(atoms, 0, 10)));
+
+  rt::Nfasl rtNfasl;
+  toRt(*expr0, rtNfasl);
+
+  std::vector<uint8_t> data;
+  rt::writeImage(rtNfasl, atomicNames(atoms), data);
+  CHECK(data.size() % rt::imageAlignment == 0);
+  auto image = openImage(data);
+  CHECK(image->kind() == rt::Image_Nfasl);
+  CHECK(std::string(image->atomicName(atoms - 1)) == "a2");
+
+  Match r0 = evalRtNfasl(rtNfasl, word0);
+  rt::ImageNfaslContext context(image);
+  CHECK(evalRt(std::make_shared<rt::ImageNfaslContext>(image), word0) == r0);
+  CHECK(evalRtNfasl(*rt::toNfasl(image), word0) == r0);
+  checkBatch(context, word0, atoms);
+}
+
+TEST_CASE("RtImage, Dfasl") {
+  constexpr size_t atoms = 4;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 4;
+  constexpr size_t maxTrs = 3;
+
+  auto dense = GENERATE(false, true);
+  auto expr0 = GENERATE(Catch2::take(50, genNfasl(depth, atoms, states, maxTrs)));
+  auto word0 = GENERATE(Catch2::take(5, genWord(atoms, 0, 5)));
+
+  Nfasl cleaned;
+  clean(*expr0, cleaned);
+  Dfasl dfa;
+  toDfasl(cleaned, dfa);
+  rt::Dfasl rtDfasl;
+  toRt(dfa, rtDfasl);
+  rt::DfaslTable table;
+  REQUIRE(rt::toTable(rtDfasl, table));
+
+  std::vector<uint8_t> data;
+  rt::writeImage(rtDfasl, dense ? &table : nullptr, atomicNames(atoms), data);
+  auto image = openImage(data);
+  CHECK(image->hasTable() == dense);
+
+  Match r0 = evalRtDfasl(rtDfasl, word0);
+  rt::ImageDfaslContext context(image);
+  CHECK(evalRt(std::make_shared<rt::ImageDfaslContext>(image), word0) == r0);
+  CHECK(evalRtDfasl(*rt::toDfasl(image), word0) == r0);
+  if (dense) {
+    CHECK(evalRtDfaslTable(*rt::toDfaslTable(image), word0) == r0);
+  } else {
+    CHECK(!rt::toDfaslTable(image));
+  }
+  checkBatch(context, word0, atoms);
+}
+
+TEST_CASE("RtImage, in place") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 4;
+  constexpr size_t maxTrs = 3;
+
+  auto expr0 = GENERATE(Catch2::take(30, genNfasl(depth, atoms, states, maxTrs)));
+  auto word0 = GENERATE(Catch2::take(3, genWord(atoms, 0, 5)));
+
+  Nfasl cleaned;
+  clean(*expr0, cleaned);
+  rt::Nfasl rtNfasl;
+  toRt(cleaned, rtNfasl);
+  Dfasl dfa;
+  toDfasl(cleaned, dfa);
+  rt::Dfasl rtDfasl;
+  toRt(dfa, rtDfasl);
+  rt::DfaslTable table;
+  REQUIRE(rt::toTable(rtDfasl, table));
+
+  std::vector<uint8_t> nfaslData, dfaslData;
+  rt::writeImage(rtNfasl, atomicNames(atoms), nfaslData);
+  rt::writeImage(rtDfasl, &table, atomicNames(atoms), dfaslData);
+  auto nfaslImage = openImage(nfaslData);
+  auto dfaslImage = openImage(dfaslData);
+  auto within = [](const rt::Image& image, const void* p) {
+    auto u = reinterpret_cast<const uint8_t*>(p);
+    return u >= image.data() && u < image.data() + image.size();
+  };
+
+  auto nfasl = rt::toNfasl(nfaslImage);
+  auto dfaslTable = rt::toDfaslTable(dfaslImage);
+  REQUIRE(dfaslTable);
+  for (size_t ix = 0; ix < nfasl->predicates.size(); ++ix) {
+    CHECK(within(*nfaslImage, nfasl->predicates[ix].code));
+  }
+  CHECK(dfaslTable->table.begin() == dfaslImage->getTable());
+  CHECK(dfaslTable->table.size() == table.table.size());
+
+  // the automata keep their images alive
+  const rt::Image* image = dfaslImage.get();
+  nfaslImage.reset();
+  dfaslImage.reset();
+  CHECK(dfaslTable->table.begin() == image->getTable());
+
+  CHECK(evalRtNfasl(*nfasl, word0) == evalRtNfasl(rtNfasl, word0));
+  CHECK(evalExtendedRtNfasl(*nfasl, word0) == evalExtendedRtNfasl(rtNfasl, word0));
+  CHECK(evalRtDfaslTable(*dfaslTable, word0) == evalRtDfaslTable(table, word0));
+  CHECK(evalExtendedRtDfaslTable(*dfaslTable, word0) == evalExtendedRtDfaslTable(table, word0));
+
+  // a copy of the table shares the cells, an owned table does not
+  rt::DfaslTable copied = *dfaslTable;
+  CHECK(copied.table.begin() == dfaslTable->table.begin());
+  rt::DfaslTable owned = table;
+  CHECK(owned.table.begin() != table.table.begin());
+  CHECK(evalRtDfaslTable(owned, word0) == evalRtDfaslTable(table, word0));
+}
+
+TEST_CASE("RtImage, corrupted") {
+  rt::Nfasl a;
+  a.atomicCount = 2;
+  a.stateCount = 2;
+  a.initials.resize(a.stateCount);
+  a.finals.resize(a.stateCount);
+  a.transitions.resize(a.stateCount);
+  a.initials.set(0);
+  a.finals.set(1);
+  rt::Program prog;
+  boolean::toRtProgram(boolean::Expr::var(0) && !boolean::Expr::var(1), prog);
+  a.transitions[0].push_back({ {}, 1, a.predicates.intern(prog) });
+
+  std::vector<uint8_t> data;
+  rt::writeImage(a, atomicNames(2), data);
+  CHECK_NOTHROW(openImage(data));
+
+  // any damaged byte is detected
+  for (size_t ix = 0; ix < data.size(); ++ix) {
+    std::vector<uint8_t> broken = data;
+    broken[ix] ^= 0x5a;
+    CHECK_THROWS_AS(openImage(broken), rt::LoadingFailed);
+  }
+
+  std::vector<uint8_t> truncated(data.begin(), data.end() - rt::imageAlignment);
+  CHECK_THROWS_AS(openImage(truncated), rt::LoadingFailed);
+
+  // the checksum is right, but the program jumps backwards
+  auto storage = rt::Image::copy(data.data(), data.size());
+  rt::ProgramView view = rt::Image(storage, data.size()).getPredicates()[0];
+  size_t offset = reinterpret_cast<const uint8_t*>(view.code) - storage.get();
+
+  std::vector<uint8_t> unsafe = data;
+  rt::ImageHeader header;
+  memcpy(&header, unsafe.data(), sizeof(header));
+  rt::Program::Word* code = reinterpret_cast<rt::Program::Word*>(unsafe.data() + offset);
+  size_t at = 0;
+  for (; at < view.codeSize; ++at) {
+    if ((code[at] & 0xff) == rt::Program::JumpIfFalse) {
+      break;
+    }
+  }
+  REQUIRE(at < view.codeSize);
+  code[at] = rt::Program::encode(rt::Program::JumpIfFalse, 0);
+  header.checksum = rt::fingerprint(unsafe.data() + 16, unsafe.size() - 16);
+  memcpy(unsafe.data(), &header, sizeof(header));
+  CHECK_THROWS_AS(openImage(unsafe), rt::LoadingFailed);
+}
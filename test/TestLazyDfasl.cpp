@@ -0,0 +1,88 @@
+#include "catch2/catch.hpp"
+
+#include "test/Tools.hpp"
+#include "test/GenNfasl.hpp"
+#include "test/GenLetter.hpp"
+#include "test/EvalRt.hpp"
+#include "test/Letter.hpp"
+
+#include "nfasl/BisimNfasl.hpp"
+#include "rt/RtLazyDfasl.hpp"
+#include "boolean/Expr.hpp"
+
+using namespace nfasl;
+
+static void checkLazyDfasl(const Nfasl& a, const Word& word, size_t cacheSize) {
+  auto rtNfasl = std::make_shared<rt::Nfasl>();
+  toRt(a, *rtNfasl);
+
+  rt::LazyDfaslContext lazy(rtNfasl, cacheSize);
+
+  // the second pass runs over cached transitions
+  for (size_t pass = 0; pass < 2; ++pass) {
+    lazy.reset();
+    for (size_t ix = 0; ix < word.size(); ++ix) {
+      Word prefix(word.begin(), word.begin() + ix + 1);
+      lazy.advance(word[ix]);
+      CHECK(lazy.getResult() == evalRtNfasl(*rtNfasl, prefix));
+    }
+  }
+}
+
+TEST_CASE("RtLazyDfasl") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t maxTrs = 3;
+
+  auto states = GENERATE(as<size_t>(), 4, 100);
+  auto cacheSize = GENERATE(as<size_t>(), 0, rt::defaultLazyCacheSize);
+  auto expr0 = GENERATE_COPY(Catch2::take(30, genNfasl(depth, atoms, states, maxTrs)));
+  auto word0 = GENERATE(Catch2::take(5, genWord(atoms, 0, 10)));
+
+  checkLazyDfasl(*expr0, word0, cacheSize);
+}
+
+TEST_CASE("RtLazyDfasl, flush") {
+  // a chain of states, every step reaches a new set of states
+  constexpr size_t length = 10;
+  auto a = std::make_shared<rt::Nfasl>();
+  a->atomicCount = 1;
+  a->stateCount = length;
+  a->initials.resize(a->stateCount);
+  a->finals.resize(a->stateCount);
+  a->transitions.resize(a->stateCount);
+  a->initials.set(0);
+  a->finals.set(length - 1);
+  rt::Program any;
+  boolean::toRtProgram(boolean::Expr::value(true), any);
+  for (size_t q = 0; q + 1 < length; ++q) {
+    a->transitions[q].push_back({ {}, rt::State(q + 1), a->predicates.intern(any) });
+  }
+
+  // the smallest cache does not fit the chain
+  rt::LazyDfaslContext lazy(a, 0);
+  rt::NfaslContext nfasl(a);
+  rt::Names vars(1);
+  for (size_t pass = 0; pass < 2; ++pass) {
+    lazy.reset();
+    nfasl.reset();
+    for (size_t ix = 0; ix <= length; ++ix) {
+      CHECK(lazy.getResult() == nfasl.getResult());
+      lazy.advance(vars);
+      nfasl.advance(vars);
+    }
+    CHECK(lazy.getResult() == Match_Failed);
+  }
+  CHECK(lazy.flushes() > 0);
+}
+
+TEST_CASE("RtLazyDfasl, limits") {
+  auto a = std::make_shared<rt::Nfasl>();
+  a->atomicCount = rt::maxLazyAtomics + 1;
+  a->stateCount = 1;
+  a->initials.resize(a->stateCount);
+  a->finals.resize(a->stateCount);
+  a->transitions.resize(a->stateCount);
+
+  CHECK(rt::createLazyDfaslContext(a) == nullptr);
+}
@@ -0,0 +1,140 @@
+#include "catch2/catch.hpp"
+
+#include "test/Tools.hpp"
+#include "test/GenNfasl.hpp"
+#include "test/GenLetter.hpp"
+#include "test/Letter.hpp"
+
+#include "nfasl/Nfasl.hpp"
+#include "rt/RtNfasl.hpp"
+#include "rt/RtMatcher.hpp"
+
+#include <tuple>
+
+typedef std::tuple<size_t, uint64_t, uint64_t> Found;
+
+/** Events [start, end) of `word` match (anchored run) */
+static bool matches(const std::shared_ptr<rt::Nfasl>& nfasl, const Word& word,
+                    size_t start, size_t end) {
+  rt::NfaslContext context(nfasl);
+  for (size_t ix = start; ix < end; ++ix) {
+    context.advance(word[ix]);
+  }
+  return context.getResult() == Match_Ok;
+}
+
+/** Matches of a rule by definition of a mode */
+static std::vector<Found> expected(const std::shared_ptr<rt::Nfasl>& nfasl, const Word& word,
+                                   rt::MatchMode mode) {
+  size_t n = word.size();
+  std::vector<std::vector<bool>> m(n + 1, std::vector<bool>(n + 1, false));
+  for (size_t s = 0; s < n; ++s) {
+    for (size_t e = s + 1; e <= n; ++e) {
+      m[s][e] = matches(nfasl, word, s, e);
+    }
+  }
+  std::vector<Found> r;
+  size_t last = 0;
+  if (mode == rt::MatchMode_LeftmostLongest) {
+    for (size_t s = 0; s < n; ++s) {
+      for (size_t e = n; e > s; --e) {
+        if (s >= last && m[s][e]) {
+          r.push_back({ 0, s, e });
+          last = e;
+          break;
+        }
+      }
+    }
+    return r;
+  }
+  for (size_t e = 1; e <= n; ++e) {
+    for (size_t s = mode == rt::MatchMode_All ? 0 : last; s < e; ++s) {
+      if (m[s][e]) {
+        r.push_back({ 0, s, e });
+        last = e;
+        break;
+      }
+    }
+  }
+  return r;
+}
+
+TEST_CASE("rt::Matcher") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 5;
+  constexpr size_t maxTrs = 3;
+
+  auto expr0 = GENERATE(Catch2::take(100, genNfasl(depth, atoms, states, maxTrs)));
+  auto word = GENERATE(Catch2::take(3, genWord(atoms, 0, 40)));
+  auto mode = GENERATE(rt::MatchMode_All, rt::MatchMode_LeftmostLongest, rt::MatchMode_NonOverlapping);
+
+  auto nfasl = std::make_shared<rt::Nfasl>();
+  nfasl::toRt(*expr0, *nfasl);
+  // empty matches are not reported by the reference
+  if ((nfasl->initials & nfasl->finals).any()) {
+    return;
+  }
+  auto reference = expected(nfasl, word, mode);
+
+  std::vector<Found> found;
+  rt::Matcher matcher(mode, [&](size_t rule, uint64_t start, uint64_t end) {
+    found.push_back({ rule, start, end });
+  });
+  auto factory = [nfasl]() { return std::make_shared<rt::NfaslExtendedContext>(nfasl); };
+  matcher.add(factory, { 0, 1, 2 });
+
+  SECTION("advance") {
+    for (auto& letter : word) {
+      matcher.advance(letter);
+    }
+    matcher.flush();
+    CHECK(matcher.offset() == word.size());
+    CHECK(found == reference);
+  }
+
+  SECTION("batch") {
+    std::vector<uint8_t> rows(word.size(), 0);
+    for (size_t ix = 0; ix < word.size(); ++ix) {
+      for (size_t a = 0; a < atoms; ++a) {
+        rows[ix] |= word[ix].test(a) << a;
+      }
+    }
+    // batches are split anywhere
+    size_t split = std::min<size_t>(word.size(), 7);
+    matcher.advanceBatch({ rows.data(), 1, split, atoms });
+    matcher.advanceBatch({ rows.data() + split, 1, word.size() - split, atoms });
+    matcher.flush();
+    CHECK(found == reference);
+  }
+
+  SECTION("atomics") {
+    // the rule reads atomics of the stream in reverse order
+    rt::Matcher mapped(mode, [&](size_t rule, uint64_t start, uint64_t end) {
+      found.push_back({ rule, start, end });
+    });
+    mapped.add(factory, { 2, 1, 0 });
+    std::vector<uint8_t> rows(word.size(), 0);
+    for (size_t ix = 0; ix < word.size(); ++ix) {
+      for (size_t a = 0; a < atoms; ++a) {
+        rows[ix] |= word[ix].test(a) << (atoms - 1 - a);
+      }
+    }
+    mapped.advanceBatch({ rows.data(), 1, word.size(), atoms });
+    mapped.flush();
+    CHECK(found == reference);
+  }
+
+  SECTION("reset") {
+    for (auto& letter : word) {
+      matcher.advance(letter);
+    }
+    matcher.reset();
+    found.clear();
+    for (auto& letter : word) {
+      matcher.advance(letter);
+    }
+    matcher.flush();
+    CHECK(found == reference);
+  }
+}
@@ -26,7 +26,8 @@ TEST_CASE("Nfasl") {
     2,  // state count
     s0, // initial
     { s1 }, // finals
-    { { r00 }, { r10 } } // transitions
+    { { r00 }, { r10 } }, // transitions
+    {} // counters
   };
 
   CHECK(evalNfasl(a, {}) == Match_Partial);
@@ -55,7 +56,8 @@ TEST_CASE("Nfasl, minimal") {
       {},
       { r34 },
       {}
-    } // transitions
+    }, // transitions
+    {} // counters
   };
 
   Nfasl b;
@@ -0,0 +1,129 @@
+#include "catch2/catch.hpp"
+
+#include "test/GenBoolExpr.hpp"
+#include "test/GenNfasl.hpp"
+#include "test/GenLetter.hpp"
+#include "test/EvalRt.hpp"
+
+#include "test/Tools.hpp"
+#include "test/Letter.hpp"
+
+#include "nfasl/BisimNfasl.hpp"
+#include "rt/RtNfaslBits.hpp"
+
+using namespace nfasl;
+
+static void checkNfaslBits(const Nfasl& a, const Word& word) {
+  rt::Nfasl rtNfasl;
+  toRt(a, rtNfasl);
+
+  rt::ExecutorPtr exec = rt::createNfaslBitsContext(rtNfasl);
+  REQUIRE(exec != nullptr);
+
+  Match r0 = evalRtNfasl(rtNfasl, word);
+  Match r1 = evalRt(exec, word);
+
+  CHECK(r0 == r1);
+}
+
+TEST_CASE("RtNfasl bit-parallel") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t maxTrs = 3;
+
+  auto states = GENERATE(as<size_t>(), 4, 100, 200);
+  auto expr0 = GENERATE_COPY(Catch2::take(30, genNfasl(depth, atoms, states, maxTrs)));
+  auto word0 = GENERATE(Catch2::take(5, genWord(atoms, 0, 5)));
+
+  checkNfaslBits(*expr0, word0);
+}
+
+TEST_CASE("RtNfasl bit-parallel, limits") {
+  rt::Nfasl a;
+  a.atomicCount = 1;
+  a.stateCount = rt::maxNfaslBitsStates + 1;
+  a.initials.resize(a.stateCount);
+  a.finals.resize(a.stateCount);
+  a.transitions.resize(a.stateCount);
+
+  CHECK(rt::createNfaslBitsContext(a) == nullptr);
+}
+
+TEST_CASE("RtNfasl bit-parallel, wide events") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 4;
+  constexpr size_t maxTrs = 3;
+
+  // events are inline in one, four words or `Names`
+  auto atomicCount = GENERATE(as<size_t>(), 3, 100, 300);
+  auto expr0 = GENERATE(Catch2::take(30, genNfasl(depth, atoms, states, maxTrs)));
+
+  rt::Nfasl rtNfasl;
+  toRt(*expr0, rtNfasl);
+  rtNfasl.atomicCount = atomicCount;
+
+  rt::ExecutorPtr exec = rt::createNfaslBitsContext(rtNfasl);
+  REQUIRE(exec != nullptr);
+
+  // unused atomics are set too
+  Word word(5);
+  for (auto& letter : word) {
+    LetterGenerator::make(atomicCount, letter);
+  }
+  CHECK(evalRtNfasl(rtNfasl, word) == evalRt(exec, word));
+}
+
+TEST_CASE("RtNfasl bit-parallel, packed rows") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 4;
+  constexpr size_t maxTrs = 3;
+  constexpr size_t length = 10;
+
+  // events are inline in one or four words, batches are sliced from 4 events
+  auto atomicCount = GENERATE(as<size_t>(), 3, 100);
+  auto chunk = GENERATE(as<size_t>(), 1, 3, 4, 10);
+  auto expr0 = GENERATE(Catch2::take(30, genNfasl(depth, atoms, states, maxTrs)));
+
+  rt::Nfasl rtNfasl;
+  toRt(*expr0, rtNfasl);
+  rtNfasl.atomicCount = atomicCount;
+
+  // bits past `atomicCount` in the last byte of a row are ignored
+  size_t stride = (atomicCount + 7) / 8 + 1;
+  Word word(length);
+  std::vector<uint8_t> rows(length*stride, 0);
+  for (size_t ix = 0; ix < length; ++ix) {
+    LetterGenerator::make(atomicCount, word[ix]);
+    uint8_t* row = rows.data() + ix*stride;
+    for (size_t a = 0; a < atomicCount; ++a) {
+      row[a / 8] |= word[ix].test(a) << (a % 8);
+    }
+    for (size_t a = atomicCount; a < stride*8; ++a) {
+      row[a / 8] |= 1 << (a % 8);
+    }
+  }
+  rt::Events events{ rows.data(), stride, length, atomicCount };
+
+  rt::AtomBits<4> packed, unpacked;
+  packed.assign(events, events.row(0));
+  unpacked.assign(word[0]);
+  CHECK(packed.words == unpacked.words);
+
+  rt::ExecutorPtr single = rt::createNfaslBitsContext(rtNfasl);
+  rt::ExecutorPtr batch = rt::createNfaslBitsContext(rtNfasl);
+  REQUIRE(single != nullptr);
+  REQUIRE(batch != nullptr);
+
+  std::vector<Match> expected(length), results(length);
+  for (size_t ix = 0; ix < length; ++ix) {
+    single->advance(word[ix]);
+    expected[ix] = single->getResult();
+  }
+  for (size_t begin = 0; begin < length; begin += chunk) {
+    size_t n = std::min(chunk, length - begin);
+    batch->advanceBatch({ events.row(begin), stride, n, atomicCount }, results.data() + begin);
+  }
+  CHECK(results == expected);
+}
@@ -121,3 +121,18 @@ TEST_CASE("Parser Transforms: RANGES") {
 TEST_CASE("Parser Transforms: ABORT") {
   COMPARE_EXPRS("ABORT(!a|b,c)", "(PARTIAL(!a|b) ; c) | (!a|b)");
 }
+
+TEST_CASE("Parser Transforms: WITHIN") {
+  COMPARE_EXPRS("WITHIN(a;b[*];c, 30)", "a;b[*];c");
+  COMPARE_EXPRS("(WITHIN(a;b, 30))", "a;b");
+
+  std::istringstream bounded("WITHIN(a;b, 30)");
+  CHECK(parser::parse(bounded).within == 30);
+  std::istringstream unbounded("a;b");
+  CHECK(parser::parse(unbounded).within == 0);
+  // a time window bounds the whole match only
+  std::istringstream nested("a;WITHIN(b, 30)");
+  CHECK_THROWS_AS(parser::parse(nested), parser::ParseError);
+  std::istringstream empty("WITHIN(a, 0)");
+  CHECK_THROWS_AS(parser::parse(empty), parser::ParseError);
+}
@@ -0,0 +1,75 @@
+#include "catch2/catch.hpp"
+
+#include "test/Tools.hpp"
+#include "test/GenNfasl.hpp"
+#include "test/GenLetter.hpp"
+#include "test/Letter.hpp"
+
+#include "nfasl/Nfasl.hpp"
+#include "rt/RtNfasl.hpp"
+#include "rt/RtRetention.hpp"
+
+/** Retained payloads are offsets of the latest events */
+static void checkRetained(const rt::EventRetention& retention,
+                          size_t count,
+                          const ExtendedMatch& result) {
+  size_t expected = std::min(count, rt::EventRetention::retained(result));
+  REQUIRE(retention.size() == expected);
+  for (size_t ix = 0; ix < expected; ++ix) {
+    CHECK(retention.data()[ix] == count - expected + ix);
+  }
+}
+
+TEST_CASE("rt::EventRetention") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 6;
+  constexpr size_t maxTrs = 3;
+
+  auto expr0 = GENERATE(Catch2::take(50, genNfasl(depth, atoms, states, maxTrs)));
+  auto word = GENERATE(Catch2::take(5, genWord(atoms, 0, 100)));
+
+  auto rtNfasl = std::make_shared<rt::Nfasl>();
+  nfasl::toRt(*expr0, *rtNfasl);
+  rt::NfaslExtendedContext context(rtNfasl);
+
+  rt::EventRetention retention;
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    context.advance(word[ix]);
+    const ExtendedMatch& result = context.getResult();
+    retention.append(ix, result);
+    checkRetained(retention, ix + 1, result);
+
+    const rt::EventRetention::Payload* match = nullptr;
+    size_t count = 0;
+    if (result.match == Match_Ok) {
+      REQUIRE(retention.match(result, true, match, count));
+      CHECK(count == result.ok.longest);
+      if (count > 0) {
+        CHECK(match[count - 1] == ix);
+      }
+      REQUIRE(retention.match(result, false, match, count));
+      CHECK(count == result.ok.shortest);
+    } else {
+      CHECK(!retention.match(result, true, match, count));
+    }
+  }
+
+  // a batch keeps the same events as appends one by one
+  std::vector<rt::EventRetention::Payload> payloads(word.size());
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    payloads[ix] = ix;
+  }
+  auto split = GENERATE(as<size_t>(), 0, 1, 30);
+  split = std::min(split, word.size());
+  ExtendedMatch first;
+  first.match = Match_Partial;
+  first.partial.horizon = split;
+  rt::EventRetention batch;
+  batch.append(payloads.data(), split, first);
+  batch.append(payloads.data() + split, word.size() - split, context.getResult());
+  checkRetained(batch, word.size(), context.getResult());
+
+  batch.clear();
+  CHECK(batch.size() == 0);
+}
@@ -0,0 +1,278 @@
+#include "catch2/catch.hpp"
+
+#include "test/Tools.hpp"
+#include "test/GenNfasl.hpp"
+#include "test/GenLetter.hpp"
+#include "test/Letter.hpp"
+#include "test/EvalNfasl.hpp"
+
+#include "nfasl/Nfasl.hpp"
+#include "rt/RtNfasl.hpp"
+#include "rt/RtReverse.hpp"
+
+#include <cstdlib>
+
+static std::vector<uint8_t> packRows(const Word& word, size_t atoms) {
+  std::vector<uint8_t> rows(word.size(), 0);
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    for (size_t a = 0; a < atoms; ++a) {
+      rows[ix] |= word[ix].test(a) << a;
+    }
+  }
+  return rows;
+}
+
+/** The earliest active run after `end` events, by anchored runs */
+static size_t earliest(std::shared_ptr<rt::Nfasl> nfasl, const Word& word, size_t end) {
+  size_t r = 0;
+  for (size_t start = 0; start < end; ++start) {
+    rt::NfaslContext context(nfasl);
+    for (size_t ix = start; ix < end; ++ix) {
+      context.advance(word[ix]);
+    }
+    if (context.getResult() != Match_Failed) {
+      r = std::max(r, end - start);
+    }
+  }
+  return r;
+}
+
+static bool sameMatch(const ExtendedMatch& r0, const ExtendedMatch& r1) {
+  if (r0.match != r1.match) {
+    return false;
+  }
+  return r0.match != Match_Ok
+    || (r0.ok.longest == r1.ok.longest && r0.ok.shortest == r1.ok.shortest);
+}
+
+TEST_CASE("rt::NfaslReverseContext") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 5;
+  constexpr size_t maxTrs = 3;
+
+  auto expr0 = GENERATE(Catch2::take(100, genNfasl(depth, atoms, states, maxTrs)));
+  auto word = GENERATE(Catch2::take(3, genWord(atoms, 0, 60)));
+
+  auto nfasl = std::make_shared<rt::Nfasl>();
+  nfasl::toRt(*expr0, *nfasl);
+  auto reversed = rt::reverse(*nfasl);
+  rt::NfaslExtendedContext forward(nfasl);
+  rt::NfaslReverseContext context(nfasl, reversed);
+  CHECK(sameMatch(context.getResult(), forward.getResult()));
+
+  std::vector<ExtendedMatch> results;
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    forward.advance(word[ix]);
+    context.advance(word[ix]);
+    const ExtendedMatch& r = context.getResult();
+    results.push_back(r);
+    REQUIRE(sameMatch(r, forward.getResult()));
+    // `horizon` is an upper bound of the earliest active run
+    size_t horizon = r.match == Match_Ok ? r.ok.horizon : r.partial.horizon;
+    if (r.match != Match_Failed) {
+      CHECK(horizon >= earliest(nfasl, word, ix + 1));
+    }
+  }
+
+  SECTION("batch") {
+    auto rows = packRows(word, atoms);
+    std::vector<ExtendedMatch> batch(word.size());
+    rt::NfaslReverseContext batched(nfasl, reversed);
+    batched.advanceBatch({ rows.data(), 1, word.size(), atoms }, batch.data());
+    for (size_t ix = 0; ix < word.size(); ++ix) {
+      CHECK(batch[ix] == results[ix]);
+    }
+  }
+
+  SECTION("snapshot") {
+    context.reset();
+    size_t half = word.size() / 2;
+    for (size_t ix = 0; ix < half; ++ix) {
+      context.advance(word[ix]);
+    }
+    std::vector<uint8_t> data;
+    rt::SnapshotWriter writer(data);
+    context.save(writer);
+    rt::NfaslReverseContext restored(nfasl, reversed);
+    rt::SnapshotReader reader(data.data(), data.size());
+    restored.restore(reader);
+    CHECK(reader.atEnd());
+    for (size_t ix = half; ix < word.size(); ++ix) {
+      restored.advance(word[ix]);
+      CHECK(restored.getResult() == results[ix]);
+    }
+
+    // retained events are a part of the snapshot
+    if (!data.empty()) {
+      data.pop_back();
+      rt::SnapshotReader truncated(data.data(), data.size());
+      CHECK_THROWS_AS(restored.restore(truncated), rt::RestoreFailed);
+    }
+  }
+}
+
+TEST_CASE("rt::NfaslReverseContext, time window") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 5;
+  constexpr size_t maxTrs = 3;
+
+  auto expr0 = GENERATE(Catch2::take(50, genNfasl(depth, atoms, states, maxTrs)));
+  auto word = GENERATE(Catch2::take(3, genWord(atoms, 0, 30)));
+  auto window = GENERATE(as<rt::Timestamp>(), 1, 3, 10);
+
+  auto nfasl = std::make_shared<rt::Nfasl>();
+  nfasl::toRt(*expr0, *nfasl);
+  nfasl->window = window;
+  rt::NfaslExtendedContext forward(nfasl);
+  rt::NfaslReverseContext context(nfasl, rt::reverse(*nfasl));
+
+  rt::Timestamp t = 1000;
+  std::vector<rt::Timestamp> times;
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    t += std::rand() % 4;
+    times.push_back(t);
+    forward.advanceAt(word[ix], t);
+    context.advanceAt(word[ix], t);
+    const ExtendedMatch& r = context.getResult();
+    REQUIRE(r.match == forward.getResult().match);
+    if (r.match != Match_Ok) {
+      continue;
+    }
+    CHECK(r.ok.shortest == forward.getResult().ok.shortest);
+    // the longest match is exact, see `RtClock::prune`
+    CHECK(r.ok.longest >= forward.getResult().ok.longest);
+    size_t start = ix + 1 - r.ok.longest;
+    CHECK((r.ok.longest == 0 || t - times[start] <= window));
+    rt::NfaslContext anchored(nfasl);
+    for (size_t k = start; k <= ix; ++k) {
+      anchored.advance(word[k]);
+    }
+    CHECK(anchored.getResult() == Match_Ok);
+  }
+}
+
+TEST_CASE("rt::NfaslReverseContext, horizon") {
+  // a0;a1 over a0,a1,a0,a1...: a run is always active, but none is long
+  nfasl::Nfasl a0a1 = nfasl::concat(nfasl::phi(boolean::Expr::var(0)),
+                                    nfasl::phi(boolean::Expr::var(1)));
+  auto nfasl = std::make_shared<rt::Nfasl>();
+  nfasl::toRt(a0a1, *nfasl);
+  rt::NfaslReverseContext context(nfasl, rt::reverse(*nfasl));
+
+  rt::Names letter;
+  letter.resize(2);
+  for (size_t ix = 0; ix < 1000; ++ix) {
+    letter.reset();
+    letter.set(ix % 2);
+    context.advance(letter);
+    const ExtendedMatch& r = context.getResult();
+    if (ix % 2) {
+      REQUIRE(r.match == Match_Ok);
+      CHECK(r.ok.longest == 2);
+      CHECK(r.ok.shortest == 2);
+      CHECK(r.ok.horizon <= 2*2 + rt::NfaslReverseContext::minSettle);
+    } else {
+      REQUIRE(r.match == Match_Partial);
+      CHECK(r.partial.horizon <= 2*2 + rt::NfaslReverseContext::minSettle);
+    }
+  }
+
+  // the match of (a0;a1)[+] grows with the stream, so all of it is retained
+  auto plus = std::make_shared<rt::Nfasl>();
+  nfasl::toRt(nfasl::kleenePlus(a0a1), *plus);
+  rt::NfaslReverseContext longest(plus, rt::reverse(*plus));
+  for (size_t ix = 0; ix < 1000; ++ix) {
+    letter.reset();
+    letter.set(ix % 2);
+    longest.advance(letter);
+    if (ix % 2) {
+      REQUIRE(longest.getResult().match == Match_Ok);
+      CHECK(longest.getResult().ok.longest == ix + 1);
+      CHECK(longest.getResult().ok.shortest == 2);
+    }
+  }
+}
+
+TEST_CASE("rt::NfaslReverseContext, retention limit") {
+  constexpr size_t limit = 64;
+  // a0 ; true[*] ; a1: after the first a0 a run is always active
+  nfasl::Nfasl a = nfasl::concat(nfasl::concat(nfasl::phi(boolean::Expr::var(0)),
+                                               nfasl::kleeneStar(nfasl::phi(boolean::Expr::value(true)))),
+                                 nfasl::phi(boolean::Expr::var(1)));
+  auto nfasl = std::make_shared<rt::Nfasl>();
+  nfasl::toRt(a, *nfasl);
+  rt::NfaslReverseContext context(nfasl, rt::reverse(*nfasl), limit);
+
+  rt::Names letter;
+  letter.resize(2);
+  size_t latest = 0; /** the latest a0 */
+  for (size_t ix = 0; ix < 100000; ++ix) {
+    letter.reset();
+    letter.set(ix == 0 ? 0 : std::rand() % 2);
+    context.advance(letter);
+    REQUIRE(context.retainedCount() <= limit);
+    const ExtendedMatch& r = context.getResult();
+    if (ix > 0 && letter.test(1)) {
+      REQUIRE(r.match == Match_Ok);
+      // the first a0 is not retained, but the length is known by `horizon`
+      CHECK(r.ok.longest == ix + 1);
+      if (ix - latest + 1 <= limit) {
+        CHECK(r.ok.shortest == ix - latest + 1);
+      }
+    } else {
+      REQUIRE(r.match == Match_Partial);
+    }
+    if (letter.test(0)) {
+      latest = ix;
+    }
+  }
+
+  // so is a snapshot
+  std::vector<uint8_t> data;
+  rt::SnapshotWriter writer(data);
+  context.save(writer);
+  CHECK(data.size() < 2*limit + 256);
+  rt::NfaslReverseContext restored(nfasl, rt::reverse(*nfasl), limit / 2);
+  rt::SnapshotReader reader(data.data(), data.size());
+  restored.restore(reader);
+  CHECK(restored.retainedCount() == limit / 2);
+}
+
+TEST_CASE("rt::NfaslReverseContext, retention limit, matches") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 5;
+  constexpr size_t maxTrs = 3;
+  constexpr size_t limit = 4;
+
+  auto expr0 = GENERATE(Catch2::take(100, genNfasl(depth, atoms, states, maxTrs)));
+  auto word = GENERATE(Catch2::take(3, genWord(atoms, 0, 60)));
+
+  auto nfasl = std::make_shared<rt::Nfasl>();
+  nfasl::toRt(*expr0, *nfasl);
+  rt::NfaslExtendedContext forward(nfasl);
+  rt::NfaslReverseContext context(nfasl, rt::reverse(*nfasl), limit);
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    forward.advance(word[ix]);
+    context.advance(word[ix]);
+    const ExtendedMatch& r = context.getResult();
+    const ExtendedMatch& f = forward.getResult();
+    REQUIRE(r.match == f.match);
+    CHECK(context.retainedCount() <= limit);
+    if (r.match != Match_Ok) {
+      continue;
+    }
+    // lengths within retained events are exact, `horizon` bounds longer ones
+    CHECK(r.ok.longest >= f.ok.longest);
+    if (r.ok.longest <= limit) {
+      CHECK(r.ok.longest == f.ok.longest);
+    }
+    if (f.ok.shortest <= limit) {
+      CHECK(r.ok.shortest == f.ok.shortest);
+    } else {
+      CHECK(r.ok.shortest >= f.ok.shortest);
+    }
+  }
+}
@@ -0,0 +1,208 @@
+#include "catch2/catch.hpp"
+
+#include "test/GenBoolExpr.hpp"
+#include "test/GenNfasl.hpp"
+#include "test/GenLetter.hpp"
+#include "test/EvalRt.hpp"
+
+#include "test/Tools.hpp"
+#include "test/Letter.hpp"
+
+#include "nfasl/BisimNfasl.hpp"
+#include "nfasl/Dfasl.hpp"
+#include "rt/RtKeyed.hpp"
+#include "boolean/Expr.hpp"
+
+#include <map>
+
+using namespace nfasl;
+
+static void checkKeyed(rt::KeyedExecutorPtr keyed,
+                       std::function<rt::ExecutorPtr()> factory,
+                       const Word& word) {
+  constexpr size_t keys = 5;
+  std::map<rt::MonitorKey, rt::ExecutorPtr> executors;
+
+  CHECK(keyed->getInitialResult() == factory()->getResult());
+
+  // interleave instances: key of the `ix`-th event is `ix % keys`
+  for (size_t ix = 0; ix < word.size() * keys; ++ix) {
+    rt::MonitorKey key = (ix % keys) * 1000003;
+    auto& exec = executors[key];
+    if (!exec) {
+      exec = factory();
+    }
+    const Letter& letter = word[ix / keys];
+    exec->advance(letter);
+    CHECK(keyed->advance(key, letter) == exec->getResult());
+  }
+
+  CHECK(keyed->size() == executors.size());
+  size_t visited = 0;
+  keyed->forEach([&executors, &visited](rt::MonitorKey key, Match r) {
+      CHECK(executors.at(key)->getResult() == r);
+      ++visited;
+    });
+  CHECK(visited == executors.size());
+}
+
+TEST_CASE("RtKeyed") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 4;
+  constexpr size_t maxTrs = 3;
+
+  auto expr0 = GENERATE(Catch2::take(30, genNfasl(depth, atoms, states, maxTrs)));
+  auto word0 = GENERATE(Catch2::take(5, genWord(atoms, 0, 5)));
+
+  auto rtNfasl = std::make_shared<rt::Nfasl>();
+  toRt(*expr0, *rtNfasl);
+  rt::KeyedExecutorPtr keyedNfasl = rt::createKeyedExecutor(*rtNfasl);
+  REQUIRE(keyedNfasl != nullptr);
+  checkKeyed(keyedNfasl,
+             [rtNfasl]() { return std::make_shared<rt::NfaslContext>(rtNfasl); },
+             word0);
+
+  Nfasl cleaned;
+  clean(*expr0, cleaned);
+  dfasl::Dfasl dfa;
+  dfasl::toDfasl(cleaned, dfa);
+  auto rtDfasl = std::make_shared<rt::Dfasl>();
+  dfasl::toRt(dfa, *rtDfasl);
+  auto table = std::make_shared<rt::DfaslTable>();
+  REQUIRE(rt::toTable(*rtDfasl, *table));
+  checkKeyed(rt::createKeyedExecutor(table),
+             [rtDfasl]() { return std::make_shared<rt::DfaslContext>(rtDfasl); },
+             word0);
+}
+
+TEST_CASE("RtKeyed, erase") {
+  constexpr size_t keys = 10000;
+
+  rt::Nfasl a;
+  a.atomicCount = 1;
+  a.stateCount = 1;
+  a.initials.resize(a.stateCount);
+  a.finals.resize(a.stateCount);
+  a.initials.set(0);
+  a.finals.set(0);
+  a.transitions.resize(a.stateCount);
+
+  rt::KeyedExecutorPtr keyed = rt::createKeyedExecutor(a);
+  REQUIRE(keyed != nullptr);
+
+  rt::Names vars(1);
+  for (rt::MonitorKey key = 0; key < keys; ++key) {
+    CHECK(keyed->advance(key, vars) == Match_Failed);
+  }
+  CHECK(keyed->size() == keys);
+  for (rt::MonitorKey key = 0; key < keys; key += 2) {
+    CHECK(keyed->erase(key));
+  }
+  CHECK(!keyed->erase(0));
+  CHECK(keyed->size() == keys / 2);
+  for (rt::MonitorKey key = 0; key < keys; ++key) {
+    CHECK(keyed->contains(key) == (key % 2 == 1));
+    CHECK(keyed->getResult(key) == (key % 2 ? Match_Failed : Match_Ok));
+  }
+}
+
+TEST_CASE("RtKeyed, expiry") {
+  // a single atomic, matches `x0 ; x0`
+  rt::Nfasl a;
+  a.atomicCount = 1;
+  a.stateCount = 3;
+  a.initials.resize(a.stateCount);
+  a.finals.resize(a.stateCount);
+  a.initials.set(0);
+  a.finals.set(2);
+  a.transitions.resize(a.stateCount);
+  rt::StateTransition tr;
+  boolean::toRtPredicate(boolean::Expr::var(0), tr.phi);
+  tr.pred = a.predicates.intern(tr.phi);
+  tr.state = 1;
+  a.transitions[0].push_back(tr);
+  tr.state = 2;
+  a.transitions[1].push_back(tr);
+
+  rt::KeyedExecutorPtr keyed = rt::createKeyedExecutor(a);
+  REQUIRE(keyed != nullptr);
+  keyed->setExpiry(10, false);
+
+  rt::Names vars(1);
+  vars.set(0);
+  for (rt::MonitorKey key = 0; key < 1000; ++key) {
+    keyed->tick(key);
+    CHECK(keyed->advance(key, vars) == Match_Partial);
+  }
+  // instances advanced at [990, 1000) are alive
+  CHECK(keyed->size() == 10);
+  for (rt::MonitorKey key = 990; key < 1000; ++key) {
+    CHECK(keyed->contains(key));
+  }
+
+  keyed->advance(990, vars);
+  std::vector<rt::MonitorKey> expired;
+  CHECK(keyed->tick(1005, [&expired](rt::MonitorKey key, Match r) {
+        CHECK(r == Match_Partial);
+        expired.push_back(key);
+      }) == 5);
+  CHECK(expired.size() == 5);
+  CHECK(keyed->contains(990));
+  CHECK(keyed->getResult(990) == Match_Ok);
+  CHECK(keyed->tick(2000) == 5);
+  CHECK(keyed->size() == 0);
+
+  // initial state is kept by `!x0`
+  boolean::toRtPredicate(!boolean::Expr::var(0), tr.phi);
+  tr.pred = a.predicates.intern(tr.phi);
+  tr.state = 0;
+  a.transitions[0].push_back(tr);
+
+  keyed = rt::createKeyedExecutor(a);
+  keyed->setExpiry(0, true);
+  CHECK(keyed->advance(1, vars) == Match_Partial);
+  CHECK(keyed->contains(1));
+  vars.reset();
+  CHECK(keyed->advance(2, vars) == Match_Partial);
+  CHECK(!keyed->contains(2));
+  CHECK(keyed->size() == 1);
+}
+
+TEST_CASE("RtKeyed, snapshot") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 4;
+  constexpr size_t maxTrs = 3;
+
+  auto expr0 = GENERATE(Catch2::take(30, genNfasl(depth, atoms, states, maxTrs)));
+  auto word0 = GENERATE(Catch2::take(5, genWord(atoms, 0, 5)));
+
+  rt::Nfasl rtNfasl;
+  toRt(*expr0, rtNfasl);
+  rt::KeyedExecutorPtr keyed = rt::createKeyedExecutor(rtNfasl);
+  rt::KeyedExecutorPtr restored = rt::createKeyedExecutor(rtNfasl);
+  REQUIRE(keyed != nullptr);
+
+  for (size_t ix = 0; ix < word0.size(); ++ix) {
+    for (rt::MonitorKey key = 0; key <= ix; ++key) {
+      keyed->advance(key, word0[ix]);
+    }
+  }
+
+  std::vector<uint8_t> data;
+  rt::SnapshotWriter writer(data);
+  keyed->save(writer);
+
+  rt::SnapshotReader broken(data.data(), data.size() - 1);
+  CHECK_THROWS_AS(restored->restore(broken), rt::RestoreFailed);
+  CHECK(restored->size() == 0);
+
+  rt::SnapshotReader reader(data.data(), data.size());
+  restored->restore(reader);
+  CHECK(restored->size() == keyed->size());
+  keyed->forEach([&restored](rt::MonitorKey key, Match r) {
+      CHECK(restored->contains(key));
+      CHECK(restored->getResult(key) == r);
+    });
+}
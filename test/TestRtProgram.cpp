@@ -0,0 +1,158 @@
+#include "catch2/catch.hpp"
+
+#include "test/GenExpr.hpp"
+#include "test/EvalExpr.hpp"
+#include "test/GenLetter.hpp"
+
+#include "test/Letter.hpp"
+
+#include "rt/RtPredicate.hpp"
+#include "rt/RtProgram.hpp"
+#include "rt/RtPredicatePool.hpp"
+
+TEST_CASE("rt::Program") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 6;
+
+  auto expr = GENERATE(Catch2::take(1000, genExpr(depth, atoms)));
+  auto letter = GENERATE(Catch2::take(16, genLetter(atoms)));
+
+  std::vector<uint8_t> phi;
+  boolean::toRtPredicate(expr, phi);
+
+  rt::Program prog0, prog1;
+  boolean::toRtProgram(expr, prog0);
+  rt::compile(phi, prog1);
+
+  bool r0 = evalBool(expr, letter);
+  bool r1 = rt::eval(letter, &phi[0], phi.size());
+  bool r2 = prog0.eval(letter);
+  bool r3 = prog1.eval(letter);
+
+  CHECK(r0 == r1);
+  CHECK(r0 == r2);
+  CHECK(r0 == r3);
+  CHECK(prog0.entries.size() <= rt::Program::MaxSlots);
+}
+
+TEST_CASE("rt::Program, sharing") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 24;
+
+  // every level doubles the tree
+  boolean::Expr x = boolean::Expr::var(0);
+  boolean::Expr y = boolean::Expr::var(1);
+  boolean::Expr z = boolean::Expr::var(2);
+  boolean::Expr e = z;
+  for (size_t d = 0; d < depth; ++d) {
+    e = (e && x) || (!e && y);
+  }
+
+  rt::Program prog;
+  boolean::toRtProgram(e, prog);
+
+  CHECK(prog.code.size() < 16*depth);
+  CHECK(prog.entries.size() == depth - 1); // innermost `e` is a variable
+
+  // bytecode and JSON refer to shared subterms too
+  std::vector<uint8_t> phi;
+  boolean::toRtPredicate(e, phi);
+  CHECK(phi.size() < 32*depth);
+  rt::Program compiled;
+  rt::compile(phi, compiled);
+  CHECK(compiled.entries.size() == depth - 1);
+
+  json j = e;
+  CHECK(j["kind"] == "dag");
+  CHECK(j.dump().size() < 256*depth);
+  boolean::Expr loaded;
+  boolean::from_json(j, loaded);
+  CHECK(loaded == e);
+
+  for (uint32_t v = 0; v < (1u << atoms); ++v) {
+    rt::Names names(atoms, v);
+    CHECK(prog.eval(names) == evalBool(e, names));
+    CHECK(compiled.eval(names) == evalBool(e, names));
+    CHECK(rt::eval(names, &phi[0], phi.size()) == evalBool(e, names));
+  }
+}
+
+TEST_CASE("rt::Program, many shared subterms") {
+  constexpr size_t atoms = 3;
+
+  // more shared subterms than `Program::MaxSlots`, none of them is inlined
+  auto depth = GENERATE(size_t(60), size_t(76), size_t(200));
+
+  boolean::Expr x = boolean::Expr::var(0);
+  boolean::Expr y = boolean::Expr::var(1);
+  boolean::Expr z = boolean::Expr::var(2);
+  boolean::Expr e = z;
+  for (size_t d = 0; d < depth; ++d) {
+    e = (e && x) || (!e && y);
+  }
+
+  rt::Program prog;
+  boolean::toRtProgram(e, prog);
+  CHECK(prog.code.size() < 16*depth);
+  CHECK(prog.entries.size() == depth - 1);
+
+  std::vector<uint8_t> phi;
+  boolean::toRtPredicate(e, phi);
+  rt::Program compiled;
+  rt::compile(phi, compiled);
+  CHECK(compiled.code.size() < 16*depth);
+  CHECK(compiled.entries.size() == depth - 1);
+
+  rt::ProgramView view{ prog.code.data(), prog.code.size(),
+                        prog.entries.data(), prog.entries.size() };
+  CHECK(rt::verify(view, atoms));
+
+  for (uint32_t v = 0; v < (1u << atoms); ++v) {
+    rt::Names names(atoms, v);
+    // every level selects `x` or `y` by the previous one
+    bool r = names.test(2);
+    for (size_t d = 0; d < depth; ++d) {
+      r = r ? names.test(0) : names.test(1);
+    }
+    CHECK(prog.eval(names) == r);
+    CHECK(compiled.eval(names) == r);
+  }
+}
+
+TEST_CASE("rt::Program, JSON") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 6;
+
+  auto expr = GENERATE(Catch2::take(300, genExpr(depth, atoms)));
+
+  json j = expr;
+  boolean::Expr loaded;
+  boolean::from_json(j, loaded);
+  CHECK(loaded == expr);
+}
+
+TEST_CASE("rt::PredicatePool") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 4;
+
+  auto expr = GENERATE(Catch2::take(100, genExpr(depth, atoms)));
+
+  std::vector<uint8_t> phi;
+  boolean::toRtPredicate(expr, phi);
+
+  rt::PredicatePool pool;
+  rt::PredicateIndex ix0 = pool.intern(phi);
+  rt::PredicateIndex ix1 = pool.intern(phi);
+
+  CHECK(ix0 == ix1);
+  CHECK(pool.size() == 1);
+
+  rt::PredicateCache cache;
+  cache.attach(pool);
+  for (uint32_t v = 0; v < (1u << atoms); ++v) {
+    rt::Names names(atoms, v);
+    cache.next(names);
+    CHECK(cache.eval(ix0) == evalBool(expr, names));
+    CHECK(cache.eval(ix0) == evalBool(expr, names));
+  }
+}
@@ -0,0 +1,80 @@
+#include "catch2/catch.hpp"
+
+#include "test/GenBoolExpr.hpp"
+#include "test/GenNfasl.hpp"
+#include "test/GenLetter.hpp"
+#include "test/EvalRt.hpp"
+
+#include "test/Tools.hpp"
+#include "test/Letter.hpp"
+
+#include "nfasl/BisimNfasl.hpp"
+#include "nfasl/Dfasl.hpp"
+#include "rt/RtSet.hpp"
+
+using namespace nfasl;
+
+TEST_CASE("RtSet") {
+  constexpr size_t atoms = 3;
+  constexpr size_t setAtoms = 4;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 4;
+  constexpr size_t maxTrs = 3;
+  constexpr size_t rules = 6;
+
+  auto word0 = GENERATE(Catch2::take(50, genWord(setAtoms, 0, 6)));
+
+  rt::SereSet set;
+  std::vector<rt::SereSet::AtomicMap> maps;
+  std::vector<rt::ExecutorPtr> executors;
+
+  for (size_t k = 0; k < rules; ++k) {
+    Ptr<Nfasl> a = makeNfasl(depth, atoms, states, maxTrs);
+    rt::SereSet::AtomicMap map;
+    for (size_t i = 0; i < atoms; ++i) {
+      map.push_back((i + k) % setAtoms);
+    }
+
+    rt::SereSet::RuleId id;
+    if (k % 2) {
+      Nfasl cleaned;
+      clean(*a, cleaned);
+      dfasl::Dfasl dfa;
+      dfasl::toDfasl(cleaned, dfa);
+      auto rtDfasl = std::make_shared<rt::Dfasl>();
+      dfasl::toRt(dfa, *rtDfasl);
+      id = set.add(*rtDfasl, map);
+      executors.push_back(std::make_shared<rt::DfaslContext>(rtDfasl));
+    } else {
+      auto rtNfasl = std::make_shared<rt::Nfasl>();
+      toRt(*a, *rtNfasl);
+      id = set.add(*rtNfasl, map);
+      executors.push_back(std::make_shared<rt::NfaslContext>(rtNfasl));
+    }
+    CHECK(id == k);
+    maps.push_back(map);
+  }
+
+  for (size_t k = 0; k < rules; ++k) {
+    CHECK(set.getResult(k) == executors[k]->getResult());
+  }
+
+  for (auto const& letter : word0) {
+    set.advance(letter);
+
+    std::vector<rt::SereSet::RuleId> changed;
+    for (size_t k = 0; k < rules; ++k) {
+      rt::Names local(atoms);
+      for (size_t i = 0; i < atoms; ++i) {
+        local.set(i, letter.test(maps[k][i]));
+      }
+      Match before = executors[k]->getResult();
+      executors[k]->advance(local);
+      CHECK(set.getResult(k) == executors[k]->getResult());
+      if (before != executors[k]->getResult()) {
+        changed.push_back(k);
+      }
+    }
+    CHECK(set.getChanged() == changed);
+  }
+}
@@ -0,0 +1,68 @@
+#include "catch2/catch.hpp"
+
+#include "test/Tools.hpp"
+#include "test/GenNfasl.hpp"
+#include "test/GenLetter.hpp"
+#include "test/Letter.hpp"
+
+#include "nfasl/BisimNfasl.hpp"
+#include "nfasl/Dfasl.hpp"
+#include "rt/RtScan.hpp"
+
+using namespace nfasl;
+using namespace dfasl;
+
+TEST_CASE("RtScan") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 6;
+  constexpr size_t maxTrs = 3;
+
+  auto threads = GENERATE(as<size_t>(), 1, 2, 4);
+  auto minChunk = GENERATE(as<size_t>(), 1, 3);
+  auto expr0 = GENERATE(Catch2::take(30, genNfasl(depth, atoms, states, maxTrs)));
+
+  Nfasl cleaned;
+  clean(*expr0, cleaned);
+  Dfasl dfa;
+  toDfasl(cleaned, dfa);
+
+  auto rtDfasl = std::make_shared<rt::Dfasl>();
+  toRt(dfa, *rtDfasl);
+  auto table = std::make_shared<rt::DfaslTable>();
+  REQUIRE(rt::toTable(*rtDfasl, *table));
+
+  // a few words, so some runs fail only in later chunks
+  Word word;
+  auto gen = genWord(atoms, 0, 8);
+  for (size_t n = 0; n < 4; ++n) {
+    gen.next();
+    word.insert(word.end(), gen.get().begin(), gen.get().end());
+  }
+
+  std::vector<uint8_t> data(word.size());
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    for (size_t a = 0; a < atoms; ++a) {
+      data[ix] |= word[ix].test(a) << a;
+    }
+  }
+  rt::Events events{ data.data(), 1, word.size(), atoms };
+
+  std::vector<Match> expected(word.size());
+  rt::DfaslContext ctx(rtDfasl);
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    ctx.advance(word[ix]);
+    expected[ix] = ctx.getResult();
+  }
+  Match last = word.empty() ? rt::DfaslContext(rtDfasl).getResult() : expected.back();
+
+  std::vector<Match> results(word.size());
+  CHECK(rt::scan(*rtDfasl, events, results.data(), threads, minChunk) == last);
+  CHECK(results == expected);
+  CHECK(rt::scan(*rtDfasl, events, nullptr, threads, minChunk) == last);
+
+  std::fill(results.begin(), results.end(), Match_Partial);
+  CHECK(rt::scan(*table, events, results.data(), threads, minChunk) == last);
+  CHECK(results == expected);
+  CHECK(rt::scan(*table, events, nullptr, threads, minChunk) == last);
+}
@@ -0,0 +1,105 @@
+#include "catch2/catch.hpp"
+
+#include "test/Tools.hpp"
+#include "test/GenNfasl.hpp"
+#include "test/GenLetter.hpp"
+#include "test/EvalRt.hpp"
+#include "test/Letter.hpp"
+
+#include "rt/RtScheduler.hpp"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+
+using namespace nfasl;
+
+TEST_CASE("RtScheduler") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 20;
+  constexpr size_t maxTrs = 3;
+  constexpr size_t streams = 50;
+
+  auto threads = GENERATE(as<size_t>(), 1, 4);
+  auto expr0 = GENERATE(Catch2::take(10, genNfasl(depth, atoms, states, maxTrs)));
+
+  auto rtNfasl = std::make_shared<rt::Nfasl>();
+  toRt(*expr0, *rtNfasl);
+
+  // stream 0 is much longer than the others
+  std::vector<Word> words;
+  auto gen = genWord(atoms, 0, 20);
+  for (size_t ix = 0; ix < streams; ++ix) {
+    Word word;
+    for (size_t n = 0; n < (ix == 0 ? 20 : 1); ++n) {
+      gen.next();
+      word.insert(word.end(), gen.get().begin(), gen.get().end());
+    }
+    words.push_back(word);
+  }
+
+  std::mutex mutex;
+  std::map<rt::StreamId, std::vector<Match>> seen;
+  rt::StreamScheduler scheduler
+    ([rtNfasl]() { return std::make_shared<rt::NfaslContext>(rtNfasl); },
+     atoms,
+     [&](rt::StreamId stream, Match result) {
+       std::lock_guard<std::mutex> lock(mutex);
+       seen[stream].push_back(result);
+     },
+     threads);
+  CHECK(scheduler.threads() == threads);
+
+  // events of streams are interleaved
+  for (size_t step = 0; ; ++step) {
+    bool posted = false;
+    for (size_t ix = 0; ix < streams; ++ix) {
+      if (step < words[ix].size()) {
+        scheduler.post(ix, words[ix][step]);
+        posted = true;
+      }
+    }
+    if (!posted) {
+      break;
+    }
+  }
+  scheduler.wait();
+
+  for (size_t ix = 0; ix < streams; ++ix) {
+    const Word& word = words[ix];
+    std::vector<Match> expected;
+    for (size_t n = 1; n <= word.size(); ++n) {
+      expected.push_back(evalRtNfasl(*rtNfasl, Word(word.begin(), word.begin() + n)));
+    }
+    CHECK(seen[ix] == expected);
+    if (!word.empty()) {
+      CHECK(scheduler.getResult(ix) == expected.back());
+    }
+  }
+}
+
+TEST_CASE("RtScheduler, unknown streams") {
+  auto rtNfasl = std::make_shared<rt::Nfasl>();
+  toRt(nfasl::phi(boolean::Expr::var(0)), *rtNfasl);
+
+  std::atomic<size_t> created(0);
+  rt::StreamScheduler scheduler
+    ([rtNfasl, &created]() {
+       ++created;
+       return std::make_shared<rt::NfaslContext>(rtNfasl);
+     },
+     1, rt::StreamScheduler::Visitor(), 2);
+  CHECK(created == 1);
+
+  // a stream without events gets no executor
+  CHECK(scheduler.getResult(7) == Match_Partial);
+  CHECK(scheduler.size() == 0);
+  CHECK(created == 1);
+
+  scheduler.post(1, rt::Names(1, 1));
+  scheduler.wait();
+  CHECK(scheduler.getResult(1) == Match_Ok);
+  CHECK(scheduler.getResult(7) == Match_Partial);
+  CHECK(created == 2);
+}
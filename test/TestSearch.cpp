@@ -0,0 +1,61 @@
+#include "catch2/catch.hpp"
+
+#include "test/Tools.hpp"
+#include "test/GenNfasl.hpp"
+#include "test/GenLetter.hpp"
+#include "test/Letter.hpp"
+
+#include "nfasl/Nfasl.hpp"
+#include "nfasl/Dfasl.hpp"
+#include "rt/RtNfasl.hpp"
+#include "rt/RtDfasl.hpp"
+
+TEST_CASE("Unanchored search") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 4;
+  constexpr size_t maxTrs = 3;
+
+  auto expr0 = GENERATE(Catch2::take(100, genNfasl(depth, atoms, states, maxTrs)));
+  auto word = GENERATE(Catch2::take(3, genWord(atoms, 0, 20)));
+
+  auto nfasl = std::make_shared<rt::Nfasl>();
+  nfasl::toRt(*expr0, *nfasl);
+  auto searchNfasl = std::make_shared<rt::Nfasl>();
+  nfasl::toRt(nfasl::search(*expr0), *searchNfasl);
+  dfasl::Dfasl dfa;
+  REQUIRE(dfasl::toSearchDfasl(*expr0, dfa));
+  auto searchDfasl = std::make_shared<rt::Dfasl>();
+  dfasl::toRt(dfa, *searchDfasl);
+
+  // a run started on every event
+  rt::NfaslExtendedContext extended(nfasl);
+  rt::NfaslContext n(searchNfasl);
+  rt::DfaslContext d(searchDfasl);
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    extended.advance(word[ix]);
+    n.advance(word[ix]);
+    d.advance(word[ix]);
+    bool ok = extended.getResult().match == Match_Ok;
+    CHECK((n.getResult() == Match_Ok) == ok);
+    CHECK((d.getResult() == Match_Ok) == ok);
+    // the search DFASL fails only if nothing matches
+    CHECK((d.getResult() == Match_Failed) == dfa.finals.empty());
+  }
+}
+
+TEST_CASE("Unanchored search, state limit") {
+  // a0 ; true{4}: the latest 5 events are told apart
+  nfasl::Nfasl a = nfasl::phi(boolean::Expr::var(0));
+  for (size_t ix = 0; ix < 4; ++ix) {
+    a = nfasl::concat(a, nfasl::phi(boolean::Expr::value(true)));
+  }
+  dfasl::Dfasl unbounded;
+  REQUIRE(dfasl::toSearchDfasl(a, unbounded));
+  CHECK(unbounded.stateCount == 32);
+
+  dfasl::Dfasl bounded;
+  CHECK(dfasl::toSearchDfasl(a, bounded, 32));
+  dfasl::Dfasl exceeded;
+  CHECK_FALSE(dfasl::toSearchDfasl(a, exceeded, 31));
+}
@@ -0,0 +1,160 @@
+#include "catch2/catch.hpp"
+
+#include "test/GenExpr.hpp"
+#include "test/EvalExpr.hpp"
+#include "test/GenLetter.hpp"
+
+#include "test/Letter.hpp"
+
+#include "rt/RtSliced.hpp"
+#include "rt/RtNfasl.hpp"
+#include "rt/RtNfaslBits.hpp"
+#include "rt/RtDfasl.hpp"
+
+static std::vector<uint8_t> packRows(const std::vector<rt::Names>& word, size_t atoms) {
+  std::vector<uint8_t> rows(word.size(), 0);
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    for (size_t a = 0; a < atoms; ++a) {
+      rows[ix] |= word[ix].test(a) << a;
+    }
+  }
+  return rows;
+}
+
+static std::vector<rt::Names> randomWord(size_t atoms, size_t length) {
+  std::vector<rt::Names> word(length);
+  for (auto& letter : word) {
+    LetterGenerator::make(atoms, letter);
+  }
+  return word;
+}
+
+TEST_CASE("rt::SlicedEvaluator") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 6;
+  constexpr size_t length = 100;
+
+  auto expr = GENERATE(Catch2::take(300, genExpr(depth, atoms)));
+
+  std::vector<uint8_t> phi;
+  boolean::toRtPredicate(expr, phi);
+  rt::Program prog0, prog1;
+  boolean::toRtProgram(expr, prog0);
+  rt::compile(phi, prog1);
+
+  // the last block is not full
+  auto word = randomWord(atoms, length);
+  auto rows = packRows(word, atoms);
+  rt::Events events{ rows.data(), 1, word.size(), atoms };
+
+  rt::SlicedEvaluator evaluator;
+  std::vector<rt::Lanes> columns;
+  for (size_t begin = 0; begin < length; begin += rt::laneCount) {
+    size_t n = rt::transpose(events, begin, columns);
+    CHECK(n == std::min(rt::laneCount, length - begin));
+    rt::Lanes r0 = evaluator.eval(prog0, columns.data());
+    rt::Lanes r1 = evaluator.eval(prog1, columns.data());
+    for (size_t lane = 0; lane < n; ++lane) {
+      bool r = evalBool(expr, word[begin + lane]);
+      CHECK(((r0 >> lane) & 1) == r);
+      CHECK(((r1 >> lane) & 1) == r);
+    }
+  }
+}
+
+TEST_CASE("rt::SlicedEvaluator, sharing") {
+  constexpr size_t atoms = 3;
+  // more subroutines than `Program::MaxSlots` too
+  auto depth = GENERATE(size_t(24), size_t(200));
+
+  boolean::Expr x = boolean::Expr::var(0);
+  boolean::Expr y = boolean::Expr::var(1);
+  boolean::Expr z = boolean::Expr::var(2);
+  boolean::Expr e = z;
+  for (size_t d = 0; d < depth; ++d) {
+    e = (e && x) || (!e && y);
+  }
+
+  rt::Program prog;
+  boolean::toRtProgram(e, prog);
+  REQUIRE(prog.entries.size() > 0);
+
+  // all the letters, so no jump is skipped for all lanes
+  std::vector<rt::Names> word;
+  for (uint32_t v = 0; v < (1u << atoms); ++v) {
+    word.push_back(rt::Names(atoms, v));
+  }
+  auto rows = packRows(word, atoms);
+  std::vector<rt::Lanes> columns;
+  rt::transpose({ rows.data(), 1, word.size(), atoms }, 0, columns);
+
+  rt::SlicedEvaluator evaluator;
+  rt::Lanes r = evaluator.eval(prog, columns.data());
+  for (size_t lane = 0; lane < word.size(); ++lane) {
+    CHECK(((r >> lane) & 1) == prog.eval(word[lane]));
+  }
+}
+
+TEST_CASE("RtSliced, executors") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 4;
+  constexpr size_t length = 150;
+
+  auto expr0 = GENERATE(Catch2::take(30, genExpr(depth, atoms)));
+  auto expr1 = GENERATE(Catch2::take(3, genExpr(depth, atoms)));
+
+  // q0 -expr0-> q1, q1 -expr1-> q1, anything else goes back to q0:
+  // runs never fail, so all the blocks are evaluated
+  std::vector<uint8_t> phi0, phi1, any;
+  boolean::toRtPredicate(expr0, phi0);
+  boolean::toRtPredicate(expr1, phi1);
+  boolean::toRtPredicate(boolean::Expr::value(true), any);
+
+  auto nfasl = std::make_shared<rt::Nfasl>();
+  nfasl->atomicCount = atoms;
+  nfasl->stateCount = 2;
+  nfasl->initials.resize(2);
+  nfasl->initials.set(0);
+  nfasl->finals.resize(2);
+  nfasl->finals.set(1);
+  nfasl->transitions.resize(2);
+  nfasl->transitions[0] = { { phi0, 1, nfasl->predicates.intern(phi0) },
+                            { any, 0, nfasl->predicates.intern(any) } };
+  nfasl->transitions[1] = { { phi1, 1, nfasl->predicates.intern(phi1) },
+                            { any, 0, nfasl->predicates.intern(any) } };
+
+  // first match: the same language
+  auto dfasl = std::make_shared<rt::Dfasl>();
+  dfasl->atomicCount = atoms;
+  dfasl->stateCount = 2;
+  dfasl->initial = 0;
+  dfasl->finals = { 1 };
+  dfasl->transitions.resize(2);
+  dfasl->transitions[0] = { { phi0, 1, dfasl->predicates.intern(phi0) },
+                            { any, 0, dfasl->predicates.intern(any) } };
+  dfasl->transitions[1] = { { phi1, 1, dfasl->predicates.intern(phi1) },
+                            { any, 0, dfasl->predicates.intern(any) } };
+
+  auto word = randomWord(atoms, length);
+  auto rows = packRows(word, atoms);
+  rt::Events events{ rows.data(), 1, word.size(), atoms };
+
+  std::vector<rt::ExecutorPtr> executors = {
+    std::make_shared<rt::NfaslContext>(nfasl),
+    rt::createNfaslBitsContext(*nfasl),
+    std::make_shared<rt::DfaslContext>(dfasl)
+  };
+  for (auto& executor : executors) {
+    REQUIRE(executor != nullptr);
+    std::vector<Match> results(length);
+    executor->advanceBatch(events, results.data());
+    Match last = executor->getResult();
+
+    executor->reset();
+    for (size_t ix = 0; ix < length; ++ix) {
+      executor->advance(word[ix]);
+      CHECK(results[ix] == executor->getResult());
+    }
+    CHECK(last == executor->getResult());
+  }
+}
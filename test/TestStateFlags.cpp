@@ -0,0 +1,275 @@
+#include "catch2/catch.hpp"
+
+#include "test/GenLetter.hpp"
+#include "test/Letter.hpp"
+#include "test/EvalNfasl.hpp"
+
+#include "rt/RtStateFlags.hpp"
+#include "rt/RtNfasl.hpp"
+#include "rt/RtNfaslBits.hpp"
+#include "rt/RtDfasl.hpp"
+#include "rt/RtDfaslTable.hpp"
+#include "rt/RtImage.hpp"
+#include "boolean/Expr.hpp"
+
+static std::vector<uint8_t> predicate(const boolean::Expr& expr) {
+  std::vector<uint8_t> phi;
+  boolean::toRtPredicate(expr, phi);
+  return phi;
+}
+
+static std::vector<uint8_t> packRows(const std::vector<rt::Names>& word, size_t atoms) {
+  std::vector<uint8_t> rows(word.size(), 0);
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    for (size_t a = 0; a < atoms; ++a) {
+      rows[ix] |= word[ix].test(a) << a;
+    }
+  }
+  return rows;
+}
+
+static std::vector<rt::Names> randomWord(size_t atoms, size_t length) {
+  std::vector<rt::Names> word(length);
+  for (auto& letter : word) {
+    LetterGenerator::make(atoms, letter);
+  }
+  return word;
+}
+
+/**
+ * q0 -a-> q1 (final, `true` loop), q0 -b-> q2 (`true` loop),
+ * q0 -c-> q3 (`c` loop), q0 -!a-> q0
+ */
+template <typename Automaton>
+static void build(Automaton& u) {
+  using boolean::Expr;
+  constexpr size_t atoms = 3;
+  auto a = predicate(Expr::var(0));
+  auto b = predicate(Expr::var(1));
+  auto c = predicate(Expr::var(2));
+  auto notA = predicate(!Expr::var(0));
+  auto any = predicate(Expr::value(true));
+  u.atomicCount = atoms;
+  u.stateCount = 4;
+  u.transitions.resize(4);
+  u.transitions[0] = { { a, 1, u.predicates.intern(a) },
+                       { b, 2, u.predicates.intern(b) },
+                       { c, 3, u.predicates.intern(c) },
+                       { notA, 0, u.predicates.intern(notA) } };
+  u.transitions[1] = { { any, 1, u.predicates.intern(any) } };
+  u.transitions[2] = { { any, 2, u.predicates.intern(any) } };
+  u.transitions[3] = { { c, 3, u.predicates.intern(c) } };
+}
+
+static std::shared_ptr<rt::Nfasl> makeNfasl() {
+  auto nfasl = std::make_shared<rt::Nfasl>();
+  build(*nfasl);
+  nfasl->initials.resize(4);
+  nfasl->initials.set(0);
+  nfasl->finals.resize(4);
+  nfasl->finals.set(1);
+  nfasl->flags = rt::stateFlags(*nfasl);
+  return nfasl;
+}
+
+/** First match: q0 goes to q1 on `a`, to q2 on `b` and so on */
+static std::shared_ptr<rt::Dfasl> makeDfasl() {
+  auto dfasl = std::make_shared<rt::Dfasl>();
+  build(*dfasl);
+  dfasl->initial = 0;
+  dfasl->finals = { 1 };
+  dfasl->flags = rt::stateFlags(*dfasl);
+  return dfasl;
+}
+
+TEST_CASE("rt::stateFlags") {
+  constexpr uint8_t dead = rt::State_Dead;
+  constexpr uint8_t absorbing = rt::State_Absorbing;
+
+  auto nfasl = makeNfasl();
+  CHECK(nfasl->flags == rt::StateFlags{ 0, absorbing, dead | absorbing, dead });
+
+  auto dfasl = makeDfasl();
+  CHECK(dfasl->flags == rt::StateFlags{ 0, absorbing, dead | absorbing, dead });
+
+  // the sink is the last state
+  rt::DfaslTable table;
+  REQUIRE(rt::toTable(*dfasl, table));
+  CHECK(table.flags == rt::StateFlags{ 0, absorbing, dead | absorbing, dead,
+                                       dead | absorbing });
+
+  // rules past a `true` one never match
+  auto b = predicate(boolean::Expr::var(1));
+  auto any = predicate(boolean::Expr::value(true));
+  dfasl->transitions[1] = { { any, 1, dfasl->predicates.intern(any) },
+                            { b, 0, dfasl->predicates.intern(b) } };
+  dfasl->transitions[2] = { { b, 0, dfasl->predicates.intern(b) },
+                            { any, 2, dfasl->predicates.intern(any) } };
+  CHECK(rt::stateFlags(*dfasl) == rt::StateFlags{ 0, absorbing, 0, dead });
+}
+
+TEST_CASE("RtStateFlags, absorbing runs") {
+  constexpr size_t atoms = 3;
+  constexpr size_t length = 200;
+
+  auto nfasl = makeNfasl();
+  auto dfasl = makeDfasl();
+  auto table = std::make_shared<rt::DfaslTable>();
+  REQUIRE(rt::toTable(*dfasl, *table));
+
+  std::vector<uint8_t> nfaslData, dfaslData;
+  rt::writeImage(*nfasl, { "a", "b", "c" }, nfaslData);
+  rt::writeImage(*dfasl, table.get(), { "a", "b", "c" }, dfaslData);
+  auto nfaslImage = std::make_shared<const rt::Image>(
+    rt::Image::copy(nfaslData.data(), nfaslData.size()), nfaslData.size());
+  auto dfaslImage = std::make_shared<const rt::Image>(
+    rt::Image::copy(dfaslData.data(), dfaslData.size()), dfaslData.size());
+  for (rt::Image::State q = 0; q < 4; ++q) {
+    CHECK(nfaslImage->stateFlags(q) == nfasl->flags[q]);
+    CHECK(dfaslImage->stateFlags(q) == table->flags[q]);
+  }
+  CHECK(rt::toNfasl(nfaslImage)->flags == nfasl->flags);
+  CHECK(rt::toDfasl(dfaslImage)->flags == dfasl->flags);
+  CHECK(rt::toDfaslTable(dfaslImage)->flags == table->flags);
+
+  // `a` is rare, most runs stay in q0 or q3 for a while
+  auto word = randomWord(atoms, length);
+  auto prefix = GENERATE(as<size_t>(), 0, 1, 5, 70, 150);
+  for (size_t ix = 0; ix < length; ++ix) {
+    word[ix].reset(0);
+    word[ix].reset(1);
+  }
+  word[prefix].set(prefix % 2);
+  auto rows = packRows(word, atoms);
+  rt::Events events{ rows.data(), 1, word.size(), atoms };
+
+  std::vector<rt::ExecutorPtr> executors = {
+    std::make_shared<rt::NfaslContext>(nfasl),
+    rt::createNfaslBitsContext(*nfasl),
+    std::make_shared<rt::DfaslContext>(dfasl),
+    std::make_shared<rt::DfaslTableContext>(table),
+    std::make_shared<rt::ImageNfaslContext>(nfaslImage),
+    std::make_shared<rt::ImageDfaslContext>(dfaslImage)
+  };
+  for (auto& executor : executors) {
+    REQUIRE(executor != nullptr);
+    std::vector<Match> results(length);
+    executor->advanceBatch(events, results.data());
+    Match last = executor->getResult();
+
+    executor->reset();
+    for (size_t ix = 0; ix < length; ++ix) {
+      executor->advance(word[ix]);
+      CHECK(results[ix] == executor->getResult());
+    }
+    CHECK(last == executor->getResult());
+  }
+}
+
+TEST_CASE("RtStateFlags, dead states") {
+  constexpr size_t atoms = 3;
+
+  auto dfasl = makeDfasl();
+  auto table = std::make_shared<rt::DfaslTable>();
+  REQUIRE(rt::toTable(*dfasl, *table));
+  std::vector<uint8_t> data;
+  rt::writeImage(*dfasl, table.get(), { "a", "b", "c" }, data);
+  auto image = std::make_shared<const rt::Image>(rt::Image::copy(data.data(), data.size()),
+                                                 data.size());
+
+  // q0 goes to the dead q2 on `b` and to the dead q3 on `c`
+  auto letter = GENERATE(as<uint32_t>(), 2, 4);
+  std::vector<rt::ExecutorPtr> executors = {
+    std::make_shared<rt::DfaslContext>(dfasl),
+    std::make_shared<rt::DfaslTableContext>(table),
+    std::make_shared<rt::ImageDfaslContext>(image)
+  };
+  for (auto& executor : executors) {
+    CHECK(executor->getResult() == Match_Partial);
+    executor->advance(rt::Names(atoms, letter));
+    // no continuation matches, not even `a`
+    CHECK(executor->getResult() == Match_Failed);
+    executor->advance(rt::Names(atoms, 1));
+    CHECK(executor->getResult() == Match_Failed);
+  }
+
+  // a live state marked as dead is rejected
+  size_t at = 0;
+  const uint8_t flags[] = { 0, rt::State_Absorbing, rt::State_Dead | rt::State_Absorbing,
+                            rt::State_Dead };
+  while (at < data.size() && memcmp(data.data() + at, flags, sizeof(flags)) != 0) {
+    at += rt::imageAlignment;
+  }
+  REQUIRE(at < data.size());
+  data[at] |= rt::State_Dead;
+  rt::ImageHeader header;
+  memcpy(&header, data.data(), sizeof(header));
+  header.checksum = rt::fingerprint(data.data() + 16, data.size() - 16);
+  memcpy(data.data(), &header, sizeof(header));
+  CHECK_THROWS_AS(rt::Image(rt::Image::copy(data.data(), data.size()), data.size()),
+                  rt::LoadingFailed);
+}
+
+TEST_CASE("RtStateFlags, quiescent extended runs") {
+  using boolean::Expr;
+  constexpr size_t atoms = 3;
+  constexpr size_t length = 300;
+
+  // a run starts on the rare `a && b`, lasts while `c` and matches at `!c`
+  auto start = predicate(Expr::var(0) && Expr::var(1));
+  auto c = predicate(Expr::var(2));
+  auto notC = predicate(!Expr::var(2));
+  auto nfasl = std::make_shared<rt::Nfasl>();
+  nfasl->atomicCount = atoms;
+  nfasl->stateCount = 3;
+  nfasl->initials.resize(3);
+  nfasl->initials.set(0);
+  nfasl->finals.resize(3);
+  nfasl->finals.set(2);
+  nfasl->transitions.resize(3);
+  nfasl->transitions[0] = { { start, 1, nfasl->predicates.intern(start) } };
+  nfasl->transitions[1] = { { c, 1, nfasl->predicates.intern(c) },
+                            { notC, 2, nfasl->predicates.intern(notC) } };
+  nfasl->flags = rt::stateFlags(*nfasl);
+
+  auto dfasl = std::make_shared<rt::Dfasl>();
+  dfasl->atomicCount = atoms;
+  dfasl->stateCount = 3;
+  dfasl->initial = 0;
+  dfasl->finals = { 2 };
+  dfasl->transitions.resize(3);
+  dfasl->transitions[0] = { { start, 1, dfasl->predicates.intern(start) } };
+  dfasl->transitions[1] = { { c, 1, dfasl->predicates.intern(c) },
+                            { notC, 2, dfasl->predicates.intern(notC) } };
+  dfasl->flags = rt::stateFlags(*dfasl);
+  auto table = std::make_shared<rt::DfaslTable>();
+  REQUIRE(rt::toTable(*dfasl, *table));
+
+  auto word = randomWord(atoms, length);
+  auto gap = GENERATE(as<size_t>(), 1, 20, 64, 100, 1000);
+  for (size_t ix = 0; ix < length; ++ix) {
+    if (ix % gap != gap / 2) {
+      word[ix].reset(0);
+    }
+  }
+  auto rows = packRows(word, atoms);
+  rt::Events events{ rows.data(), 1, word.size(), atoms };
+
+  std::vector<std::shared_ptr<rt::ExtendedExecutor>> executors = {
+    std::make_shared<rt::NfaslExtendedContext>(nfasl),
+    std::make_shared<rt::DfaslExtendedContext>(dfasl),
+    std::make_shared<rt::DfaslTableExtendedContext>(table)
+  };
+  for (auto& executor : executors) {
+    std::vector<ExtendedMatch> results(length);
+    executor->advanceBatch(events, results.data());
+    ExtendedMatch last = executor->getResult();
+
+    executor->reset();
+    for (size_t ix = 0; ix < length; ++ix) {
+      executor->advance(word[ix]);
+      CHECK(results[ix] == executor->getResult());
+    }
+    CHECK(last == executor->getResult());
+  }
+}
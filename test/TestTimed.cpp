@@ -0,0 +1,189 @@
+#include "catch2/catch.hpp"
+
+#include "test/Tools.hpp"
+#include "test/GenNfasl.hpp"
+#include "test/GenLetter.hpp"
+#include "test/Letter.hpp"
+#include "test/EvalNfasl.hpp"
+
+#include "nfasl/Nfasl.hpp"
+#include "nfasl/BisimNfasl.hpp"
+#include "nfasl/Dfasl.hpp"
+#include "rt/RtClock.hpp"
+#include "rt/RtNfasl.hpp"
+#include "rt/RtDfasl.hpp"
+#include "rt/RtDfaslTable.hpp"
+#include "rt/RtImage.hpp"
+
+#include <cstdlib>
+
+/** Events [start, end) of `word` match (anchored run of `Anchored`) */
+template <typename Anchored, typename Automaton>
+static bool matches(const Automaton& automaton, const Word& word,
+                    size_t start, size_t end) {
+  Anchored context(automaton);
+  for (size_t ix = start; ix < end; ++ix) {
+    context.advance(word[ix]);
+  }
+  return context.getResult() == Match_Ok;
+}
+
+/** Non-decreasing times of events */
+static std::vector<rt::Timestamp> makeTimes(size_t count) {
+  std::vector<rt::Timestamp> times(count);
+  rt::Timestamp t = 1000;
+  for (auto& time : times) {
+    t += std::rand() % 4;
+    time = t;
+  }
+  return times;
+}
+
+/**
+ * Check a result after `end` events by definition
+ *
+ * Matches and the shortest one are exact, the longest one
+ * is a match within the window, see `RtClock::prune`.
+ */
+template <typename Anchored, typename Automaton>
+static void checkResult(const Automaton& automaton,
+                        const Word& word,
+                        const std::vector<rt::Timestamp>& times,
+                        rt::Timestamp window,
+                        size_t end,
+                        const ExtendedMatch& result) {
+  auto valid = [&](size_t start) {
+    return (start == end || times[end - 1] - times[start] <= window)
+      && matches<Anchored>(automaton, word, start, end);
+  };
+  bool found = false;
+  size_t shortest = 0;
+  for (size_t start = 0; start <= end; ++start) {
+    if (valid(start)) {
+      found = true;
+      shortest = end - start;
+    }
+  }
+  if (!found) {
+    CHECK(result.match != Match_Ok);
+    return;
+  }
+  REQUIRE(result.match == Match_Ok);
+  CHECK(result.ok.shortest == shortest);
+  CHECK(result.ok.longest >= shortest);
+  CHECK(result.ok.longest <= end);
+  CHECK(valid(end - result.ok.longest));
+}
+
+template <typename Ctx, typename Anchored, typename Automaton>
+static void checkExtended(Automaton automaton,
+                          const Word& word,
+                          const std::vector<rt::Timestamp>& times,
+                          rt::Timestamp window) {
+  automaton->window = window;
+  Ctx context(automaton);
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    context.advanceAt(word[ix], times[ix]);
+    checkResult<Anchored>(automaton, word, times, window, ix + 1, context.getResult());
+  }
+
+  // a snapshot keeps times of runs
+  context.reset();
+  size_t half = word.size() / 2;
+  for (size_t ix = 0; ix < half; ++ix) {
+    context.advanceAt(word[ix], times[ix]);
+  }
+  std::vector<uint8_t> data;
+  rt::SnapshotWriter writer(data);
+  context.save(writer);
+  Ctx restored(automaton);
+  rt::SnapshotReader reader(data.data(), data.size());
+  restored.restore(reader);
+  for (size_t ix = half; ix < word.size(); ++ix) {
+    restored.advanceAt(word[ix], times[ix]);
+    context.advanceAt(word[ix], times[ix]);
+    CHECK(restored.getResult() == context.getResult());
+  }
+}
+
+TEST_CASE("rt::RtClock, extended") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 5;
+  constexpr size_t maxTrs = 3;
+
+  auto expr0 = GENERATE(Catch2::take(50, genNfasl(depth, atoms, states, maxTrs)));
+  auto word = GENERATE(Catch2::take(3, genWord(atoms, 0, 30)));
+  auto window = GENERATE(as<rt::Timestamp>(), 1, 3, 10);
+  auto times = makeTimes(word.size());
+
+  auto nfasl = std::make_shared<rt::Nfasl>();
+  nfasl::toRt(*expr0, *nfasl);
+
+  nfasl::Nfasl cleaned;
+  nfasl::clean(*expr0, cleaned);
+  dfasl::Dfasl dfa;
+  dfasl::toDfasl(cleaned, dfa);
+  auto rtDfasl = std::make_shared<rt::Dfasl>();
+  dfasl::toRt(dfa, *rtDfasl);
+  auto table = std::make_shared<rt::DfaslTable>();
+  REQUIRE(rt::toTable(*rtDfasl, *table));
+
+  SECTION("Nfasl") {
+    checkExtended<rt::NfaslExtendedContext, rt::NfaslContext>(nfasl, word, times, window);
+  }
+  SECTION("Dfasl") {
+    checkExtended<rt::DfaslExtendedContext, rt::DfaslContext>(rtDfasl, word, times, window);
+  }
+  SECTION("DfaslTable") {
+    checkExtended<rt::DfaslTableExtendedContext, rt::DfaslTableContext>(table, word, times, window);
+  }
+}
+
+TEST_CASE("rt::TimedContext") {
+  constexpr size_t atoms = 3;
+  constexpr size_t depth = 3;
+  constexpr size_t states = 5;
+  constexpr size_t maxTrs = 3;
+
+  auto expr0 = GENERATE(Catch2::take(50, genNfasl(depth, atoms, states, maxTrs)));
+  auto word = GENERATE(Catch2::take(3, genWord(atoms, 0, 30)));
+  auto window = GENERATE(as<rt::Timestamp>(), 1, 10);
+  auto times = makeTimes(word.size());
+
+  auto nfasl = std::make_shared<rt::Nfasl>();
+  nfasl::toRt(*expr0, *nfasl);
+  rt::NfaslContext untimed(nfasl);
+  rt::TimedContext timed(std::make_shared<rt::NfaslContext>(nfasl), window);
+
+  for (size_t ix = 0; ix < word.size(); ++ix) {
+    untimed.advance(word[ix]);
+    timed.advanceAt(word[ix], times[ix]);
+    if (times[ix] - times[0] <= window) {
+      CHECK(timed.getResult() == untimed.getResult());
+    } else {
+      CHECK(timed.getResult() == Match_Failed);
+    }
+  }
+
+  // events without time happen at the time of the previous one
+  timed.reset();
+  for (auto& letter : word) {
+    timed.advance(letter);
+  }
+  CHECK(timed.getResult() == untimed.getResult());
+}
+
+TEST_CASE("rt::RtClock, image") {
+  constexpr size_t atoms = 3;
+  auto expr0 = makeNfasl(3, atoms, 5, 3);
+  rt::Nfasl nfasl;
+  nfasl::toRt(*expr0, nfasl);
+  nfasl.window = 30;
+
+  std::vector<uint8_t> data;
+  rt::writeImage(nfasl, { "a0", "a1", "a2" }, data);
+  auto image = std::make_shared<const rt::Image>(rt::Image::copy(data.data(), data.size()), data.size());
+  CHECK(image->window() == 30);
+  CHECK(rt::toNfasl(image)->window == 30);
+}
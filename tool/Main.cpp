@@ -15,6 +15,8 @@ int main(int, char*[]) {
        SERE_TARGET_DFASL,
        SERE_FORMAT_JSON,
        0,
+       0,
+       0,
        0 };
 
   struct sere_compiled compiled;